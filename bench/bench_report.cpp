@@ -0,0 +1,64 @@
+#include "bench_report.hpp"
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace rendy::bench {
+
+auto Report::WriteJson(const std::filesystem::path &path) const -> bool {
+  auto metrics = nlohmann::json::object();
+  for (const auto &metric : _metrics) {
+    metrics[metric.name] = {
+        {"value", metric.value}, {"unit", metric.unit}, {"higher_is_better", metric.higher_is_better}};
+  }
+  const nlohmann::json json = {{"device", _device}, {"driver", _driver}, {"metrics", metrics}};
+
+  std::ofstream file(path);
+  file << json.dump(2) << '\n';
+  if (!file) {
+    spdlog::error("Failed to write benchmark results to {}", path.string());
+    return false;
+  }
+  spdlog::info("Wrote benchmark results to {}", path.string());
+  return true;
+}
+
+auto Report::Compare(const std::filesystem::path &baseline_path, double threshold) const
+    -> std::optional<std::vector<Comparison>> {
+  std::ifstream file(baseline_path);
+  const auto baseline = nlohmann::json::parse(file, nullptr, false);
+  if (!file || baseline.is_discarded() || !baseline.contains("metrics")) {
+    spdlog::error("Failed to read benchmark baseline {}", baseline_path.string());
+    return std::nullopt;
+  }
+  // Numbers from another GPU or driver aren't comparable, but the check still runs so CI notices the mismatch
+  if (const auto device = baseline.value("device", std::string{}); device != _device) {
+    spdlog::warn("Baseline {} was measured on {}, this run is on {}", baseline_path.string(), device, _device);
+  } else if (const auto driver = baseline.value("driver", std::string{}); driver != _driver) {
+    spdlog::warn("Baseline {} was measured with driver {}, this run uses {}", baseline_path.string(), driver, _driver);
+  }
+
+  const auto &baseline_metrics = baseline["metrics"];
+  std::vector<Comparison> comparisons;
+  for (const auto &metric : _metrics) {
+    const auto it = baseline_metrics.find(metric.name);
+    if (it == baseline_metrics.end()) {
+      spdlog::info("{} is not in the baseline yet", metric.name);
+      continue;
+    }
+    Comparison comparison{.name = metric.name,
+                          .unit = metric.unit,
+                          .baseline = it->value("value", 0.0),
+                          .value = metric.value,
+                          .threshold = it->value("threshold", threshold)};
+    if (comparison.baseline > 0.0) {
+      const auto ratio = metric.value / comparison.baseline;
+      comparison.change = metric.higher_is_better ? 1.0 - ratio : ratio - 1.0;
+    }
+    comparison.regressed = comparison.change > comparison.threshold;
+    comparisons.push_back(std::move(comparison));
+  }
+  return comparisons;
+}
+
+} // namespace rendy::bench
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rendy::bench {
+
+struct Metric {
+  std::string name;
+  double value{0.0};
+  std::string unit;
+  bool higher_is_better{true};
+};
+
+// One metric measured now against the same metric in a baseline
+struct Comparison {
+  std::string name;
+  std::string unit;
+  double baseline{0.0};
+  double value{0.0};
+  double change{0.0};    // Relative change in the direction that is worse, e.g. 0.2 for 20% slower
+  double threshold{0.0}; // Largest change that still passes
+  bool regressed{false};
+};
+
+// Results of one benchmark run. The JSON it writes doubles as a baseline: copy a results file of a trusted build into
+// bench/baselines and add a "threshold" to any metric that needs a looser or tighter limit than the default.
+class Report {
+  std::string _device;
+  std::string _driver;
+  std::vector<Metric> _metrics;
+
+public:
+  Report(std::string device, std::string driver) : _device(std::move(device)), _driver(std::move(driver)) {}
+
+  void Add(Metric metric) { _metrics.push_back(std::move(metric)); }
+  [[nodiscard]] auto GetMetrics() const -> const std::vector<Metric> & { return _metrics; }
+
+  [[nodiscard]] auto WriteJson(const std::filesystem::path &path) const -> bool;
+  // Compares every metric the baseline also has; metrics new since the baseline are skipped. The threshold is a
+  // fraction, e.g. 0.1 flags anything more than 10% worse. Returns nothing when the baseline can't be read.
+  [[nodiscard]] auto Compare(const std::filesystem::path &baseline_path, double threshold) const
+      -> std::optional<std::vector<Comparison>>;
+};
+
+} // namespace rendy::bench
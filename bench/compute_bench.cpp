@@ -0,0 +1,214 @@
+// Measures the vector add kernel in assets/triangle.slang across element counts and workgroup sizes.
+// Runs headless, so it works on software implementations like lavapipe:
+//   rendy_compute_bench [--max-elements N] [--iterations N]
+#include "vulkan/buffer.hpp"
+#include "vulkan/command_list.hpp"
+#include "vulkan/compute_kernel.hpp"
+#include "vulkan/renderer.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace rendy::graphics;
+
+struct BenchOptions {
+  uint32_t max_elements{1U << 22U};
+  uint32_t iterations{20};
+};
+
+struct VectorAddParams {
+  uint32_t element_count;
+};
+
+auto parseOptions(std::span<char *> args) -> BenchOptions {
+  BenchOptions options;
+  for (size_t i = 1; i + 1 < args.size(); ++i) {
+    const std::string_view arg = args[i];
+    if (arg == "--max-elements") {
+      options.max_elements = static_cast<uint32_t>(std::stoul(args[++i]));
+    } else if (arg == "--iterations") {
+      options.iterations = std::max(1U, static_cast<uint32_t>(std::stoul(args[++i])));
+    }
+  }
+  return options;
+}
+
+auto makeBuffer(const vulkan::VulkanDevice &device, uint64_t size, core::BufferUsage usage,
+                core::MemoryUsage memory_usage) -> std::unique_ptr<vulkan::VulkanBuffer> {
+  auto buffer = std::make_unique<vulkan::VulkanBuffer>();
+  if (!buffer->Initialize(device, core::BufferDesc{.size = size, .usage = usage, .memory_usage = memory_usage})) {
+    throw std::runtime_error("Failed to create benchmark buffer.");
+  }
+  return buffer;
+}
+
+// Inputs, output and a host visible copy of the output for one element count
+struct VectorAddBuffers {
+  std::unique_ptr<vulkan::VulkanBuffer> lhs;
+  std::unique_ptr<vulkan::VulkanBuffer> rhs;
+  std::unique_ptr<vulkan::VulkanBuffer> result;
+  std::unique_ptr<vulkan::VulkanBuffer> readback;
+
+  VectorAddBuffers(const vulkan::VulkanDevice &device, uint32_t element_count) {
+    const auto size = uint64_t{element_count} * sizeof(float);
+    lhs = makeBuffer(device, size, core::BufferUsage::Storage, core::MemoryUsage::GpuOnly);
+    rhs = makeBuffer(device, size, core::BufferUsage::Storage, core::MemoryUsage::GpuOnly);
+    result = makeBuffer(device, size, core::BufferUsage::Storage | core::BufferUsage::TransferSrc,
+                        core::MemoryUsage::GpuOnly);
+    readback = makeBuffer(device, size, core::BufferUsage::TransferDst, core::MemoryUsage::Readback);
+
+    std::vector<float> values(element_count);
+    for (uint32_t i = 0; i < element_count; ++i) {
+      values[i] = static_cast<float>(i);
+    }
+    lhs->Upload(std::as_bytes(std::span(values)));
+    for (auto &value : values) {
+      value *= 2.0F;
+    }
+    rhs->Upload(std::as_bytes(std::span(values)));
+  }
+
+  ~VectorAddBuffers() {
+    for (auto *buffer : {lhs.get(), rhs.get(), result.get(), readback.get()}) {
+      buffer->Destroy();
+    }
+  }
+
+  VectorAddBuffers(const VectorAddBuffers &) = delete;
+  VectorAddBuffers(VectorAddBuffers &&) = delete;
+  auto operator=(const VectorAddBuffers &) -> VectorAddBuffers & = delete;
+  auto operator=(VectorAddBuffers &&) -> VectorAddBuffers & = delete;
+};
+
+// Records `iterations` back to back dispatches, each waiting for the previous one like a dependent pass would
+void recordDispatches(vulkan::VulkanCommandList &command_list, const vulkan::ComputeKernel &kernel,
+                      const VectorAddBuffers &buffers, uint32_t element_count, uint32_t iterations) {
+  const std::array bindings{
+      vulkan::ComputeBufferBinding{.binding = 0, .buffer = buffers.lhs.get()},
+      vulkan::ComputeBufferBinding{.binding = 1, .buffer = buffers.rhs.get()},
+      vulkan::ComputeBufferBinding{.binding = 2, .buffer = buffers.result.get()},
+  };
+  const VectorAddParams params{.element_count = element_count};
+  for (uint32_t i = 0; i < iterations; ++i) {
+    if (i > 0) {
+      command_list.GlobalBarrier(vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite,
+                                 vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite);
+    }
+    kernel.Record(command_list, bindings, std::as_bytes(std::span(&params, 1)), kernel.GetGroupCount(element_count));
+  }
+}
+
+auto verify(const vulkan::VulkanDevice &device, core::QueueType queue, const VectorAddBuffers &buffers,
+            uint32_t element_count) -> bool {
+  const auto size = uint64_t{element_count} * sizeof(float);
+  device.ImmediateSubmit(queue, [&](vk::CommandBuffer command_buffer) {
+    vulkan::VulkanCommandList command_list(command_buffer, queue, vk::CommandBufferLevel::ePrimary);
+    command_list.GlobalBarrier(vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite,
+                               vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferRead);
+    command_list.CopyBuffer(*buffers.result, 0, *buffers.readback, 0, size);
+    command_list.GlobalBarrier(vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+                               vk::PipelineStageFlagBits2::eHost, vk::AccessFlagBits2::eHostRead);
+  });
+  device.GetAllocator().Invalidate(*buffers.readback->GetAllocation());
+
+  std::vector<float> values(element_count);
+  std::memcpy(values.data(), buffers.readback->GetMappedData(), size);
+  for (uint32_t i = 0; i < element_count; ++i) {
+    if (std::abs(values[i] - (3.0F * static_cast<float>(i))) > 0.5F) {
+      spdlog::error("Mismatch at element {}: expected {}, got {}", i, 3.0F * static_cast<float>(i), values[i]);
+      return false;
+    }
+  }
+  return true;
+}
+
+auto runBenchmark(vulkan::Renderer &renderer, const BenchOptions &options) -> bool {
+  auto &device = renderer.GetDevice();
+  const auto queue = device.GetAsyncComputeQueueType();
+  const auto shader = renderer.GetShaderLibrary().Load("triangle");
+  if (shader == nullptr) {
+    return false;
+  }
+
+  const auto &limits = device.GetPhysicalDevice().GetProperties().limits;
+  const auto max_group_size = std::min(limits.maxComputeWorkGroupSize[0], limits.maxComputeWorkGroupInvocations);
+  std::vector<uint32_t> group_sizes;
+  for (uint32_t size = 32; size <= std::min(max_group_size, 1024U); size *= 2) {
+    group_sizes.push_back(size);
+  }
+
+  // All workgroup sizes compile in parallel on the pipeline compiler's workers
+  std::vector<std::unique_ptr<vulkan::ComputeKernel>> kernels;
+  bool ready = true;
+  for (const auto group_size : group_sizes) {
+    auto &kernel = kernels.emplace_back(std::make_unique<vulkan::ComputeKernel>());
+    const std::array specialization{vulkan::SpecializationConstant{.id = 0, .value = group_size}};
+    ready = kernel->Initialize(device, renderer.GetPipelineCompiler(), shader, "computeMain", specialization) && ready;
+  }
+  ready = ready && std::ranges::all_of(kernels, [](const auto &kernel) { return kernel->WaitUntilReady(); });
+  const auto destroy_kernels = [&kernels] {
+    for (const auto &kernel : kernels) {
+      kernel->Destroy();
+    }
+  };
+  if (!ready) {
+    destroy_kernels();
+    return false;
+  }
+
+  spdlog::info("Running on the {} queue, {} iterations per measurement",
+               queue == core::QueueType::Compute ? "async compute" : "graphics", options.iterations);
+  fmt::print("{:>12} {:>6} {:>12} {:>10}\n", "elements", "group", "time (us)", "GB/s");
+
+  bool passed = true;
+  for (uint32_t element_count = 1U << 16U; element_count <= options.max_elements; element_count *= 4) {
+    const VectorAddBuffers buffers(device, element_count);
+    auto &uploads = device.GetUploadContext();
+    uploads.WaitForSubmission(uploads.Flush());
+
+    for (size_t i = 0; i < kernels.size(); ++i) {
+      const auto &kernel = *kernels[i];
+      const auto record = [&](uint32_t iterations) {
+        device.ImmediateSubmit(queue, [&](vk::CommandBuffer command_buffer) {
+          vulkan::VulkanCommandList command_list(command_buffer, queue, vk::CommandBufferLevel::ePrimary);
+          recordDispatches(command_list, kernel, buffers, element_count, iterations);
+        });
+      };
+
+      record(1); // Warm up caches and lazy driver state
+      const auto start = std::chrono::steady_clock::now();
+      record(options.iterations);
+      const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      // Two reads and one write per element
+      const auto bytes = 3.0 * sizeof(float) * element_count * options.iterations;
+      fmt::print("{:>12} {:>6} {:>12.1f} {:>10.2f}\n", element_count, group_sizes[i],
+                 elapsed * 1e6 / options.iterations, bytes / elapsed / 1e9);
+      passed = verify(device, queue, buffers, element_count) && passed;
+    }
+  }
+
+  destroy_kernels();
+  return passed;
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  const auto options = parseOptions(std::span(argv, static_cast<size_t>(argc)));
+
+  auto renderer = rendy::graphics::vulkan::Renderer();
+  renderer.InitializeHeadless(vk::Extent2D{1, 1});
+  const auto passed = runBenchmark(renderer, options);
+  renderer.Destroy();
+  return passed ? 0 : 1;
+}
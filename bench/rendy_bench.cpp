@@ -0,0 +1,408 @@
+// Engine benchmark suite: device creation, buffer uploads, command recording, pipeline creation and compute
+// dispatches. Runs headless, so it works on software implementations like lavapipe, and writes its results as JSON
+// that can be checked against a stored baseline:
+//   rendy_bench [--output results.json] [--baseline baseline.json] [--threshold percent] [--repeat N]
+// Afterwards it renders the test scene of scene_checks.hpp. Exits with 1 when a metric regressed by more than the
+// threshold, a measurement failed or a scene check failed.
+#include "bench_report.hpp"
+#include "scene_checks.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/command_context.hpp"
+#include "vulkan/command_list.hpp"
+#include "vulkan/compute_kernel.hpp"
+#include "vulkan/renderer.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace rendy::graphics;
+using rendy::bench::Report;
+using Clock = std::chrono::steady_clock;
+
+constexpr uint64_t kUploadSize = 64ULL * 1024 * 1024;
+constexpr uint32_t kRecordedLists = 64;
+constexpr uint32_t kDrawsPerList = 1000;
+constexpr uint32_t kDispatchElements = 1U << 20U;
+constexpr uint32_t kDispatchesPerSubmit = 100;
+// Pipelines compiled per cache measurement, one vector add variant per workgroup size plus the draw pipeline
+constexpr std::array<uint32_t, 6> kKernelGroupSizes{32, 64, 128, 256, 512, 1024};
+constexpr vk::Format kColorFormat = vk::Format::eR8G8B8A8Unorm;
+
+struct BenchOptions {
+  std::filesystem::path output{"bench_results.json"};
+  std::optional<std::filesystem::path> baseline;
+  double threshold{0.1};
+  uint32_t repeat{5};
+};
+
+struct VectorAddParams {
+  uint32_t element_count;
+};
+
+auto parseOptions(std::span<char *> args) -> BenchOptions {
+  BenchOptions options;
+  for (size_t i = 1; i + 1 < args.size(); ++i) {
+    const std::string_view arg = args[i];
+    if (arg == "--output") {
+      options.output = args[++i];
+    } else if (arg == "--baseline") {
+      options.baseline = args[++i];
+    } else if (arg == "--threshold") {
+      options.threshold = std::stod(args[++i]) / 100.0;
+    } else if (arg == "--repeat") {
+      options.repeat = std::max(1U, static_cast<uint32_t>(std::stoul(args[++i])));
+    }
+  }
+  return options;
+}
+
+auto elapsedMs(Clock::time_point start) -> double {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Runs the measurement `repeat` times after one warm up run and keeps the median, which shrugs off a stray
+// context switch on a shared CI machine
+template <typename Measure> auto median(uint32_t repeat, Measure &&measure) -> double {
+  (void)measure();
+  std::vector<double> samples(repeat);
+  for (auto &sample : samples) {
+    sample = measure();
+  }
+  std::ranges::sort(samples);
+  return samples[samples.size() / 2];
+}
+
+auto makeBuffer(const vulkan::VulkanDevice &device, uint64_t size, core::BufferUsage usage,
+                core::MemoryUsage memory_usage) -> std::unique_ptr<vulkan::VulkanBuffer> {
+  auto buffer = std::make_unique<vulkan::VulkanBuffer>();
+  if (!buffer->Initialize(device, core::BufferDesc{.size = size, .usage = usage, .memory_usage = memory_usage})) {
+    throw std::runtime_error("Failed to create benchmark buffer.");
+  }
+  return buffer;
+}
+
+// Instance, physical device selection and device creation, as a headless application pays for them at startup
+auto measureDeviceCreation() -> double {
+  const auto start = Clock::now();
+  vulkan::Instance instance;
+  if (!instance.Initialize({})) {
+    throw std::runtime_error("Failed to create Vulkan instance.");
+  }
+  auto physical_device = std::make_shared<vulkan::PhysicalDevice>();
+  if (!physical_device->Initialize(instance, nullptr)) {
+    throw std::runtime_error("Failed to choose a valid Vulkan physical device.");
+  }
+  vulkan::VulkanDevice device(physical_device);
+  if (!device.Initialize()) {
+    throw std::runtime_error("Failed to create Vulkan device");
+  }
+  const auto elapsed = elapsedMs(start);
+  device.Cleanup();
+  physical_device->Destroy();
+  instance.Destroy();
+  return elapsed;
+}
+
+// Staged upload into device local memory through the upload context, until the transfer has completed
+auto measureUpload(const vulkan::VulkanDevice &device, const vulkan::VulkanBuffer &buffer,
+                   std::span<const std::byte> data) -> double {
+  auto &uploads = device.GetUploadContext();
+  const auto start = Clock::now();
+  uploads.Enqueue(buffer.Get(), 0, data);
+  uploads.WaitForSubmission(uploads.Flush());
+  return elapsedMs(start);
+}
+
+auto createDrawPipelineDesc(const vulkan::Shader &shader, vk::PipelineLayout layout)
+    -> std::optional<vulkan::GraphicsPipelineDesc> {
+  const auto vertex = shader.GetStage("vertexMain");
+  const auto fragment = shader.GetStage("fragmentMain");
+  if (!vertex.has_value() || !fragment.has_value()) {
+    return std::nullopt;
+  }
+  return vulkan::GraphicsPipelineDesc{.stages = {vertex.value(), fragment.value()},
+                                      .layout = layout,
+                                      .cull_mode = vk::CullModeFlagBits::eNone,
+                                      .depth_test = false,
+                                      .depth_write = false,
+                                      .color_formats = {kColorFormat}};
+}
+
+// Secondary command lists of draws, as a render pass split across threads would record them. Nothing is submitted;
+// only the CPU side of recording is measured.
+void recordDraws(vulkan::CommandContext &context, uint32_t thread_index, const vulkan::VulkanPipeline &pipeline) {
+  const std::array color_formats{kColorFormat};
+  const vk::Viewport viewport{.width = 1.0F, .height = 1.0F, .maxDepth = 1.0F};
+  const vk::Rect2D scissor{.extent = {.width = 1, .height = 1}};
+  auto &command_list = context.Allocate(thread_index, core::QueueType::Graphics, vk::CommandBufferLevel::eSecondary);
+  command_list.BeginSecondary(vulkan::RenderingInheritance{.color_formats = color_formats});
+  command_list.BindPipeline(pipeline);
+  command_list.Get().setViewport(0, viewport);
+  command_list.Get().setScissor(0, scissor);
+  for (uint32_t draw = 0; draw < kDrawsPerList; ++draw) {
+    command_list.Draw(3);
+  }
+  command_list.End();
+}
+
+void benchRecording(vulkan::Renderer &renderer, const vulkan::VulkanPipeline &pipeline, const BenchOptions &options,
+                    Report &report) {
+  auto &jobs = renderer.GetJobSystem();
+  vulkan::CommandContext context;
+  if (!context.Initialize(renderer.GetDevice(), {.frames_in_flight = 1, .max_threads = jobs.GetWorkerCount() + 1})) {
+    throw std::runtime_error("Failed to create command context.");
+  }
+
+  uint64_t frame = 0;
+  const auto total_draws = static_cast<double>(kRecordedLists) * kDrawsPerList;
+  const auto single_ms = median(options.repeat, [&] {
+    context.BeginFrame(frame++);
+    const auto start = Clock::now();
+    for (uint32_t list = 0; list < kRecordedLists; ++list) {
+      recordDraws(context, 0, pipeline);
+    }
+    return elapsedMs(start);
+  });
+  const auto multi_ms = median(options.repeat, [&] {
+    context.BeginFrame(frame++);
+    const auto start = Clock::now();
+    jobs.ParallelFor(kRecordedLists, 1, [&](size_t begin, size_t end) {
+      for (auto list = begin; list < end; ++list) {
+        recordDraws(context, jobs.GetThreadIndex(), pipeline);
+      }
+    });
+    return elapsedMs(start);
+  });
+  context.Destroy();
+
+  report.Add({.name = "record_draws_single_thread", .value = total_draws / single_ms, .unit = "draws/ms"});
+  report.Add({.name = "record_draws_multi_thread", .value = total_draws / multi_ms, .unit = "draws/ms"});
+}
+
+// Compiles every pipeline of the set with a compiler of its own, so nothing is deduplicated against earlier runs.
+// A cold run starts without a cache file; a warm run loads the file the cold run saved.
+auto measurePipelineCreation(vulkan::Renderer &renderer, const std::shared_ptr<const vulkan::Shader> &kernel_shader,
+                             const vulkan::GraphicsPipelineDesc &draw_desc,
+                             const std::filesystem::path &cache_directory, bool cold) -> std::optional<double> {
+  if (cold) {
+    std::error_code error;
+    std::filesystem::remove_all(cache_directory, error);
+  }
+  auto &device = renderer.GetDevice();
+  vulkan::PipelineCompiler compiler;
+  if (!compiler.Initialize(device, renderer.GetJobSystem(),
+                           vulkan::PipelineCompilerConfig{.cache_directory = cache_directory})) {
+    return std::nullopt;
+  }
+
+  const auto start = Clock::now();
+  std::vector<std::unique_ptr<vulkan::ComputeKernel>> kernels;
+  bool ready = true;
+  for (const auto group_size : kKernelGroupSizes) {
+    auto &kernel = kernels.emplace_back(std::make_unique<vulkan::ComputeKernel>());
+    const std::array specialization{vulkan::SpecializationConstant{.id = 0, .value = group_size}};
+    ready = kernel->Initialize(device, compiler, kernel_shader, "computeMain", specialization) && ready;
+  }
+  const auto draw = compiler.Request(draw_desc);
+  ready = std::ranges::all_of(kernels, [](const auto &kernel) { return kernel->WaitUntilReady(); }) && ready;
+  ready = draw.Wait() != nullptr && ready;
+  const auto elapsed = elapsedMs(start);
+
+  for (const auto &kernel : kernels) {
+    kernel->Destroy();
+  }
+  compiler.Destroy();
+  return ready ? std::optional(elapsed) : std::nullopt;
+}
+
+void benchCompute(vulkan::Renderer &renderer, const vulkan::ComputeKernel &kernel, const BenchOptions &options,
+                  Report &report) {
+  auto &device = renderer.GetDevice();
+  const auto queue = device.GetAsyncComputeQueueType();
+  const auto size = uint64_t{kDispatchElements} * sizeof(float);
+  auto lhs = makeBuffer(device, size, core::BufferUsage::Storage, core::MemoryUsage::GpuOnly);
+  auto rhs = makeBuffer(device, size, core::BufferUsage::Storage, core::MemoryUsage::GpuOnly);
+  auto result = makeBuffer(device, size, core::BufferUsage::Storage, core::MemoryUsage::GpuOnly);
+  const std::array bindings{
+      vulkan::ComputeBufferBinding{.binding = 0, .buffer = lhs.get()},
+      vulkan::ComputeBufferBinding{.binding = 1, .buffer = rhs.get()},
+      vulkan::ComputeBufferBinding{.binding = 2, .buffer = result.get()},
+  };
+  const VectorAddParams params{.element_count = kDispatchElements};
+
+  // Dependent dispatches, each waiting for the previous one like consecutive passes would
+  const auto elapsed_ms = median(options.repeat, [&] {
+    const auto start = Clock::now();
+    device.ImmediateSubmit(queue, [&](vk::CommandBuffer command_buffer) {
+      vulkan::VulkanCommandList command_list(command_buffer, queue, vk::CommandBufferLevel::ePrimary);
+      for (uint32_t i = 0; i < kDispatchesPerSubmit; ++i) {
+        if (i > 0) {
+          command_list.GlobalBarrier(
+              vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite,
+              vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite);
+        }
+        kernel.Record(command_list, bindings, std::as_bytes(std::span(&params, 1)),
+                      kernel.GetGroupCount(kDispatchElements));
+      }
+    });
+    return elapsedMs(start);
+  });
+  for (auto *buffer : {lhs.get(), rhs.get(), result.get()}) {
+    buffer->Destroy();
+  }
+
+  // Two reads and one write per element
+  const auto bytes = 3.0 * sizeof(float) * kDispatchElements * kDispatchesPerSubmit;
+  report.Add({.name = "compute_dispatches", .value = kDispatchesPerSubmit / elapsed_ms, .unit = "dispatches/ms"});
+  report.Add({.name = "compute_bandwidth", .value = bytes / elapsed_ms / 1e6, .unit = "GB/s"});
+}
+
+auto runBenchmarks(vulkan::Renderer &renderer, const BenchOptions &options, Report &report) -> bool {
+  auto &device = renderer.GetDevice();
+
+  spdlog::info("Measuring device creation");
+  report.Add({.name = "device_creation",
+              .value = median(options.repeat, measureDeviceCreation),
+              .unit = "ms",
+              .higher_is_better = false});
+
+  spdlog::info("Measuring buffer uploads");
+  {
+    const auto buffer = makeBuffer(device, kUploadSize, core::BufferUsage::Storage | core::BufferUsage::TransferDst,
+                                   core::MemoryUsage::GpuOnly);
+    const std::vector<std::byte> data(kUploadSize, std::byte{0x5a});
+    const auto upload_ms = median(options.repeat, [&] { return measureUpload(device, *buffer, data); });
+    buffer->Destroy();
+    report.Add({.name = "upload_bandwidth", .value = kUploadSize / upload_ms / 1e6, .unit = "GB/s"});
+  }
+
+  auto &shaders = renderer.GetShaderLibrary();
+  const auto kernel_shader = shaders.Load("triangle");
+  const auto draw_shader = shaders.Load("bench_draw");
+  if (kernel_shader == nullptr || draw_shader == nullptr) {
+    return false;
+  }
+  const auto layout =
+      vulkan::VkCheckAndUnwrap(device.Get().createPipelineLayout({}), "Failed to create pipeline layout.");
+  const auto draw_desc = createDrawPipelineDesc(*draw_shader, layout);
+  bool passed = draw_desc.has_value();
+
+  if (passed) {
+    spdlog::info("Measuring command recording");
+    const auto *pipeline = renderer.GetPipelineCompiler().Request(draw_desc.value()).Wait();
+    passed = pipeline != nullptr;
+    if (passed) {
+      benchRecording(renderer, *pipeline, options, report);
+    }
+  }
+
+  if (passed) {
+    spdlog::info("Measuring pipeline creation");
+    // Best of the runs: a cold run can't be warmed up, and the first one also pays for loading the driver's compiler
+    const auto cache_directory = std::filesystem::temp_directory_path() / "rendy_bench_pipelines";
+    std::optional<double> cold_ms;
+    std::optional<double> warm_ms;
+    for (uint32_t run = 0; run < options.repeat && passed; ++run) {
+      const auto cold = measurePipelineCreation(renderer, kernel_shader, draw_desc.value(), cache_directory, true);
+      const auto warm = measurePipelineCreation(renderer, kernel_shader, draw_desc.value(), cache_directory, false);
+      passed = cold.has_value() && warm.has_value();
+      if (passed) {
+        cold_ms = std::min(cold_ms.value_or(cold.value()), cold.value());
+        warm_ms = std::min(warm_ms.value_or(warm.value()), warm.value());
+      }
+    }
+    if (passed) {
+      report.Add({.name = "pipeline_creation_cold", .value = cold_ms.value(), .unit = "ms", .higher_is_better = false});
+      report.Add({.name = "pipeline_creation_warm", .value = warm_ms.value(), .unit = "ms", .higher_is_better = false});
+    }
+  }
+  device.Get().destroyPipelineLayout(layout);
+
+  if (passed) {
+    spdlog::info("Measuring compute dispatches");
+    vulkan::ComputeKernel kernel;
+    const std::array specialization{vulkan::SpecializationConstant{.id = 0, .value = 256}};
+    passed = kernel.Initialize(device, renderer.GetPipelineCompiler(), kernel_shader, "computeMain", specialization) &&
+             kernel.WaitUntilReady();
+    if (passed) {
+      benchCompute(renderer, kernel, options, report);
+    }
+    kernel.Destroy();
+  }
+  return passed;
+}
+
+// Mesa keeps its own on-disk shader cache, which would turn every cold pipeline measurement after the first run into
+// a warm one. Only the application's pipeline cache should make a difference.
+void disableDriverShaderCache() {
+#ifdef _WIN32
+  _putenv_s("MESA_SHADER_CACHE_DISABLE", "true");
+#else
+  setenv("MESA_SHADER_CACHE_DISABLE", "true", 0);
+#endif
+}
+
+auto printAndCompare(const Report &report, const BenchOptions &options) -> bool {
+  fmt::print("{:<28} {:>14} {:<14}\n", "metric", "value", "unit");
+  for (const auto &metric : report.GetMetrics()) {
+    fmt::print("{:<28} {:>14.2f} {:<14}\n", metric.name, metric.value, metric.unit);
+  }
+  if (!options.baseline.has_value()) {
+    return true;
+  }
+
+  const auto comparisons = report.Compare(options.baseline.value(), options.threshold);
+  if (!comparisons.has_value()) {
+    return false;
+  }
+  fmt::print("\n{:<28} {:>14} {:>14} {:>9} {:>9}\n", "metric", "baseline", "current", "worse by", "limit");
+  bool passed = true;
+  for (const auto &comparison : comparisons.value()) {
+    fmt::print("{:<28} {:>14.2f} {:>14.2f} {:>8.1f}% {:>8.1f}%{}\n", comparison.name, comparison.baseline,
+               comparison.value, comparison.change * 100.0, comparison.threshold * 100.0,
+               comparison.regressed ? "  REGRESSED" : "");
+    passed = passed && !comparison.regressed;
+  }
+  return passed;
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  const auto options = parseOptions(std::span(argv, static_cast<size_t>(argc)));
+  disableDriverShaderCache();
+
+  auto renderer = rendy::graphics::vulkan::Renderer();
+  renderer.InitializeHeadless(vk::Extent2D{1, 1});
+  const auto &properties = renderer.GetDevice().GetPhysicalDevice().GetProperties();
+  Report report(properties.deviceName.data(), fmt::format("{:#x}", properties.driverVersion));
+
+  bool passed = false;
+  try {
+    passed = runBenchmarks(renderer, options, report);
+    spdlog::info("Checking the test scene");
+    passed = rendy::bench::RunSceneChecks(renderer) && passed;
+  } catch (const std::exception &error) {
+    spdlog::error("Benchmark failed: {}", error.what());
+  }
+  renderer.Destroy();
+  if (!passed) {
+    spdlog::error("Some measurements or scene checks failed, results are incomplete");
+  }
+
+  passed = report.WriteJson(options.output) && passed;
+  return printAndCompare(report, options) && passed ? 0 : 1;
+}
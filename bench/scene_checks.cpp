@@ -0,0 +1,636 @@
+#include "scene_checks.hpp"
+#include "core/mesh_format.hpp"
+#include "engine_core/math.hpp"
+#include "engine_core/transform_store.hpp"
+#include "mesh_cooker.hpp"
+#include "source_mesh.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/command_list.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/frame_scheduler.hpp"
+#include "vulkan/gpu_culling.hpp"
+#include "vulkan/memory_allocator.hpp"
+#include "vulkan/mesh.hpp"
+#include "vulkan/meshlet_renderer.hpp"
+#include "vulkan/render_graph.hpp"
+#include "vulkan/renderer.hpp"
+#include "vulkan/upload_context.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <random>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace rendy::bench {
+
+namespace {
+
+using namespace graphics;
+using engine_core::Mat4;
+using engine_core::Quat;
+using engine_core::TransformHandle;
+using engine_core::TransformStore;
+using Point = std::array<float, 3>;
+
+constexpr vk::Extent2D kTargetExtent{.width = 64, .height = 64};
+constexpr vk::Format kColorFormat = vk::Format::eR8G8B8A8Unorm;
+constexpr vk::Format kDepthFormat = vk::Format::eD32Sfloat;
+constexpr auto kReadyTimeout = std::chrono::seconds(60);
+
+constexpr uint32_t kSphereRings = 24;
+constexpr uint32_t kSphereSegments = 48;
+// More children than TransformStore::kUpdateGrain, so every level below the root is split into several jobs
+constexpr uint32_t kHierarchyChildren = 600;
+
+// The camera looks down -z from here; the occluder is a depth clear kOccluderDistance in front of it
+constexpr float kCameraDistance = 3.0F;
+constexpr float kOccluderDistance = 4.0F;
+constexpr float kNear = 0.1F;
+constexpr float kFar = 100.0F;
+// Share of the target a unit sphere at the origin covers from the camera, within the tolerance of the tessellation
+constexpr float kMinCoverage = 0.2F;
+constexpr float kMaxCoverage = 0.4F;
+
+// Readback layout of the culling results: the draw count, then the draws
+constexpr vk::DeviceSize kDrawsOffset = 16;
+
+auto check(bool passed, std::string_view what) -> bool {
+  if (!passed) {
+    spdlog::error("Scene check failed: {}", what);
+  }
+  return passed;
+}
+
+// Pipelines compile in the background, the frames of a check need them from the start
+auto waitUntilReady(const std::function<bool()> &is_ready) -> bool {
+  const auto deadline = std::chrono::steady_clock::now() + kReadyTimeout;
+  while (!is_ready()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+auto makeReadback(const vulkan::VulkanDevice &device, vk::DeviceSize size) -> std::unique_ptr<vulkan::VulkanBuffer> {
+  auto buffer = std::make_unique<vulkan::VulkanBuffer>();
+  if (!buffer->Initialize(device, core::BufferDesc{.size = size,
+                                                   .usage = core::BufferUsage::TransferDst,
+                                                   .memory_usage = core::MemoryUsage::Readback})) {
+    return nullptr;
+  }
+  return buffer;
+}
+
+// Builds one frame's graph, executes it and waits for the GPU, so the frame's readbacks can be checked right away
+auto runFrame(vulkan::Renderer &renderer, vulkan::RenderGraph &graph,
+              const std::function<bool(vulkan::RenderGraph &)> &build) -> bool {
+  renderer.BeginFrame();
+  graph.Reset();
+  const bool built = build(graph) && graph.Compile();
+  if (built) {
+    graph.Execute(renderer.GetFrameScheduler());
+  }
+  renderer.EndFrame();
+  renderer.GetFrameScheduler().WaitIdle();
+  return built;
+}
+
+// Row major Vulkan view projection of a camera at (0, 0, kCameraDistance) looking down -z with a 60 degree field of
+// view, depth 0 at the near plane
+auto makeView() -> vulkan::CullView {
+  const auto focal = 1.0F / std::tan(std::numbers::pi_v<float> / 6.0F);
+  const auto aspect = static_cast<float>(kTargetExtent.width) / static_cast<float>(kTargetExtent.height);
+  const auto depth_scale = kFar / (kNear - kFar);
+  const auto depth_offset = (kNear * kFar) / (kNear - kFar);
+  return {.view_projection = {focal / aspect, 0.0F, 0.0F, 0.0F,                                        //
+                              0.0F, -focal, 0.0F, 0.0F,                                                //
+                              0.0F, 0.0F, depth_scale, depth_offset - (depth_scale * kCameraDistance), //
+                              0.0F, 0.0F, -1.0F, kCameraDistance},
+          .camera_position = {0.0F, 0.0F, kCameraDistance}};
+}
+
+// Depth buffer value of a point on the view axis the given distance in front of the camera
+auto depthAt(const vulkan::CullView &view, float distance) -> float {
+  const auto &matrix = view.view_projection;
+  const auto z = kCameraDistance - distance;
+  return ((matrix[10] * z) + matrix[11]) / ((matrix[14] * z) + matrix[15]);
+}
+
+// UV sphere of radius 1, triangles wound counter clockwise seen from outside
+auto makeSphere() -> tools::SourceMesh {
+  tools::SourceMesh sphere;
+  for (uint32_t ring = 0; ring <= kSphereRings; ++ring) {
+    const auto theta = std::numbers::pi_v<float> * static_cast<float>(ring) / kSphereRings;
+    for (uint32_t segment = 0; segment <= kSphereSegments; ++segment) {
+      const auto phi = 2.0F * std::numbers::pi_v<float> * static_cast<float>(segment) / kSphereSegments;
+      const std::array normal{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+      sphere.vertices.push_back(tools::SourceVertex{
+          .position = normal,
+          .normal = normal,
+          .uv = {static_cast<float>(segment) / kSphereSegments, static_cast<float>(ring) / kSphereRings}});
+    }
+  }
+  const auto vertex = [](uint32_t ring, uint32_t segment) { return (ring * (kSphereSegments + 1)) + segment; };
+  for (uint32_t ring = 0; ring < kSphereRings; ++ring) {
+    for (uint32_t segment = 0; segment < kSphereSegments; ++segment) {
+      const auto top_left = vertex(ring, segment);
+      const auto bottom_left = vertex(ring + 1, segment);
+      const auto bottom_right = vertex(ring + 1, segment + 1);
+      const auto top_right = vertex(ring, segment + 1);
+      // The quads touching a pole have one edge collapsed into it
+      if (ring + 1 < kSphereRings) {
+        sphere.indices.insert(sphere.indices.end(), {top_left, bottom_right, bottom_left});
+      }
+      if (ring > 0) {
+        sphere.indices.insert(sphere.indices.end(), {top_left, top_right, bottom_right});
+      }
+    }
+  }
+  return sphere;
+}
+
+auto readFile(const std::filesystem::path &path) -> std::vector<std::byte> {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  std::vector<std::byte> bytes(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  return bytes;
+}
+
+auto writeFile(const std::filesystem::path &path, std::span<const std::byte> bytes) -> bool {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  return static_cast<bool>(file);
+}
+
+template <typename T> void patch(std::vector<std::byte> &bytes, uint64_t offset, const T &value) {
+  std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+template <typename T> auto sectionMatches(const core::MeshFile &file, core::MeshSection section,
+                                          const std::vector<T> &expected) -> bool {
+  const auto bytes = file.GetSection(section);
+  return std::ranges::equal(bytes, std::as_bytes(std::span(expected)));
+}
+
+auto checkMeshFileRoundTrip(const tools::CookedMesh &cooked, const core::MeshFile &file) -> bool {
+  using core::MeshSection;
+  const auto &header = file.GetHeader();
+  return check(std::memcmp(&header, &cooked.header, sizeof(header)) == 0, "mesh file header round trip") &&
+         check(sectionMatches(file, MeshSection::Positions, cooked.positions) &&
+                   sectionMatches(file, MeshSection::Attributes, cooked.attributes) &&
+                   sectionMatches(file, MeshSection::Indices, cooked.indices) &&
+                   sectionMatches(file, MeshSection::Lods, cooked.lods) &&
+                   sectionMatches(file, MeshSection::Meshlets, cooked.meshlets) &&
+                   sectionMatches(file, MeshSection::MeshletBounds, cooked.meshlet_bounds) &&
+                   sectionMatches(file, MeshSection::MeshletVertices, cooked.meshlet_vertices) &&
+                   sectionMatches(file, MeshSection::MeshletTriangles, cooked.meshlet_triangles),
+               "mesh file sections round trip");
+}
+
+// Each damaged copy of a valid file has to fail to open. MeshFile logs an error for every one of them.
+auto checkMeshFileRejection(const std::filesystem::path &path, const core::MeshFileHeader &header) -> bool {
+  const auto original = readFile(path);
+  const auto damaged_path = std::filesystem::temp_directory_path() / "rendy_scene_damaged.rmesh";
+  const auto &meshlets = header.sections.at(static_cast<size_t>(core::MeshSection::Meshlets));
+  const auto &triangles = header.sections.at(static_cast<size_t>(core::MeshSection::MeshletTriangles));
+
+  const std::array<std::pair<std::string_view, std::function<void(std::vector<std::byte> &)>>, 5> damages{{
+      {"bad magic", [](auto &bytes) { patch(bytes, offsetof(core::MeshFileHeader, magic), uint32_t{0}); }},
+      {"other version",
+       [](auto &bytes) { patch(bytes, offsetof(core::MeshFileHeader, version), core::kMeshFileVersion + 1); }},
+      {"truncated file", [&](auto &bytes) { bytes.resize(triangles.offset); }},
+      {"meshlet over the vertex limit",
+       [&](auto &bytes) {
+         patch(bytes, meshlets.offset + offsetof(core::MeshletDesc, vertex_count), core::kMeshletMaxVertices + 1);
+       }},
+      {"meshlet triangles past the end",
+       [&](auto &bytes) {
+         patch(bytes, meshlets.offset + offsetof(core::MeshletDesc, triangle_offset),
+               static_cast<uint32_t>(triangles.size));
+       }},
+  }};
+
+  spdlog::info("Opening damaged mesh files, the errors they log are expected");
+  bool passed = true;
+  for (const auto &[name, damage] : damages) {
+    auto bytes = original;
+    damage(bytes);
+    core::MeshFile file;
+    passed = check(writeFile(damaged_path, bytes) && !file.Open(damaged_path), name) && passed;
+  }
+  std::error_code error;
+  std::filesystem::remove(damaged_path, error);
+  return passed;
+}
+
+auto rotate(const Quat &rotation, const Point &point) -> Point {
+  // v + 2w (u x v) + 2 u x (u x v) for the vector part u
+  const Point u{rotation.x, rotation.y, rotation.z};
+  const auto cross = [](const Point &lhs, const Point &rhs) {
+    return Point{(lhs[1] * rhs[2]) - (lhs[2] * rhs[1]), (lhs[2] * rhs[0]) - (lhs[0] * rhs[2]),
+                 (lhs[0] * rhs[1]) - (lhs[1] * rhs[0])};
+  };
+  const auto first = cross(u, point);
+  const auto second = cross(u, first);
+  Point result{};
+  for (size_t i = 0; i < result.size(); ++i) {
+    result.at(i) = point.at(i) + (2.0F * rotation.w * first.at(i)) + (2.0F * second.at(i));
+  }
+  return result;
+}
+
+// Moves a point through the local transforms from the transform up to the root, without any matrices
+auto referenceTransform(const TransformStore &store, TransformHandle handle, Point point) -> Point {
+  for (; handle.IsValid(); handle = store.GetParent(handle)) {
+    const auto local = store.GetLocal(handle);
+    point = rotate(local.rotation, {point[0] * local.scale.x, point[1] * local.scale.y, point[2] * local.scale.z});
+    point = {point[0] + local.position.x, point[1] + local.position.y, point[2] + local.position.z};
+  }
+  return point;
+}
+
+auto matchesReference(const TransformStore &store, TransformHandle handle) -> bool {
+  const auto near = [](float value, float expected) {
+    return std::abs(value - expected) <= 1e-3F * std::max(1.0F, std::abs(expected));
+  };
+  const auto &world = store.GetWorld(handle).m;
+  const auto origin = referenceTransform(store, handle, {0.0F, 0.0F, 0.0F});
+  for (size_t column = 0; column < 4; ++column) {
+    auto expected = origin;
+    if (column < 3) {
+      Point axis{};
+      axis.at(column) = 1.0F;
+      const auto moved = referenceTransform(store, handle, axis);
+      expected = {moved[0] - origin[0], moved[1] - origin[1], moved[2] - origin[2]};
+    }
+    for (size_t row = 0; row < 3; ++row) {
+      if (!near(world.at((column * 4) + row), expected.at(row))) {
+        return false;
+      }
+    }
+    if (world.at((column * 4) + 3) != (column == 3 ? 1.0F : 0.0F)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto checkTransforms(common::JobSystem &jobs) -> bool {
+  std::mt19937 random(7);
+  std::uniform_real_distribution<float> position(-5.0F, 5.0F);
+  std::uniform_real_distribution<float> component(-1.0F, 1.0F);
+  std::uniform_real_distribution<float> scale(0.5F, 1.5F);
+  const auto random_local = [&] {
+    Quat rotation{.x = component(random), .y = component(random), .z = component(random), .w = component(random)};
+    const auto length = std::sqrt((rotation.x * rotation.x) + (rotation.y * rotation.y) +
+                                  (rotation.z * rotation.z) + (rotation.w * rotation.w));
+    rotation = {.x = rotation.x / length, .y = rotation.y / length, .z = rotation.z / length, .w = rotation.w / length};
+    return engine_core::Transform{.position = {.x = position(random), .y = position(random), .z = position(random)},
+                                  .rotation = rotation,
+                                  .scale = {.x = scale(random), .y = scale(random), .z = scale(random)}};
+  };
+
+  // Three levels: a root, its children and one grandchild per child
+  TransformStore store;
+  const auto root = store.Create(random_local());
+  std::vector<TransformHandle> handles{root};
+  for (uint32_t child = 0; child < kHierarchyChildren; ++child) {
+    const auto handle = store.Create(random_local(), root);
+    handles.push_back(handle);
+    handles.push_back(store.Create(random_local(), handle));
+  }
+  const auto all_match = [&] {
+    return std::ranges::all_of(handles, [&](TransformHandle handle) { return matchesReference(store, handle); });
+  };
+
+  store.UpdateWorldTransforms(&jobs);
+  bool passed = check(all_match(), "world matrices of a new hierarchy");
+  passed = check(store.GetChanged().size() == handles.size(), "a new hierarchy is changed as a whole") && passed;
+
+  // Moving the root recomputes every transform below it, parents before their children
+  store.SetLocal(root, random_local());
+  store.UpdateWorldTransforms(&jobs);
+  passed = check(all_match(), "world matrices after moving the root") && passed;
+  const auto changed = store.GetChanged();
+  bool parents_first = changed.size() == handles.size();
+  for (size_t index = 0; index < changed.size() && parents_first; ++index) {
+    const auto parent = store.GetParent(changed[index]);
+    parents_first = !parent.IsValid() || std::ranges::find(changed.first(index), parent) != changed.first(index).end();
+  }
+  passed = check(parents_first, "changes after moving the root list parents before children") && passed;
+
+  // A leaf changes alone
+  const auto leaf = handles.back();
+  store.SetPosition(leaf, {.x = 1.0F, .y = 2.0F, .z = 3.0F});
+  store.UpdateWorldTransforms(&jobs);
+  passed = check(store.GetChanged().size() == 1 && store.GetChanged().front() == leaf,
+                 "moving a leaf changes only the leaf") &&
+           passed;
+  return check(matchesReference(store, leaf), "world matrix of a moved leaf") && passed;
+}
+
+// Bounding sphere of the mesh placed with the world matrix
+auto worldSphere(const Mat4 &world, const core::MeshFileHeader &header) -> std::array<float, 4> {
+  const auto &m = world.m;
+  const auto &center = header.bounds_center;
+  float max_scale_squared = 0.0F;
+  for (size_t column = 0; column < 3; ++column) {
+    const auto x = m.at(column * 4);
+    const auto y = m.at((column * 4) + 1);
+    const auto z = m.at((column * 4) + 2);
+    max_scale_squared = std::max(max_scale_squared, (x * x) + (y * y) + (z * z));
+  }
+  std::array<float, 4> sphere{};
+  for (size_t row = 0; row < 3; ++row) {
+    sphere.at(row) = (m.at(row) * center[0]) + (m.at(4 + row) * center[1]) + (m.at(8 + row) * center[2]) +
+                     m.at(12 + row);
+  }
+  sphere[3] = header.bounds_radius * std::sqrt(max_scale_squared);
+  return sphere;
+}
+
+// Object ids that survived culling, sorted
+auto readSurvivors(const vulkan::VulkanDevice &device, const vulkan::GpuCulling &culling,
+                   const vulkan::VulkanBuffer &readback) -> std::vector<uint32_t> {
+  device.GetAllocator().Invalidate(*readback.GetAllocation());
+  const auto *data = readback.GetMappedData();
+  uint32_t count = 0;
+  std::memcpy(&count, data, sizeof(count));
+  std::vector<vk::DrawIndexedIndirectCommand> draws(culling.GetObjectCount());
+  std::memcpy(draws.data(), data + kDrawsOffset, draws.size() * sizeof(vk::DrawIndexedIndirectCommand));
+
+  std::vector<uint32_t> survivors;
+  if (culling.IsCompact()) {
+    draws.resize(std::min<size_t>(count, draws.size()));
+  }
+  for (const auto &draw : draws) {
+    if (draw.instanceCount != 0) {
+      survivors.push_back(draw.firstInstance);
+    }
+  }
+  std::ranges::sort(survivors);
+  return survivors;
+}
+
+// Three copies of the mesh placed through a transform hierarchy: one in front of the occluder, one behind it and one
+// outside the frustum. The first frame has no depth pyramid yet, so only the frustum test culls; the second frame
+// tests against the pyramid the first one built. Then the hidden object moves out from behind the occluder.
+auto checkCulling(vulkan::Renderer &renderer, const vulkan::VulkanMesh &mesh) -> bool {
+  auto *bindless_heap = renderer.GetBindlessHeap();
+  if (bindless_heap == nullptr) {
+    spdlog::warn("Skipping the GPU culling checks, the device has no bindless heap for the depth pyramid");
+    return true;
+  }
+  auto &device = renderer.GetDevice();
+  vulkan::GpuCulling culling;
+  if (!check(culling.Initialize(device, renderer.GetPipelineCompiler(), renderer.GetShaderLibrary(), *bindless_heap,
+                                renderer.GetFrameScheduler(), {.max_objects = 16, .max_updates_per_frame = 16}),
+             "GPU culling initializes")) {
+    return false;
+  }
+  auto readback = makeReadback(device, kDrawsOffset + (16 * sizeof(vk::DrawIndexedIndirectCommand)));
+  vulkan::RenderGraph graph;
+  bool passed = check(readback != nullptr && graph.Initialize(device), "culling readback and graph") &&
+                check(waitUntilReady([&] { return culling.IsReady(); }), "GPU culling pipelines compile");
+
+  TransformStore store;
+  const auto root = store.Create({.position = {.x = 0.0F, .y = 0.0F, .z = -1.0F}});
+  const auto front = store.Create({.position = {.x = 0.0F, .y = 0.0F, .z = 1.0F}}, root);
+  const auto behind = store.Create({.position = {.x = 0.0F, .y = 0.0F, .z = -5.0F}}, root);
+  const auto outside = store.Create({.position = {.x = 50.0F, .y = 0.0F, .z = 1.0F}}, root);
+  store.UpdateWorldTransforms(&renderer.GetJobSystem());
+
+  const auto &lod = mesh.GetLods().front();
+  const auto cull_object = [&](TransformHandle handle) {
+    return vulkan::CullObject{.sphere = worldSphere(store.GetWorld(handle), mesh.GetHeader()),
+                              .index_count = lod.index_count,
+                              .first_index = lod.index_offset,
+                              .vertex_offset = 0};
+  };
+  std::vector<std::pair<TransformHandle, uint32_t>> objects;
+  for (const auto handle : {front, behind, outside}) {
+    objects.emplace_back(handle, culling.AddObject(cull_object(handle)));
+  }
+  const auto front_id = objects[0].second;
+  const auto behind_id = objects[1].second;
+
+  const auto view = makeView();
+  const auto occluder_depth = depthAt(view, kOccluderDistance);
+  const auto cull_frame = [&](vulkan::RenderGraph &frame_graph) {
+    culling.SetView(view);
+    const auto resources = culling.AddCullPass(frame_graph, kTargetExtent);
+    if (!resources.has_value()) {
+      return false;
+    }
+    const auto depth = frame_graph.CreateImage("Occluder Depth", {.extent = kTargetExtent, .format = kDepthFormat});
+    frame_graph.AddPass("Occluder", vulkan::PassType::Raster)
+        .WriteDepth(depth, occluder_depth)
+        .SetExecute([](vulkan::PassContext &) {});
+    culling.AddDepthPyramidPass(frame_graph, depth);
+
+    const auto readback_handle =
+        frame_graph.ImportBuffer("Culling Readback", readback->Get(), readback->GetDesc().size);
+    frame_graph.AddPass("Culling Readback", vulkan::PassType::Transfer)
+        .Read(resources->draws, vulkan::ResourceAccess::TransferRead)
+        .Read(resources->draw_count, vulkan::ResourceAccess::TransferRead)
+        .Write(readback_handle, vulkan::ResourceAccess::TransferWrite)
+        .SetExecute([&culling, resources, readback_handle](vulkan::PassContext &context) {
+          const auto command_buffer = context.command_list.Get();
+          const auto destination = context.graph.GetBuffer(readback_handle);
+          command_buffer.copyBuffer(context.graph.GetBuffer(resources->draw_count), destination,
+                                    vk::BufferCopy{.srcOffset = 0, .dstOffset = 0, .size = sizeof(uint32_t)});
+          command_buffer.copyBuffer(
+              context.graph.GetBuffer(resources->draws), destination,
+              vk::BufferCopy{.srcOffset = 0,
+                             .dstOffset = kDrawsOffset,
+                             .size = culling.GetObjectCount() * sizeof(vk::DrawIndexedIndirectCommand)});
+        });
+    return true;
+  };
+  const auto survivors = [&] { return readSurvivors(device, culling, *readback); };
+
+  if (passed) {
+    passed = check(runFrame(renderer, graph, cull_frame), "culling frame without a depth pyramid") &&
+             check(survivors() == std::vector{std::min(front_id, behind_id), std::max(front_id, behind_id)},
+                   "frustum culling keeps the objects in view");
+  }
+  if (passed) {
+    passed = check(runFrame(renderer, graph, cull_frame), "culling frame with a depth pyramid") &&
+             check(survivors() == std::vector{front_id}, "occlusion culling drops the object behind the occluder");
+  }
+  if (passed) {
+    // Only the moved transform changes, and only its object is sent to the GPU again
+    store.SetPosition(behind, {.x = 2.0F, .y = 0.0F, .z = 1.0F});
+    store.UpdateWorldTransforms(&renderer.GetJobSystem());
+    for (const auto handle : store.GetChanged()) {
+      const auto object = std::ranges::find(objects, handle, &std::pair<TransformHandle, uint32_t>::first);
+      culling.UpdateObject(object->second, cull_object(handle));
+    }
+    passed = check(runFrame(renderer, graph, cull_frame), "culling frame after moving an object") &&
+             check(survivors() == std::vector{std::min(front_id, behind_id), std::max(front_id, behind_id)},
+                   "culling follows an object moved out from behind the occluder");
+  }
+
+  graph.Destroy();
+  if (readback != nullptr) {
+    readback->Destroy();
+  }
+  culling.Destroy();
+  return passed;
+}
+
+// Renders the mesh at the origin and returns the share of the target it covered
+auto renderMeshlets(vulkan::Renderer &renderer, const vulkan::VulkanMesh &mesh, bool force_emulation)
+    -> std::optional<float> {
+  auto &device = renderer.GetDevice();
+  vulkan::MeshletRenderer meshlets;
+  if (!check(meshlets.Initialize(device, renderer.GetPipelineCompiler(), renderer.GetShaderLibrary(),
+                                 renderer.GetFrameScheduler(),
+                                 {.color_formats = {kColorFormat},
+                                  .depth_format = kDepthFormat,
+                                  .max_draws = 4,
+                                  .max_meshlets = 4096,
+                                  .force_emulation = force_emulation}),
+             "meshlet renderer initializes")) {
+    return std::nullopt;
+  }
+  const auto path = meshlets.GetPath() == vulkan::MeshletPath::MeshShader ? "mesh shader" : "emulated";
+  spdlog::info("Rendering meshlets on the {} path", path);
+
+  const auto pixel_count = size_t{kTargetExtent.width} * kTargetExtent.height;
+  auto readback = makeReadback(device, pixel_count * 4);
+  vulkan::RenderGraph graph;
+  bool passed = check(readback != nullptr && graph.Initialize(device), "meshlet readback and graph") &&
+                check(waitUntilReady([&] { return meshlets.IsReady(); }), "meshlet pipelines compile");
+
+  const auto meshlet_frame = [&](vulkan::RenderGraph &frame_graph) {
+    meshlets.SetView(makeView());
+    if (!meshlets.Submit(mesh, {})) {
+      return false;
+    }
+    meshlets.AddCullPass(frame_graph);
+    const auto color = frame_graph.CreateImage("Scene Color", {.extent = kTargetExtent, .format = kColorFormat});
+    const auto depth = frame_graph.CreateImage("Scene Depth", {.extent = kTargetExtent, .format = kDepthFormat});
+    auto &pass = frame_graph.AddPass("Meshlets", vulkan::PassType::Raster)
+                     .WriteColor(color, std::array{0.0F, 0.0F, 0.0F, 0.0F})
+                     .WriteDepth(depth, 1.0F);
+    meshlets.ReadDraws(pass);
+    // The graph leaves the dynamic viewport and scissor to its passes
+    pass.SetExecute([&meshlets](vulkan::PassContext &context) {
+      const auto command_buffer = context.command_list.Get();
+      command_buffer.setViewport(0, vk::Viewport{.width = static_cast<float>(kTargetExtent.width),
+                                                 .height = static_cast<float>(kTargetExtent.height),
+                                                 .maxDepth = 1.0F});
+      command_buffer.setScissor(0, vk::Rect2D{.extent = kTargetExtent});
+      meshlets.RecordDraws(context.command_list);
+    });
+
+    const auto readback_handle = frame_graph.ImportBuffer("Scene Readback", readback->Get(), readback->GetDesc().size);
+    frame_graph.AddPass("Scene Readback", vulkan::PassType::Transfer)
+        .Read(color, vulkan::ResourceAccess::TransferRead)
+        .Write(readback_handle, vulkan::ResourceAccess::TransferWrite)
+        .SetExecute([color, readback_handle](vulkan::PassContext &context) {
+          const vk::BufferImageCopy region{
+              .imageSubresource = vk::ImageSubresourceLayers{.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                             .layerCount = 1},
+              .imageExtent = vk::Extent3D{.width = kTargetExtent.width, .height = kTargetExtent.height, .depth = 1}};
+          context.command_list.Get().copyImageToBuffer(context.graph.GetImage(color),
+                                                       vk::ImageLayout::eTransferSrcOptimal,
+                                                       context.graph.GetBuffer(readback_handle), region);
+        });
+    return true;
+  };
+
+  std::optional<float> coverage;
+  if (passed && check(runFrame(renderer, graph, meshlet_frame), "meshlet frame")) {
+    device.GetAllocator().Invalidate(*readback->GetAllocation());
+    const auto pixels = std::span(readback->GetMappedData(), pixel_count * 4);
+    // The clear leaves alpha at zero, the meshlet shading writes one
+    const auto covered = [&](size_t x, size_t y) {
+      return pixels[(((y * kTargetExtent.width) + x) * 4) + 3] != std::byte{0};
+    };
+    size_t covered_count = 0;
+    for (size_t y = 0; y < kTargetExtent.height; ++y) {
+      for (size_t x = 0; x < kTargetExtent.width; ++x) {
+        covered_count += covered(x, y) ? 1 : 0;
+      }
+    }
+    if (check(covered(kTargetExtent.width / 2, kTargetExtent.height / 2) && !covered(0, 0),
+              "meshlets cover the center of the target and leave its corner clear")) {
+      coverage = static_cast<float>(covered_count) / static_cast<float>(pixel_count);
+    }
+  }
+
+  graph.Destroy();
+  if (readback != nullptr) {
+    readback->Destroy();
+  }
+  meshlets.Destroy();
+  return coverage;
+}
+
+auto checkMeshlets(vulkan::Renderer &renderer, const vulkan::VulkanMesh &mesh) -> bool {
+  const auto native = renderMeshlets(renderer, mesh, false);
+  const auto emulated = renderMeshlets(renderer, mesh, true);
+  if (!native.has_value() || !emulated.has_value()) {
+    return false;
+  }
+  const auto plausible = [](float coverage) { return coverage > kMinCoverage && coverage < kMaxCoverage; };
+  return check(plausible(native.value()) && plausible(emulated.value()),
+               "meshlets cover the share of the target the sphere projects to") &&
+         check(std::abs(native.value() - emulated.value()) <= 0.01F, "both meshlet paths cover the same pixels");
+}
+
+} // namespace
+
+auto RunSceneChecks(vulkan::Renderer &renderer) -> bool {
+  spdlog::info("Checking transform updates");
+  bool passed = checkTransforms(renderer.GetJobSystem());
+
+  spdlog::info("Cooking the scene mesh");
+  auto cooked = tools::CookMesh(makeSphere(), tools::CookOptions{});
+  const auto mesh_path = std::filesystem::temp_directory_path() / "rendy_scene_sphere.rmesh";
+  core::MeshFile file;
+  if (!check(tools::WriteMeshFile(cooked, mesh_path) && file.Open(mesh_path), "the cooked mesh opens")) {
+    return false;
+  }
+  passed = checkMeshFileRoundTrip(cooked, file) && passed;
+  passed = checkMeshFileRejection(mesh_path, file.GetHeader()) && passed;
+
+  auto &device = renderer.GetDevice();
+  vulkan::VulkanMesh mesh;
+  const bool uploaded = check(mesh.Initialize(device, file), "the cooked mesh uploads");
+  file.Close();
+  std::error_code error;
+  std::filesystem::remove(mesh_path, error);
+  if (!uploaded) {
+    return false;
+  }
+  device.GetUploadContext().WaitForSubmission(mesh.GetUploadValue());
+
+  spdlog::info("Checking GPU culling");
+  passed = checkCulling(renderer, mesh) && passed;
+  spdlog::info("Checking meshlet rendering");
+  passed = checkMeshlets(renderer, mesh) && passed;
+  mesh.Destroy();
+  return passed;
+}
+
+} // namespace rendy::bench
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace rendy::graphics::vulkan {
+class Renderer;
+} // namespace rendy::graphics::vulkan
+
+namespace rendy::bench {
+
+// Cooks, loads and renders a small scene through the GPU driven subsystems and checks their results against CPU side
+// expectations:
+//   - a procedural sphere written by the mesh cooker reads back unchanged through MeshFile, and damaged copies of the
+//     file are rejected
+//   - a transform hierarchy updated across the job system matches a scalar reference, and only changed transforms
+//     are recomputed
+//   - GPU culling drops objects outside the frustum, drops objects behind an occluder once the depth pyramid exists,
+//     and picks up moved objects
+//   - the meshlet renderer covers the expected pixels on the mesh shader path, when the device has one, and on the
+//     emulated path
+// Every failed check is logged. Returns false when any failed.
+[[nodiscard]] auto RunSceneChecks(graphics::vulkan::Renderer &renderer) -> bool;
+
+} // namespace rendy::bench
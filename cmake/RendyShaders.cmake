@@ -0,0 +1,49 @@
+# Compiles .slang modules to SPIR-V at build time. The runtime shader library
+# loads these when slangc isn't available to compile the sources itself.
+find_program(
+    SLANGC_EXECUTABLE
+    slangc
+    HINTS $ENV{VULKAN_SDK}/bin
+)
+if(SLANGC_EXECUTABLE)
+    message(STATUS "Found slangc: ${SLANGC_EXECUTABLE}")
+endif()
+
+# rendy_add_shaders(<target> OUTPUT_DIRECTORY <dir> SOURCES <files...>)
+function(rendy_add_shaders TARGET_NAME)
+    cmake_parse_arguments(PARSE_ARGV 1 ARG "" "OUTPUT_DIRECTORY" "SOURCES")
+
+    if(NOT SLANGC_EXECUTABLE)
+        message(
+            WARNING
+            "slangc not found, ${TARGET_NAME} will not precompile shaders."
+        )
+        add_custom_target(${TARGET_NAME})
+        return()
+    endif()
+
+    set(outputs)
+    foreach(source IN LISTS ARG_SOURCES)
+        get_filename_component(name ${source} NAME_WE)
+        set(output ${ARG_OUTPUT_DIRECTORY}/${name}.spv)
+        # slangc lists the modules the shader imports, e.g. from assets/include, so editing one recompiles its users
+        set(depfile ${CMAKE_CURRENT_BINARY_DIR}/shaders/${name}.spv.d)
+        # Options must match kCompilerOptions in shader_library.cpp
+        add_custom_command(
+            OUTPUT ${output}
+            COMMAND ${CMAKE_COMMAND} -E make_directory ${ARG_OUTPUT_DIRECTORY}
+            COMMAND
+                ${CMAKE_COMMAND} -E make_directory
+                ${CMAKE_CURRENT_BINARY_DIR}/shaders
+            COMMAND
+                ${SLANGC_EXECUTABLE} ${source} -target spirv
+                -fvk-use-entrypoint-name -o ${output} -depfile ${depfile}
+            DEPENDS ${source}
+            DEPFILE ${depfile}
+            COMMENT "Compiling shader ${name}.slang"
+            VERBATIM
+        )
+        list(APPEND outputs ${output})
+    endforeach()
+    add_custom_target(${TARGET_NAME} ALL DEPENDS ${outputs})
+endfunction()
@@ -28,6 +28,10 @@ class RendyEngineConan(ConanFile):
         "nlohmann_json/3.12.0",
         "yaml-cpp/0.8.0",
         "spdlog/1.15.3",
+        # Offline asset tools
+        "meshoptimizer/0.22",
+        "cgltf/1.14",
+        "tinyobjloader/2.0.0-rc10",
     )
 
     def generate(self):
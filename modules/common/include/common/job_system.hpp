@@ -0,0 +1,180 @@
+#pragma once
+
+#include "rendy_common_api_export.h"
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace rendy::common {
+
+class JobSystem;
+// Defined in job_system.cpp
+struct Job;
+struct JobWorker;
+
+struct JobSystemConfig {
+  // Zero picks one less than the number of hardware threads, leaving a core to the main thread
+  uint32_t worker_count{0};
+  // Pins worker i to logical core i + 1 so the OS doesn't migrate workers between cores. Ignored where threads can't
+  // be pinned.
+  bool pin_workers{true};
+  // Jobs a worker can queue on its own deque; more spill into the shared queue. Rounded up to a power of two.
+  size_t deque_capacity{4096};
+};
+
+// Counts the jobs started with it that haven't finished yet. Jobs and coroutines can wait for it to drop to zero, and
+// jobs can be made to start only once it has. A counter can be reused as soon as it is done; it must outlive every
+// job counted by it and every job depending on it.
+class RENDY_COMMON_API JobCounter {
+  friend class JobSystem;
+
+  std::atomic<uint32_t> _pending{0};
+  // Held while the counter drops to zero, so whoever sees it done knows it is no longer touched
+  mutable std::mutex _mutex;
+  std::vector<Job *> _waiters; // Jobs and suspended coroutines to schedule once the counter drops to zero
+
+public:
+  JobCounter() = default;
+  JobCounter(const JobCounter &) = delete;
+  JobCounter(JobCounter &&) = delete;
+  auto operator=(const JobCounter &) -> JobCounter & = delete;
+  auto operator=(JobCounter &&) -> JobCounter & = delete;
+  ~JobCounter() = default;
+
+  [[nodiscard]] auto IsDone() const -> bool;
+};
+
+// Coroutine started with JobSystem::Run. It can co_await JobSystem::WaitFor and JobSystem::Yield, which suspend it
+// and free the worker for other jobs instead of blocking it; it resumes on whichever worker picks it up next.
+class RENDY_COMMON_API JobTask {
+public:
+  struct promise_type {
+    JobSystem *system{nullptr};
+    JobCounter *counter{nullptr};
+
+    struct FinalAwaiter {
+      [[nodiscard]] auto await_ready() const noexcept -> bool { return false; }
+      void await_suspend(std::coroutine_handle<promise_type> handle) const noexcept;
+      void await_resume() const noexcept {}
+    };
+
+    [[nodiscard]] auto get_return_object() -> JobTask {
+      return JobTask(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    // Nothing runs until the task has been handed to the job system
+    [[nodiscard]] auto initial_suspend() const noexcept -> std::suspend_always { return {}; }
+    [[nodiscard]] auto final_suspend() const noexcept -> FinalAwaiter { return {}; }
+    void return_void() const noexcept {}
+    void unhandled_exception() const noexcept;
+  };
+
+  JobTask(const JobTask &) = delete;
+  JobTask(JobTask &&other) noexcept : _handle(std::exchange(other._handle, {})) {}
+  auto operator=(const JobTask &) -> JobTask & = delete;
+  auto operator=(JobTask &&) -> JobTask & = delete;
+  ~JobTask() {
+    if (_handle) {
+      _handle.destroy();
+    }
+  }
+
+private:
+  friend class JobSystem;
+
+  std::coroutine_handle<promise_type> _handle;
+
+  explicit JobTask(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+};
+
+// Shared scheduler for CPU work: a fixed set of worker threads, each with its own work-stealing deque. Jobs started
+// from a worker go onto that worker's deque and run there last in, first out while they are still warm in its cache;
+// idle workers steal the oldest jobs of busy ones. Jobs started from other threads go through a shared queue.
+//
+// Subsystems queue their work here instead of owning threads, so they never compete for more cores than there are.
+// Long jobs that have to wait should be JobTask coroutines awaiting WaitFor; Wait blocks the calling thread, running
+// other jobs meanwhile.
+class RENDY_COMMON_API JobSystem {
+  friend class JobTask;
+
+  std::vector<std::unique_ptr<JobWorker>> _workers;
+  // For threads without a deque and for jobs that didn't fit on one
+  std::mutex _shared_mutex;
+  std::deque<Job *> _shared_jobs;
+  std::atomic<size_t> _shared_count{0};
+  // Bumped whenever work is queued; idle workers sleep on it
+  std::atomic<uint32_t> _epoch{0};
+  std::atomic<uint32_t> _sleeping{0};
+  std::atomic<bool> _stopping{false};
+
+  void workerLoop(JobWorker &worker);
+  void schedule(Job *job);
+  void pushShared(Job *job);
+  [[nodiscard]] auto popShared() -> Job *;
+  [[nodiscard]] auto findJob(JobWorker *worker) -> Job *;
+  void execute(Job *job);
+  void finish(JobCounter &counter);
+  // Queues the job once the dependency is done, or right away when it already is
+  void scheduleAfter(Job *job, JobCounter *dependency);
+  void wake();
+  [[nodiscard]] auto currentWorker() const -> JobWorker *;
+
+public:
+  struct WaitAwaiter {
+    JobCounter *counter;
+
+    [[nodiscard]] auto await_ready() const -> bool { return counter->IsDone(); }
+    [[nodiscard]] auto await_suspend(std::coroutine_handle<> handle) const -> bool;
+    void await_resume() const noexcept {}
+  };
+
+  struct YieldAwaiter {
+    JobSystem *system;
+
+    [[nodiscard]] auto await_ready() const noexcept -> bool { return false; }
+    void await_suspend(std::coroutine_handle<> handle) const;
+    void await_resume() const noexcept {}
+  };
+
+  JobSystem();
+  JobSystem(const JobSystem &) = delete;
+  JobSystem(JobSystem &&) = delete;
+  auto operator=(const JobSystem &) -> JobSystem & = delete;
+  auto operator=(JobSystem &&) -> JobSystem & = delete;
+  ~JobSystem();
+
+  [[nodiscard]] auto Initialize(const JobSystemConfig &config = {}) -> bool;
+  // Runs the jobs still queued and stops the workers. Coroutines suspended on counters that never finish are leaked.
+  void Destroy();
+
+  // Queues the job. The counter, if any, is incremented right away and decremented once the job has returned; with a
+  // dependency the job doesn't start before that counter is done. Exceptions escaping the job are logged.
+  void Run(std::function<void()> job, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+  // Same for a coroutine; the counter is decremented when it returns, not when it first suspends
+  void Run(JobTask task, JobCounter *counter = nullptr, JobCounter *dependency = nullptr);
+
+  // Runs queued jobs on the calling thread until the counter is done. Safe to call from jobs, but it blocks the
+  // worker while the counter waits on jobs running elsewhere; coroutines should co_await WaitFor instead.
+  void Wait(JobCounter &counter);
+  // co_await from a JobTask: suspends until the counter is done
+  [[nodiscard]] auto WaitFor(JobCounter &counter) -> WaitAwaiter { return {.counter = &counter}; }
+  // co_await from a JobTask: lets queued jobs run before the coroutine continues
+  [[nodiscard]] auto Yield() -> YieldAwaiter { return {.system = this}; }
+
+  // Calls body with consecutive ranges of at most grain items covering [0, count) and returns once all have run.
+  // The calling thread takes ranges too. Ranges are claimed dynamically, so uneven ranges still balance.
+  void ParallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &body);
+
+  [[nodiscard]] auto GetWorkerCount() const -> uint32_t { return static_cast<uint32_t>(_workers.size()); }
+  // 1 + the index of the worker running the caller, 0 on any other thread. Suits per-thread resources such as the
+  // command pools of a CommandContext sized for GetWorkerCount() + 1 threads.
+  [[nodiscard]] auto GetThreadIndex() const -> uint32_t;
+};
+
+} // namespace rendy::common
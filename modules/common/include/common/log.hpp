@@ -0,0 +1,166 @@
+#pragma once
+
+#include "rendy_common_api_export.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/spdlog.h>
+#include <unordered_map>
+#include <utility>
+
+#define RENDY_LOG_LEVEL_TRACE 0
+#define RENDY_LOG_LEVEL_DEBUG 1
+#define RENDY_LOG_LEVEL_INFO 2
+#define RENDY_LOG_LEVEL_WARN 3
+#define RENDY_LOG_LEVEL_ERROR 4
+#define RENDY_LOG_LEVEL_CRITICAL 5
+#define RENDY_LOG_LEVEL_OFF 6
+
+// Levels below this are compiled out entirely, arguments included
+#ifndef RENDY_LOG_ACTIVE_LEVEL
+#ifdef NDEBUG
+#define RENDY_LOG_ACTIVE_LEVEL RENDY_LOG_LEVEL_INFO
+#else
+#define RENDY_LOG_ACTIVE_LEVEL RENDY_LOG_LEVEL_TRACE
+#endif
+#endif
+
+namespace rendy::common {
+
+enum class LogLevel : uint8_t {
+  Trace = RENDY_LOG_LEVEL_TRACE,
+  Debug = RENDY_LOG_LEVEL_DEBUG,
+  Info = RENDY_LOG_LEVEL_INFO,
+  Warn = RENDY_LOG_LEVEL_WARN,
+  Error = RENDY_LOG_LEVEL_ERROR,
+  Critical = RENDY_LOG_LEVEL_CRITICAL,
+  Off = RENDY_LOG_LEVEL_OFF,
+};
+
+struct LogConfig {
+  // Messages the hot path can queue before new ones are dropped; rounded up to a power of two
+  size_t ring_capacity{4096};
+  // Messages waiting in spdlog's thread pool for the sinks; the oldest are overwritten when it is full
+  size_t sink_queue_size{8192};
+  LogLevel level{static_cast<LogLevel>(RENDY_LOG_ACTIVE_LEVEL)};
+};
+
+// Longer messages are truncated
+constexpr size_t kMaxLogMessageSize = 512;
+
+// Switches logging to the asynchronous path. RENDY_LOG_* calls format into a preallocated slot of a lock-free ring
+// and return; a background thread hands the messages to an spdlog async logger, which also becomes spdlog's default
+// logger so direct spdlog calls stop blocking on the sinks too. Before initialization, and after shutdown, RENDY_LOG_*
+// falls back to synchronous spdlog.
+RENDY_COMMON_API auto InitializeLogging(const LogConfig &config = {}) -> bool;
+// Writes out every queued message and stops the background threads
+RENDY_COMMON_API void ShutdownLogging();
+// Blocks until the messages queued so far have reached the sinks
+RENDY_COMMON_API void FlushLog();
+RENDY_COMMON_API void SetLogLevel(LogLevel level);
+[[nodiscard]] RENDY_COMMON_API auto GetLogLevel() -> LogLevel;
+// Messages dropped because the ring was full
+[[nodiscard]] RENDY_COMMON_API auto GetDroppedLogCount() -> uint64_t;
+
+// Keeps asynchronous logging running for its lifetime, e.g. at the top of main
+class RENDY_COMMON_API LoggingScope {
+public:
+  explicit LoggingScope(const LogConfig &config = {}) { static_cast<void>(InitializeLogging(config)); }
+  LoggingScope(const LoggingScope &) = delete;
+  LoggingScope(LoggingScope &&) = delete;
+  auto operator=(const LoggingScope &) -> LoggingScope & = delete;
+  auto operator=(LoggingScope &&) -> LoggingScope & = delete;
+  ~LoggingScope() { ShutdownLogging(); }
+};
+
+namespace detail {
+
+struct LogReservation {
+  std::span<char> text;
+  void *entry{nullptr}; // Null when the ring is full or logging isn't initialized
+  size_t position{0};
+};
+
+[[nodiscard]] RENDY_COMMON_API auto IsLogLevelEnabled(LogLevel level) -> bool;
+[[nodiscard]] RENDY_COMMON_API auto IsLoggingInitialized() -> bool;
+[[nodiscard]] RENDY_COMMON_API auto ReserveLogEntry(LogLevel level) -> LogReservation;
+RENDY_COMMON_API void CommitLogEntry(const LogReservation &reservation, size_t size);
+
+} // namespace detail
+
+template <typename... Args> void Log(LogLevel level, fmt::format_string<Args...> format, Args &&...args) {
+  if (!detail::IsLogLevelEnabled(level)) {
+    return;
+  }
+  if (!detail::IsLoggingInitialized()) {
+    spdlog::log(static_cast<spdlog::level::level_enum>(level), format, std::forward<Args>(args)...);
+    return;
+  }
+  const auto reservation = detail::ReserveLogEntry(level);
+  if (reservation.entry == nullptr) {
+    return;
+  }
+  // Formats straight into the slot, nothing is allocated
+  const auto result =
+      fmt::format_to_n(reservation.text.data(), reservation.text.size(), format, std::forward<Args>(args)...);
+  detail::CommitLogEntry(reservation, std::min(result.size, reservation.text.size()));
+}
+
+// Lets a burst of messages with the same key through per time window and counts the rest, e.g. for validation
+// messages that repeat every frame
+class RENDY_COMMON_API LogRateLimiter {
+  struct State {
+    std::chrono::steady_clock::time_point window_start;
+    uint32_t count{0};
+    uint32_t suppressed{0};
+  };
+
+  std::mutex _mutex;
+  std::unordered_map<uint64_t, State> _states;
+  uint32_t _burst;
+  std::chrono::steady_clock::duration _window;
+
+public:
+  LogRateLimiter(uint32_t burst, std::chrono::steady_clock::duration window) : _burst(burst), _window(window) {}
+
+  // Returns whether the message should be logged. When it opens a new window, suppressed is set to the number of
+  // messages dropped in the previous one so the caller can mention them.
+  [[nodiscard]] auto Allow(uint64_t key, uint32_t &suppressed) -> bool;
+};
+
+} // namespace rendy::common
+
+#if RENDY_LOG_ACTIVE_LEVEL <= RENDY_LOG_LEVEL_TRACE
+#define RENDY_LOG_TRACE(...) ::rendy::common::Log(::rendy::common::LogLevel::Trace, __VA_ARGS__)
+#else
+#define RENDY_LOG_TRACE(...) static_cast<void>(0)
+#endif
+#if RENDY_LOG_ACTIVE_LEVEL <= RENDY_LOG_LEVEL_DEBUG
+#define RENDY_LOG_DEBUG(...) ::rendy::common::Log(::rendy::common::LogLevel::Debug, __VA_ARGS__)
+#else
+#define RENDY_LOG_DEBUG(...) static_cast<void>(0)
+#endif
+#if RENDY_LOG_ACTIVE_LEVEL <= RENDY_LOG_LEVEL_INFO
+#define RENDY_LOG_INFO(...) ::rendy::common::Log(::rendy::common::LogLevel::Info, __VA_ARGS__)
+#else
+#define RENDY_LOG_INFO(...) static_cast<void>(0)
+#endif
+#if RENDY_LOG_ACTIVE_LEVEL <= RENDY_LOG_LEVEL_WARN
+#define RENDY_LOG_WARN(...) ::rendy::common::Log(::rendy::common::LogLevel::Warn, __VA_ARGS__)
+#else
+#define RENDY_LOG_WARN(...) static_cast<void>(0)
+#endif
+#if RENDY_LOG_ACTIVE_LEVEL <= RENDY_LOG_LEVEL_ERROR
+#define RENDY_LOG_ERROR(...) ::rendy::common::Log(::rendy::common::LogLevel::Error, __VA_ARGS__)
+#else
+#define RENDY_LOG_ERROR(...) static_cast<void>(0)
+#endif
+#if RENDY_LOG_ACTIVE_LEVEL <= RENDY_LOG_LEVEL_CRITICAL
+#define RENDY_LOG_CRITICAL(...) ::rendy::common::Log(::rendy::common::LogLevel::Critical, __VA_ARGS__)
+#else
+#define RENDY_LOG_CRITICAL(...) static_cast<void>(0)
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "rendy_common_api_export.h"
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rendy::common {
+
+struct StartupPhase {
+  std::string name;
+  std::chrono::steady_clock::duration start; // Since the timer was reset
+  std::chrono::steady_clock::duration duration;
+};
+
+// Collects how long each phase of startup took. Phases may run on several threads at once, so they are reported with
+// their start offsets rather than summed; the total is the time from the reset to the end of the last phase.
+class RENDY_COMMON_API StartupTimer {
+  using Clock = std::chrono::steady_clock;
+
+  mutable std::mutex _mutex;
+  Clock::time_point _origin{Clock::now()};
+  std::vector<StartupPhase> _phases;
+
+public:
+  // Records the phase when it goes out of scope
+  class RENDY_COMMON_API Scope {
+    StartupTimer &_timer;
+    std::string _name;
+    Clock::time_point _start{Clock::now()};
+
+  public:
+    Scope(StartupTimer &timer, std::string name) : _timer(timer), _name(std::move(name)) {}
+    Scope(const Scope &) = delete;
+    Scope(Scope &&) = delete;
+    auto operator=(const Scope &) -> Scope & = delete;
+    auto operator=(Scope &&) -> Scope & = delete;
+    ~Scope() { _timer.Record(std::move(_name), _start, Clock::now()); }
+  };
+
+  StartupTimer() = default;
+  StartupTimer(const StartupTimer &) = delete;
+  StartupTimer(StartupTimer &&) = delete;
+  auto operator=(const StartupTimer &) -> StartupTimer & = delete;
+  auto operator=(StartupTimer &&) -> StartupTimer & = delete;
+  ~StartupTimer() = default;
+
+  // Forgets every phase and starts counting from now
+  void Reset();
+  // Thread safe
+  [[nodiscard]] auto Measure(std::string name) -> Scope { return {*this, std::move(name)}; }
+  void Record(std::string name, Clock::time_point start, Clock::time_point end);
+
+  // Ordered by start
+  [[nodiscard]] auto GetPhases() const -> std::vector<StartupPhase>;
+  [[nodiscard]] auto GetTotal() const -> Clock::duration;
+  // Logs one line per phase with its start offset and duration
+  void LogReport() const;
+  // Writes the phases as JSON, e.g. for CI to track cold start times
+  [[nodiscard]] auto WriteJson(const std::filesystem::path &path) const -> bool;
+};
+
+} // namespace rendy::common
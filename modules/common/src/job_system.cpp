@@ -0,0 +1,415 @@
+#include "common/job_system.hpp"
+#include "common/log.hpp"
+#include <algorithm>
+#include <bit>
+#include <exception>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+namespace rendy::common {
+
+struct Job {
+  std::function<void()> function{};
+  std::coroutine_handle<> coroutine{}; // Resumed instead of calling function
+  JobCounter *counter{nullptr};        // Decremented once function has returned
+};
+
+namespace {
+
+// Searches an idle worker makes, yielding in between, before it goes to sleep. Waking a sleeping worker costs a
+// system call on both sides, which would dominate short jobs.
+constexpr uint32_t kIdleSpins = 32;
+
+// Chase-Lev deque: the owning worker pushes and pops at the bottom without contention, thieves take from the top and
+// only race the owner for the last job. Fixed capacity; callers fall back to the shared queue when it is full.
+class WorkStealingDeque {
+  std::vector<std::atomic<Job *>> _buffer;
+  int64_t _mask;
+  alignas(64) std::atomic<int64_t> _top{0};
+  alignas(64) std::atomic<int64_t> _bottom{0};
+
+public:
+  explicit WorkStealingDeque(size_t capacity) : _buffer(capacity), _mask(static_cast<int64_t>(capacity) - 1) {}
+
+  // Owner only
+  [[nodiscard]] auto Push(Job *job) -> bool {
+    const auto bottom = _bottom.load(std::memory_order_relaxed);
+    const auto top = _top.load(std::memory_order_acquire);
+    if (bottom - top > _mask) {
+      return false;
+    }
+    _buffer[bottom & _mask].store(job, std::memory_order_relaxed);
+    _bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Owner only
+  [[nodiscard]] auto Pop() -> Job * {
+    const auto bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    // Claims the bottom job before looking at the top, so a thief can't take it at the same time unless it is the last
+    _bottom.store(bottom, std::memory_order_seq_cst);
+    auto top = _top.load(std::memory_order_seq_cst);
+    if (top > bottom) {
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    auto *job = _buffer[bottom & _mask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+      if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        job = nullptr;
+      }
+      _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  // Any thread
+  [[nodiscard]] auto Steal() -> Job * {
+    while (true) {
+      auto top = _top.load(std::memory_order_seq_cst);
+      const auto bottom = _bottom.load(std::memory_order_seq_cst);
+      if (top >= bottom) {
+        return nullptr;
+      }
+      auto *job = _buffer[top & _mask].load(std::memory_order_relaxed);
+      if (_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return job;
+      }
+      // Lost the job to the owner or another thief, the next one may still be there
+    }
+  }
+};
+
+auto pinThread([[maybe_unused]] std::jthread &thread, [[maybe_unused]] uint32_t core) -> bool {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+  return core < 64 && SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{1} << core) != 0;
+#else
+  return false;
+#endif
+}
+
+} // namespace
+
+struct JobWorker {
+  JobSystem *system;
+  uint32_t index;
+  WorkStealingDeque deque;
+  std::jthread thread;
+
+  JobWorker(JobSystem *system, uint32_t index, size_t deque_capacity)
+      : system(system), index(index), deque(deque_capacity) {}
+};
+
+namespace {
+
+thread_local JobWorker *tls_worker = nullptr;
+
+} // namespace
+
+auto JobCounter::IsDone() const -> bool {
+  if (_pending.load(std::memory_order_acquire) != 0) {
+    return false;
+  }
+  // The job that finished last may still be releasing waiters
+  const std::scoped_lock lock(_mutex);
+  return true;
+}
+
+void JobTask::promise_type::FinalAwaiter::await_suspend(std::coroutine_handle<promise_type> handle) const noexcept {
+  auto *system = handle.promise().system;
+  auto *counter = handle.promise().counter;
+  handle.destroy();
+  if (counter != nullptr) {
+    system->finish(*counter);
+  }
+}
+
+void JobTask::promise_type::unhandled_exception() const noexcept {
+  try {
+    std::rethrow_exception(std::current_exception());
+  } catch (const std::exception &exception) {
+    RENDY_LOG_ERROR("Job coroutine threw: {}", exception.what());
+  } catch (...) {
+    RENDY_LOG_ERROR("Job coroutine threw an unknown exception");
+  }
+}
+
+auto JobSystem::WaitAwaiter::await_suspend(std::coroutine_handle<> handle) const -> bool {
+  auto job = std::make_unique<Job>(Job{.coroutine = handle});
+  auto *waited = counter; // The awaiter lives in the coroutine frame, which may be resumed once the lock is released
+  const std::scoped_lock lock(waited->_mutex);
+  if (waited->_pending.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  waited->_waiters.push_back(job.release());
+  return true;
+}
+
+void JobSystem::YieldAwaiter::await_suspend(std::coroutine_handle<> handle) const {
+  // The shared queue is first in, first out, so everything already queued there runs first. The awaiter lives in the
+  // coroutine frame, which may be gone by the time the push returns.
+  auto *owner = system;
+  owner->pushShared(std::make_unique<Job>(Job{.coroutine = handle}).release());
+  owner->wake();
+}
+
+JobSystem::JobSystem() = default;
+
+JobSystem::~JobSystem() { Destroy(); }
+
+auto JobSystem::Initialize(const JobSystemConfig &config) -> bool {
+  const auto hardware_threads = std::max(std::thread::hardware_concurrency(), 1U);
+  auto worker_count = config.worker_count;
+  if (worker_count == 0) {
+    worker_count = std::max(hardware_threads, 2U) - 1;
+  }
+  const auto capacity = std::bit_ceil(std::max<size_t>(config.deque_capacity, 2));
+  _stopping.store(false);
+
+  // Every worker exists before any starts, since workers steal from each other
+  _workers.reserve(worker_count);
+  for (uint32_t index = 0; index < worker_count; ++index) {
+    _workers.push_back(std::make_unique<JobWorker>(this, index, capacity));
+  }
+  bool pinned = config.pin_workers;
+  for (auto &worker : _workers) {
+    worker->thread = std::jthread([this, &worker = *worker] { workerLoop(worker); });
+    if (config.pin_workers) {
+      pinned = pinThread(worker->thread, (worker->index + 1) % hardware_threads) && pinned;
+    }
+  }
+  if (config.pin_workers && !pinned) {
+    RENDY_LOG_WARN("Failed to pin job system workers to cores");
+  }
+  RENDY_LOG_INFO("Job system running {} workers", worker_count);
+  return true;
+}
+
+void JobSystem::Destroy() {
+  _stopping.store(true);
+  _epoch.fetch_add(1);
+  _epoch.notify_all();
+  for (auto &worker : _workers) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+  // Jobs queued from outside after the workers left, or every job when there are none
+  while (auto *job = findJob(nullptr)) {
+    execute(job);
+  }
+  _workers.clear();
+}
+
+void JobSystem::Run(std::function<void()> job, JobCounter *counter, JobCounter *dependency) {
+  if (counter != nullptr) {
+    counter->_pending.fetch_add(1, std::memory_order_relaxed);
+  }
+  scheduleAfter(std::make_unique<Job>(Job{.function = std::move(job), .counter = counter}).release(), dependency);
+}
+
+void JobSystem::Run(JobTask task, JobCounter *counter, JobCounter *dependency) {
+  const auto handle = std::exchange(task._handle, {});
+  handle.promise().system = this;
+  handle.promise().counter = counter;
+  if (counter != nullptr) {
+    counter->_pending.fetch_add(1, std::memory_order_relaxed);
+  }
+  scheduleAfter(std::make_unique<Job>(Job{.coroutine = handle}).release(), dependency);
+}
+
+void JobSystem::Wait(JobCounter &counter) {
+  auto *worker = currentWorker();
+  while (true) {
+    const auto pending = counter._pending.load(std::memory_order_acquire);
+    if (pending == 0) {
+      break;
+    }
+    if (auto *job = findJob(worker); job != nullptr) {
+      execute(job);
+      continue;
+    }
+    // Nothing to help with, the remaining jobs are running elsewhere or waiting on other counters
+    counter._pending.wait(pending, std::memory_order_acquire);
+  }
+  const std::scoped_lock lock(counter._mutex);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)> &body) {
+  if (count == 0) {
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+  const auto range_count = (count + grain - 1) / grain;
+  const auto helper_count = std::min<size_t>(range_count - 1, _workers.size());
+  std::atomic<size_t> next{0};
+  const auto run_ranges = [&] {
+    for (auto begin = next.fetch_add(grain, std::memory_order_relaxed); begin < count;
+         begin = next.fetch_add(grain, std::memory_order_relaxed)) {
+      body(begin, std::min(begin + grain, count));
+    }
+  };
+  JobCounter counter;
+  for (size_t helper = 0; helper < helper_count; ++helper) {
+    Run(run_ranges, &counter);
+  }
+  run_ranges();
+  // Helpers that start after the caller took the last range return right away
+  Wait(counter);
+}
+
+auto JobSystem::GetThreadIndex() const -> uint32_t {
+  const auto *worker = currentWorker();
+  return worker != nullptr ? worker->index + 1 : 0;
+}
+
+void JobSystem::workerLoop(JobWorker &worker) {
+  tls_worker = &worker;
+  while (true) {
+    Job *job = nullptr;
+    uint32_t epoch = 0;
+    for (uint32_t spin = 0; spin < kIdleSpins && job == nullptr; ++spin) {
+      // Read before searching: work queued after the search bumps it, so the wait below returns right away
+      epoch = _epoch.load();
+      job = findJob(&worker);
+      if (job == nullptr) {
+        std::this_thread::yield();
+      }
+    }
+    if (job != nullptr) {
+      execute(job);
+      continue;
+    }
+    if (_stopping.load()) {
+      break;
+    }
+    _sleeping.fetch_add(1);
+    _epoch.wait(epoch);
+    _sleeping.fetch_sub(1);
+  }
+  tls_worker = nullptr;
+}
+
+void JobSystem::schedule(Job *job) {
+  auto *worker = currentWorker();
+  if (worker == nullptr || !worker->deque.Push(job)) {
+    pushShared(job);
+  }
+  wake();
+}
+
+void JobSystem::pushShared(Job *job) {
+  const std::scoped_lock lock(_shared_mutex);
+  _shared_jobs.push_back(job);
+  _shared_count.fetch_add(1, std::memory_order_release);
+}
+
+auto JobSystem::popShared() -> Job * {
+  if (_shared_count.load(std::memory_order_acquire) == 0) {
+    return nullptr;
+  }
+  const std::scoped_lock lock(_shared_mutex);
+  if (_shared_jobs.empty()) {
+    return nullptr;
+  }
+  auto *job = _shared_jobs.front();
+  _shared_jobs.pop_front();
+  _shared_count.fetch_sub(1, std::memory_order_relaxed);
+  return job;
+}
+
+auto JobSystem::findJob(JobWorker *worker) -> Job * {
+  if (worker != nullptr) {
+    if (auto *job = worker->deque.Pop(); job != nullptr) {
+      return job;
+    }
+  }
+  if (auto *job = popShared(); job != nullptr) {
+    return job;
+  }
+  // Victims are visited starting after the thief, so idle workers don't all hammer the first deque
+  const auto worker_count = _workers.size();
+  const auto start = worker != nullptr ? worker->index + 1 : 0;
+  for (size_t offset = 0; offset < worker_count; ++offset) {
+    auto &victim = *_workers[(start + offset) % worker_count];
+    if (&victim == worker) {
+      continue;
+    }
+    if (auto *job = victim.deque.Steal(); job != nullptr) {
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void JobSystem::execute(Job *job) {
+  const std::unique_ptr<Job> owned(job);
+  if (job->coroutine) {
+    // The coroutine finishes its counter itself once it returns
+    job->coroutine.resume();
+    return;
+  }
+  try {
+    job->function();
+  } catch (const std::exception &exception) {
+    RENDY_LOG_ERROR("Job threw: {}", exception.what());
+  } catch (...) {
+    RENDY_LOG_ERROR("Job threw an unknown exception");
+  }
+  if (job->counter != nullptr) {
+    finish(*job->counter);
+  }
+}
+
+void JobSystem::finish(JobCounter &counter) {
+  std::vector<Job *> waiters;
+  {
+    // Waiters check the counter under the same lock before they return, so it isn't touched once they see it done
+    const std::scoped_lock lock(counter._mutex);
+    if (counter._pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return;
+    }
+    waiters.swap(counter._waiters);
+    counter._pending.notify_all();
+  }
+  for (auto *job : waiters) {
+    schedule(job);
+  }
+}
+
+void JobSystem::scheduleAfter(Job *job, JobCounter *dependency) {
+  if (dependency != nullptr) {
+    const std::scoped_lock lock(dependency->_mutex);
+    if (dependency->_pending.load(std::memory_order_acquire) != 0) {
+      dependency->_waiters.push_back(job);
+      return;
+    }
+  }
+  schedule(job);
+}
+
+void JobSystem::wake() {
+  _epoch.fetch_add(1);
+  if (_sleeping.load() > 0) {
+    _epoch.notify_one();
+  }
+}
+
+auto JobSystem::currentWorker() const -> JobWorker * {
+  return tls_worker != nullptr && tls_worker->system == this ? tls_worker : nullptr;
+}
+
+} // namespace rendy::common
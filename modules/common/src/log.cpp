@@ -0,0 +1,227 @@
+#include "common/log.hpp"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace rendy::common {
+
+namespace {
+
+// How long the drain thread sleeps when the ring is empty. Producers never signal it except for errors, so the hot
+// path doesn't pay for a wake up.
+constexpr auto kDrainInterval = std::chrono::milliseconds(2);
+
+struct Entry {
+  // Bounded MPMC queue sequence: equal to the position when the slot is free for that position, position + 1 once
+  // its message is committed
+  std::atomic<size_t> sequence{0};
+  LogLevel level{LogLevel::Info};
+  size_t size{0};
+  std::array<char, kMaxLogMessageSize> text{};
+};
+
+struct LogSystem {
+  std::atomic<LogLevel> level{LogLevel::Info};
+  std::atomic<bool> initialized{false};
+  std::atomic<uint64_t> dropped{0};
+  uint64_t reported_dropped{0};
+
+  std::vector<Entry> ring;
+  size_t mask{0};
+  alignas(64) std::atomic<size_t> tail{0};
+  alignas(64) size_t head{0}; // Only touched by the drain thread
+  std::atomic<size_t> drained{0};
+
+  std::shared_ptr<spdlog::logger> logger;
+  std::mutex drain_mutex;
+  std::condition_variable_any drain_condition;
+  std::condition_variable_any flushed_condition;
+  bool flush_requested{false};
+  std::jthread drain_thread;
+
+  auto drain() -> size_t {
+    size_t count = 0;
+    while (true) {
+      auto &entry = ring[head & mask];
+      if (entry.sequence.load(std::memory_order_acquire) != head + 1) {
+        break;
+      }
+      logger->log(static_cast<spdlog::level::level_enum>(entry.level),
+                  std::string_view(entry.text.data(), entry.size));
+      entry.sequence.store(head + ring.size(), std::memory_order_release);
+      ++head;
+      ++count;
+    }
+    const auto total_dropped = dropped.load(std::memory_order_relaxed);
+    if (total_dropped != reported_dropped) {
+      logger->warn("{} log messages were dropped because the log ring was full", total_dropped - reported_dropped);
+      reported_dropped = total_dropped;
+    }
+    {
+      const std::scoped_lock lock(drain_mutex);
+      drained.store(head, std::memory_order_release);
+    }
+    flushed_condition.notify_all();
+    return count;
+  }
+
+  void drainLoop(const std::stop_token &stop_token) {
+    while (!stop_token.stop_requested()) {
+      if (drain() > 0) {
+        continue;
+      }
+      std::unique_lock lock(drain_mutex);
+      drain_condition.wait_for(lock, stop_token, kDrainInterval, [&] { return flush_requested; });
+      flush_requested = false;
+    }
+    drain();
+  }
+};
+
+auto logSystem() -> LogSystem & {
+  static LogSystem system;
+  return system;
+}
+
+} // namespace
+
+auto InitializeLogging(const LogConfig &config) -> bool {
+  auto &system = logSystem();
+  if (system.initialized.load()) {
+    spdlog::warn("Logging is already initialized");
+    return true;
+  }
+
+  spdlog::init_thread_pool(std::max<size_t>(config.sink_queue_size, 1), 1);
+  auto sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  // Overwriting the oldest queued message keeps a burst of logging from ever blocking the caller
+  system.logger = std::make_shared<spdlog::async_logger>("rendy", std::move(sink), spdlog::thread_pool(),
+                                                         spdlog::async_overflow_policy::overrun_oldest);
+  system.logger->flush_on(spdlog::level::err);
+  spdlog::set_default_logger(system.logger);
+  SetLogLevel(config.level);
+
+  // Producers may still hold slots from before a shutdown, so the ring is only ever allocated once
+  if (system.ring.empty()) {
+    system.ring = std::vector<Entry>(std::bit_ceil(std::max<size_t>(config.ring_capacity, 2)));
+    for (size_t i = 0; i < system.ring.size(); ++i) {
+      system.ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    system.mask = system.ring.size() - 1;
+  }
+  system.drain_thread = std::jthread([&system](const std::stop_token &stop_token) { system.drainLoop(stop_token); });
+  system.initialized.store(true, std::memory_order_release);
+  return true;
+}
+
+void ShutdownLogging() {
+  auto &system = logSystem();
+  if (!system.initialized.exchange(false)) {
+    return;
+  }
+  system.drain_thread.request_stop();
+  system.drain_thread.join();
+  system.logger->flush();
+
+  // Later spdlog calls, e.g. from static destructors, go to the same sinks synchronously
+  const auto &sinks = system.logger->sinks();
+  auto fallback = std::make_shared<spdlog::logger>("rendy", sinks.begin(), sinks.end());
+  fallback->set_level(system.logger->level());
+  spdlog::set_default_logger(std::move(fallback));
+  system.logger.reset();
+}
+
+void FlushLog() {
+  auto &system = logSystem();
+  if (!system.initialized.load(std::memory_order_acquire)) {
+    spdlog::default_logger()->flush();
+    return;
+  }
+  const auto target = system.tail.load(std::memory_order_acquire);
+  {
+    std::unique_lock lock(system.drain_mutex);
+    system.flush_requested = true;
+    system.drain_condition.notify_one();
+    system.flushed_condition.wait(lock, [&] { return system.drained.load(std::memory_order_acquire) >= target; });
+  }
+  system.logger->flush();
+}
+
+void SetLogLevel(LogLevel level) {
+  auto &system = logSystem();
+  system.level.store(level, std::memory_order_relaxed);
+  spdlog::set_level(static_cast<spdlog::level::level_enum>(level));
+}
+
+auto GetLogLevel() -> LogLevel { return logSystem().level.load(std::memory_order_relaxed); }
+
+auto GetDroppedLogCount() -> uint64_t { return logSystem().dropped.load(std::memory_order_relaxed); }
+
+namespace detail {
+
+auto IsLogLevelEnabled(LogLevel level) -> bool {
+  return level >= logSystem().level.load(std::memory_order_relaxed) && level != LogLevel::Off;
+}
+
+auto IsLoggingInitialized() -> bool { return logSystem().initialized.load(std::memory_order_acquire); }
+
+auto ReserveLogEntry(LogLevel level) -> LogReservation {
+  auto &system = logSystem();
+  auto position = system.tail.load(std::memory_order_relaxed);
+  while (true) {
+    auto &entry = system.ring[position & system.mask];
+    const auto sequence = entry.sequence.load(std::memory_order_acquire);
+    const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+    if (difference == 0) {
+      if (system.tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        entry.level = level;
+        return LogReservation{.text = entry.text, .entry = &entry, .position = position};
+      }
+    } else if (difference < 0) {
+      // The drain thread hasn't caught up; dropping keeps the caller from ever waiting on it
+      system.dropped.fetch_add(1, std::memory_order_relaxed);
+      return LogReservation{};
+    } else {
+      position = system.tail.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void CommitLogEntry(const LogReservation &reservation, size_t size) {
+  auto &entry = *static_cast<Entry *>(reservation.entry);
+  entry.size = size;
+  // The slot may be drained and reused as soon as it is published
+  const bool urgent = entry.level >= LogLevel::Error;
+  entry.sequence.store(reservation.position + 1, std::memory_order_release);
+  if (urgent) {
+    logSystem().drain_condition.notify_one();
+  }
+}
+
+} // namespace detail
+
+auto LogRateLimiter::Allow(uint64_t key, uint32_t &suppressed) -> bool {
+  const auto now = std::chrono::steady_clock::now();
+  const std::scoped_lock lock(_mutex);
+  auto &state = _states[key];
+  suppressed = 0;
+  if (state.count == 0 || now - state.window_start >= _window) {
+    suppressed = state.suppressed;
+    state = State{.window_start = now, .count = 1};
+    return true;
+  }
+  if (state.count < _burst) {
+    ++state.count;
+    return true;
+  }
+  ++state.suppressed;
+  return false;
+}
+
+} // namespace rendy::common
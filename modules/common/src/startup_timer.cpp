@@ -0,0 +1,73 @@
+#include "common/startup_timer.hpp"
+#include "common/log.hpp"
+#include <algorithm>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+namespace rendy::common {
+
+namespace {
+
+auto toMilliseconds(std::chrono::steady_clock::duration duration) -> double {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+void StartupTimer::Reset() {
+  const std::scoped_lock lock(_mutex);
+  _origin = Clock::now();
+  _phases.clear();
+}
+
+void StartupTimer::Record(std::string name, Clock::time_point start, Clock::time_point end) {
+  const std::scoped_lock lock(_mutex);
+  _phases.push_back(StartupPhase{.name = std::move(name), .start = start - _origin, .duration = end - start});
+}
+
+auto StartupTimer::GetPhases() const -> std::vector<StartupPhase> {
+  auto phases = [&] {
+    const std::scoped_lock lock(_mutex);
+    return _phases;
+  }();
+  std::ranges::stable_sort(phases, {}, &StartupPhase::start);
+  return phases;
+}
+
+auto StartupTimer::GetTotal() const -> Clock::duration {
+  const std::scoped_lock lock(_mutex);
+  Clock::duration total{};
+  for (const auto &phase : _phases) {
+    total = std::max(total, phase.start + phase.duration);
+  }
+  return total;
+}
+
+void StartupTimer::LogReport() const {
+  RENDY_LOG_INFO("Startup took {:.1f} ms", toMilliseconds(GetTotal()));
+  for (const auto &phase : GetPhases()) {
+    RENDY_LOG_INFO("  {:<24} at {:>8.1f} ms took {:>8.1f} ms", phase.name, toMilliseconds(phase.start),
+                   toMilliseconds(phase.duration));
+  }
+}
+
+auto StartupTimer::WriteJson(const std::filesystem::path &path) const -> bool {
+  auto phases = nlohmann::json::array();
+  for (const auto &phase : GetPhases()) {
+    phases.push_back({{"name", phase.name},
+                      {"start_ms", toMilliseconds(phase.start)},
+                      {"duration_ms", toMilliseconds(phase.duration)}});
+  }
+  const nlohmann::json report{{"total_ms", toMilliseconds(GetTotal())}, {"phases", std::move(phases)}};
+
+  std::ofstream file(path);
+  file << report.dump(2) << '\n';
+  if (!file) {
+    RENDY_LOG_ERROR("Failed to write startup report {}", path.string());
+    return false;
+  }
+  RENDY_LOG_INFO("Wrote startup report {}", path.string());
+  return true;
+}
+
+} // namespace rendy::common
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "rendy_engine_core_api_export.h"
+#include <array>
+
+namespace rendy::engine_core {
+
+struct Vec3 {
+  float x{0.0F};
+  float y{0.0F};
+  float z{0.0F};
+
+  auto operator==(const Vec3 &) const -> bool = default;
+};
+
+// Unit quaternion, w is the scalar part
+struct Quat {
+  float x{0.0F};
+  float y{0.0F};
+  float z{0.0F};
+  float w{1.0F};
+
+  auto operator==(const Quat &) const -> bool = default;
+};
+
+// Column major 4x4 matrix, m[column * 4 + row]. Aligned so a pair of columns loads as one AVX register.
+struct alignas(32) Mat4 {
+  std::array<float, 16> m{1.0F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F, 0.0F,
+                          0.0F, 0.0F, 1.0F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F};
+
+  auto operator==(const Mat4 &) const -> bool = default;
+};
+
+// Which kernel Multiply was built with: "AVX2", "SSE", "NEON" or "scalar"
+[[nodiscard]] RENDY_ENGINE_CORE_API auto GetSimdPath() -> const char *;
+// lhs * rhs, so rhs is applied first
+[[nodiscard]] RENDY_ENGINE_CORE_API auto Multiply(const Mat4 &lhs, const Mat4 &rhs) -> Mat4;
+// Translation * rotation * scale
+[[nodiscard]] RENDY_ENGINE_CORE_API auto ComposeTransform(const Vec3 &position, const Quat &rotation, const Vec3 &scale)
+    -> Mat4;
+
+} // namespace rendy::engine_core
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "common/job_system.hpp"
+#include "engine_core/math.hpp"
+#include "rendy_engine_core_api_export.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rendy::engine_core {
+
+// Refers to a transform through a slot that survives the transform moving in the dense arrays. The generation is
+// bumped when the slot is freed, so handles to destroyed transforms are detected instead of aliasing a new one.
+struct TransformHandle {
+  static constexpr uint32_t kInvalid = UINT32_MAX;
+  uint32_t index{kInvalid};
+  uint32_t generation{0};
+
+  [[nodiscard]] auto IsValid() const -> bool { return index != kInvalid; }
+  auto operator==(const TransformHandle &) const -> bool = default;
+};
+
+struct Transform {
+  Vec3 position;
+  Quat rotation;
+  Vec3 scale{.x = 1.0F, .y = 1.0F, .z = 1.0F};
+};
+
+// Transform hierarchy stored as dense arrays per component, so updates stream through memory instead of following
+// node pointers. Destroying a transform moves the last one into its place; handles keep pointing at the right one.
+//
+// Changing a local transform marks it dirty. UpdateWorldTransforms recomputes the dirty transforms and their
+// descendants one depth level at a time, splitting each level across the job system, and leaves everything else
+// untouched. GetChanged then lists exactly the world matrices that have to be uploaded.
+//
+// Handles that are no longer alive are ignored by the setters.
+class RENDY_ENGINE_CORE_API TransformStore {
+  struct Slot {
+    uint32_t dense{TransformHandle::kInvalid};
+    uint32_t generation{0};
+    uint32_t parent{TransformHandle::kInvalid};
+    uint32_t first_child{TransformHandle::kInvalid};
+    uint32_t next_sibling{TransformHandle::kInvalid};
+    uint32_t previous_sibling{TransformHandle::kInvalid};
+  };
+
+  std::vector<Slot> _slots;
+  std::vector<uint32_t> _free_slots;
+
+  // Indexed by dense position
+  std::vector<Vec3> _positions;
+  std::vector<Quat> _rotations;
+  std::vector<Vec3> _scales;
+  std::vector<Mat4> _world;
+  std::vector<uint32_t> _depths;
+  std::vector<uint32_t> _slot_of;
+  std::vector<uint8_t> _dirty; // Bytes rather than bits, so workers can flag neighbouring transforms
+
+  // Slots of dirty transforms by depth, and the children each chunk of a level found while it was updated
+  std::vector<std::vector<uint32_t>> _dirty_levels;
+  std::vector<std::vector<uint32_t>> _chunk_children;
+  std::vector<TransformHandle> _changed;
+
+  [[nodiscard]] auto slotOf(TransformHandle handle) const -> const Slot *;
+  [[nodiscard]] auto handleOf(uint32_t slot) const -> TransformHandle;
+  void markDirty(uint32_t slot);
+  void unmarkDirty(uint32_t slot);
+  void link(uint32_t slot, uint32_t parent);
+  void unlink(uint32_t slot);
+  void setDepths(uint32_t slot, uint32_t depth);
+  void destroyOne(uint32_t slot);
+  void updateOne(uint32_t slot, std::vector<uint32_t> &children);
+
+public:
+  // Transforms updated per chunk of a level
+  static constexpr size_t kUpdateGrain = 256;
+
+  [[nodiscard]] auto Create(const Transform &local = {}, TransformHandle parent = {}) -> TransformHandle;
+  // Destroys the transform and all of its descendants
+  void Destroy(TransformHandle handle);
+  [[nodiscard]] auto IsAlive(TransformHandle handle) const -> bool { return slotOf(handle) != nullptr; }
+
+  // Returns false when the new parent is the transform itself or one of its descendants
+  auto SetParent(TransformHandle handle, TransformHandle parent) -> bool;
+  void SetLocal(TransformHandle handle, const Transform &local);
+  void SetPosition(TransformHandle handle, const Vec3 &position);
+  void SetRotation(TransformHandle handle, const Quat &rotation);
+  void SetScale(TransformHandle handle, const Vec3 &scale);
+
+  [[nodiscard]] auto GetParent(TransformHandle handle) const -> TransformHandle;
+  [[nodiscard]] auto GetLocal(TransformHandle handle) const -> Transform;
+  // As of the last UpdateWorldTransforms, identity for handles that are not alive
+  [[nodiscard]] auto GetWorld(TransformHandle handle) const -> const Mat4 &;
+
+  // Recomputes the world matrices of dirty transforms and their descendants. Runs on the calling thread without a
+  // job system.
+  void UpdateWorldTransforms(common::JobSystem *jobs = nullptr);
+  // Transforms whose world matrix the last UpdateWorldTransforms recomputed, parents before children
+  [[nodiscard]] auto GetChanged() const -> std::span<const TransformHandle> { return _changed; }
+  [[nodiscard]] auto GetSize() const -> size_t { return _positions.size(); }
+  // World matrices in dense order, e.g. for a full upload after loading a scene
+  [[nodiscard]] auto GetWorldMatrices() const -> std::span<const Mat4> { return _world; }
+};
+
+} // namespace rendy::engine_core
@@ -0,0 +1,116 @@
+#include "engine_core/math.hpp"
+
+#if defined(__AVX2__) && defined(__FMA__)
+#define RENDY_SIMD_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#define RENDY_SIMD_SSE
+#include <xmmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define RENDY_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace rendy::engine_core {
+
+auto GetSimdPath() -> const char * {
+#if defined(RENDY_SIMD_AVX2)
+  return "AVX2";
+#elif defined(RENDY_SIMD_SSE)
+  return "SSE";
+#elif defined(RENDY_SIMD_NEON)
+  return "NEON";
+#else
+  return "scalar";
+#endif
+}
+
+// Every column of the result is a linear combination of the columns of lhs, weighted by the matching column of rhs
+auto Multiply(const Mat4 &lhs, const Mat4 &rhs) -> Mat4 {
+  Mat4 result;
+  const float *a = lhs.m.data();
+  const float *b = rhs.m.data();
+  float *c = result.m.data();
+#if defined(RENDY_SIMD_AVX2)
+  // Two result columns per iteration: each lhs column sits in both halves, the in-lane permute broadcasts one weight
+  // from each of the two rhs columns
+  const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a));
+  const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a + 4));
+  const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a + 8));
+  const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a + 12));
+  for (int column = 0; column < 16; column += 8) {
+    const __m256 weights = _mm256_load_ps(b + column);
+    __m256 sum = _mm256_mul_ps(a0, _mm256_permute_ps(weights, 0x00));
+    sum = _mm256_fmadd_ps(a1, _mm256_permute_ps(weights, 0x55), sum);
+    sum = _mm256_fmadd_ps(a2, _mm256_permute_ps(weights, 0xAA), sum);
+    sum = _mm256_fmadd_ps(a3, _mm256_permute_ps(weights, 0xFF), sum);
+    _mm256_store_ps(c + column, sum);
+  }
+#elif defined(RENDY_SIMD_SSE)
+  const __m128 a0 = _mm_load_ps(a);
+  const __m128 a1 = _mm_load_ps(a + 4);
+  const __m128 a2 = _mm_load_ps(a + 8);
+  const __m128 a3 = _mm_load_ps(a + 12);
+  for (int column = 0; column < 16; column += 4) {
+    __m128 sum = _mm_mul_ps(a0, _mm_set1_ps(b[column]));
+    sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_set1_ps(b[column + 1])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(b[column + 2])));
+    sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(b[column + 3])));
+    _mm_store_ps(c + column, sum);
+  }
+#elif defined(RENDY_SIMD_NEON)
+  const float32x4_t a0 = vld1q_f32(a);
+  const float32x4_t a1 = vld1q_f32(a + 4);
+  const float32x4_t a2 = vld1q_f32(a + 8);
+  const float32x4_t a3 = vld1q_f32(a + 12);
+  for (int column = 0; column < 16; column += 4) {
+    const float32x4_t weights = vld1q_f32(b + column);
+    float32x4_t sum = vmulq_laneq_f32(a0, weights, 0);
+    sum = vfmaq_laneq_f32(sum, a1, weights, 1);
+    sum = vfmaq_laneq_f32(sum, a2, weights, 2);
+    sum = vfmaq_laneq_f32(sum, a3, weights, 3);
+    vst1q_f32(c + column, sum);
+  }
+#else
+  for (int column = 0; column < 16; column += 4) {
+    for (int row = 0; row < 4; ++row) {
+      c[column + row] = (a[row] * b[column]) + (a[4 + row] * b[column + 1]) + (a[8 + row] * b[column + 2]) +
+                        (a[12 + row] * b[column + 3]);
+    }
+  }
+#endif
+  return result;
+}
+
+auto ComposeTransform(const Vec3 &position, const Quat &rotation, const Vec3 &scale) -> Mat4 {
+  const auto [x, y, z, w] = rotation;
+  const float xx = x * x;
+  const float yy = y * y;
+  const float zz = z * z;
+  const float xy = x * y;
+  const float xz = x * z;
+  const float yz = y * z;
+  const float wx = w * x;
+  const float wy = w * y;
+  const float wz = w * z;
+  Mat4 result;
+  result.m = {(1.0F - (2.0F * (yy + zz))) * scale.x,
+              2.0F * (xy + wz) * scale.x,
+              2.0F * (xz - wy) * scale.x,
+              0.0F,
+              2.0F * (xy - wz) * scale.y,
+              (1.0F - (2.0F * (xx + zz))) * scale.y,
+              2.0F * (yz + wx) * scale.y,
+              0.0F,
+              2.0F * (xz + wy) * scale.z,
+              2.0F * (yz - wx) * scale.z,
+              (1.0F - (2.0F * (xx + yy))) * scale.z,
+              0.0F,
+              position.x,
+              position.y,
+              position.z,
+              1.0F};
+  return result;
+}
+
+} // namespace rendy::engine_core
@@ -0,0 +1,314 @@
+#include "engine_core/transform_store.hpp"
+#include <algorithm>
+
+namespace rendy::engine_core {
+
+namespace {
+
+constexpr uint32_t kNone = TransformHandle::kInvalid;
+
+} // namespace
+
+auto TransformStore::Create(const Transform &local, TransformHandle parent) -> TransformHandle {
+  uint32_t slot = 0;
+  if (!_free_slots.empty()) {
+    slot = _free_slots.back();
+    _free_slots.pop_back();
+  } else {
+    slot = static_cast<uint32_t>(_slots.size());
+    _slots.emplace_back();
+  }
+  const auto dense = static_cast<uint32_t>(_positions.size());
+  _slots[slot].dense = dense;
+  _positions.push_back(local.position);
+  _rotations.push_back(local.rotation);
+  _scales.push_back(local.scale);
+  _world.emplace_back();
+  _depths.push_back(0);
+  _slot_of.push_back(slot);
+  _dirty.push_back(0);
+
+  if (const auto *parent_slot = slotOf(parent); parent_slot != nullptr) {
+    link(slot, parent.index);
+    _depths[dense] = _depths[parent_slot->dense] + 1;
+  }
+  markDirty(slot);
+  return handleOf(slot);
+}
+
+void TransformStore::Destroy(TransformHandle handle) {
+  if (slotOf(handle) == nullptr) {
+    return;
+  }
+  unlink(handle.index);
+  std::vector<uint32_t> pending{handle.index};
+  while (!pending.empty()) {
+    const auto slot = pending.back();
+    pending.pop_back();
+    for (auto child = _slots[slot].first_child; child != kNone; child = _slots[child].next_sibling) {
+      pending.push_back(child);
+    }
+    unmarkDirty(slot);
+    destroyOne(slot);
+  }
+}
+
+auto TransformStore::SetParent(TransformHandle handle, TransformHandle parent) -> bool {
+  if (slotOf(handle) == nullptr) {
+    return false;
+  }
+  const auto *parent_slot = slotOf(parent);
+  if (parent.IsValid() && parent_slot == nullptr) {
+    return false;
+  }
+  for (auto ancestor = parent_slot != nullptr ? parent.index : kNone; ancestor != kNone;
+       ancestor = _slots[ancestor].parent) {
+    if (ancestor == handle.index) {
+      return false;
+    }
+  }
+
+  // The whole subtree is recomputed from its root, and the depths its dirty entries were filed under change
+  std::vector<uint32_t> pending{handle.index};
+  while (!pending.empty()) {
+    const auto slot = pending.back();
+    pending.pop_back();
+    unmarkDirty(slot);
+    for (auto child = _slots[slot].first_child; child != kNone; child = _slots[child].next_sibling) {
+      pending.push_back(child);
+    }
+  }
+  unlink(handle.index);
+  if (parent_slot != nullptr) {
+    link(handle.index, parent.index);
+  }
+  setDepths(handle.index, parent_slot != nullptr ? _depths[parent_slot->dense] + 1 : 0);
+  markDirty(handle.index);
+  return true;
+}
+
+void TransformStore::SetLocal(TransformHandle handle, const Transform &local) {
+  if (const auto *slot = slotOf(handle); slot != nullptr) {
+    _positions[slot->dense] = local.position;
+    _rotations[slot->dense] = local.rotation;
+    _scales[slot->dense] = local.scale;
+    markDirty(handle.index);
+  }
+}
+
+void TransformStore::SetPosition(TransformHandle handle, const Vec3 &position) {
+  if (const auto *slot = slotOf(handle); slot != nullptr) {
+    _positions[slot->dense] = position;
+    markDirty(handle.index);
+  }
+}
+
+void TransformStore::SetRotation(TransformHandle handle, const Quat &rotation) {
+  if (const auto *slot = slotOf(handle); slot != nullptr) {
+    _rotations[slot->dense] = rotation;
+    markDirty(handle.index);
+  }
+}
+
+void TransformStore::SetScale(TransformHandle handle, const Vec3 &scale) {
+  if (const auto *slot = slotOf(handle); slot != nullptr) {
+    _scales[slot->dense] = scale;
+    markDirty(handle.index);
+  }
+}
+
+auto TransformStore::GetParent(TransformHandle handle) const -> TransformHandle {
+  const auto *slot = slotOf(handle);
+  if (slot == nullptr || slot->parent == kNone) {
+    return {};
+  }
+  return handleOf(slot->parent);
+}
+
+auto TransformStore::GetLocal(TransformHandle handle) const -> Transform {
+  const auto *slot = slotOf(handle);
+  if (slot == nullptr) {
+    return {};
+  }
+  return {.position = _positions[slot->dense], .rotation = _rotations[slot->dense], .scale = _scales[slot->dense]};
+}
+
+auto TransformStore::GetWorld(TransformHandle handle) const -> const Mat4 & {
+  static const Mat4 kIdentity;
+  const auto *slot = slotOf(handle);
+  return slot != nullptr ? _world[slot->dense] : kIdentity;
+}
+
+void TransformStore::UpdateWorldTransforms(common::JobSystem *jobs) {
+  _changed.clear();
+  // Parents are one level above their children, so a level only reads world matrices that are already final
+  for (size_t depth = 0; depth < _dirty_levels.size(); ++depth) {
+    const auto count = _dirty_levels[depth].size();
+    if (count == 0) {
+      continue;
+    }
+    const auto chunk_count = (count + kUpdateGrain - 1) / kUpdateGrain;
+    if (_chunk_children.size() < chunk_count) {
+      _chunk_children.resize(chunk_count);
+    }
+    const auto update_range = [this, depth](size_t begin, size_t end) {
+      auto &children = _chunk_children[begin / kUpdateGrain];
+      children.clear();
+      const auto &level = _dirty_levels[depth];
+      for (size_t index = begin; index < end; ++index) {
+        updateOne(level[index], children);
+      }
+    };
+    if (jobs != nullptr) {
+      jobs->ParallelFor(count, kUpdateGrain, update_range);
+    } else {
+      for (size_t begin = 0; begin < count; begin += kUpdateGrain) {
+        update_range(begin, std::min(begin + kUpdateGrain, count));
+      }
+    }
+
+    bool has_children = false;
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+      has_children = has_children || !_chunk_children[chunk].empty();
+    }
+    if (has_children) {
+      if (_dirty_levels.size() <= depth + 1) {
+        _dirty_levels.resize(depth + 2);
+      }
+      auto &next = _dirty_levels[depth + 1];
+      for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        next.insert(next.end(), _chunk_children[chunk].begin(), _chunk_children[chunk].end());
+      }
+    }
+
+    auto &level = _dirty_levels[depth];
+    for (const auto slot : level) {
+      _dirty[_slots[slot].dense] = 0;
+      _changed.push_back(handleOf(slot));
+    }
+    level.clear();
+  }
+}
+
+auto TransformStore::slotOf(TransformHandle handle) const -> const Slot * {
+  if (handle.index >= _slots.size()) {
+    return nullptr;
+  }
+  const auto &slot = _slots[handle.index];
+  return slot.dense != kNone && slot.generation == handle.generation ? &slot : nullptr;
+}
+
+auto TransformStore::handleOf(uint32_t slot) const -> TransformHandle {
+  return {.index = slot, .generation = _slots[slot].generation};
+}
+
+void TransformStore::markDirty(uint32_t slot) {
+  const auto dense = _slots[slot].dense;
+  if (_dirty[dense] != 0) {
+    return;
+  }
+  _dirty[dense] = 1;
+  const auto depth = _depths[dense];
+  if (_dirty_levels.size() <= depth) {
+    _dirty_levels.resize(depth + 1);
+  }
+  _dirty_levels[depth].push_back(slot);
+}
+
+void TransformStore::unmarkDirty(uint32_t slot) {
+  const auto dense = _slots[slot].dense;
+  if (_dirty[dense] == 0) {
+    return;
+  }
+  _dirty[dense] = 0;
+  auto &level = _dirty_levels[_depths[dense]];
+  if (const auto it = std::ranges::find(level, slot); it != level.end()) {
+    *it = level.back();
+    level.pop_back();
+  }
+}
+
+void TransformStore::link(uint32_t slot, uint32_t parent) {
+  auto &node = _slots[slot];
+  auto &parent_node = _slots[parent];
+  node.parent = parent;
+  node.previous_sibling = kNone;
+  node.next_sibling = parent_node.first_child;
+  if (parent_node.first_child != kNone) {
+    _slots[parent_node.first_child].previous_sibling = slot;
+  }
+  parent_node.first_child = slot;
+}
+
+void TransformStore::unlink(uint32_t slot) {
+  auto &node = _slots[slot];
+  if (node.parent == kNone) {
+    return;
+  }
+  if (node.previous_sibling != kNone) {
+    _slots[node.previous_sibling].next_sibling = node.next_sibling;
+  } else {
+    _slots[node.parent].first_child = node.next_sibling;
+  }
+  if (node.next_sibling != kNone) {
+    _slots[node.next_sibling].previous_sibling = node.previous_sibling;
+  }
+  node.parent = kNone;
+  node.next_sibling = kNone;
+  node.previous_sibling = kNone;
+}
+
+void TransformStore::setDepths(uint32_t slot, uint32_t depth) {
+  std::vector<std::pair<uint32_t, uint32_t>> pending{{slot, depth}};
+  while (!pending.empty()) {
+    const auto [current, current_depth] = pending.back();
+    pending.pop_back();
+    _depths[_slots[current].dense] = current_depth;
+    for (auto child = _slots[current].first_child; child != kNone; child = _slots[child].next_sibling) {
+      pending.emplace_back(child, current_depth + 1);
+    }
+  }
+}
+
+void TransformStore::destroyOne(uint32_t slot) {
+  // Moves the last transform into the hole so the arrays stay dense
+  const auto dense = _slots[slot].dense;
+  const auto last = static_cast<uint32_t>(_positions.size() - 1);
+  if (dense != last) {
+    _positions[dense] = _positions[last];
+    _rotations[dense] = _rotations[last];
+    _scales[dense] = _scales[last];
+    _world[dense] = _world[last];
+    _depths[dense] = _depths[last];
+    _dirty[dense] = _dirty[last];
+    _slot_of[dense] = _slot_of[last];
+    _slots[_slot_of[dense]].dense = dense;
+  }
+  _positions.pop_back();
+  _rotations.pop_back();
+  _scales.pop_back();
+  _world.pop_back();
+  _depths.pop_back();
+  _dirty.pop_back();
+  _slot_of.pop_back();
+
+  _slots[slot] = Slot{.generation = _slots[slot].generation + 1};
+  _free_slots.push_back(slot);
+}
+
+void TransformStore::updateOne(uint32_t slot, std::vector<uint32_t> &children) {
+  const auto &node = _slots[slot];
+  const auto dense = node.dense;
+  const auto local = ComposeTransform(_positions[dense], _rotations[dense], _scales[dense]);
+  _world[dense] = node.parent == kNone ? local : Multiply(_world[_slots[node.parent].dense], local);
+  // Each child has one parent, so no other chunk touches its flag
+  for (auto child = node.first_child; child != kNone; child = _slots[child].next_sibling) {
+    auto &dirty = _dirty[_slots[child].dense];
+    if (dirty == 0) {
+      dirty = 1;
+      children.push_back(child);
+    }
+  }
+}
+
+} // namespace rendy::engine_core
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "enums.hpp"
+#include "rendy_api_export.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace rendy::graphics::core {
+
+struct BufferDesc {
+  uint64_t size{0};
+  BufferUsage usage{BufferUsage::None};
+  MemoryUsage memory_usage{MemoryUsage::GpuOnly};
+};
+
+class RENDY_API Buffer {
+public:
+  Buffer() = default;
+  Buffer(const Buffer &) = delete;
+  Buffer(Buffer &&) = delete;
+  auto operator=(const Buffer &) -> Buffer & = delete;
+  auto operator=(Buffer &&) -> Buffer & = delete;
+  virtual ~Buffer() = default;
+
+  [[nodiscard]] virtual auto GetDesc() const -> const BufferDesc & = 0;
+  // Null when the buffer lives in memory the CPU can't see
+  [[nodiscard]] virtual auto GetMappedData() const -> std::byte * = 0;
+  [[nodiscard]] auto IsMapped() const -> bool { return GetMappedData() != nullptr; }
+  // GPU address of the first byte. Shaders read through it like a pointer, without a descriptor.
+  [[nodiscard]] virtual auto GetDeviceAddress() const -> uint64_t = 0;
+
+  // Writes straight into the mapping when there is one, otherwise queues a staged copy that is submitted with the
+  // next upload flush
+  virtual void Upload(std::span<const std::byte> data, uint64_t offset = 0) = 0;
+};
+
+} // namespace rendy::graphics::core
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "enums.hpp"
+#include "rendy_api_export.h"
+#include <cstdint>
+
+namespace rendy::graphics::core {
+
+class Buffer;
+class Pipeline;
+
+class RENDY_API CommandList {
+public:
+  CommandList() = default;
+  CommandList(const CommandList &) = delete;
+  CommandList(CommandList &&) = delete;
+  auto operator=(const CommandList &) -> CommandList & = delete;
+  auto operator=(CommandList &&) -> CommandList & = delete;
+  virtual ~CommandList() = default;
+
+  [[nodiscard]] virtual auto GetQueueType() const -> QueueType = 0;
+
+  virtual void Begin() = 0;
+  virtual void End() = 0;
+
+  virtual void BindPipeline(const Pipeline &pipeline) = 0;
+  virtual void BindVertexBuffer(uint32_t binding, const Buffer &buffer, uint64_t offset = 0) = 0;
+  virtual void BindIndexBuffer(const Buffer &buffer, uint64_t offset = 0, bool use_32_bit_indices = true) = 0;
+  virtual void Draw(uint32_t vertex_count, uint32_t instance_count = 1, uint32_t first_vertex = 0,
+                    uint32_t first_instance = 0) = 0;
+  virtual void DrawIndexed(uint32_t index_count, uint32_t instance_count = 1, uint32_t first_index = 0,
+                           int32_t vertex_offset = 0, uint32_t first_instance = 0) = 0;
+  // Draws draw_count non-indexed commands laid out stride bytes apart
+  virtual void DrawIndirect(const Buffer &buffer, uint64_t offset, uint32_t draw_count, uint32_t stride) = 0;
+  // Draws draw_count commands laid out stride bytes apart
+  virtual void DrawIndexedIndirect(const Buffer &buffer, uint64_t offset, uint32_t draw_count, uint32_t stride) = 0;
+  // Like DrawIndexedIndirect, with the number of draws read by the GPU from count_buffer and capped at max_draw_count
+  virtual void DrawIndexedIndirectCount(const Buffer &buffer, uint64_t offset, const Buffer &count_buffer,
+                                        uint64_t count_offset, uint32_t max_draw_count, uint32_t stride) = 0;
+  virtual void Dispatch(uint32_t group_count_x, uint32_t group_count_y = 1, uint32_t group_count_z = 1) = 0;
+  virtual void CopyBuffer(const Buffer &src, uint64_t src_offset, const Buffer &dst, uint64_t dst_offset,
+                          uint64_t size) = 0;
+};
+
+} // namespace rendy::graphics::core
@@ -7,6 +7,18 @@ namespace rendy::graphics::core {
 
 struct DeviceCapabilities {
   bool compute_support{false};
+  bool async_compute_support{false};          // Compute queue can run alongside the graphics queue
+  bool dedicated_transfer_support{false};     // Transfer queue lives in its own family
+  bool bindless_support{false};               // Descriptor indexing with update-after-bind for a global resource heap
+  bool memory_budget_support{false};          // VK_EXT_memory_budget reports per heap budgets and usage
+  bool pipeline_statistics_support{false};    // Pipeline statistics queries for the GPU profiler
+  bool present_support{false};                // The device was created for a surface and can create swapchains
+  bool swapchain_maintenance1_support{false}; // Present fences and present mode switches without recreation
+  bool present_wait_support{false};           // VK_KHR_present_wait lets low latency mode wait for the display
+  bool multi_draw_indirect_support{false};    // One indirect draw call can issue more than one draw
+  bool draw_indirect_count_support{false};    // The GPU can read the number of indirect draws from a buffer
+  bool mesh_shader_support{false};            // VK_EXT_mesh_shader task and mesh shaders
+  bool sampler_anisotropy_support{false};     // Samplers can filter anisotropically
 };
 
 class RENDY_API Device {
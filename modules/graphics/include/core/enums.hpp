@@ -19,4 +19,81 @@ inline auto operator&(QueueType lhs, QueueType rhs) -> QueueType {
   return static_cast<QueueType>(static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs));
 }
 
+enum class PipelineType : uint8_t { Graphics, Compute };
+
+enum class BufferUsage : uint32_t {
+  None = 0x0,
+  Vertex = 0x1,
+  Index = 0x2,
+  Uniform = 0x4,
+  Storage = 0x8,
+  Indirect = 0x10,
+  TransferSrc = 0x20,
+  TransferDst = 0x40,
+};
+
+inline auto operator|(BufferUsage lhs, BufferUsage rhs) -> BufferUsage {
+  return static_cast<BufferUsage>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+}
+
+inline auto operator&(BufferUsage lhs, BufferUsage rhs) -> BufferUsage {
+  return static_cast<BufferUsage>(static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs));
+}
+
+inline auto HasFlag(BufferUsage value, BufferUsage flag) -> bool { return (value & flag) != BufferUsage::None; }
+
+enum class MemoryUsage : uint8_t {
+  GpuOnly,  // Device local, filled through the staging ring
+  Upload,   // Host visible and persistently mapped
+  Readback, // Host visible and cached, for GPU to CPU transfers
+  Dynamic,  // Rewritten every frame: device local and mapped when the memory allows it, staged otherwise
+};
+
+enum class Format : uint16_t {
+  Undefined,
+  R8Unorm,
+  R8G8Unorm,
+  R8G8B8A8Unorm,
+  R8G8B8A8Srgb,
+  B8G8R8A8Unorm,
+  B8G8R8A8Srgb,
+  R16G16B16A16Sfloat,
+  R32G32B32A32Sfloat,
+  BC1RgbaUnorm,
+  BC1RgbaSrgb,
+  BC3Unorm,
+  BC3Srgb,
+  BC4Unorm,
+  BC5Unorm,
+  BC6HUfloat,
+  BC7Unorm,
+  BC7Srgb,
+  ASTC4x4Unorm,
+  ASTC4x4Srgb,
+  ASTC6x6Unorm,
+  ASTC6x6Srgb,
+  ASTC8x8Unorm,
+  ASTC8x8Srgb,
+};
+
+enum class ImageUsage : uint32_t {
+  None = 0x0,
+  Sampled = 0x1,
+  Storage = 0x2,
+  ColorAttachment = 0x4,
+  DepthStencilAttachment = 0x8,
+  TransferSrc = 0x10,
+  TransferDst = 0x20,
+};
+
+inline auto operator|(ImageUsage lhs, ImageUsage rhs) -> ImageUsage {
+  return static_cast<ImageUsage>(static_cast<uint32_t>(lhs) | static_cast<uint32_t>(rhs));
+}
+
+inline auto operator&(ImageUsage lhs, ImageUsage rhs) -> ImageUsage {
+  return static_cast<ImageUsage>(static_cast<uint32_t>(lhs) & static_cast<uint32_t>(rhs));
+}
+
+inline auto HasFlag(ImageUsage value, ImageUsage flag) -> bool { return (value & flag) != ImageUsage::None; }
+
 } // namespace rendy::graphics::core
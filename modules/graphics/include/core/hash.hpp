@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+namespace rendy::graphics::core {
+
+constexpr uint64_t kHashSeed = 0xcbf29ce484222325ULL;
+
+// 64-bit FNV-1a, meant for cache keys and not for anything that needs collision resistance against an adversary
+[[nodiscard]] inline auto HashBytes(std::span<const std::byte> bytes, uint64_t seed = kHashSeed) -> uint64_t {
+  constexpr uint64_t kPrime = 0x100000001b3ULL;
+  auto hash = seed;
+  for (const auto byte : bytes) {
+    hash ^= static_cast<uint64_t>(byte);
+    hash *= kPrime;
+  }
+  return hash;
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+[[nodiscard]] auto HashValue(const T &value, uint64_t seed = kHashSeed) -> uint64_t {
+  return HashBytes(std::as_bytes(std::span(&value, 1)), seed);
+}
+
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+[[nodiscard]] auto HashSpan(std::span<const T> values, uint64_t seed = kHashSeed) -> uint64_t {
+  return HashBytes(std::as_bytes(values), HashValue(values.size(), seed));
+}
+
+[[nodiscard]] inline auto HashString(std::string_view value, uint64_t seed = kHashSeed) -> uint64_t {
+  return HashSpan(std::span(value.data(), value.size()), seed);
+}
+
+} // namespace rendy::graphics::core
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "enums.hpp"
+#include "rendy_api_export.h"
+#include <cstdint>
+
+namespace rendy::graphics::core {
+
+struct ImageExtent {
+  uint32_t width{1};
+  uint32_t height{1};
+
+  auto operator==(const ImageExtent &) const -> bool = default;
+};
+
+struct ImageDesc {
+  ImageExtent extent;
+  uint32_t mip_levels{1};
+  uint32_t array_layers{1};
+  Format format{Format::Undefined};
+  ImageUsage usage{ImageUsage::Sampled};
+};
+
+// Texels are stored in blocks of block_width x block_height, uncompressed formats use 1x1 blocks
+struct FormatInfo {
+  uint32_t block_width{1};
+  uint32_t block_height{1};
+  uint32_t block_size{0}; // Bytes per block, zero for Format::Undefined
+  bool srgb{false};
+};
+
+[[nodiscard]] RENDY_API auto GetFormatInfo(Format format) -> FormatInfo;
+// Levels in a full chain down to 1x1
+[[nodiscard]] RENDY_API auto GetFullMipCount(ImageExtent extent) -> uint32_t;
+[[nodiscard]] RENDY_API auto GetMipExtent(ImageExtent extent, uint32_t level) -> ImageExtent;
+// Tightly packed size of one level across all array layers
+[[nodiscard]] RENDY_API auto GetMipSize(const ImageDesc &desc, uint32_t level) -> uint64_t;
+// Tightly packed size of levels [first_level, mip_levels)
+[[nodiscard]] RENDY_API auto GetMipChainSize(const ImageDesc &desc, uint32_t first_level) -> uint64_t;
+
+class RENDY_API Image {
+public:
+  Image() = default;
+  Image(const Image &) = delete;
+  Image(Image &&) = delete;
+  auto operator=(const Image &) -> Image & = delete;
+  auto operator=(Image &&) -> Image & = delete;
+  virtual ~Image() = default;
+
+  [[nodiscard]] virtual auto GetDesc() const -> const ImageDesc & = 0;
+};
+
+} // namespace rendy::graphics::core
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "rendy_api_export.h"
+#include "texture.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rendy::graphics::core {
+
+// Whether the device can sample the format, so loaders can pick what to transcode to
+using FormatSupportQuery = std::function<bool(Format)>;
+
+// KTX2 texture read through a file mapping. Block compressed and uncompressed levels are copied from the mapping into
+// the staging memory as they are, without any decoding on the CPU. Basis Universal payloads (UASTC and ETC1S) are
+// transcoded on the streamer's workers to BC7, ASTC 4x4 or RGBA8, whichever the device supports first; that needs a
+// build with RENDY_WITH_BASISU.
+class RENDY_API Ktx2TextureSource final : public TextureSource {
+  struct Level {
+    uint64_t offset{0};
+    uint64_t size{0};
+  };
+  struct BasisTranscoder;
+
+  std::string _name;
+  ImageDesc _desc;
+  MappedFile _file;
+  std::vector<Level> _levels;
+  std::unique_ptr<BasisTranscoder> _transcoder; // Only set for Basis Universal payloads
+
+  Ktx2TextureSource();
+  [[nodiscard]] auto parse(const FormatSupportQuery &is_supported) -> bool;
+  [[nodiscard]] auto initializeTranscoder(const FormatSupportQuery &is_supported, bool srgb) -> bool;
+
+public:
+  ~Ktx2TextureSource() override;
+
+  // Returns null when the file can't be read, isn't a 2D KTX2 texture or holds a format the device can't sample
+  [[nodiscard]] static auto Open(const std::filesystem::path &path, const FormatSupportQuery &is_supported)
+      -> std::unique_ptr<Ktx2TextureSource>;
+
+  [[nodiscard]] auto GetName() const -> std::string_view override { return _name; }
+  [[nodiscard]] auto GetDesc() const -> const ImageDesc & override { return _desc; }
+  auto LoadMip(uint32_t level, std::span<std::byte> dst) -> bool override;
+};
+
+} // namespace rendy::graphics::core
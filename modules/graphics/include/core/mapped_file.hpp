@@ -0,0 +1,30 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace rendy::graphics::core {
+
+// Read-only mapping of a whole file. Loaders copy out of the page cache directly instead of reading into a buffer
+// first, and only the pages they touch are ever read from disk.
+class RENDY_API MappedFile {
+  std::span<const std::byte> _data;
+
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(MappedFile &&) = delete;
+  auto operator=(const MappedFile &) -> MappedFile & = delete;
+  auto operator=(MappedFile &&) -> MappedFile & = delete;
+  ~MappedFile() { Close(); }
+
+  [[nodiscard]] auto Open(const std::filesystem::path &path) -> bool;
+  void Close();
+
+  [[nodiscard]] auto IsOpen() const -> bool { return !_data.empty(); }
+  [[nodiscard]] auto GetData() const -> std::span<const std::byte> { return _data; }
+};
+
+} // namespace rendy::graphics::core
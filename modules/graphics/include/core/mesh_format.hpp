@@ -0,0 +1,147 @@
+#pragma once
+
+#include "mapped_file.hpp"
+#include "rendy_api_export.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <type_traits>
+
+namespace rendy::graphics::core {
+
+// Cooked mesh files (.rmesh) as written by tools/mesh_cooker. Everything is laid out the way the GPU reads it, so a
+// loader maps the file and copies each section into its buffer without touching the data on the CPU.
+//
+// The file starts with a MeshFileHeader; its section table gives the offset and size of every array. Sections are
+// aligned to kMeshSectionAlignment, which also satisfies storage buffer offset alignment, so they can be bound
+// straight out of one buffer holding the whole file. All values are little endian.
+constexpr uint32_t kMeshFileMagic = 0x48534d52; // "RMSH"
+// Bumped whenever the layout changes; files of another version are rejected and have to be cooked again
+constexpr uint32_t kMeshFileVersion = 1;
+constexpr uint64_t kMeshSectionAlignment = 256;
+// Meshlet limits the cooker builds for, suiting both mesh shader workgroups and the compute fallback
+constexpr uint32_t kMeshletMaxVertices = 64;
+constexpr uint32_t kMeshletMaxTriangles = 124;
+constexpr uint32_t kMeshMaxLods = 8;
+
+enum class MeshSection : uint32_t {
+  Positions,        // MeshPosition per vertex
+  Attributes,       // MeshAttributes per vertex
+  Indices,          // uint32_t, triangle lists of every LOD back to back
+  Lods,             // MeshLod, most detailed first
+  Meshlets,         // MeshletDesc of every LOD back to back
+  MeshletBounds,    // MeshletBounds per meshlet
+  MeshletVertices,  // uint32_t, vertex indices referenced by the meshlets
+  MeshletTriangles, // uint8_t triples indexing a meshlet's vertices, each meshlet padded to 4 bytes
+  Count,
+};
+
+// Position quantized to 16-bit unorm within the mesh bounds: position = offset + value * scale. The fourth
+// component pads the vertex to 8 bytes.
+struct MeshPosition {
+  std::array<uint16_t, 4> value;
+};
+
+// Octahedral encoded normal as 16-bit snorm and texture coordinates as half floats
+struct MeshAttributes {
+  std::array<int16_t, 2> normal;
+  std::array<uint16_t, 2> uv;
+};
+
+struct MeshLod {
+  uint32_t index_offset;
+  uint32_t index_count;
+  uint32_t meshlet_offset;
+  uint32_t meshlet_count;
+  float error; // Object space deviation from the original surface, 0 for the first LOD
+  uint32_t padding;
+};
+
+struct MeshletDesc {
+  uint32_t vertex_offset;   // Into the meshlet vertices
+  uint32_t triangle_offset; // In bytes, into the meshlet triangles
+  uint32_t vertex_count;
+  uint32_t triangle_count;
+};
+
+// Bounding sphere and normal cone for culling. A meshlet faces away from a camera at position p when
+// dot(center - p, cone_axis) >= cone_cutoff * length(center - p) + radius.
+struct MeshletBounds {
+  std::array<float, 3> center;
+  float radius;
+  std::array<float, 3> cone_axis;
+  float cone_cutoff;
+};
+
+struct MeshFileSection {
+  uint64_t offset;
+  uint64_t size;
+};
+
+struct MeshFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t vertex_count;
+  uint32_t lod_count;
+  uint32_t meshlet_count;
+  uint32_t padding;
+  std::array<float, 3> position_offset;
+  std::array<float, 3> position_scale;
+  std::array<float, 3> bounds_center;
+  float bounds_radius;
+  std::array<MeshFileSection, static_cast<size_t>(MeshSection::Count)> sections;
+};
+
+// Read straight out of the mapping, so the layout must not depend on the compiler
+static_assert(sizeof(MeshPosition) == 8 && sizeof(MeshAttributes) == 8);
+static_assert(sizeof(MeshLod) == 24 && sizeof(MeshletDesc) == 16 && sizeof(MeshletBounds) == 32);
+static_assert(sizeof(MeshFileHeader) == 64 + (sizeof(MeshFileSection) * static_cast<size_t>(MeshSection::Count)));
+static_assert(std::is_trivially_copyable_v<MeshFileHeader>);
+
+// Cooked mesh read through a file mapping. Open checks the header and that every section lies inside the file with
+// the size its element count implies; the accessors then point into the mapping without copying.
+class RENDY_API MeshFile {
+  MappedFile _file;
+  MeshFileHeader _header{};
+
+  [[nodiscard]] auto validate(const std::filesystem::path &path) const -> bool;
+  template <typename T> [[nodiscard]] auto view(MeshSection section) const -> std::span<const T> {
+    const auto bytes = GetSection(section);
+    return {reinterpret_cast<const T *>(bytes.data()), bytes.size() / sizeof(T)};
+  }
+
+public:
+  // Fails when the file can't be mapped, isn't a mesh file of this version or is truncated
+  [[nodiscard]] auto Open(const std::filesystem::path &path) -> bool;
+  void Close();
+
+  [[nodiscard]] auto IsOpen() const -> bool { return _file.IsOpen(); }
+  [[nodiscard]] auto GetHeader() const -> const MeshFileHeader & { return _header; }
+  // Raw bytes of a section, ready to be handed to an upload
+  [[nodiscard]] auto GetSection(MeshSection section) const -> std::span<const std::byte>;
+
+  [[nodiscard]] auto GetPositions() const -> std::span<const MeshPosition> {
+    return view<MeshPosition>(MeshSection::Positions);
+  }
+  [[nodiscard]] auto GetAttributes() const -> std::span<const MeshAttributes> {
+    return view<MeshAttributes>(MeshSection::Attributes);
+  }
+  [[nodiscard]] auto GetIndices() const -> std::span<const uint32_t> { return view<uint32_t>(MeshSection::Indices); }
+  [[nodiscard]] auto GetLods() const -> std::span<const MeshLod> { return view<MeshLod>(MeshSection::Lods); }
+  [[nodiscard]] auto GetMeshlets() const -> std::span<const MeshletDesc> {
+    return view<MeshletDesc>(MeshSection::Meshlets);
+  }
+  [[nodiscard]] auto GetMeshletBounds() const -> std::span<const MeshletBounds> {
+    return view<MeshletBounds>(MeshSection::MeshletBounds);
+  }
+  [[nodiscard]] auto GetMeshletVertices() const -> std::span<const uint32_t> {
+    return view<uint32_t>(MeshSection::MeshletVertices);
+  }
+  [[nodiscard]] auto GetMeshletTriangles() const -> std::span<const uint8_t> {
+    return view<uint8_t>(MeshSection::MeshletTriangles);
+  }
+};
+
+} // namespace rendy::graphics::core
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "enums.hpp"
+#include "rendy_api_export.h"
+#include <cstdint>
+
+namespace rendy::graphics::core {
+
+class RENDY_API Pipeline {
+public:
+  Pipeline() = default;
+  Pipeline(const Pipeline &) = delete;
+  Pipeline(Pipeline &&) = delete;
+  auto operator=(const Pipeline &) -> Pipeline & = delete;
+  auto operator=(Pipeline &&) -> Pipeline & = delete;
+  virtual ~Pipeline() = default;
+
+  [[nodiscard]] virtual auto GetType() const -> PipelineType = 0;
+  // Hash of everything the pipeline was built from; equal hashes share one compiled pipeline
+  [[nodiscard]] virtual auto GetStateHash() const -> uint64_t = 0;
+};
+
+} // namespace rendy::graphics::core
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rendy::graphics::core {
+
+struct CpuZoneRecord {
+  const char *name{nullptr}; // Zone names are string literals, nothing is copied while recording
+  uint32_t thread_id{0};
+  uint32_t depth{0};
+  uint64_t begin_ns{0}; // Since the profiler was first used
+  uint64_t end_ns{0};
+};
+
+// Collects CPU zones from every thread. Each thread records into its own buffer, so zones on different threads never
+// contend; the owner of the frame loop drains all buffers once per frame with Collect.
+class RENDY_API CpuProfiler {
+  struct ThreadBuffer {
+    std::mutex mutex; // Only contended while Collect drains the buffer
+    std::vector<CpuZoneRecord> zones;
+    uint32_t thread_id{0};
+    uint32_t depth{0};
+  };
+
+  std::mutex _threads_mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> _threads;
+  std::atomic<bool> _enabled{true};
+  std::atomic<uint64_t> _dropped{0};
+
+  auto threadBuffer() -> ThreadBuffer &;
+
+public:
+  // Zones recorded by a thread between two collections; later ones are dropped so an idle collector can't grow memory
+  static constexpr size_t kMaxZonesPerThread = 1U << 16U;
+
+  [[nodiscard]] static auto Get() -> CpuProfiler &;
+  [[nodiscard]] static auto Now() -> uint64_t;
+
+  void SetEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+  [[nodiscard]] auto IsEnabled() const -> bool { return _enabled.load(std::memory_order_relaxed); }
+
+  // Returns the nesting depth of the new zone
+  auto BeginZone() -> uint32_t;
+  void EndZone(const char *name, uint32_t depth, uint64_t begin_ns, uint64_t end_ns);
+  // Moves out every zone recorded since the last call
+  [[nodiscard]] auto Collect() -> std::vector<CpuZoneRecord>;
+  [[nodiscard]] auto GetDroppedCount() const -> uint64_t { return _dropped.load(std::memory_order_relaxed); }
+};
+
+// Times its scope on the calling thread. Use through RENDY_PROFILE_ZONE.
+class RENDY_API CpuZone {
+  const char *_name;
+  uint64_t _begin_ns{0};
+  uint32_t _depth{0};
+  bool _active;
+
+public:
+  explicit CpuZone(const char *name);
+  CpuZone(const CpuZone &) = delete;
+  CpuZone(CpuZone &&) = delete;
+  auto operator=(const CpuZone &) -> CpuZone & = delete;
+  auto operator=(CpuZone &&) -> CpuZone & = delete;
+  ~CpuZone();
+};
+
+} // namespace rendy::graphics::core
+
+#define RENDY_PROFILE_CONCAT_INNER(a, b) a##b
+#define RENDY_PROFILE_CONCAT(a, b) RENDY_PROFILE_CONCAT_INNER(a, b)
+
+// Records the enclosing scope as a CPU zone. The name must be a string literal. Compiles to nothing when
+// RENDY_DISABLE_PROFILING is defined.
+#ifdef RENDY_DISABLE_PROFILING
+#define RENDY_PROFILE_ZONE(name)
+#else
+#define RENDY_PROFILE_ZONE(name)                                                                                      \
+  const ::rendy::graphics::core::CpuZone RENDY_PROFILE_CONCAT(rendy_profile_zone_, __LINE__)(name)
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "image.hpp"
+#include "rendy_api_export.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace rendy::graphics::core {
+
+// Produces the texel data of a streamed texture. LoadMip runs on the streamer's worker threads, so decoding and file
+// reads stay off the thread that asked for the texture. Calls for one source never overlap.
+class RENDY_API TextureSource {
+public:
+  TextureSource() = default;
+  TextureSource(const TextureSource &) = delete;
+  TextureSource(TextureSource &&) = delete;
+  auto operator=(const TextureSource &) -> TextureSource & = delete;
+  auto operator=(TextureSource &&) -> TextureSource & = delete;
+  virtual ~TextureSource() = default;
+
+  [[nodiscard]] virtual auto GetName() const -> std::string_view = 0;
+  // Known up front, before any level has been loaded
+  [[nodiscard]] virtual auto GetDesc() const -> const ImageDesc & = 0;
+  // Writes all array layers of the level tightly packed into dst, which holds GetMipSize(GetDesc(), level) bytes
+  virtual auto LoadMip(uint32_t level, std::span<std::byte> dst) -> bool = 0;
+};
+
+// Source for 8-bit RGBA pixels already in memory. Lower levels are box filtered from the base level when they are
+// loaded, in linear space for sRGB data.
+class RENDY_API Rgba8TextureSource final : public TextureSource {
+  std::string _name;
+  ImageDesc _desc;
+  std::vector<std::byte> _pixels;
+
+public:
+  Rgba8TextureSource(std::string name, ImageExtent extent, std::vector<std::byte> pixels, bool srgb = true);
+
+  [[nodiscard]] auto GetName() const -> std::string_view override { return _name; }
+  [[nodiscard]] auto GetDesc() const -> const ImageDesc & override { return _desc; }
+  auto LoadMip(uint32_t level, std::span<std::byte> dst) -> bool override;
+};
+
+// Sampled image whose detailed levels are streamed in and out while the low resolution tail stays resident
+class RENDY_API Texture {
+public:
+  Texture() = default;
+  Texture(const Texture &) = delete;
+  Texture(Texture &&) = delete;
+  auto operator=(const Texture &) -> Texture & = delete;
+  auto operator=(Texture &&) -> Texture & = delete;
+  virtual ~Texture() = default;
+
+  [[nodiscard]] virtual auto GetDesc() const -> const ImageDesc & = 0;
+  // Most detailed level that can be sampled, GetDesc().mip_levels while nothing has been uploaded yet
+  [[nodiscard]] virtual auto GetResidentMip() const -> uint32_t = 0;
+  [[nodiscard]] auto IsResident() const -> bool { return GetResidentMip() < GetDesc().mip_levels; }
+  // Asks for the level to become resident, e.g. from the screen size of the objects using the texture. Granted as far
+  // as the memory budget allows; textures nobody asks for fall back to their tail.
+  virtual void RequestMip(uint32_t level) = 0;
+};
+
+// First level of the longest tail of the chain that fits in max_bytes. The last level is always part of the tail.
+[[nodiscard]] RENDY_API auto GetMipTailStart(const ImageDesc &desc, uint64_t max_bytes) -> uint32_t;
+
+} // namespace rendy::graphics::core
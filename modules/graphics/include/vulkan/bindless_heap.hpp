@@ -0,0 +1,114 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+class VulkanCommandList;
+
+// Binding of each resource array in the bindless set, mirrored by assets/include/bindless.slang
+enum class BindlessResourceType : uint8_t {
+  SampledImage = 0,
+  StorageImage = 1,
+  StorageBuffer = 2,
+  Sampler = 3,
+};
+
+struct BindlessHeapConfig {
+  // Upper bounds, clamped to the device's update-after-bind limits
+  uint32_t max_sampled_images{16384};
+  uint32_t max_storage_images{4096};
+  uint32_t max_storage_buffers{16384};
+  uint32_t max_samplers{256};
+};
+
+// Slot in one of the bindless arrays. Shaders receive GetIndex() through push constants or buffers.
+struct BindlessHandle {
+  static constexpr uint32_t kInvalid = UINT32_MAX;
+  BindlessResourceType type{BindlessResourceType::SampledImage};
+  uint32_t index{kInvalid};
+
+  [[nodiscard]] auto IsValid() const -> bool { return index != kInvalid; }
+  [[nodiscard]] auto GetIndex() const -> uint32_t { return index; }
+  auto operator==(const BindlessHandle &) const -> bool = default;
+};
+
+// One descriptor set holding every texture, storage buffer and sampler the renderer knows about, created with
+// update-after-bind so resources can be registered while the set is bound by in-flight frames. Pipelines bind it
+// once at kSetIndex, and draws address resources by index, leaving set 0 to push descriptors for per-draw data.
+class RENDY_API BindlessHeap {
+  static constexpr size_t kTypeCount = 4;
+
+  struct Retired {
+    BindlessHandle handle;
+    // Queue timeline values that must complete before the slot can be reused
+    uint64_t graphics_value;
+    uint64_t compute_value;
+  };
+
+  struct Slots {
+    uint32_t capacity{0};
+    uint32_t next{0};
+    std::vector<uint32_t> free;
+  };
+
+  const VulkanDevice *_device{nullptr};
+  vk::DescriptorPool _pool;
+  vk::DescriptorSetLayout _set_layout;
+  vk::DescriptorSet _set;
+
+  std::mutex _mutex;
+  std::array<Slots, kTypeCount> _slots;
+  std::vector<Retired> _retired;
+
+  [[nodiscard]] auto allocate(BindlessResourceType type) -> BindlessHandle;
+  void write(BindlessHandle handle, const vk::DescriptorImageInfo *image_info,
+             const vk::DescriptorBufferInfo *buffer_info);
+  void collectLocked();
+
+public:
+  static constexpr uint32_t kSetIndex = 1;
+
+  BindlessHeap() = default;
+  BindlessHeap(const BindlessHeap &) = delete;
+  BindlessHeap(BindlessHeap &&) = delete;
+  auto operator=(const BindlessHeap &) -> BindlessHeap & = delete;
+  auto operator=(BindlessHeap &&) -> BindlessHeap & = delete;
+  ~BindlessHeap() = default;
+
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, const BindlessHeapConfig &config = {}) -> bool;
+  void Destroy();
+
+  // Registration writes the descriptor immediately and is thread safe. Returns an invalid handle when the array is
+  // full.
+  [[nodiscard]] auto RegisterSampledImage(vk::ImageView view,
+                                          vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal)
+      -> BindlessHandle;
+  [[nodiscard]] auto RegisterStorageImage(vk::ImageView view) -> BindlessHandle;
+  [[nodiscard]] auto RegisterStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0,
+                                           vk::DeviceSize range = vk::WholeSize) -> BindlessHandle;
+  [[nodiscard]] auto RegisterSampler(vk::Sampler sampler) -> BindlessHandle;
+  // Points an existing slot at a new resource, e.g. after a texture finished streaming in
+  void UpdateSampledImage(BindlessHandle handle, vk::ImageView view,
+                          vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+  // Call once the last work using the resource has been submitted. The slot is reused after that work completed.
+  void Release(BindlessHandle handle);
+  // Returns retired slots whose last possible use has completed to the free lists
+  void Collect();
+
+  [[nodiscard]] auto GetSetLayout() const -> vk::DescriptorSetLayout { return _set_layout; }
+  [[nodiscard]] auto GetSet() const -> vk::DescriptorSet { return _set; }
+  [[nodiscard]] auto GetCapacity(BindlessResourceType type) const -> uint32_t;
+  // Whether a reflected shader binding at kSetIndex refers to one of the heap's arrays
+  [[nodiscard]] auto Matches(uint32_t binding, vk::DescriptorType type) const -> bool;
+  // Binds the heap at kSetIndex of a layout that was created with GetSetLayout there
+  void Bind(VulkanCommandList &command_list, vk::PipelineBindPoint bind_point, vk::PipelineLayout layout) const;
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core/buffer.hpp"
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+struct Allocation;
+
+class RENDY_API VulkanBuffer final : public core::Buffer {
+  const VulkanDevice *_device{nullptr};
+  core::BufferDesc _desc;
+  vk::Buffer _buffer;
+  Allocation *_allocation{nullptr};
+  vk::DeviceAddress _device_address{0};
+
+public:
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, const core::BufferDesc &desc) -> bool;
+  void Destroy();
+
+  [[nodiscard]] auto GetDesc() const -> const core::BufferDesc & override { return _desc; }
+  [[nodiscard]] auto GetMappedData() const -> std::byte * override;
+  [[nodiscard]] auto GetDeviceAddress() const -> uint64_t override { return _device_address; }
+  void Upload(std::span<const std::byte> data, uint64_t offset = 0) override;
+
+  [[nodiscard]] auto Get() const -> vk::Buffer { return _buffer; }
+  [[nodiscard]] auto GetAllocation() const -> const Allocation * { return _allocation; }
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "vulkan/command_list.hpp"
+#include <array>
+#include <memory>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+
+struct CommandContextConfig {
+  uint32_t frames_in_flight{2};
+  // Upper bound on the thread indices passed to Allocate
+  uint32_t max_threads{8};
+};
+
+// One group of command lists in a batched submission, with the semaphores it waits on and signals
+struct SubmitBatch {
+  std::span<VulkanCommandList *const> command_lists;
+  std::span<const vk::SemaphoreSubmitInfo> wait_semaphores;
+  std::span<const vk::SemaphoreSubmitInfo> signal_semaphores;
+};
+
+// Owns one command pool per frame in flight, recording thread and queue type. Threads allocate from their own pools
+// without locking, and all pools of a frame are reset in one go when the frame slot is reused instead of freeing
+// command buffers one by one.
+class RENDY_API CommandContext {
+  static constexpr size_t kQueueSlotCount = 3;
+
+  struct ThreadPool {
+    vk::CommandPool pool;
+    std::array<std::vector<std::unique_ptr<VulkanCommandList>>, 2> lists; // Primary, secondary
+    std::array<size_t, 2> used{};
+  };
+
+  const VulkanDevice *_device{nullptr};
+  CommandContextConfig _config;
+  uint32_t _frame_slot{0};
+  // Indexed by [frame slot][thread][queue slot]
+  std::vector<ThreadPool> _pools;
+
+  [[nodiscard]] auto poolFor(uint32_t frame_slot, uint32_t thread_index, core::QueueType queue_type) -> ThreadPool &;
+
+public:
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, CommandContextConfig config = {}) -> bool;
+  void Destroy();
+
+  // Resets every pool of the frame slot. The GPU must be done with the work previously recorded in that slot.
+  void BeginFrame(uint64_t frame_index);
+
+  // Returns a command list that stays valid until its frame slot is reset. Each thread must use its own
+  // thread_index; different threads can allocate and record concurrently.
+  [[nodiscard]] auto Allocate(uint32_t thread_index, core::QueueType queue_type,
+                              vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary) -> VulkanCommandList &;
+
+  // Submits all batches with a single vkQueueSubmit2 call and returns the queue timeline value that marks their
+  // completion
+  auto Submit(core::QueueType queue_type, std::span<const SubmitBatch> batches) const -> uint64_t;
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "core/command_list.hpp"
+#include <span>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+// Formats of the dynamic rendering pass a secondary command list is recorded for
+struct RenderingInheritance {
+  std::span<const vk::Format> color_formats;
+  vk::Format depth_format{vk::Format::eUndefined};
+  vk::Format stencil_format{vk::Format::eUndefined};
+  vk::SampleCountFlagBits samples{vk::SampleCountFlagBits::e1};
+};
+
+class RENDY_API VulkanCommandList final : public core::CommandList {
+  vk::CommandBuffer _command_buffer;
+  core::QueueType _queue_type;
+  vk::CommandBufferLevel _level;
+
+public:
+  VulkanCommandList(vk::CommandBuffer command_buffer, core::QueueType queue_type, vk::CommandBufferLevel level);
+
+  [[nodiscard]] auto GetQueueType() const -> core::QueueType override { return _queue_type; }
+  [[nodiscard]] auto GetLevel() const -> vk::CommandBufferLevel { return _level; }
+  [[nodiscard]] auto Get() const -> vk::CommandBuffer { return _command_buffer; }
+
+  void Begin() override;
+  // Begins a secondary command list that continues a dynamic rendering pass of the primary executing it
+  void BeginSecondary(const RenderingInheritance &inheritance);
+  void End() override;
+
+  void BindPipeline(const core::Pipeline &pipeline) override;
+  void BindVertexBuffer(uint32_t binding, const core::Buffer &buffer, uint64_t offset = 0) override;
+  void BindIndexBuffer(const core::Buffer &buffer, uint64_t offset = 0, bool use_32_bit_indices = true) override;
+  void Draw(uint32_t vertex_count, uint32_t instance_count = 1, uint32_t first_vertex = 0,
+            uint32_t first_instance = 0) override;
+  void DrawIndexed(uint32_t index_count, uint32_t instance_count = 1, uint32_t first_index = 0,
+                   int32_t vertex_offset = 0, uint32_t first_instance = 0) override;
+  void DrawIndirect(const core::Buffer &buffer, uint64_t offset, uint32_t draw_count, uint32_t stride) override;
+  void DrawIndexedIndirect(const core::Buffer &buffer, uint64_t offset, uint32_t draw_count, uint32_t stride) override;
+  // Needs drawIndirectCount, see DeviceCapabilities::draw_indirect_count_support
+  void DrawIndexedIndirectCount(const core::Buffer &buffer, uint64_t offset, const core::Buffer &count_buffer,
+                                uint64_t count_offset, uint32_t max_draw_count, uint32_t stride) override;
+  // Needs VK_EXT_mesh_shader, see DeviceCapabilities::mesh_shader_support
+  void DrawMeshTasks(uint32_t group_count_x, uint32_t group_count_y = 1, uint32_t group_count_z = 1);
+  void Dispatch(uint32_t group_count_x, uint32_t group_count_y = 1, uint32_t group_count_z = 1) override;
+  void CopyBuffer(const core::Buffer &src, uint64_t src_offset, const core::Buffer &dst, uint64_t dst_offset,
+                  uint64_t size) override;
+
+  // Makes writes from the source stages visible to the destination stages, e.g. compute results to the host after
+  // the submission's timeline value has been waited on
+  void GlobalBarrier(vk::PipelineStageFlags2 src_stages, vk::AccessFlags2 src_access,
+                     vk::PipelineStageFlags2 dst_stages, vk::AccessFlags2 dst_access);
+  void ExecuteSecondaries(std::span<VulkanCommandList *const> secondaries);
+};
+
+} // namespace rendy::graphics::vulkan
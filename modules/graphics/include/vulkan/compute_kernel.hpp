@@ -0,0 +1,84 @@
+#pragma once
+
+#include "core/buffer.hpp"
+#include "rendy_api_export.h"
+#include "vulkan/pipeline_compiler.hpp"
+#include "vulkan/shader_reflection.hpp"
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+class VulkanCommandList;
+class BindlessHeap;
+class Shader;
+
+struct ComputeBufferBinding {
+  uint32_t binding{0};
+  const core::Buffer *buffer{nullptr};
+  uint64_t offset{0};
+  uint64_t range{vk::WholeSize};
+};
+
+// One compute entry point with the pipeline layout reflected from its shader. Set 0 is a push descriptor set, so
+// dispatches bind their buffers without allocating or updating descriptor sets. Kernels created with a bindless heap
+// also see the heap at BindlessHeap::kSetIndex.
+class RENDY_API ComputeKernel {
+  const VulkanDevice *_device{nullptr};
+  PipelineCompiler *_compiler{nullptr};
+  const BindlessHeap *_bindless_heap{nullptr};
+  std::shared_ptr<const Shader> _shader;
+  std::string _entry_point;
+  std::vector<SpecializationConstant> _specialization;
+  uint32_t _shader_version{0};
+
+  ReflectedEntryPoint _reflected;
+  std::vector<ReflectedBinding> _bindings; // Push descriptor bindings of set 0
+  uint32_t _push_constant_size{0};
+  vk::DescriptorSetLayout _set_layout;
+  vk::PipelineLayout _layout;
+  PipelineRequest _pipeline;
+
+  [[nodiscard]] auto build() -> bool;
+  void destroyLayouts();
+
+public:
+  ComputeKernel() = default;
+  ComputeKernel(const ComputeKernel &) = delete;
+  ComputeKernel(ComputeKernel &&) = delete;
+  auto operator=(const ComputeKernel &) -> ComputeKernel & = delete;
+  auto operator=(ComputeKernel &&) -> ComputeKernel & = delete;
+  ~ComputeKernel() = default;
+
+  // The pipeline compiles in the background; Record skips the dispatch until it is ready
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, PipelineCompiler &compiler,
+                                std::shared_ptr<const Shader> shader, std::string_view entry_point,
+                                std::span<const SpecializationConstant> specialization = {},
+                                const BindlessHeap *bindless_heap = nullptr) -> bool;
+  void Destroy();
+  // Rebuilds the layout and pipeline when the shader was hot reloaded. On failure the previous pipeline stays in use.
+  auto Refresh() -> bool;
+
+  [[nodiscard]] auto IsReady() const -> bool { return _pipeline.IsReady(); }
+  // Blocks until the pipeline has compiled, returns false when compilation failed
+  [[nodiscard]] auto WaitUntilReady() const -> bool { return _pipeline.Wait() != nullptr; }
+  // Workgroup size with specialization constants applied
+  [[nodiscard]] auto GetWorkgroupSize() const -> std::array<uint32_t, 3>;
+  // Workgroups needed along x to cover the given number of invocations
+  [[nodiscard]] auto GetGroupCount(uint32_t invocations) const -> uint32_t;
+
+  // Binds the pipeline, pushes the buffer descriptors and push constants, and dispatches. Returns false without
+  // recording anything while the pipeline is still compiling.
+  auto Record(VulkanCommandList &command_list, std::span<const ComputeBufferBinding> buffers,
+              std::span<const std::byte> push_constants, uint32_t group_count_x, uint32_t group_count_y = 1,
+              uint32_t group_count_z = 1) const -> bool;
+};
+
+} // namespace rendy::graphics::vulkan
@@ -1,32 +1,86 @@
 #pragma once
 
 #include "core/device.hpp"
+#include "vulkan/device_features.hpp"
+#include "vulkan/memory_allocator.hpp"
 #include "vulkan/queue.hpp"
+#include "vulkan/timeline_semaphore.hpp"
+#include "vulkan/upload_context.hpp"
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <vulkan/vulkan.hpp>
 
 namespace rendy::graphics::vulkan {
 class PhysicalDevice;
+
+struct MemoryHeapBudget {
+  vk::DeviceSize budget{0}; // How much the process can use before allocations fail or start paging
+  vk::DeviceSize usage{0};
+  bool device_local{false};
+};
+
 class RENDY_API VulkanDevice final : public core::Device {
   vk::Device _device;
   core::DeviceCapabilities _device_capabilities{};
+  DeviceFeatures _features;
   std::shared_ptr<PhysicalDevice> _physical_device;
   QueueRegistry _queue_registry;
+  QueueConfig _queue_config;
+  std::unique_ptr<MemoryAllocator> _allocator;
+  std::unique_ptr<UploadContext> _upload_context;
+
+  // vk::Queue access must be externally synchronized, and queue types may share a queue
+  mutable std::map<uint64_t, std::mutex> _queue_mutexes;
+  // One timeline per created queue, signaled by every submission made through Submit
+  mutable std::map<uint64_t, TimelineSemaphore> _queue_timelines;
 
   // Queue handles mapped by type
   std::map<core::QueueType, vk::Queue> _queues;
 
 public:
-  explicit VulkanDevice(std::shared_ptr<PhysicalDevice> physical_device);
+  explicit VulkanDevice(std::shared_ptr<PhysicalDevice> physical_device, QueueConfig queue_config = {});
 
   auto GetGraphicsAPI() -> core::GraphicsAPI override;
+  [[nodiscard]] auto GetCapabilities() const -> const core::DeviceCapabilities & { return _device_capabilities; }
+  // The features and extensions the device was created with, for checks the capabilities don't cover
+  [[nodiscard]] auto GetFeatures() const -> const DeviceFeatures & { return _features; }
   auto Initialize() -> bool override;
   void Cleanup() override;
 
+  [[nodiscard]] auto Get() const -> vk::Device { return _device; }
+  [[nodiscard]] auto GetPhysicalDevice() const -> const PhysicalDevice &;
+  // The allocator is internally synchronized and can be used from any thread
+  [[nodiscard]] auto GetAllocator() const -> MemoryAllocator & { return *_allocator; }
+  [[nodiscard]] auto GetUploadContext() const -> UploadContext & { return *_upload_context; }
+  // Per heap budgets from VK_EXT_memory_budget. Without the extension the budget is derived from the heap size and the
+  // usage only counts this device's allocations.
+  [[nodiscard]] auto GetMemoryBudget() const -> std::vector<MemoryHeapBudget>;
+
   // Queue access
   [[nodiscard]] auto GetQueue(core::QueueType type) const -> vk::Queue;
+  // Hold the returned lock around vkQueueSubmit/vkQueuePresentKHR on the queue of this type
+  [[nodiscard]] auto LockQueue(core::QueueType type) const -> std::unique_lock<std::mutex>;
+  [[nodiscard]] auto GetQueueFamilyIndex(core::QueueType type) const -> uint32_t;
+  // Distinct family indices of all created queues, for resources shared concurrently between queues
+  [[nodiscard]] auto GetUniqueQueueFamilyIndices() const -> std::vector<uint32_t>;
+  // Compute when the device has a compute queue that runs alongside graphics, otherwise graphics
+  [[nodiscard]] auto GetAsyncComputeQueueType() const -> core::QueueType;
   [[nodiscard]] auto GetQueueRegistry() const -> const QueueRegistry & { return _queue_registry; }
+
+  // Timeline tracking the progress of the queue of this type
+  [[nodiscard]] auto GetTimeline(core::QueueType type) const -> TimelineSemaphore &;
+  // Submits the batches with one vkQueueSubmit2 and signals the queue timeline after the last one. Returns the
+  // signaled value, which can be waited on through GetTimeline or by other queues.
+  auto Submit(core::QueueType type, std::span<const vk::SubmitInfo2> submits) const -> uint64_t;
+  // Blocks until every submission made so far on every queue has completed
+  void WaitIdle() const;
+
+  // Records and submits a one-off command buffer on the given queue and blocks until it has executed.
+  // Meant for setup and readback work, not for per-frame recording.
+  void ImmediateSubmit(core::QueueType type, const std::function<void(vk::CommandBuffer)> &record) const;
 };
 
 } // namespace rendy::graphics::vulkan
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <algorithm>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class PhysicalDevice;
+
+// Feature structs a device is negotiated with. Core structs are always chained, the device requires Vulkan 1.3;
+// extension structs are only chained while their extension is enabled.
+using DeviceFeatureChain =
+    vk::StructureChain<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features,
+                       vk::PhysicalDeviceVulkan13Features, vk::PhysicalDeviceMeshShaderFeaturesEXT,
+                       vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT, vk::PhysicalDevicePresentIdFeaturesKHR,
+                       vk::PhysicalDevicePresentWaitFeaturesKHR>;
+
+// Extension that provides a feature struct, null for core features
+template <typename T> inline constexpr const char *kFeatureExtension = nullptr;
+template <>
+inline constexpr const char *kFeatureExtension<vk::PhysicalDeviceMeshShaderFeaturesEXT> =
+    vk::EXTMeshShaderExtensionName;
+template <>
+inline constexpr const char *kFeatureExtension<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT> =
+    vk::EXTSwapchainMaintenance1ExtensionName;
+template <>
+inline constexpr const char *kFeatureExtension<vk::PhysicalDevicePresentIdFeaturesKHR> =
+    vk::KHRPresentIdExtensionName;
+template <>
+inline constexpr const char *kFeatureExtension<vk::PhysicalDevicePresentWaitFeaturesKHR> =
+    vk::KHRPresentWaitExtensionName;
+
+struct DeviceFeatureReport {
+  std::string name;
+  bool required{false};
+  bool enabled{false};
+};
+
+// Negotiates the features and extensions a device is created with. Subsystems require what they can't work without
+// and request what they can use when it is there; a request enables its features only when the device supports all
+// of them and reports whether it did, so the caller can pick its code path from the answer.
+//
+// Features are named by member pointer into their struct, e.g.
+//   features.Request<vk::PhysicalDeviceVulkan12Features>("draw indirect count",
+//                                                         {&vk::PhysicalDeviceVulkan12Features::drawIndirectCount});
+// Features of vk::PhysicalDeviceFeatures are requested through that struct. Requesting features of an extension
+// struct enables the extension too.
+class RENDY_API DeviceFeatures {
+public:
+  template <typename T> using Feature = vk::Bool32 T::*;
+
+private:
+  const PhysicalDevice *_physical_device{nullptr};
+  DeviceFeatureChain _supported;
+  DeviceFeatureChain _enabled;
+  std::vector<const char *> _extensions;
+  std::vector<DeviceFeatureReport> _report;
+
+  template <typename T> static auto get(auto &chain) -> auto & {
+    if constexpr (std::is_same_v<T, vk::PhysicalDeviceFeatures>) {
+      return chain.template get<vk::PhysicalDeviceFeatures2>().features;
+    } else {
+      return chain.template get<T>();
+    }
+  }
+  [[nodiscard]] auto isExtensionSupported(const char *name) const -> bool;
+  void enableExtension(const char *name);
+  // Records the outcome in the report and returns whether the features can be enabled
+  auto negotiate(std::string_view name, bool required, bool supported) -> bool;
+  template <typename T> auto negotiate(std::string_view name, bool required, std::initializer_list<Feature<T>> features)
+      -> bool {
+    if (!negotiate(name, required, IsSupported<T>(features))) {
+      return false;
+    }
+    auto &enabled = get<T>(_enabled);
+    for (const auto feature : features) {
+      enabled.*feature = vk::True;
+    }
+    if constexpr (kFeatureExtension<T> != nullptr) {
+      enableExtension(kFeatureExtension<T>);
+    }
+    return true;
+  }
+
+public:
+  // Queries what the device supports. Features of extensions the device lacks read as unsupported.
+  void Initialize(const PhysicalDevice &physical_device);
+
+  template <typename T> [[nodiscard]] auto IsSupported(std::initializer_list<Feature<T>> features) const -> bool {
+    if (kFeatureExtension<T> != nullptr && !isExtensionSupported(kFeatureExtension<T>)) {
+      return false;
+    }
+    const auto &supported = get<T>(_supported);
+    return std::ranges::all_of(features, [&](Feature<T> feature) { return supported.*feature == vk::True; });
+  }
+  template <typename T> [[nodiscard]] auto IsEnabled(Feature<T> feature) const -> bool {
+    return get<T>(_enabled).*feature == vk::True;
+  }
+
+  // Enables the features together when the device supports all of them and returns whether it did
+  template <typename T> auto Request(std::string_view name, std::initializer_list<Feature<T>> features) -> bool {
+    return negotiate<T>(name, false, features);
+  }
+  // Like Request, but a device without the features can't be created, see GetMissing
+  template <typename T> void Require(std::string_view name, std::initializer_list<Feature<T>> features) {
+    negotiate<T>(name, true, features);
+  }
+  // Extensions without features of their own
+  auto RequestExtension(const char *name) -> bool;
+  void RequireExtension(const char *name);
+
+  [[nodiscard]] auto IsExtensionEnabled(std::string_view name) const -> bool;
+  [[nodiscard]] auto GetExtensions() const -> const std::vector<const char *> & { return _extensions; }
+  // Required features and extensions the device lacks, empty when it can be created
+  [[nodiscard]] auto GetMissing() const -> std::vector<std::string_view>;
+  // Everything that was required or requested, in request order
+  [[nodiscard]] auto GetReport() const -> const std::vector<DeviceFeatureReport> & { return _report; }
+  void LogReport() const;
+  // The enabled features for vk::DeviceCreateInfo::pNext, with the structs of extensions that aren't enabled unlinked
+  [[nodiscard]] auto GetCreateChain() -> const vk::PhysicalDeviceFeatures2 &;
+};
+
+} // namespace rendy::graphics::vulkan
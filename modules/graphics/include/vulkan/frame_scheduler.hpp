@@ -0,0 +1,65 @@
+#pragma once
+
+#include "vulkan/command_context.hpp"
+#include <map>
+#include <span>
+#include <vector>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+
+struct FrameSchedulerConfig {
+  // More frames give the CPU more room to run ahead of the GPU at the cost of input latency
+  uint32_t frames_in_flight{2};
+  uint32_t recording_threads{4};
+};
+
+struct FrameContext {
+  uint64_t frame_index{0};
+  uint32_t frame_slot{0};
+};
+
+// Paces the CPU against the GPU with a fixed number of frames in flight. Progress is tracked through the queue
+// timelines: a frame slot is reused once the timeline values its submissions signaled have been reached, so no fences
+// are created, reset or waited on per frame.
+class RENDY_API FrameScheduler {
+  struct FrameSlot {
+    // Last timeline value signaled by the frame on each queue it submitted to
+    std::map<core::QueueType, uint64_t> timeline_values;
+  };
+
+  const VulkanDevice *_device{nullptr};
+  FrameSchedulerConfig _config;
+  CommandContext _command_context;
+  std::vector<FrameSlot> _slots;
+  uint64_t _frame_index{0};
+  bool _in_frame{false};
+  // Highest upload timeline value each queue has been made to wait on
+  std::map<core::QueueType, uint64_t> _upload_waits;
+
+  [[nodiscard]] auto currentSlot() -> FrameSlot & { return _slots[_frame_index % _slots.size()]; }
+  auto waitForSlot(const FrameSlot &slot, uint64_t timeout_ns) const -> bool;
+
+public:
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, FrameSchedulerConfig config = {}) -> bool;
+  void Destroy();
+
+  // Blocks until the frame that last used this slot has finished on the GPU, then resets its command pools
+  auto BeginFrame() -> FrameContext;
+  // Flushes pending uploads and submits the batches in one call. The submission waits for the uploads on the
+  // transfer timeline. Returns the queue timeline value signaled when the batches complete.
+  auto Submit(core::QueueType queue_type, std::span<const SubmitBatch> batches) -> uint64_t;
+  void EndFrame();
+
+  // Blocks until all GPU work of the frame has completed. Returns false on timeout.
+  auto WaitForFrame(uint64_t frame_index, uint64_t timeout_ns = UINT64_MAX) const -> bool;
+  [[nodiscard]] auto IsFrameComplete(uint64_t frame_index) const -> bool { return WaitForFrame(frame_index, 0); }
+  void WaitIdle() const;
+
+  [[nodiscard]] auto GetCommandContext() -> CommandContext & { return _command_context; }
+  [[nodiscard]] auto GetFrameIndex() const -> uint64_t { return _frame_index; }
+  [[nodiscard]] auto GetFramesInFlight() const -> uint32_t { return _config.frames_in_flight; }
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include "vulkan/bindless_heap.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/compute_kernel.hpp"
+#include "vulkan/render_graph.hpp"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+class VulkanCommandList;
+class FrameScheduler;
+class PipelineCompiler;
+class ShaderLibrary;
+struct Allocation;
+
+struct GpuCullingConfig {
+  uint32_t max_objects{65536};
+  // Object changes copied to the GPU per frame. Further changes carry over to the next frame.
+  uint32_t max_updates_per_frame{4096};
+  bool occlusion{true};
+};
+
+// World space bounding sphere and the indexed draw that renders the object
+struct CullObject {
+  std::array<float, 4> sphere{}; // Center in xyz, radius in w
+  uint32_t index_count{0};
+  uint32_t first_index{0};
+  int32_t vertex_offset{0};
+};
+
+struct CullView {
+  // Row major, maps world space to Vulkan clip space with depth 0 at the near plane
+  std::array<float, 16> view_projection{};
+  // World space, only needed by the normal cone test of meshlet culling
+  std::array<float, 3> camera_position{};
+};
+
+// Planes of the clip space volume -w <= x, y <= w, 0 <= z <= w in world space, normalized with normals pointing
+// inwards: left, right, bottom, top, near, far
+[[nodiscard]] RENDY_API auto ExtractFrustumPlanes(const std::array<float, 16> &view_projection)
+    -> std::array<std::array<float, 4>, 6>;
+
+// Outputs of the culling pass. Raster passes that call RecordDraws read both with ResourceAccess::IndirectRead.
+struct CullingResources {
+  RenderGraphHandle draws;
+  RenderGraphHandle draw_count;
+};
+
+// GPU driven draw submission. Objects live in a storage buffer that only receives the objects changed since the last
+// frame, and an async compute pass tests every object against the view frustum and a depth pyramid, writing the
+// survivors as indexed indirect draws. The CPU cost of a frame depends on the number of changed objects, not on the
+// scene size.
+//
+// The occlusion test uses the pyramid built from the previous frame's depth and the view it was rendered with, so
+// objects that become visible through camera or object motion appear one frame late. Draws take the object index as
+// their first instance, which the vertex shader uses to look up per object data.
+class RENDY_API GpuCulling {
+  // Per frame slot: the constants the shader reads, followed by the objects copied this frame
+  struct FrameData {
+    std::array<std::array<float, 4>, 6> frustum;
+    std::array<std::array<float, 4>, 4> pyramid_view_projection;
+  };
+
+  struct PyramidLevel {
+    vk::ImageView view;
+    BindlessHandle storage;
+  };
+
+  // A pyramid replaced on resize, destroyed once both queues are past the frames that were using it
+  struct RetiredPyramid {
+    vk::Image image;
+    Allocation *allocation;
+    std::vector<vk::ImageView> views;
+    uint64_t graphics_value;
+    uint64_t compute_value;
+  };
+
+  const VulkanDevice *_device{nullptr};
+  const FrameScheduler *_scheduler{nullptr};
+  BindlessHeap *_bindless_heap{nullptr};
+  GpuCullingConfig _config;
+  bool _compact{true};    // The device has drawIndirectCount
+  bool _multi_draw{true}; // One indirect call can issue more than one draw
+
+  ComputeKernel _cull_kernel;
+  ComputeKernel _pyramid_kernel;
+  VulkanBuffer _objects_buffer;
+  VulkanBuffer _frame_buffer;
+  VulkanBuffer _draws_buffer;
+  VulkanBuffer _count_buffer;
+  vk::DeviceSize _frame_stride{0};
+
+  // CPU copy of every object, ids are indices
+  std::vector<CullObject> _objects;
+  std::vector<uint32_t> _free_ids;
+  std::vector<uint32_t> _dirty_ids;
+  std::vector<bool> _dirty;
+  std::vector<vk::BufferCopy> _copies;
+  uint32_t _object_count{0}; // One past the highest id in use
+  bool _culled{false};       // The current frame's culling pass was recorded
+
+  CullView _view;
+  CullView _pyramid_camera; // View the pyramid was rendered with
+  vk::Extent2D _pyramid_extent;
+  vk::Image _pyramid;
+  vk::ImageView _pyramid_view;
+  Allocation *_pyramid_allocation{nullptr};
+  BindlessHandle _pyramid_sampled;
+  std::vector<PyramidLevel> _pyramid_levels;
+  RenderGraphHandle _pyramid_handle;
+  vk::ImageView _depth_view;
+  BindlessHandle _depth_sampled;
+  bool _pyramid_built{false};
+  std::vector<RetiredPyramid> _retired_pyramids;
+
+  [[nodiscard]] auto createPyramid(vk::Extent2D extent) -> bool;
+  // Releases the pyramid's bindless slots and hands its image and views to _retired_pyramids
+  void retirePyramid();
+  void collectRetired();
+  void destroyRetired(const RetiredPyramid &retired);
+  void recordCull(VulkanCommandList &command_list);
+  void recordPyramid(VulkanCommandList &command_list, vk::ImageView depth_view);
+
+public:
+  static constexpr uint32_t kInvalidObject = UINT32_MAX;
+
+  GpuCulling() = default;
+  GpuCulling(const GpuCulling &) = delete;
+  GpuCulling(GpuCulling &&) = delete;
+  auto operator=(const GpuCulling &) -> GpuCulling & = delete;
+  auto operator=(GpuCulling &&) -> GpuCulling & = delete;
+  ~GpuCulling() = default;
+
+  // Needs a bindless heap for the depth pyramid. The scheduler provides the frame slot of the per frame data.
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, PipelineCompiler &compiler, ShaderLibrary &shader_library,
+                                BindlessHeap &bindless_heap, const FrameScheduler &scheduler,
+                                const GpuCullingConfig &config = {}) -> bool;
+  void Destroy();
+
+  // Returns kInvalidObject when max_objects are in use
+  [[nodiscard]] auto AddObject(const CullObject &object) -> uint32_t;
+  void UpdateObject(uint32_t id, const CullObject &object);
+  void RemoveObject(uint32_t id);
+  // Call every frame before the graph executes
+  void SetView(const CullView &view) { _view = view; }
+
+  // Adds the culling pass, to be followed by the raster passes that draw the survivors. The depth extent sizes the
+  // pyramid, which is recreated when it changed; the previous one lives on until the frames using it have completed.
+  [[nodiscard]] auto AddCullPass(RenderGraph &graph, vk::Extent2D depth_extent) -> std::optional<CullingResources>;
+  // Adds a graphics queue pass building the pyramid the next frame's culling tests against from a depth only image.
+  // Add it after the passes that write the depth. Does nothing when occlusion culling is off.
+  void AddDepthPyramidPass(RenderGraph &graph, RenderGraphHandle depth);
+  // Draws the survivors with the pipeline and index buffer bound by the caller
+  void RecordDraws(VulkanCommandList &command_list) const;
+
+  [[nodiscard]] auto IsReady() const -> bool { return _cull_kernel.IsReady() && _pyramid_kernel.IsReady(); }
+  [[nodiscard]] auto GetObjectCount() const -> uint32_t { return _object_count; }
+  // With drawIndirectCount the survivors are packed at the front of the draws and counted. Without it every object
+  // keeps the draw at its id, with zero instances when it was culled.
+  [[nodiscard]] auto IsCompact() const -> bool { return _compact; }
+  [[nodiscard]] auto GetDrawsBuffer() const -> const VulkanBuffer & { return _draws_buffer; }
+  [[nodiscard]] auto GetCountBuffer() const -> const VulkanBuffer & { return _count_buffer; }
+};
+
+} // namespace rendy::graphics::vulkan
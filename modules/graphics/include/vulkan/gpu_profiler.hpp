@@ -0,0 +1,146 @@
+#pragma once
+
+#include "core/enums.hpp"
+#include "core/profiler.hpp"
+#include "rendy_api_export.h"
+#include "vulkan/command_list.hpp"
+#include "vulkan/frame_scheduler.hpp"
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+
+struct GpuProfilerConfig {
+  uint32_t max_zones_per_frame{512};
+  // Collected for the outermost zone of each graphics command list when the device supports the queries
+  bool pipeline_statistics{true};
+  // Frames of GPU results and CPU zones kept for GetFrames and ExportChromeTrace
+  uint32_t history_frames{240};
+};
+
+struct PipelineStatistics {
+  uint64_t input_assembly_vertices{0};
+  uint64_t input_assembly_primitives{0};
+  uint64_t vertex_shader_invocations{0};
+  uint64_t clipping_primitives{0};
+  uint64_t fragment_shader_invocations{0};
+  uint64_t compute_shader_invocations{0};
+};
+
+struct GpuZoneResult {
+  std::string name;
+  core::QueueType queue{core::QueueType::Graphics};
+  uint32_t depth{0};
+  // GPU clock in nanoseconds, only comparable to other GPU zones
+  uint64_t begin_ns{0};
+  uint64_t end_ns{0};
+  std::optional<PipelineStatistics> statistics;
+
+  [[nodiscard]] auto GetDurationMs() const -> double { return static_cast<double>(end_ns - begin_ns) / 1e6; }
+};
+
+struct GpuFrameResult {
+  uint64_t frame_index{0};
+  std::vector<GpuZoneResult> zones;
+  std::vector<core::CpuZoneRecord> cpu_zones;
+};
+
+struct GpuZone {
+  static constexpr uint32_t kInvalid = UINT32_MAX;
+  uint32_t index{kInvalid};
+};
+
+// Times zones of command lists with timestamp queries and reads them back a full frame ring later, once the frame
+// scheduler has waited for the slot anyway, so reading results never stalls. Each frame slot owns a fixed range of
+// queries that is reset from the host before the slot is recorded again.
+class RENDY_API GpuProfiler {
+  struct ZoneRecord {
+    std::string name;
+    core::QueueType queue{core::QueueType::Graphics};
+    uint32_t depth{0};
+    bool statistics{false};
+  };
+  struct FrameSlot {
+    uint64_t frame_index{0};
+    std::vector<ZoneRecord> zones;
+    std::vector<core::CpuZoneRecord> cpu_zones;
+    bool recorded{false};
+  };
+  struct OpenZones {
+    uint32_t depth{0};
+    bool statistics_active{false};
+  };
+
+  const VulkanDevice *_device{nullptr};
+  GpuProfilerConfig _config;
+  vk::QueryPool _timestamp_pool;
+  vk::QueryPool _statistics_pool;
+  double _timestamp_period{1.0};
+  std::map<core::QueueType, uint64_t> _timestamp_masks; // Queues without timestamp support are missing
+  std::vector<FrameSlot> _slots;
+  uint32_t _slot{0};
+  bool _in_frame{false};
+
+  std::mutex _mutex;
+  std::map<vk::CommandBuffer, OpenZones> _open_zones;
+  std::deque<GpuFrameResult> _history;
+
+  void resolve(FrameSlot &slot, uint32_t slot_index);
+
+public:
+  GpuProfiler() = default;
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler(GpuProfiler &&) = delete;
+  auto operator=(const GpuProfiler &) -> GpuProfiler & = delete;
+  auto operator=(GpuProfiler &&) -> GpuProfiler & = delete;
+  ~GpuProfiler() = default;
+
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, uint32_t frames_in_flight,
+                                const GpuProfilerConfig &config = {}) -> bool;
+  // The GPU must be idle
+  void Destroy();
+
+  // Call right after FrameScheduler::BeginFrame. Reads back the results of the frame that last used the slot and
+  // takes the CPU zones recorded since the previous call.
+  void BeginFrame(const FrameContext &frame);
+
+  // Zones can be opened from any recording thread and nest per command list. Zones on queues without timestamp
+  // support and zones beyond max_zones_per_frame return an invalid handle, which EndZone ignores.
+  [[nodiscard]] auto BeginZone(VulkanCommandList &command_list, std::string_view name) -> GpuZone;
+  void EndZone(VulkanCommandList &command_list, GpuZone zone);
+
+  // Oldest first; a frame shows up frames_in_flight frames after it was recorded
+  [[nodiscard]] auto GetFrames() const -> const std::deque<GpuFrameResult> & { return _history; }
+  [[nodiscard]] auto GetLatestFrame() const -> const GpuFrameResult *;
+  // Writes the retained history in the Chrome trace event format, viewable in chrome://tracing or Perfetto. CPU and
+  // GPU zones are written as separate processes since their clocks aren't calibrated against each other.
+  [[nodiscard]] auto ExportChromeTrace(const std::filesystem::path &path) const -> bool;
+};
+
+// Times its scope on a command list
+class RENDY_API GpuScope {
+  GpuProfiler *_profiler;
+  VulkanCommandList &_command_list;
+  GpuZone _zone;
+
+public:
+  // A null profiler records nothing
+  GpuScope(GpuProfiler *profiler, VulkanCommandList &command_list, std::string_view name);
+  GpuScope(const GpuScope &) = delete;
+  GpuScope(GpuScope &&) = delete;
+  auto operator=(const GpuScope &) -> GpuScope & = delete;
+  auto operator=(GpuScope &&) -> GpuScope & = delete;
+  ~GpuScope();
+};
+
+} // namespace rendy::graphics::vulkan
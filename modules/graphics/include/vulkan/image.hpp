@@ -0,0 +1,32 @@
+#pragma once
+
+#include "core/image.hpp"
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+struct Allocation;
+
+[[nodiscard]] RENDY_API auto ToVkFormat(core::Format format) -> vk::Format;
+
+// Device local image with one view over all of its levels and layers. The image is exclusive to one queue family at a
+// time, so using it on another family takes an ownership transfer.
+class RENDY_API VulkanImage final : public core::Image {
+  const VulkanDevice *_device{nullptr};
+  core::ImageDesc _desc;
+  vk::Image _image;
+  vk::ImageView _view;
+  Allocation *_allocation{nullptr};
+
+public:
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, const core::ImageDesc &desc) -> bool;
+  void Destroy();
+
+  [[nodiscard]] auto GetDesc() const -> const core::ImageDesc & override { return _desc; }
+  [[nodiscard]] auto Get() const -> vk::Image { return _image; }
+  [[nodiscard]] auto GetView() const -> vk::ImageView { return _view; }
+  [[nodiscard]] auto GetAllocation() const -> const Allocation * { return _allocation; }
+};
+
+} // namespace rendy::graphics::vulkan
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "rendy_api_export.h"
+#include <functional>
+#include <set>
 #include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_structs.hpp>
@@ -13,6 +17,7 @@ class RENDY_API Instance {
   vk::Instance _vk_instance{nullptr};
   vk::DebugUtilsMessengerCreateInfoEXT _vk_debug_utils_messenger_create_info;
   vk::DebugUtilsMessengerEXT _vk_debug_utils_messenger;
+  std::set<std::string, std::less<>> _enabled_extensions;
 
   void createDebugUtilsMessengerCreateInfo();
   void initializeDebugUtilsMessenger();
@@ -21,10 +26,18 @@ class RENDY_API Instance {
   [[nodiscard]] static auto validateLayers(const std::vector<const char *> &required_layers) -> bool;
 
 public:
-  [[nodiscard]] auto Initialize(std::span<const char *const> window_extensions) -> bool;
+  // Optional extensions are enabled when the loader has them, e.g. the surface side of swapchain maintenance1
+  [[nodiscard]] auto Initialize(std::span<const char *const> window_extensions,
+                                std::span<const char *const> optional_extensions = {}) -> bool;
   void Destroy() const;
 
   [[nodiscard]] auto Get() const -> vk::Instance;
+  [[nodiscard]] auto IsExtensionEnabled(std::string_view name) const -> bool {
+    return _enabled_extensions.contains(name);
+  }
+  [[nodiscard]] auto GetEnabledExtensions() const -> const std::set<std::string, std::less<>> & {
+    return _enabled_extensions;
+  }
 };
 
 } // namespace rendy::graphics::vulkan
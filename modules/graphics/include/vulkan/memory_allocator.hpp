@@ -0,0 +1,213 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class PhysicalDevice;
+class MemoryBlock;
+
+struct Allocation {
+  vk::DeviceMemory memory;
+  vk::DeviceSize offset{0};
+  vk::DeviceSize size{0};
+  void *mapped{nullptr}; // Persistently mapped pointer to offset, null for memory that is not host visible
+  uint32_t memory_type{0};
+  bool dedicated{false};
+  bool movable{false};
+
+  // Allocator bookkeeping
+  MemoryBlock *block{nullptr};
+  uint32_t order{0};
+};
+
+struct AllocationCreateInfo {
+  vk::MemoryPropertyFlags required_flags;
+  vk::MemoryPropertyFlags preferred_flags;
+  bool dedicated{false}; // Always give the resource its own vk::DeviceMemory
+  bool movable{false};   // The owner can handle the allocation being moved by defragmentation
+};
+
+struct MemoryAllocatorConfig {
+  vk::DeviceSize block_size{64ULL * 1024 * 1024};
+  // Allocations above block_size / dedicated_threshold_divisor skip the pools
+  vk::DeviceSize dedicated_threshold_divisor{2};
+  // Allocates all memory with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT so buffers bound to it have device addresses.
+  // Needs the bufferDeviceAddress feature.
+  bool device_address{false};
+};
+
+struct MemoryTypeStatistics {
+  uint32_t block_count{0};
+  uint32_t allocation_count{0};
+  uint32_t dedicated_allocation_count{0};
+  vk::DeviceSize bytes_reserved{0};
+  vk::DeviceSize bytes_used{0};
+  vk::DeviceSize largest_free_range{0};
+  // 0 when all free memory is one contiguous range, approaching 1 as it gets split into small ranges
+  float fragmentation{0.0F};
+};
+
+struct MemoryStatistics {
+  std::array<MemoryTypeStatistics, VK_MAX_MEMORY_TYPES> memory_types{};
+  MemoryTypeStatistics total;
+  uint32_t device_memory_count{0};
+};
+
+// Moves produced by BeginDefragmentation. The owner of each allocation copies its contents from src to dst and
+// rebinds its resource, then hands the moves back to EndDefragmentation.
+struct DefragmentationMove {
+  Allocation *allocation{nullptr};
+  vk::DeviceMemory src_memory;
+  vk::DeviceSize src_offset{0};
+  vk::DeviceMemory dst_memory;
+  vk::DeviceSize dst_offset{0};
+  vk::DeviceSize size{0};
+
+  // Allocator bookkeeping
+  MemoryBlock *dst_block{nullptr};
+};
+
+// Bump allocator over a single vk::DeviceMemory, reset as a whole
+class RENDY_API LinearPool {
+  vk::DeviceMemory _memory;
+  vk::DeviceSize _capacity{0};
+  vk::DeviceSize _head{0};
+  void *_mapped{nullptr};
+  uint32_t _memory_type{0};
+
+public:
+  LinearPool(vk::DeviceMemory memory, vk::DeviceSize capacity, void *mapped, uint32_t memory_type);
+
+  [[nodiscard]] auto Allocate(vk::DeviceSize size, vk::DeviceSize alignment) -> std::optional<Allocation>;
+  void Reset() { _head = 0; }
+
+  [[nodiscard]] auto GetMemory() const -> vk::DeviceMemory { return _memory; }
+  [[nodiscard]] auto GetCapacity() const -> vk::DeviceSize { return _capacity; }
+  [[nodiscard]] auto GetUsed() const -> vk::DeviceSize { return _head; }
+};
+
+// Ring allocator over a single vk::DeviceMemory. Allocations made between two EndFrame calls are released together
+// once the GPU has finished with that frame.
+class RENDY_API RingPool {
+  struct FrameMarker {
+    uint64_t frame{0};
+    vk::DeviceSize head{0};
+    vk::DeviceSize total_allocated{0};
+  };
+
+  vk::DeviceMemory _memory;
+  vk::DeviceSize _capacity{0};
+  vk::DeviceSize _head{0};
+  vk::DeviceSize _tail{0};
+  vk::DeviceSize _total_allocated{0}; // Monotonic, including padding and wasted space at the end of the ring
+  vk::DeviceSize _total_released{0};
+  std::deque<FrameMarker> _frames;
+  void *_mapped{nullptr};
+  uint32_t _memory_type{0};
+
+public:
+  RingPool(vk::DeviceMemory memory, vk::DeviceSize capacity, void *mapped, uint32_t memory_type);
+
+  [[nodiscard]] auto Allocate(vk::DeviceSize size, vk::DeviceSize alignment) -> std::optional<Allocation>;
+  void EndFrame(uint64_t frame);
+  // Releases every frame up to and including completed_frame
+  void ReleaseFrames(uint64_t completed_frame);
+
+  [[nodiscard]] auto GetMemory() const -> vk::DeviceMemory { return _memory; }
+  [[nodiscard]] auto GetCapacity() const -> vk::DeviceSize { return _capacity; }
+  [[nodiscard]] auto GetUsed() const -> vk::DeviceSize { return _total_allocated - _total_released; }
+};
+
+// Sub-allocates device memory out of per memory type pools of buddy blocks. Large resources, and those the driver
+// asks for, get dedicated allocations. Keeps the number of vk::DeviceMemory objects far below
+// maxMemoryAllocationCount.
+class RENDY_API MemoryAllocator {
+  struct PoolMemory {
+    vk::DeviceMemory memory;
+    vk::DeviceSize size{0};
+    void *mapped{nullptr};
+    uint32_t memory_type{0};
+  };
+
+  vk::Device _device;
+  const PhysicalDevice *_physical_device{nullptr};
+  MemoryAllocatorConfig _config;
+  vk::DeviceSize _min_block_size{256};
+  vk::DeviceSize _non_coherent_atom_size{1};
+
+  mutable std::mutex _mutex;
+  std::array<std::vector<std::unique_ptr<MemoryBlock>>, VK_MAX_MEMORY_TYPES> _pools;
+  std::unordered_map<const Allocation *, std::unique_ptr<Allocation>> _allocations;
+  std::vector<PoolMemory> _pool_memories;
+  uint32_t _device_memory_count{0};
+
+  [[nodiscard]] auto findMemoryType(uint32_t type_bits, const AllocationCreateInfo &create_info) const
+      -> std::optional<uint32_t>;
+  [[nodiscard]] auto allocateDeviceMemory(vk::DeviceSize size, uint32_t memory_type, const void *p_next)
+      -> std::optional<std::pair<vk::DeviceMemory, void *>>;
+  void freeDeviceMemory(vk::DeviceMemory memory);
+  [[nodiscard]] auto blockSizeFor(uint32_t memory_type) const -> vk::DeviceSize;
+  [[nodiscard]] auto allocateFromPools(const vk::MemoryRequirements &requirements, uint32_t memory_type,
+                                       const AllocationCreateInfo &create_info) -> Allocation *;
+  [[nodiscard]] auto allocateDedicated(const vk::MemoryRequirements &requirements, uint32_t memory_type,
+                                       const AllocationCreateInfo &create_info,
+                                       const vk::MemoryDedicatedAllocateInfo *dedicated_info) -> Allocation *;
+  [[nodiscard]] auto allocate(const vk::MemoryRequirements &requirements, const AllocationCreateInfo &create_info,
+                              bool prefers_dedicated, const vk::MemoryDedicatedAllocateInfo *dedicated_info)
+      -> Allocation *;
+  [[nodiscard]] auto createPoolMemory(vk::DeviceSize size, const AllocationCreateInfo &create_info,
+                                      uint32_t memory_type_bits) -> std::optional<PoolMemory>;
+  void releaseEmptyBlocks(uint32_t memory_type);
+  [[nodiscard]] auto isHostCoherent(uint32_t memory_type) const -> bool;
+  [[nodiscard]] auto alignedRange(const Allocation &allocation, vk::DeviceSize offset, vk::DeviceSize size) const
+      -> vk::MappedMemoryRange;
+
+public:
+  MemoryAllocator(vk::Device device, const PhysicalDevice &physical_device, MemoryAllocatorConfig config = {});
+  MemoryAllocator(const MemoryAllocator &) = delete;
+  MemoryAllocator(MemoryAllocator &&) = delete;
+  auto operator=(const MemoryAllocator &) -> MemoryAllocator & = delete;
+  auto operator=(MemoryAllocator &&) -> MemoryAllocator & = delete;
+  ~MemoryAllocator();
+
+  // Returns null when no memory type matches or the device is out of memory
+  [[nodiscard]] auto Allocate(const vk::MemoryRequirements &requirements, const AllocationCreateInfo &create_info)
+      -> Allocation *;
+  // Allocates and binds memory for the resource, honoring the driver's dedicated allocation preference
+  [[nodiscard]] auto AllocateForBuffer(vk::Buffer buffer, const AllocationCreateInfo &create_info) -> Allocation *;
+  [[nodiscard]] auto AllocateForImage(vk::Image image, const AllocationCreateInfo &create_info) -> Allocation *;
+  void Free(Allocation *allocation);
+
+  // Pools for per-frame data. memory_type_bits restricts the memory type, e.g. to bind a buffer over the pool.
+  [[nodiscard]] auto CreateLinearPool(vk::DeviceSize size, const AllocationCreateInfo &create_info,
+                                      uint32_t memory_type_bits = ~0U) -> std::unique_ptr<LinearPool>;
+  [[nodiscard]] auto CreateRingPool(vk::DeviceSize size, const AllocationCreateInfo &create_info,
+                                    uint32_t memory_type_bits = ~0U) -> std::unique_ptr<RingPool>;
+  // Frees the vk::DeviceMemory backing a pool; the pool must not be used afterwards
+  void DestroyPool(vk::DeviceMemory pool_memory);
+
+  // Flush/invalidate are no-ops on host coherent memory
+  void Flush(const Allocation &allocation, vk::DeviceSize offset = 0, vk::DeviceSize size = vk::WholeSize) const;
+  void Invalidate(const Allocation &allocation, vk::DeviceSize offset = 0, vk::DeviceSize size = vk::WholeSize) const;
+
+  // Plans moves of movable allocations out of the emptiest blocks into denser ones, up to max_bytes in total
+  [[nodiscard]] auto BeginDefragmentation(vk::DeviceSize max_bytes) -> std::vector<DefragmentationMove>;
+  // Commits the moves once the copies have completed on the GPU and releases blocks left empty
+  void EndDefragmentation(std::span<const DefragmentationMove> moves);
+
+  [[nodiscard]] auto GetStatistics() const -> MemoryStatistics;
+  [[nodiscard]] auto GetMemoryTypeFlags(uint32_t memory_type) const -> vk::MemoryPropertyFlags;
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/mesh_format.hpp"
+#include "rendy_api_export.h"
+#include "vulkan/buffer.hpp"
+#include <array>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+
+// Cooked mesh in device local buffers, one per section of the file. The sections are staged straight from the file
+// mapping, so loading never parses or converts vertex data on the CPU.
+class RENDY_API VulkanMesh {
+  std::array<std::unique_ptr<VulkanBuffer>, static_cast<size_t>(core::MeshSection::Count)> _buffers;
+  core::MeshFileHeader _header{};
+  std::vector<core::MeshLod> _lods;
+  uint64_t _upload_value{0};
+
+public:
+  // Queues the uploads and returns without waiting for them; the file can be closed as soon as this returns
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, const core::MeshFile &file) -> bool;
+  void Destroy();
+
+  // Null for sections the mesh has no data in
+  [[nodiscard]] auto GetBuffer(core::MeshSection section) const -> const VulkanBuffer * {
+    return _buffers.at(static_cast<size_t>(section)).get();
+  }
+  // Counts, bounds and position dequantization; the section table refers to the file, not the buffers
+  [[nodiscard]] auto GetHeader() const -> const core::MeshFileHeader & { return _header; }
+  [[nodiscard]] auto GetLods() const -> std::span<const core::MeshLod> { return _lods; }
+  // Transfer timeline value the uploads complete at. Wait for it, e.g. with UploadContext::WaitForSubmission or a
+  // semaphore wait on the transfer timeline, before the buffers are read.
+  [[nodiscard]] auto GetUploadValue() const -> uint64_t { return _upload_value; }
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include "vulkan/buffer.hpp"
+#include "vulkan/compute_kernel.hpp"
+#include "vulkan/gpu_culling.hpp"
+#include "vulkan/pipeline_compiler.hpp"
+#include "vulkan/render_graph.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+class VulkanCommandList;
+class VulkanMesh;
+class FrameScheduler;
+class ShaderLibrary;
+class Shader;
+
+enum class MeshletPath : uint8_t {
+  MeshShader, // Task shaders cull, mesh shaders emit the surviving meshlets
+  Emulated,   // A compute pass culls into one non-indexed indirect draw per mesh that pulls the meshlet triangles
+};
+
+struct MeshletRendererConfig {
+  // Formats of the dynamic rendering pass RecordDraws is called in
+  std::vector<vk::Format> color_formats;
+  vk::Format depth_format{vk::Format::eUndefined};
+  uint32_t max_draws{1024};
+  // Meshlets the emulated path can keep per frame, summed over the drawn LODs
+  uint32_t max_meshlets{1U << 20U};
+  // Takes the emulated path on devices with mesh shaders too, e.g. to test it
+  bool force_emulation{false};
+};
+
+struct MeshletInstance {
+  // Row major affine object to world transform. Cone culling assumes rotation and uniform scale.
+  std::array<float, 16> model{1.0F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F, 0.0F, 0.0F,
+                              0.0F, 0.0F, 1.0F, 0.0F, 0.0F, 0.0F, 0.0F, 1.0F};
+  uint32_t lod{0}; // Clamped to the mesh's last LOD
+};
+
+// Draws cooked meshes (see VulkanMesh) meshlet by meshlet, culling every meshlet against the view frustum and by its
+// normal cone before it is rasterized, so clusters that are off screen or face away cost no vertex work.
+//
+// With VK_EXT_mesh_shader the culling runs in task shaders inside the raster pass. Without it AddCullPass adds a
+// compute pass that appends the visible meshlets to a list and sizes one indirect draw per mesh, whose vertex shader
+// pulls the meshlet triangles; this path needs no extension and runs on software implementations like lavapipe.
+// Either way the shaders read the mesh and the per draw data through buffer device addresses in push constants, so
+// recording a draw updates no descriptors.
+//
+// Meshes are submitted every frame. A frame calls SetView and Submit, then AddCullPass, then records RecordDraws in a
+// raster pass that declared its reads with ReadDraws.
+class RENDY_API MeshletRenderer {
+  struct Draw {
+    const VulkanMesh *mesh;
+    std::array<float, 16> model;
+    uint32_t meshlet_offset;
+    uint32_t meshlet_count;
+    uint32_t visible_offset;
+  };
+
+  const VulkanDevice *_device{nullptr};
+  PipelineCompiler *_compiler{nullptr};
+  const FrameScheduler *_scheduler{nullptr};
+  MeshletRendererConfig _config;
+  MeshletPath _path{MeshletPath::Emulated};
+
+  std::shared_ptr<const Shader> _shader;
+  uint32_t _shader_version{0};
+  vk::ShaderStageFlags _stages;
+  vk::PipelineLayout _layout;
+  PipelineRequest _pipeline;
+  ComputeKernel _cull_kernel;
+
+  VulkanBuffer _frame_buffer;
+  VulkanBuffer _commands_buffer; // Emulated path only
+  VulkanBuffer _visible_buffer;  // Emulated path only
+  vk::DeviceSize _frame_stride{0};
+  vk::DeviceSize _commands_offset{0}; // Within a frame slot
+
+  CullView _view;
+  std::vector<Draw> _pending;
+  uint32_t _pending_meshlets{0};
+  std::vector<Draw> _draws; // Taken from _pending by AddCullPass
+  vk::DeviceSize _frame_offset{0};
+  RenderGraphHandle _commands_handle;
+  RenderGraphHandle _visible_handle;
+  bool _culled{false};
+
+  [[nodiscard]] auto build() -> bool;
+  void destroyLayout();
+  void refresh();
+  void writeFrame();
+  void recordCull(VulkanCommandList &command_list);
+
+public:
+  MeshletRenderer() = default;
+  MeshletRenderer(const MeshletRenderer &) = delete;
+  MeshletRenderer(MeshletRenderer &&) = delete;
+  auto operator=(const MeshletRenderer &) -> MeshletRenderer & = delete;
+  auto operator=(MeshletRenderer &&) -> MeshletRenderer & = delete;
+  ~MeshletRenderer() = default;
+
+  // Picks the mesh shader path when the device has mesh shaders. The scheduler provides the frame slot of the per
+  // frame data.
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, PipelineCompiler &compiler, ShaderLibrary &shader_library,
+                                const FrameScheduler &scheduler, const MeshletRendererConfig &config) -> bool;
+  void Destroy();
+
+  // Call every frame before AddCullPass
+  void SetView(const CullView &view) { _view = view; }
+  // Queues a draw for the next AddCullPass. The mesh's uploads must have completed and it has to stay alive until
+  // the frame has. Returns false when max_draws or max_meshlets is reached.
+  auto Submit(const VulkanMesh &mesh, const MeshletInstance &instance) -> bool;
+
+  // Takes the submitted draws and, on the emulated path, adds the culling pass. Also picks up hot reloaded shaders.
+  void AddCullPass(RenderGraph &graph);
+  // Declares the buffers RecordDraws reads on the raster pass that calls it
+  void ReadDraws(RenderGraphPass &pass) const;
+  // Draws the meshes taken by the last AddCullPass inside the raster pass
+  void RecordDraws(VulkanCommandList &command_list) const;
+
+  [[nodiscard]] auto GetPath() const -> MeshletPath { return _path; }
+  [[nodiscard]] auto IsReady() const -> bool;
+};
+
+} // namespace rendy::graphics::vulkan
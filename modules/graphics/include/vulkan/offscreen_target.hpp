@@ -0,0 +1,46 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <array>
+#include <cstddef>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+struct Allocation;
+
+// Color image that can be rendered to without a swapchain and read back to host memory.
+class RENDY_API OffscreenTarget {
+  const VulkanDevice *_device{nullptr};
+  vk::Extent2D _extent;
+  vk::Format _format{vk::Format::eUndefined};
+  vk::ImageLayout _layout{vk::ImageLayout::eUndefined};
+
+  vk::Image _image;
+  Allocation *_image_allocation{nullptr};
+  vk::ImageView _image_view;
+
+  vk::Buffer _readback_buffer;
+  Allocation *_readback_allocation{nullptr};
+
+  void transitionLayout(vk::CommandBuffer command_buffer, vk::ImageLayout new_layout);
+  [[nodiscard]] auto readbackSize() const -> vk::DeviceSize;
+
+public:
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, vk::Extent2D extent,
+                                vk::Format format = vk::Format::eR8G8B8A8Unorm) -> bool;
+  void Destroy();
+
+  void Clear(const std::array<float, 4> &color);
+  // Copies the current image contents into tightly packed rows and blocks until the copy is done
+  [[nodiscard]] auto Readback() -> std::vector<std::byte>;
+
+  [[nodiscard]] auto GetImage() const -> vk::Image { return _image; }
+  [[nodiscard]] auto GetImageView() const -> vk::ImageView { return _image_view; }
+  [[nodiscard]] auto GetExtent() const -> vk::Extent2D { return _extent; }
+  [[nodiscard]] auto GetFormat() const -> vk::Format { return _format; }
+};
+
+} // namespace rendy::graphics::vulkan
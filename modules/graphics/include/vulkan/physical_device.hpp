@@ -1,6 +1,11 @@
 #pragma once
 
 #include "queue.hpp"
+#include <functional>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 
@@ -14,24 +19,42 @@ struct RENDY_API SwapChainSupportDetails {
   [[nodiscard]] auto IsAdequate() const -> bool { return !formats.empty() && !present_modes.empty(); }
 };
 
+// Picks the device to render with. Everything selection looks at is queried once per device and kept for the chosen
+// one, so later lookups of queue families, presentation support and extensions don't go back to the driver.
 class RENDY_API PhysicalDevice {
+  // A device as probed during selection
+  struct Candidate {
+    vk::PhysicalDevice device;
+    vk::PhysicalDeviceProperties properties;
+    vk::PhysicalDeviceFeatures features;
+    std::vector<vk::QueueFamilyProperties> queue_families;
+    std::vector<vk::Bool32> present_support; // Per queue family, empty without a surface
+    std::vector<std::string> extensions;     // Sorted
+    SwapChainSupportDetails swapchain_support;
+  };
+
   vk::PhysicalDevice _vk_physical_device;
   vk::PhysicalDeviceFeatures _vk_features;
   vk::PhysicalDeviceProperties _vk_properties;
+  vk::PhysicalDevicePushDescriptorPropertiesKHR _vk_push_descriptor_properties;
+  vk::PhysicalDeviceDescriptorIndexingProperties _vk_descriptor_indexing_properties;
   vk::PhysicalDeviceMemoryProperties _vk_memory_properties;
   std::vector<vk::QueueFamilyProperties> _vk_queue_family_properties;
+  std::vector<vk::Bool32> _present_support;
+  std::vector<std::string> _extensions; // Sorted
+  std::set<std::string, std::less<>> _instance_extensions;
   QueueFamilyIndices _queue_family_indices;
   SwapChainSupportDetails _swapchain_support;
 
-  void queryDeviceInfo();
-  [[nodiscard]] static auto findQueueFamilies(vk::PhysicalDevice device, vk::SurfaceKHR surface) -> QueueFamilyIndices;
-  [[nodiscard]] static auto querySwapChainSupport(vk::PhysicalDevice device, vk::SurfaceKHR surface)
-      -> SwapChainSupportDetails;
-  [[nodiscard]] static auto checkDeviceExtensionSupport(vk::PhysicalDevice device) -> bool;
-  [[nodiscard]] static auto isDeviceSuitable(vk::PhysicalDevice device, vk::SurfaceKHR surface) -> bool;
-  [[nodiscard]] static auto scoreDevice(vk::PhysicalDevice device) -> uint32_t;
+  void queryDeviceInfo(Candidate &&candidate);
+  [[nodiscard]] static auto probe(vk::PhysicalDevice device, vk::SurfaceKHR surface) -> Candidate;
+  // Required capabilities the device lacks, empty when it is suitable
+  [[nodiscard]] static auto findMissingCapabilities(const Candidate &candidate, bool has_surface)
+      -> std::vector<std::string_view>;
+  [[nodiscard]] static auto scoreDevice(const Candidate &candidate) -> uint32_t;
 
 public:
+  // Pass a null surface to select a device for headless rendering; swapchain support is then not required.
   [[nodiscard]] auto Initialize(class Instance &instance, vk::SurfaceKHR surface) -> bool;
   void Destroy();
 
@@ -40,7 +63,24 @@ public:
   [[nodiscard]] auto GetSwapChainSupport() const -> const SwapChainSupportDetails &;
   [[nodiscard]] auto GetFeatures() const -> const vk::PhysicalDeviceFeatures &;
   [[nodiscard]] auto GetProperties() const -> const vk::PhysicalDeviceProperties &;
+  [[nodiscard]] auto GetPushDescriptorProperties() const -> const vk::PhysicalDevicePushDescriptorPropertiesKHR &;
+  [[nodiscard]] auto GetDescriptorIndexingProperties() const -> const vk::PhysicalDeviceDescriptorIndexingProperties &;
   [[nodiscard]] auto GetMemoryProperties() const -> const vk::PhysicalDeviceMemoryProperties &;
+  [[nodiscard]] auto GetQueueFamilyProperties() const -> const std::vector<vk::QueueFamilyProperties> &;
+  [[nodiscard]] auto IsExtensionSupported(std::string_view name) const -> bool;
+  // Always false without a surface
+  [[nodiscard]] auto IsPresentSupported(uint32_t queue_family) const -> bool {
+    return queue_family < _present_support.size() && _present_support[queue_family] == vk::True;
+  }
+  // Device extensions that build on instance extensions are only usable when the instance enabled those
+  [[nodiscard]] auto IsInstanceExtensionEnabled(std::string_view name) const -> bool {
+    return _instance_extensions.contains(name);
+  }
+
+  [[nodiscard]] auto FindMemoryType(uint32_t type_bits, vk::MemoryPropertyFlags properties) const
+      -> std::optional<uint32_t>;
+  // Whether optimally tiled images of the format support all of the features
+  [[nodiscard]] auto IsFormatSupported(vk::Format format, vk::FormatFeatureFlags features) const -> bool;
 };
 
 } // namespace rendy::graphics::vulkan
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "core/pipeline.hpp"
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+struct SpecializationConstant {
+  uint32_t id{0};
+  uint32_t value{0};
+};
+
+struct ShaderStageDesc {
+  vk::ShaderStageFlagBits stage{vk::ShaderStageFlagBits::eVertex};
+  std::vector<uint32_t> spirv;
+  std::string entry_point{"main"};
+  std::vector<SpecializationConstant> specialization;
+};
+
+// Viewport and scissor are always dynamic state
+struct GraphicsPipelineDesc {
+  std::vector<ShaderStageDesc> stages;
+  vk::PipelineLayout layout;
+  std::vector<vk::VertexInputBindingDescription> vertex_bindings;
+  std::vector<vk::VertexInputAttributeDescription> vertex_attributes;
+  vk::PrimitiveTopology topology{vk::PrimitiveTopology::eTriangleList};
+  vk::PolygonMode polygon_mode{vk::PolygonMode::eFill};
+  vk::CullModeFlags cull_mode{vk::CullModeFlagBits::eBack};
+  vk::FrontFace front_face{vk::FrontFace::eCounterClockwise};
+  bool depth_test{true};
+  bool depth_write{true};
+  vk::CompareOp depth_compare{vk::CompareOp::eLessOrEqual};
+  bool alpha_blend{false};
+  // Formats of the dynamic rendering pass the pipeline is used in
+  std::vector<vk::Format> color_formats;
+  vk::Format depth_format{vk::Format::eUndefined};
+  vk::SampleCountFlagBits samples{vk::SampleCountFlagBits::e1};
+
+  [[nodiscard]] auto Hash() const -> uint64_t;
+};
+
+struct ComputePipelineDesc {
+  ShaderStageDesc shader{.stage = vk::ShaderStageFlagBits::eCompute};
+  vk::PipelineLayout layout;
+
+  [[nodiscard]] auto Hash() const -> uint64_t;
+};
+
+class RENDY_API VulkanPipeline final : public core::Pipeline {
+  vk::Pipeline _pipeline;
+  vk::PipelineLayout _layout;
+  core::PipelineType _type;
+  uint64_t _state_hash;
+
+public:
+  VulkanPipeline(vk::Pipeline pipeline, vk::PipelineLayout layout, core::PipelineType type, uint64_t state_hash);
+
+  [[nodiscard]] auto GetType() const -> core::PipelineType override { return _type; }
+  [[nodiscard]] auto GetStateHash() const -> uint64_t override { return _state_hash; }
+
+  [[nodiscard]] auto Get() const -> vk::Pipeline { return _pipeline; }
+  [[nodiscard]] auto GetLayout() const -> vk::PipelineLayout { return _layout; }
+  [[nodiscard]] auto GetBindPoint() const -> vk::PipelineBindPoint;
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class PhysicalDevice;
+
+// Contents of a cache file that passed validation, read ahead of device creation
+struct PipelineCacheBlob {
+  std::filesystem::path path;
+  std::vector<std::byte> data; // Empty when there was no usable cache
+};
+
+// vk::PipelineCache persisted between runs. The file name carries the vendor and device id, and the blob is only
+// handed to the driver when its header matches this device and driver build (pipelineCacheUUID), so a driver update
+// or a different GPU starts from an empty cache instead of feeding the driver foreign data.
+class RENDY_API PipelineCache {
+  vk::Device _device;
+  vk::PipelineCache _cache;
+  std::filesystem::path _path;
+
+public:
+  // Reads and validates the cache file for the device. Only needs the physical device, so it can overlap device
+  // creation.
+  [[nodiscard]] static auto Read(const PhysicalDevice &physical_device, const std::filesystem::path &directory)
+      -> PipelineCacheBlob;
+
+  [[nodiscard]] auto Initialize(vk::Device device, const PhysicalDevice &physical_device,
+                                const std::filesystem::path &directory) -> bool;
+  // Creates the cache from a blob returned by Read
+  [[nodiscard]] auto Initialize(vk::Device device, PipelineCacheBlob blob) -> bool;
+  // Saves the cache before destroying it
+  void Destroy();
+
+  // Writes the current contents to disk. Safe to call while pipelines are being compiled.
+  void Save() const;
+
+  [[nodiscard]] auto Get() const -> vk::PipelineCache { return _cache; }
+  [[nodiscard]] auto GetPath() const -> const std::filesystem::path & { return _path; }
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "common/job_system.hpp"
+#include "vulkan/pipeline.hpp"
+#include "vulkan/pipeline_cache.hpp"
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+
+struct PipelineCompilerConfig {
+  std::filesystem::path cache_directory{"cache"};
+};
+
+// Handle to a pipeline that may still be compiling. Cheap to copy and to poll every frame.
+class RENDY_API PipelineRequest {
+  std::shared_future<VulkanPipeline *> _future;
+  uint64_t _state_hash{0};
+
+public:
+  PipelineRequest() = default;
+  PipelineRequest(std::shared_future<VulkanPipeline *> future, uint64_t state_hash)
+      : _future(std::move(future)), _state_hash(state_hash) {}
+
+  [[nodiscard]] auto IsReady() const -> bool;
+  // Null while the pipeline is compiling or when compilation failed; draw with a fallback or skip the draw meanwhile
+  [[nodiscard]] auto TryGet() const -> VulkanPipeline *;
+  // Blocks until compilation has finished. Not from a job: with every worker blocked the compilation never starts.
+  [[nodiscard]] auto Wait() const -> VulkanPipeline *;
+  [[nodiscard]] auto GetStateHash() const -> uint64_t { return _state_hash; }
+};
+
+// Compiles pipelines as jobs against a persistent disk cache. Requests are deduplicated by state hash,
+// so asking for the same pipeline every frame only compiles it once. Failed compilations are not kept; the next
+// request for that state compiles again.
+class RENDY_API PipelineCompiler {
+  struct Entry {
+    std::shared_future<VulkanPipeline *> future;
+    std::unique_ptr<VulkanPipeline> pipeline;
+  };
+
+  const VulkanDevice *_device{nullptr};
+  common::JobSystem *_job_system{nullptr};
+  PipelineCache _cache;
+
+  std::mutex _mutex;
+  std::unordered_map<uint64_t, Entry> _pipelines;
+  common::JobCounter _compiling;
+
+  [[nodiscard]] auto compileGraphics(const GraphicsPipelineDesc &desc) const -> vk::Pipeline;
+  [[nodiscard]] auto compileCompute(const ComputePipelineDesc &desc) const -> vk::Pipeline;
+  [[nodiscard]] auto createShaderModule(const ShaderStageDesc &stage) const -> vk::ShaderModule;
+  template <typename Desc> auto request(Desc desc, core::PipelineType type) -> PipelineRequest;
+
+public:
+  PipelineCompiler() = default;
+  PipelineCompiler(const PipelineCompiler &) = delete;
+  PipelineCompiler(PipelineCompiler &&) = delete;
+  auto operator=(const PipelineCompiler &) -> PipelineCompiler & = delete;
+  auto operator=(PipelineCompiler &&) -> PipelineCompiler & = delete;
+  ~PipelineCompiler() = default;
+
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, common::JobSystem &job_system,
+                                const PipelineCompilerConfig &config = {}) -> bool;
+  // Starts from a cache read with PipelineCache::Read, e.g. while the device was being created
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, common::JobSystem &job_system, PipelineCacheBlob cache)
+      -> bool;
+  // Finishes queued compilations, saves the cache and destroys every pipeline
+  void Destroy();
+
+  auto Request(const GraphicsPipelineDesc &desc) -> PipelineRequest;
+  auto Request(const ComputePipelineDesc &desc) -> PipelineRequest;
+
+  [[nodiscard]] auto GetCache() const -> const PipelineCache & { return _cache; }
+};
+
+} // namespace rendy::graphics::vulkan
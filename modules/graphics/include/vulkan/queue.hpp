@@ -4,38 +4,58 @@
 #include "rendy_api_export.h"
 #include <map>
 #include <optional>
+#include <span>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 
 namespace rendy::graphics::vulkan {
 
 struct QueueFamilyIndices {
-  uint32_t graphics_family{};              // Required (also handles presentation)
+  uint32_t graphics_family{};              // Required
+  std::optional<uint32_t> present_family;  // Only set when a surface is provided
   std::optional<uint32_t> compute_family;  // Optional
   std::optional<uint32_t> transfer_family; // Optional
 };
 
 struct QueueFamilyInfo {
   uint32_t family_index{};
-  uint32_t queue_count{};
+  uint32_t queue_count{}; // Queues available in the family
   core::QueueType supported_types{};
+  std::vector<float> priorities; // One entry per queue that will be created
+};
+
+struct QueueLocation {
+  uint32_t family_index{};
+  uint32_t queue_index{};
+
+  auto operator==(const QueueLocation &) const -> bool = default;
+};
+
+// Priorities handed to the driver for each logical queue, in the [0, 1] range
+struct QueueConfig {
+  float graphics_priority{1.0F};
+  float compute_priority{1.0F};
+  float transfer_priority{0.5F};
 };
 
 class QueueRegistry {
   std::map<uint32_t, QueueFamilyInfo> _families;
+  std::map<core::QueueType, QueueLocation> _locations;
 
 public:
   void RegisterFamily(uint32_t family_index, core::QueueType types, uint32_t count);
+  // Reserves a queue for the given type in a registered family. A new queue index is used while the family has
+  // queues left, otherwise the last queue of the family is shared.
+  auto AssignQueue(core::QueueType type, uint32_t family_index, float priority) -> QueueLocation;
 
   [[nodiscard]] auto GetQueueCreateInfos() const -> std::vector<vk::DeviceQueueCreateInfo>;
-  [[nodiscard]] auto GetFamilyFor(core::QueueType type) const -> uint32_t;
+  [[nodiscard]] auto GetLocation(core::QueueType type) const -> std::optional<QueueLocation>;
   [[nodiscard]] auto GetAllFamilies() const -> const std::map<uint32_t, QueueFamilyInfo> &;
-
-private:
-  std::vector<float> _queue_priorities{1.0F};
 };
 
-// Utility functions moved from PhysicalDevice
-[[nodiscard]] auto FindQueueFamilies(vk::PhysicalDevice device, vk::SurfaceKHR surface) -> QueueFamilyIndices;
+// Picks families from properties already queried for the device. Empty presentation support, one entry per family
+// otherwise, selects the headless path: no present family is set and any graphics family is accepted.
+[[nodiscard]] auto FindQueueFamilies(std::span<const vk::QueueFamilyProperties> queue_families,
+                                     std::span<const vk::Bool32> present_support) -> QueueFamilyIndices;
 
 } // namespace rendy::graphics::vulkan
@@ -0,0 +1,246 @@
+#pragma once
+
+#include "core/enums.hpp"
+#include "rendy_api_export.h"
+#include "vulkan/command_list.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+class FrameScheduler;
+class GpuProfiler;
+class RenderGraph;
+struct Allocation;
+
+struct RenderGraphHandle {
+  static constexpr uint32_t kInvalid = UINT32_MAX;
+  uint32_t index{kInvalid};
+
+  [[nodiscard]] auto IsValid() const -> bool { return index != kInvalid; }
+  auto operator==(const RenderGraphHandle &) const -> bool = default;
+};
+
+enum class PassType : uint8_t {
+  Raster,       // Draws inside a dynamic rendering scope built from the attachments the pass declares
+  Compute,      // Dispatches on the graphics queue
+  AsyncCompute, // Dispatches on the async compute queue when the device has one, otherwise on the graphics queue
+  Transfer,     // Copies on the graphics queue
+};
+
+enum class ResourceAccess : uint8_t {
+  ColorAttachment,
+  DepthAttachment,
+  DepthRead,
+  SampledRead,
+  StorageRead,
+  StorageWrite,
+  UniformRead,
+  VertexRead,
+  IndexRead,
+  IndirectRead,
+  TransferRead,
+  TransferWrite,
+};
+
+struct RenderGraphImageDesc {
+  vk::Extent2D extent;
+  vk::Format format{vk::Format::eUndefined};
+  uint32_t mip_levels{1};
+  vk::SampleCountFlagBits samples{vk::SampleCountFlagBits::e1};
+};
+
+struct RenderGraphBufferDesc {
+  vk::DeviceSize size{0};
+};
+
+struct RenderGraphStatistics {
+  uint32_t declared_passes{0};
+  uint32_t culled_passes{0};
+  uint32_t batches{0};
+  uint32_t async_compute_batches{0};
+  // Filled by the last Execute
+  uint32_t barrier_calls{0};
+  uint32_t image_barriers{0};
+  // Memory the transient resources would need without aliasing, and what was actually allocated
+  vk::DeviceSize transient_bytes{0};
+  vk::DeviceSize allocated_bytes{0};
+};
+
+struct PassContext {
+  VulkanCommandList &command_list;
+  const RenderGraph &graph;
+};
+
+// Declares which resources a pass touches and how. The graph derives culling, ordering across queues, barriers and
+// attachment load/store operations from these declarations alone.
+class RENDY_API RenderGraphPass {
+  friend class RenderGraph;
+
+  struct Use {
+    RenderGraphHandle resource;
+    ResourceAccess access;
+  };
+  struct Attachment {
+    RenderGraphHandle resource;
+    std::optional<vk::ClearValue> clear;
+    bool read_only{false};
+  };
+
+  std::string _name;
+  PassType _type;
+  std::vector<Use> _uses;
+  std::vector<Attachment> _color_attachments;
+  std::optional<Attachment> _depth_attachment;
+  std::function<void(PassContext &)> _execute;
+  bool _side_effects{false};
+
+public:
+  RenderGraphPass(std::string_view name, PassType type) : _name(name), _type(type) {}
+
+  auto Read(RenderGraphHandle resource, ResourceAccess access) -> RenderGraphPass &;
+  auto Write(RenderGraphHandle resource, ResourceAccess access) -> RenderGraphPass &;
+  // Attachments are bound in declaration order. Without a clear value the previous contents are loaded, or discarded
+  // when the pass is the first to touch a transient image.
+  auto WriteColor(RenderGraphHandle resource, std::optional<std::array<float, 4>> clear = std::nullopt)
+      -> RenderGraphPass &;
+  auto WriteDepth(RenderGraphHandle resource, std::optional<float> clear = std::nullopt) -> RenderGraphPass &;
+  // Binds a depth attachment for testing only
+  auto ReadDepth(RenderGraphHandle resource) -> RenderGraphPass &;
+  // Keeps the pass even when none of its outputs are consumed, e.g. for readbacks or queries
+  auto SetSideEffects() -> RenderGraphPass &;
+  auto SetExecute(std::function<void(PassContext &)> execute) -> RenderGraphPass &;
+
+  [[nodiscard]] auto GetName() const -> const std::string & { return _name; }
+  [[nodiscard]] auto GetType() const -> PassType { return _type; }
+};
+
+// Frame graph that is built and compiled once and executed every frame.
+// Compile culls passes whose results are never consumed, groups the remaining ones into per-queue batches with
+// timeline semaphore waits between queues, and places transient resources whose lifetimes can't overlap on the GPU in
+// shared memory. Execute records every batch with one vkCmdPipelineBarrier2 per pass that needs synchronization.
+class RENDY_API RenderGraph {
+  struct Resource {
+    std::string name;
+    bool is_image{true};
+    bool imported{false};
+    bool output{false};
+    RenderGraphImageDesc image_desc;
+    RenderGraphBufferDesc buffer_desc;
+    vk::ImageUsageFlags image_usage;
+    vk::BufferUsageFlags buffer_usage;
+    vk::ImageLayout initial_layout{vk::ImageLayout::eUndefined};
+    vk::ImageLayout final_layout{vk::ImageLayout::eUndefined};
+
+    vk::Image image;
+    vk::ImageView view;
+    vk::Buffer buffer;
+
+    // Filled by Compile
+    uint32_t first_use{UINT32_MAX};
+    uint32_t last_use{0};
+    std::vector<uint32_t> batches;
+    vk::MemoryRequirements requirements;
+  };
+
+  struct Batch {
+    core::QueueType queue{core::QueueType::Graphics};
+    std::vector<uint32_t> positions; // Indices into _schedule
+    std::vector<uint32_t> waits;     // Earlier batches on other queues
+    bool first_on_queue{false};
+  };
+
+  struct AliasSlot {
+    bool is_image{true};
+    vk::MemoryRequirements requirements;
+    std::vector<uint32_t> resources;
+    Allocation *allocation{nullptr};
+  };
+
+  struct AccessState {
+    vk::ImageLayout layout{vk::ImageLayout::eUndefined};
+    vk::PipelineStageFlags2 write_stages;
+    vk::AccessFlags2 write_access;
+    vk::PipelineStageFlags2 synced_read_stages;
+    vk::PipelineStageFlags2 pending_read_stages;
+    std::optional<core::QueueType> queue;
+  };
+
+  const VulkanDevice *_device{nullptr};
+  GpuProfiler *_profiler{nullptr};
+  std::vector<Resource> _resources;
+  std::vector<std::unique_ptr<RenderGraphPass>> _passes;
+  std::vector<uint32_t> _schedule;
+  std::vector<Batch> _batches;
+  std::vector<AliasSlot> _alias_slots;
+  std::vector<uint32_t> _concurrent_families;
+  std::map<core::QueueType, uint64_t> _last_signals;
+  RenderGraphStatistics _statistics;
+  bool _compiled{false};
+
+  [[nodiscard]] auto addResource(Resource resource) -> RenderGraphHandle;
+  [[nodiscard]] auto queueFor(PassType type) const -> core::QueueType;
+  void cullPasses();
+  void buildBatches();
+  [[nodiscard]] auto allocateTransients() -> bool;
+  [[nodiscard]] auto canAlias(const Resource &lhs, const Resource &rhs,
+                              const std::vector<std::vector<bool>> &batch_order) const -> bool;
+  void destroyTransients();
+  void recordPass(uint32_t position, VulkanCommandList &command_list, core::QueueType queue,
+                  std::vector<AccessState> &states);
+  void recordFinalTransitions(VulkanCommandList &command_list, core::QueueType queue, std::vector<AccessState> &states);
+
+public:
+  RenderGraph() = default;
+  RenderGraph(const RenderGraph &) = delete;
+  RenderGraph(RenderGraph &&) = delete;
+  auto operator=(const RenderGraph &) -> RenderGraph & = delete;
+  auto operator=(RenderGraph &&) -> RenderGraph & = delete;
+  ~RenderGraph() = default;
+
+  [[nodiscard]] auto Initialize(const VulkanDevice &device) -> bool;
+  void Destroy();
+  // Drops all passes and resources so the graph can be rebuilt, e.g. after a resize
+  void Reset();
+
+  // Imported images are expected in initial_layout at the start of every execution and are left in final_layout.
+  // Unless they were created with concurrent sharing, only use imported resources from graphics queue passes.
+  [[nodiscard]] auto ImportImage(std::string_view name, vk::Image image, vk::ImageView view,
+                                 const RenderGraphImageDesc &desc, vk::ImageLayout initial_layout,
+                                 vk::ImageLayout final_layout) -> RenderGraphHandle;
+  // Swaps the image behind an import between executions, e.g. for the acquired swapchain image
+  void SetImportedImage(RenderGraphHandle handle, vk::Image image, vk::ImageView view);
+  [[nodiscard]] auto ImportBuffer(std::string_view name, vk::Buffer buffer, vk::DeviceSize size) -> RenderGraphHandle;
+  // Transient resources are owned by the graph. Their contents don't survive between executions.
+  [[nodiscard]] auto CreateImage(std::string_view name, const RenderGraphImageDesc &desc) -> RenderGraphHandle;
+  [[nodiscard]] auto CreateBuffer(std::string_view name, const RenderGraphBufferDesc &desc) -> RenderGraphHandle;
+  // Passes run in the order they are added, which must already respect their data dependencies
+  auto AddPass(std::string_view name, PassType type) -> RenderGraphPass &;
+  // Keeps the passes producing this resource alive. Writes to imported resources are always kept.
+  void MarkOutput(RenderGraphHandle handle);
+
+  [[nodiscard]] auto Compile() -> bool;
+  // Records and submits every batch for the current frame of the scheduler
+  void Execute(FrameScheduler &scheduler, uint32_t thread_index = 0);
+  // Times every executed pass as a GPU zone named after the pass. Pass null to stop profiling.
+  void SetProfiler(GpuProfiler *profiler) { _profiler = profiler; }
+
+  [[nodiscard]] auto GetImage(RenderGraphHandle handle) const -> vk::Image;
+  [[nodiscard]] auto GetImageView(RenderGraphHandle handle) const -> vk::ImageView;
+  [[nodiscard]] auto GetBuffer(RenderGraphHandle handle) const -> vk::Buffer;
+  // For buffers the graph created and passes access as storage, to pass to shaders that read through pointers. Valid
+  // while executing. Imported buffers are the importer's to address, e.g. with VulkanBuffer::GetDeviceAddress.
+  [[nodiscard]] auto GetBufferAddress(RenderGraphHandle handle) const -> vk::DeviceAddress;
+  [[nodiscard]] auto GetStatistics() const -> const RenderGraphStatistics & { return _statistics; }
+};
+
+} // namespace rendy::graphics::vulkan
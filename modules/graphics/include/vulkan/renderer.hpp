@@ -1,23 +1,105 @@
 #pragma once
 
+#include "bindless_heap.hpp"
+#include "common/job_system.hpp"
+#include "common/startup_timer.hpp"
 #include "device.hpp"
+#include "frame_scheduler.hpp"
+#include "gpu_profiler.hpp"
 #include "instance.hpp"
+#include "offscreen_target.hpp"
 #include "physical_device.hpp"
+#include "pipeline_compiler.hpp"
+#include "shader_library.hpp"
+#include "swapchain.hpp"
+#include "texture_streamer.hpp"
 #include <GLFW/glfw3.h>
 #include <memory>
+#include <optional>
 #include <vulkan/vulkan.hpp>
 
 namespace rendy::graphics::vulkan {
 
 class RENDY_API Renderer {
   std::unique_ptr<vk::SurfaceKHR> _surface;
+  GLFWwindow *_window{nullptr};
+  vk::Extent2D _surface_extent; // Used when there is no window to ask, i.e. for headless surfaces
+  common::StartupTimer _startup_timer;
+  std::optional<common::StartupTimer::Scope> _first_frame; // From the end of initialization to the first EndFrame
   std::unique_ptr<Instance> _instance;
   std::shared_ptr<PhysicalDevice> _physical_device;
   std::unique_ptr<VulkanDevice> _device;
+  std::unique_ptr<OffscreenTarget> _offscreen_target;
+  std::unique_ptr<Swapchain> _swapchain;
+  std::optional<SwapchainImage> _backbuffer;
+  std::unique_ptr<FrameScheduler> _frame_scheduler;
+  std::unique_ptr<GpuProfiler> _gpu_profiler;
+  std::unique_ptr<PipelineCompiler> _pipeline_compiler;
+  std::unique_ptr<ShaderLibrary> _shader_library;
+  std::unique_ptr<BindlessHeap> _bindless_heap;
+  std::unique_ptr<TextureStreamer> _texture_streamer;
+  // Work started during initialization that overlaps instance and device creation
+  common::JobCounter _startup_jobs;
+  bool _shader_library_ready{false};
+  common::JobCounter _pipeline_cache_read;
+  PipelineCacheBlob _pipeline_cache; // Handed to the pipeline compiler once read
+  // Declared last so it is destroyed first: jobs still running when initialization throws finish before the members
+  // they touch go away
+  std::unique_ptr<common::JobSystem> _job_system;
+
+  // Starts the startup timer, the job system and the startup work that doesn't need a device
+  void beginStartup();
+  void finishStartup();
+  void initializeDevice(vk::SurfaceKHR surface, const FrameSchedulerConfig &frame_config);
+  void initializeSwapchain(const SwapchainConfig &swapchain_config);
+  [[nodiscard]] auto surfaceExtent() const -> vk::Extent2D;
+  void acquireBackbuffer();
+  void presentBackbuffer();
 
 public:
-  void Initialize(GLFWwindow &window);
+  void Initialize(GLFWwindow &window, const FrameSchedulerConfig &frame_config = {},
+                  const SwapchainConfig &swapchain_config = {});
+  // Initializes without a window or surface and renders into an offscreen target of the given size
+  void InitializeHeadless(vk::Extent2D extent, const FrameSchedulerConfig &frame_config = {});
+  // Presents to a VK_EXT_headless_surface of the given size, which exercises the whole swapchain path without a
+  // display, e.g. on lavapipe in CI
+  void InitializeHeadlessSurface(vk::Extent2D extent, const FrameSchedulerConfig &frame_config = {},
+                                 const SwapchainConfig &swapchain_config = {});
   void Destroy();
+
+  // Blocks in low latency mode until earlier presents have reached the display. Call it once per frame, right before
+  // sampling input and BeginFrame.
+  void WaitForLatency() const;
+  // Applies pending shader reloads, waits for a free frame slot, uploads streamed texture levels and acquires the next
+  // swapchain image. Command lists for the frame come from the scheduler's command context.
+  auto BeginFrame() -> FrameContext;
+  // Presents the backbuffer, if one was acquired
+  void EndFrame();
+  // Sets the size of a headless surface; window surfaces follow the framebuffer size on their own
+  void Resize(vk::Extent2D extent) { _surface_extent = extent; }
+  // Shared by the renderer's subsystems; queue other CPU work here too rather than starting threads
+  [[nodiscard]] auto GetJobSystem() const -> common::JobSystem & { return *_job_system; }
+  [[nodiscard]] auto GetDevice() const -> VulkanDevice & { return *_device; }
+  [[nodiscard]] auto GetFrameScheduler() const -> FrameScheduler & { return *_frame_scheduler; }
+  [[nodiscard]] auto GetGpuProfiler() const -> GpuProfiler & { return *_gpu_profiler; }
+  [[nodiscard]] auto GetPipelineCompiler() const -> PipelineCompiler & { return *_pipeline_compiler; }
+  [[nodiscard]] auto GetShaderLibrary() const -> ShaderLibrary & { return *_shader_library; }
+  // Null when the device lacks descriptor indexing
+  [[nodiscard]] auto GetBindlessHeap() const -> BindlessHeap * { return _bindless_heap.get(); }
+  [[nodiscard]] auto GetTextureStreamer() const -> TextureStreamer & { return *_texture_streamer; }
+  // Phases of the last initialization, plus the first frame once it has ended
+  [[nodiscard]] auto GetStartupTimer() const -> const common::StartupTimer & { return _startup_timer; }
+
+  [[nodiscard]] auto IsHeadless() const -> bool { return _surface == nullptr; }
+  [[nodiscard]] auto GetOffscreenTarget() const -> OffscreenTarget * { return _offscreen_target.get(); }
+  // Null without a surface
+  [[nodiscard]] auto GetSwapchain() const -> Swapchain * { return _swapchain.get(); }
+  // The swapchain image of the current frame, or null when none could be acquired, e.g. while minimized. It is in
+  // color attachment layout between BeginFrame and EndFrame and has to be left in it; only use it on the graphics
+  // queue. Render graphs import it with that layout as both the initial and final layout.
+  [[nodiscard]] auto GetBackbuffer() const -> const SwapchainImage * {
+    return _backbuffer.has_value() ? &_backbuffer.value() : nullptr;
+  }
 };
 
 } // namespace rendy::graphics::vulkan
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "common/job_system.hpp"
+#include "rendy_api_export.h"
+#include "vulkan/pipeline.hpp"
+#include "vulkan/shader_reflection.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace rendy::graphics::vulkan {
+
+struct ShaderLibraryConfig {
+  // Where the .slang sources live, relative to the working directory
+  std::filesystem::path source_directory{"assets"};
+  // SPIR-V compiled by the build, used as is when no compiler is available at runtime
+  std::filesystem::path precompiled_directory{"assets/shaders"};
+  std::filesystem::path cache_directory{"cache/shaders"};
+  // Path to slangc. Empty searches $RENDY_SLANGC, $VULKAN_SDK/bin and $PATH.
+  std::filesystem::path compiler;
+  bool hot_reload{true};
+  std::chrono::milliseconds poll_interval{500};
+};
+
+// One compiled .slang module with every entry point it declares
+class RENDY_API Shader {
+  friend class ShaderLibrary;
+
+  std::string _name;
+  std::filesystem::path _source_path;
+  std::vector<uint32_t> _spirv;
+  ShaderReflection _reflection;
+  uint64_t _content_hash{0};
+  uint32_t _version{0};
+  // Sources pulled in through import and #include, watched alongside the module itself
+  std::vector<std::filesystem::path> _dependencies;
+
+public:
+  [[nodiscard]] auto GetName() const -> const std::string & { return _name; }
+  [[nodiscard]] auto GetSpirv() const -> const std::vector<uint32_t> & { return _spirv; }
+  [[nodiscard]] auto GetReflection() const -> const ShaderReflection & { return _reflection; }
+  [[nodiscard]] auto GetContentHash() const -> uint64_t { return _content_hash; }
+  // Bumped on every hot reload. Holders of pipelines built from this shader re-request them when it changes.
+  [[nodiscard]] auto GetVersion() const -> uint32_t { return _version; }
+  // Stage description for one entry point, ready to be placed into a pipeline description
+  [[nodiscard]] auto GetStage(std::string_view entry_point) const -> std::optional<ShaderStageDesc>;
+};
+
+// Compiles .slang modules to SPIR-V with slangc and caches the output on disk under the hash of the module's sources
+// and the compiler options, so unchanged shaders load without invoking the compiler. A watcher thread polls the
+// sources of loaded modules, and ProcessReloads recompiles changed ones in place and notifies the reload callbacks.
+class RENDY_API ShaderLibrary {
+  struct WatchedFile {
+    std::filesystem::file_time_type last_write;
+    std::set<std::string, std::less<>> shaders;
+  };
+
+  ShaderLibraryConfig _config;
+  std::filesystem::path _compiler;
+  std::map<std::string, std::shared_ptr<Shader>, std::less<>> _shaders;
+  std::vector<std::function<void(const Shader &)>> _reload_callbacks;
+
+  std::mutex _watch_mutex;
+  std::condition_variable_any _watch_condition;
+  std::map<std::filesystem::path, WatchedFile> _watched_files;
+  std::set<std::string, std::less<>> _dirty;
+  std::jthread _watcher;
+
+  [[nodiscard]] auto compile(Shader &shader) const -> bool;
+  [[nodiscard]] auto loadPrecompiled(Shader &shader) const -> bool;
+  [[nodiscard]] auto compileToCache(const Shader &shader, const std::filesystem::path &output) const -> bool;
+  void watch(const Shader &shader);
+  void pollSourcesLocked();
+
+public:
+  ShaderLibrary() = default;
+  ShaderLibrary(const ShaderLibrary &) = delete;
+  ShaderLibrary(ShaderLibrary &&) = delete;
+  auto operator=(const ShaderLibrary &) -> ShaderLibrary & = delete;
+  auto operator=(ShaderLibrary &&) -> ShaderLibrary & = delete;
+  ~ShaderLibrary() = default;
+
+  [[nodiscard]] auto Initialize(const ShaderLibraryConfig &config = {}) -> bool;
+  void Destroy();
+
+  // Loads a module by its path relative to the source directory without extension, e.g. "triangle".
+  // Returns the already loaded module when called again.
+  [[nodiscard]] auto Load(std::string_view name) -> std::shared_ptr<Shader>;
+  // Loads several modules at once, compiling them as jobs, so later Load calls find them ready. Returns how many
+  // loaded; failures are logged like those of Load.
+  auto Preload(std::span<const std::string_view> names, common::JobSystem &job_system) -> size_t;
+  // Recompiles modules whose sources changed since the last call. Call from the thread that owns the pipelines.
+  // A module that fails to compile keeps its previous SPIR-V. Returns the number of reloaded modules.
+  auto ProcessReloads() -> size_t;
+  void AddReloadCallback(std::function<void(const Shader &)> callback);
+
+  [[nodiscard]] auto HasCompiler() const -> bool { return !_compiler.empty(); }
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+struct ReflectedEntryPoint {
+  std::string name;
+  vk::ShaderStageFlagBits stage{vk::ShaderStageFlagBits::eVertex};
+  std::array<uint32_t, 3> local_size{1, 1, 1};
+  // Specialization constant ids driving the workgroup size, when it was declared through constants
+  std::array<std::optional<uint32_t>, 3> local_size_spec_ids;
+};
+
+struct ReflectedBinding {
+  std::string name;
+  uint32_t set{0};
+  uint32_t binding{0};
+  vk::DescriptorType type{vk::DescriptorType::eUniformBuffer};
+  uint32_t count{1}; // Zero for runtime sized arrays
+  vk::ShaderStageFlags stages;
+};
+
+struct ShaderReflection {
+  std::vector<ReflectedEntryPoint> entry_points;
+  std::vector<ReflectedBinding> bindings;
+  uint32_t push_constant_size{0};
+  vk::ShaderStageFlags push_constant_stages;
+
+  [[nodiscard]] auto FindEntryPoint(std::string_view name) const -> const ReflectedEntryPoint *;
+  [[nodiscard]] auto GetSetLayoutBindings(uint32_t set) const -> std::vector<vk::DescriptorSetLayoutBinding>;
+  [[nodiscard]] auto GetPushConstantRange() const -> std::optional<vk::PushConstantRange>;
+};
+
+// Reads entry points, descriptor bindings and the push constant block straight from the SPIR-V words. Covers the
+// subset of the format our shaders produce; returns nothing for malformed modules.
+[[nodiscard]] RENDY_API auto ReflectSpirv(std::span<const uint32_t> spirv) -> std::optional<ShaderReflection>;
+
+} // namespace rendy::graphics::vulkan
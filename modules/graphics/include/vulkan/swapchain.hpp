@@ -0,0 +1,131 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+
+enum class PresentMode : uint8_t {
+  Fifo,        // Waits for vblank and never tears. Always supported, used when the requested mode isn't.
+  FifoRelaxed, // Like Fifo, but a frame that misses vblank is shown right away and may tear
+  Mailbox,     // The newest frame replaces the queued one at vblank: no tearing and little queuing
+  Immediate,   // Shown right away, tears, lowest latency
+};
+
+struct SwapchainConfig {
+  PresentMode present_mode{PresentMode::Fifo};
+  // Clamped to the surface limits. Fewer images queue fewer frames with Fifo.
+  uint32_t image_count{3};
+  bool srgb{true};
+  // Keeps at most max_queued_frames presents ahead of the display. WaitForLatency blocks until an earlier present has
+  // reached the screen (VK_KHR_present_wait) or at least finished rendering, so input sampled after it is fresher.
+  bool low_latency{false};
+  uint32_t max_queued_frames{1};
+};
+
+struct SwapchainImage {
+  vk::Image image;
+  vk::ImageView view;
+  uint32_t index{0};
+  vk::Semaphore acquired; // Signaled once the image can be written; the first submission using it has to wait on it
+  vk::Semaphore rendered; // Must be signaled by the last submission of the frame, Present waits on it
+};
+
+// Presents to a surface from the graphics queue. Resizing retires the old swapchain instead of idling the device:
+// it keeps presenting its queued images and is destroyed once its presents are done, which
+// VK_EXT_swapchain_maintenance1 reports through present fences and is otherwise inferred from the graphics timeline.
+class RENDY_API Swapchain {
+  // A swapchain and everything that has to outlive its last present
+  struct Generation {
+    vk::SwapchainKHR swapchain;
+    std::vector<vk::Image> images;
+    std::vector<vk::ImageView> views;
+    std::vector<vk::Semaphore> rendered_semaphores; // One per image, reused when the image is acquired again
+    std::vector<vk::Fence> present_fences;          // One per image with swapchain maintenance1
+    uint64_t retire_value{0};                       // Graphics timeline value that outlives the last present
+  };
+
+  struct AcquireSemaphore {
+    vk::Semaphore semaphore;
+    uint64_t release_value{0}; // Graphics timeline value after which the wait on it has completed
+  };
+
+  static constexpr size_t kLatencyHistory = 8;
+
+  const VulkanDevice *_device{nullptr};
+  vk::SurfaceKHR _surface;
+  SwapchainConfig _config;
+
+  Generation _current;
+  std::vector<Generation> _retired;
+  vk::SurfaceFormatKHR _surface_format;
+  vk::Extent2D _extent;
+  vk::PresentModeKHR _present_mode{vk::PresentModeKHR::eFifo};
+  // Modes the swapchain can switch to per present without being recreated, from swapchain maintenance1
+  std::vector<vk::PresentModeKHR> _compatible_present_modes;
+  std::vector<vk::PresentModeKHR> _supported_present_modes;
+  bool _maintenance1{false};
+  bool _present_wait{false};
+  bool _needs_recreate{false};
+  uint32_t _recreate_count{0};
+
+  std::vector<AcquireSemaphore> _acquire_semaphores;
+  size_t _next_acquire{0};
+  std::optional<size_t> _pending_acquire;
+
+  // Ids of presents made to the current swapchain, and the graphics timeline value each one waited behind
+  uint64_t _present_id{0};
+  uint64_t _first_present_id{1};
+  std::array<uint64_t, kLatencyHistory> _present_timeline_values{};
+
+  [[nodiscard]] auto createGeneration(vk::Extent2D extent, vk::SwapchainKHR old_swapchain) -> bool;
+  void destroyGeneration(Generation &generation) const;
+  void collectRetired();
+  [[nodiscard]] auto chooseSurfaceFormat() const -> vk::SurfaceFormatKHR;
+  [[nodiscard]] auto choosePresentMode(PresentMode mode) const -> vk::PresentModeKHR;
+  void queryCompatiblePresentModes();
+
+public:
+  Swapchain() = default;
+  Swapchain(const Swapchain &) = delete;
+  Swapchain(Swapchain &&) = delete;
+  auto operator=(const Swapchain &) -> Swapchain & = delete;
+  auto operator=(Swapchain &&) -> Swapchain & = delete;
+  ~Swapchain() = default;
+
+  // The extent is used when the surface leaves it to the swapchain, e.g. for headless surfaces or Wayland windows
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, vk::SurfaceKHR surface, vk::Extent2D extent,
+                                const SwapchainConfig &config = {}) -> bool;
+  void Destroy();
+
+  // Replaces the swapchain without waiting for the device. Returns false while the extent is zero, e.g. when the
+  // window is minimized.
+  auto Recreate(vk::Extent2D extent) -> bool;
+  // Switches the present mode, in place when swapchain maintenance1 allows it, otherwise on the next Recreate
+  void SetPresentMode(PresentMode mode);
+
+  // Blocks until no more than max_queued_frames presents are waiting for the display. No-op unless low latency is on.
+  void WaitForLatency() const;
+  // Returns nothing when the swapchain is out of date and has to be recreated first
+  [[nodiscard]] auto AcquireNextImage() -> std::optional<SwapchainImage>;
+  // Queues the image for presentation on the graphics queue. The rendered semaphore of the image must have been
+  // signaled by an earlier submission on that queue.
+  void Present(const SwapchainImage &image);
+
+  [[nodiscard]] auto NeedsRecreate() const -> bool { return _needs_recreate; }
+  [[nodiscard]] auto Get() const -> vk::SwapchainKHR { return _current.swapchain; }
+  [[nodiscard]] auto GetExtent() const -> vk::Extent2D { return _extent; }
+  [[nodiscard]] auto GetFormat() const -> vk::Format { return _surface_format.format; }
+  [[nodiscard]] auto GetPresentMode() const -> vk::PresentModeKHR { return _present_mode; }
+  [[nodiscard]] auto GetImageCount() const -> uint32_t { return static_cast<uint32_t>(_current.images.size()); }
+  [[nodiscard]] auto GetRecreateCount() const -> uint32_t { return _recreate_count; }
+  [[nodiscard]] auto HasPresentWait() const -> bool { return _present_wait; }
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "common/job_system.hpp"
+#include "core/texture.hpp"
+#include "vulkan/bindless_heap.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/image.hpp"
+#include <atomic>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+
+struct TextureStreamerConfig {
+  // The longest tail of each chain that fits in this many bytes is loaded first and never evicted
+  uint64_t mip_tail_bytes{64ULL * 1024};
+  // Share of the device local budget left over by other resources that textures may fill
+  float budget_fraction{0.8F};
+  // Hard cap on resident texture memory in bytes, zero for none
+  uint64_t max_budget{0};
+  // Level data being loaded or uploaded at once. Bounds staging memory and the upload work of a single frame.
+  uint64_t max_in_flight_bytes{64ULL * 1024 * 1024};
+  // Frames without a RequestMip call after which a texture falls back to its tail
+  uint32_t idle_frames{120};
+};
+
+// Texture whose image is reallocated with more or fewer levels as it streams, so level 0 of the image is always the
+// most detailed resident level. The bindless index changes with every reallocation and must be read when recording.
+// Images are owned by the graphics queue family.
+class RENDY_API VulkanTexture final : public core::Texture {
+  friend class TextureStreamer;
+
+  std::unique_ptr<core::TextureSource> _source;
+  core::ImageDesc _desc;
+  uint32_t _tail_start{0};
+
+  // Only touched by the thread calling TextureStreamer::Update
+  std::unique_ptr<VulkanImage> _image; // Levels [resident mip, mip_levels)
+  BindlessHandle _bindless;
+  uint32_t _wanted_mip{0}; // Textures that are never requested want every level
+  uint32_t _target_mip{0}; // Level being loaded while busy
+  std::optional<uint64_t> _last_request_frame;
+  bool _busy{false}; // A load is in flight
+  bool _failed{false};
+
+  std::atomic<uint32_t> _resident_mip;
+  // Most detailed level requested since the last update
+  std::atomic<uint32_t> _requested_mip{UINT32_MAX};
+
+public:
+  VulkanTexture(std::unique_ptr<core::TextureSource> source, uint64_t mip_tail_bytes);
+
+  [[nodiscard]] auto GetDesc() const -> const core::ImageDesc & override { return _desc; }
+  [[nodiscard]] auto GetResidentMip() const -> uint32_t override { return _resident_mip.load(); }
+  void RequestMip(uint32_t level) override;
+
+  [[nodiscard]] auto GetName() const -> std::string_view { return _source->GetName(); }
+  // Null until the tail has been uploaded
+  [[nodiscard]] auto GetImageView() const -> vk::ImageView { return _image ? _image->GetView() : vk::ImageView{}; }
+  // Index into the bindless sampled image array, BindlessHandle::kInvalid until the tail has been uploaded
+  [[nodiscard]] auto GetBindlessIndex() const -> uint32_t { return _bindless.GetIndex(); }
+};
+
+// Loads textures progressively: the mip tail of every texture first, then more detailed levels as they are requested
+// and as the memory budget allows, evicting levels of textures that are no longer requested. Levels are decoded by
+// jobs into staging buffers, copied on the transfer queue and handed to the graphics queue family with an
+// ownership transfer.
+class RENDY_API TextureStreamer {
+  struct LoadJob {
+    std::shared_ptr<VulkanTexture> texture;
+    uint32_t first_mip{0}; // New levels are [first_mip, last_mip)
+    uint32_t last_mip{0};
+    std::unique_ptr<VulkanBuffer> staging;
+    std::vector<vk::DeviceSize> offsets; // Staging offset of each new level
+    bool succeeded{false};
+  };
+
+  // Level change of a texture recorded in this update
+  struct Reallocation {
+    std::shared_ptr<VulkanTexture> texture;
+    uint32_t mip{0};
+    std::unique_ptr<VulkanImage> image;
+    LoadJob *job{nullptr}; // Set when the new levels come from the transfer queue
+  };
+
+  struct Retired {
+    std::unique_ptr<VulkanImage> image;
+    std::unique_ptr<VulkanBuffer> staging;
+    uint64_t graphics_value{0};
+    uint64_t transfer_value{0};
+  };
+
+  struct CommandRing {
+    core::QueueType queue{core::QueueType::Graphics};
+    vk::CommandPool pool;
+    std::deque<std::pair<uint64_t, vk::CommandBuffer>> in_flight;
+    std::vector<vk::CommandBuffer> free;
+  };
+
+  const VulkanDevice *_device{nullptr};
+  BindlessHeap *_bindless_heap{nullptr};
+  TextureStreamerConfig _config;
+
+  std::vector<std::shared_ptr<VulkanTexture>> _textures;
+  std::vector<std::unique_ptr<LoadJob>> _jobs;
+  std::vector<Retired> _retired;
+  CommandRing _transfer_commands;
+  CommandRing _graphics_commands;
+  uint64_t _in_flight_bytes{0};
+  uint64_t _resident_bytes{0};
+  uint64_t _budget{0};
+
+  common::JobSystem *_job_system{nullptr};
+  common::JobCounter _decoding;
+  std::atomic<bool> _abandoning{false}; // Decode jobs that haven't started return right away
+  std::mutex _completed_mutex;
+  std::vector<LoadJob *> _completed;
+
+  void decode(LoadJob &job);
+  [[nodiscard]] auto queryBudget() const -> uint64_t;
+  [[nodiscard]] auto plan(uint64_t frame_index) -> std::vector<std::pair<std::shared_ptr<VulkanTexture>, uint32_t>>;
+  void startLoad(const std::shared_ptr<VulkanTexture> &texture, uint32_t mip);
+  void submit(std::vector<Reallocation> &reallocations);
+  void retire(bool wait);
+  void unloadUnused();
+  [[nodiscard]] auto createImage(const VulkanTexture &texture, uint32_t mip) const -> std::unique_ptr<VulkanImage>;
+  [[nodiscard]] auto acquireCommandBuffer(CommandRing &ring) -> vk::CommandBuffer;
+  auto submitCommandBuffer(CommandRing &ring, vk::CommandBuffer command_buffer,
+                           std::span<const vk::SemaphoreSubmitInfo> waits) -> uint64_t;
+
+public:
+  TextureStreamer() = default;
+  TextureStreamer(const TextureStreamer &) = delete;
+  TextureStreamer(TextureStreamer &&) = delete;
+  auto operator=(const TextureStreamer &) -> TextureStreamer & = delete;
+  auto operator=(TextureStreamer &&) -> TextureStreamer & = delete;
+  ~TextureStreamer() = default;
+
+  // The bindless heap is optional; without it textures are bound through their image views
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, common::JobSystem &job_system, BindlessHeap *bindless_heap,
+                                const TextureStreamerConfig &config = {}) -> bool;
+  // Abandons loads that haven't been uploaded and waits for the GPU before destroying every image
+  void Destroy();
+
+  // Returns right away; the texture becomes resident once its tail has been uploaded. Dropping the last reference
+  // unloads it. Like Update, only call it from the render thread.
+  [[nodiscard]] auto Load(std::unique_ptr<core::TextureSource> source) -> std::shared_ptr<VulkanTexture>;
+  // Maps the KTX2 file and loads it, transcoding Basis Universal payloads to a format the device supports
+  [[nodiscard]] auto LoadKtx2(const std::filesystem::path &path) -> std::shared_ptr<VulkanTexture>;
+  // Picks the levels to keep resident, starts loads and uploads finished ones. Call once per frame from the render
+  // thread before recording; frames submitted afterwards can sample the new levels.
+  void Update(uint64_t frame_index);
+
+  // Whether streamed textures can use the format: sampled, and copied when levels are added or dropped
+  [[nodiscard]] auto IsFormatSupported(core::Format format) const -> bool;
+  [[nodiscard]] auto GetResidentBytes() const -> uint64_t { return _resident_bytes; }
+  [[nodiscard]] auto GetBudget() const -> uint64_t { return _budget; }
+  [[nodiscard]] auto GetPendingLoadCount() const -> size_t { return _jobs.size(); }
+};
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include <atomic>
+#include <cstdint>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+// Monotonic GPU progress counter. Each queue owns one and every submission to it signals the next value, so "has this
+// work finished" becomes a comparison against the completed value instead of a fence per submission.
+class RENDY_API TimelineSemaphore {
+  vk::Device _device;
+  vk::Semaphore _semaphore;
+  // Highest value handed out for a signal operation
+  std::atomic<uint64_t> _last_reserved{0};
+
+public:
+  [[nodiscard]] auto Initialize(vk::Device device, uint64_t initial_value = 0) -> bool;
+  void Destroy();
+
+  [[nodiscard]] auto Get() const -> vk::Semaphore { return _semaphore; }
+
+  // Returns the value the next submission should signal. Submissions have to reach the queue in reservation order,
+  // so call this while holding the queue lock.
+  [[nodiscard]] auto Reserve() -> uint64_t { return ++_last_reserved; }
+  [[nodiscard]] auto GetLastReserved() const -> uint64_t { return _last_reserved.load(); }
+
+  // Non-blocking query of the value the GPU has reached
+  [[nodiscard]] auto GetCompletedValue() const -> uint64_t;
+  [[nodiscard]] auto IsComplete(uint64_t value) const -> bool { return GetCompletedValue() >= value; }
+  // Blocks until the value is reached. Returns false on timeout.
+  auto Wait(uint64_t value, uint64_t timeout_ns = UINT64_MAX) const -> bool;
+  // Signals the value from the host
+  void Signal(uint64_t value);
+};
+
+} // namespace rendy::graphics::vulkan
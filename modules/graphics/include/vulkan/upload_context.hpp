@@ -0,0 +1,61 @@
+#pragma once
+
+#include "rendy_api_export.h"
+#include "vulkan/memory_allocator.hpp"
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+namespace rendy::graphics::vulkan {
+
+class VulkanDevice;
+
+struct UploadContextConfig {
+  vk::DeviceSize staging_size{64ULL * 1024 * 1024};
+};
+
+// Stages buffer uploads in a shared host visible ring and submits them on the transfer queue in one batch.
+// Copies into the same destination buffer are recorded as a single vkCmdCopyBuffer with adjacent regions merged.
+class RENDY_API UploadContext {
+  struct Submission {
+    uint64_t timeline_value{0};
+    vk::CommandBuffer command_buffer;
+  };
+
+  const VulkanDevice *_device{nullptr};
+  UploadContextConfig _config;
+
+  std::mutex _mutex;
+  std::unique_ptr<RingPool> _staging_ring;
+  vk::Buffer _staging_buffer;
+  vk::CommandPool _command_pool;
+  std::map<VkBuffer, std::vector<vk::BufferCopy>> _pending_copies;
+  std::deque<Submission> _in_flight;
+  std::vector<Submission> _free_submissions;
+  uint64_t _last_submitted_value{0};
+
+  [[nodiscard]] auto flushLocked() -> uint64_t;
+  void retireLocked(bool wait_for_oldest);
+  [[nodiscard]] auto acquireSubmission() -> Submission;
+
+public:
+  [[nodiscard]] auto Initialize(const VulkanDevice &device, UploadContextConfig config = {}) -> bool;
+  void Destroy();
+
+  // Copies data into the staging ring and queues a copy to dst. Thread safe.
+  void Enqueue(vk::Buffer dst, vk::DeviceSize dst_offset, std::span<const std::byte> data);
+  // Submits every queued copy in one command buffer and returns the transfer queue timeline value it signals, or the
+  // value of the previous submission when nothing was queued. Queues reading the uploaded data wait on that value.
+  auto Flush() -> uint64_t;
+  // Recycles finished submissions and their staging memory without blocking
+  void Poll();
+  void WaitForSubmission(uint64_t timeline_value);
+  [[nodiscard]] auto IsComplete(uint64_t timeline_value) -> bool;
+};
+
+} // namespace rendy::graphics::vulkan
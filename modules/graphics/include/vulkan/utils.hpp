@@ -16,4 +16,10 @@ template <typename T>
   return result_value.value;
 }
 
+RENDY_API inline void VkCheck(const vk::Result result, const std::string_view error_message) {
+  if (result != vk::Result::eSuccess) {
+    throw std::runtime_error(std::string(error_message) + " | " + vk::to_string(result));
+  }
+}
+
 } // namespace rendy::graphics::vulkan
@@ -0,0 +1,78 @@
+#include "core/image.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace rendy::graphics::core {
+
+auto GetFormatInfo(Format format) -> FormatInfo {
+  switch (format) {
+  case Format::Undefined:
+    return FormatInfo{};
+  case Format::R8Unorm:
+    return FormatInfo{.block_size = 1};
+  case Format::R8G8Unorm:
+    return FormatInfo{.block_size = 2};
+  case Format::R8G8B8A8Unorm:
+  case Format::B8G8R8A8Unorm:
+    return FormatInfo{.block_size = 4};
+  case Format::R8G8B8A8Srgb:
+  case Format::B8G8R8A8Srgb:
+    return FormatInfo{.block_size = 4, .srgb = true};
+  case Format::R16G16B16A16Sfloat:
+    return FormatInfo{.block_size = 8};
+  case Format::R32G32B32A32Sfloat:
+    return FormatInfo{.block_size = 16};
+  case Format::BC1RgbaUnorm:
+  case Format::BC4Unorm:
+    return FormatInfo{.block_width = 4, .block_height = 4, .block_size = 8};
+  case Format::BC1RgbaSrgb:
+    return FormatInfo{.block_width = 4, .block_height = 4, .block_size = 8, .srgb = true};
+  case Format::BC3Unorm:
+  case Format::BC5Unorm:
+  case Format::BC6HUfloat:
+  case Format::BC7Unorm:
+    return FormatInfo{.block_width = 4, .block_height = 4, .block_size = 16};
+  case Format::BC3Srgb:
+  case Format::BC7Srgb:
+    return FormatInfo{.block_width = 4, .block_height = 4, .block_size = 16, .srgb = true};
+  case Format::ASTC4x4Unorm:
+    return FormatInfo{.block_width = 4, .block_height = 4, .block_size = 16};
+  case Format::ASTC4x4Srgb:
+    return FormatInfo{.block_width = 4, .block_height = 4, .block_size = 16, .srgb = true};
+  case Format::ASTC6x6Unorm:
+    return FormatInfo{.block_width = 6, .block_height = 6, .block_size = 16};
+  case Format::ASTC6x6Srgb:
+    return FormatInfo{.block_width = 6, .block_height = 6, .block_size = 16, .srgb = true};
+  case Format::ASTC8x8Unorm:
+    return FormatInfo{.block_width = 8, .block_height = 8, .block_size = 16};
+  case Format::ASTC8x8Srgb:
+    return FormatInfo{.block_width = 8, .block_height = 8, .block_size = 16, .srgb = true};
+  }
+  return FormatInfo{};
+}
+
+auto GetFullMipCount(ImageExtent extent) -> uint32_t {
+  return static_cast<uint32_t>(std::bit_width(std::max({extent.width, extent.height, 1U})));
+}
+
+auto GetMipExtent(ImageExtent extent, uint32_t level) -> ImageExtent {
+  return ImageExtent{.width = std::max(extent.width >> level, 1U), .height = std::max(extent.height >> level, 1U)};
+}
+
+auto GetMipSize(const ImageDesc &desc, uint32_t level) -> uint64_t {
+  const auto info = GetFormatInfo(desc.format);
+  const auto extent = GetMipExtent(desc.extent, level);
+  const uint64_t blocks_x = (extent.width + info.block_width - 1) / info.block_width;
+  const uint64_t blocks_y = (extent.height + info.block_height - 1) / info.block_height;
+  return blocks_x * blocks_y * info.block_size * desc.array_layers;
+}
+
+auto GetMipChainSize(const ImageDesc &desc, uint32_t first_level) -> uint64_t {
+  uint64_t size = 0;
+  for (auto level = first_level; level < desc.mip_levels; ++level) {
+    size += GetMipSize(desc, level);
+  }
+  return size;
+}
+
+} // namespace rendy::graphics::core
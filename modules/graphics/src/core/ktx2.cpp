@@ -0,0 +1,247 @@
+#include "core/ktx2.hpp"
+#include "common/log.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+#ifdef RENDY_HAS_BASISU
+#include <basisu_transcoder.h>
+#include <mutex>
+#endif
+
+namespace rendy::graphics::core {
+
+namespace {
+
+constexpr std::array<uint8_t, 12> kIdentifier = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+constexpr size_t kHeaderSize = 80;
+constexpr size_t kLevelIndexEntrySize = 24;
+constexpr uint32_t kSupercompressionNone = 0;
+// Offset of the transfer function byte in the data format descriptor, behind its total size and the first two words
+// of the basic descriptor block
+constexpr size_t kDfdTransferOffset = 14;
+constexpr uint8_t kDfdTransferSrgb = 2;
+
+template <typename T> auto read(std::span<const std::byte> data, size_t offset) -> T {
+  T value{};
+  std::memcpy(&value, data.data() + offset, sizeof(T));
+  return value;
+}
+
+// KTX2 stores VkFormat values; only the ones core::Format can describe are accepted
+auto fromVkFormat(uint32_t vk_format) -> Format {
+  switch (vk_format) {
+  case 9: // VK_FORMAT_R8_UNORM
+    return Format::R8Unorm;
+  case 16: // VK_FORMAT_R8G8_UNORM
+    return Format::R8G8Unorm;
+  case 37: // VK_FORMAT_R8G8B8A8_UNORM
+    return Format::R8G8B8A8Unorm;
+  case 43: // VK_FORMAT_R8G8B8A8_SRGB
+    return Format::R8G8B8A8Srgb;
+  case 44: // VK_FORMAT_B8G8R8A8_UNORM
+    return Format::B8G8R8A8Unorm;
+  case 50: // VK_FORMAT_B8G8R8A8_SRGB
+    return Format::B8G8R8A8Srgb;
+  case 97: // VK_FORMAT_R16G16B16A16_SFLOAT
+    return Format::R16G16B16A16Sfloat;
+  case 109: // VK_FORMAT_R32G32B32A32_SFLOAT
+    return Format::R32G32B32A32Sfloat;
+  case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+    return Format::BC1RgbaUnorm;
+  case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+    return Format::BC1RgbaSrgb;
+  case 137: // VK_FORMAT_BC3_UNORM_BLOCK
+    return Format::BC3Unorm;
+  case 138: // VK_FORMAT_BC3_SRGB_BLOCK
+    return Format::BC3Srgb;
+  case 139: // VK_FORMAT_BC4_UNORM_BLOCK
+    return Format::BC4Unorm;
+  case 141: // VK_FORMAT_BC5_UNORM_BLOCK
+    return Format::BC5Unorm;
+  case 143: // VK_FORMAT_BC6H_UFLOAT_BLOCK
+    return Format::BC6HUfloat;
+  case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+    return Format::BC7Unorm;
+  case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+    return Format::BC7Srgb;
+  case 157: // VK_FORMAT_ASTC_4x4_UNORM_BLOCK
+    return Format::ASTC4x4Unorm;
+  case 158: // VK_FORMAT_ASTC_4x4_SRGB_BLOCK
+    return Format::ASTC4x4Srgb;
+  case 165: // VK_FORMAT_ASTC_6x6_UNORM_BLOCK
+    return Format::ASTC6x6Unorm;
+  case 166: // VK_FORMAT_ASTC_6x6_SRGB_BLOCK
+    return Format::ASTC6x6Srgb;
+  case 171: // VK_FORMAT_ASTC_8x8_UNORM_BLOCK
+    return Format::ASTC8x8Unorm;
+  case 172: // VK_FORMAT_ASTC_8x8_SRGB_BLOCK
+    return Format::ASTC8x8Srgb;
+  default:
+    return Format::Undefined;
+  }
+}
+
+} // namespace
+
+#ifdef RENDY_HAS_BASISU
+struct Ktx2TextureSource::BasisTranscoder {
+  basist::ktx2_transcoder transcoder;
+  basist::transcoder_texture_format target{basist::transcoder_texture_format::cTFRGBA32};
+};
+#else
+struct Ktx2TextureSource::BasisTranscoder {};
+#endif
+
+Ktx2TextureSource::Ktx2TextureSource() = default;
+Ktx2TextureSource::~Ktx2TextureSource() = default;
+
+auto Ktx2TextureSource::Open(const std::filesystem::path &path, const FormatSupportQuery &is_supported)
+    -> std::unique_ptr<Ktx2TextureSource> {
+  // The constructor is private so every instance is backed by a parsed file
+  std::unique_ptr<Ktx2TextureSource> source(new Ktx2TextureSource());
+  source->_name = path.string();
+  if (!source->_file.Open(path) || !source->parse(is_supported)) {
+    return nullptr;
+  }
+  return source;
+}
+
+auto Ktx2TextureSource::parse(const FormatSupportQuery &is_supported) -> bool {
+  const auto data = _file.GetData();
+  if (data.size() < kHeaderSize || std::memcmp(data.data(), kIdentifier.data(), kIdentifier.size()) != 0) {
+    RENDY_LOG_ERROR("{} is not a KTX2 file", _name);
+    return false;
+  }
+
+  const auto vk_format = read<uint32_t>(data, 12);
+  const auto width = read<uint32_t>(data, 20);
+  const auto height = read<uint32_t>(data, 24);
+  const auto depth = read<uint32_t>(data, 28);
+  const auto layers = read<uint32_t>(data, 32);
+  const auto faces = read<uint32_t>(data, 36);
+  const auto levels = std::max(read<uint32_t>(data, 40), 1U); // Zero asks the loader to generate levels
+  const auto supercompression = read<uint32_t>(data, 44);
+  const auto dfd_offset = read<uint32_t>(data, 48);
+  const auto dfd_size = read<uint32_t>(data, 52);
+
+  if (width == 0 || depth > 1 || faces != 1) {
+    RENDY_LOG_ERROR("{} is not a 2D texture; 1D, 3D and cube map textures are not supported", _name);
+    return false;
+  }
+  _desc = ImageDesc{.extent = ImageExtent{.width = width, .height = std::max(height, 1U)},
+                    .mip_levels = std::min(levels, GetFullMipCount(ImageExtent{.width = width, .height = height})),
+                    .array_layers = std::max(layers, 1U)};
+
+  if (data.size() < kHeaderSize + (kLevelIndexEntrySize * levels)) {
+    RENDY_LOG_ERROR("{} is truncated", _name);
+    return false;
+  }
+  _levels.clear();
+  for (uint32_t level = 0; level < _desc.mip_levels; ++level) {
+    const auto entry = kHeaderSize + (kLevelIndexEntrySize * level);
+    const Level index{.offset = read<uint64_t>(data, entry), .size = read<uint64_t>(data, entry + 8)};
+    if (index.offset > data.size() || index.size > data.size() - index.offset) {
+      RENDY_LOG_ERROR("Level {} of {} lies outside the file", level, _name);
+      return false;
+    }
+    _levels.push_back(index);
+  }
+
+  // Basis Universal payloads carry no VkFormat; they are transcoded to whatever the device can sample
+  if (vk_format == 0) {
+    const bool srgb = dfd_size > kDfdTransferOffset && size_t{dfd_offset} + dfd_size <= data.size() &&
+                      read<uint8_t>(data, dfd_offset + kDfdTransferOffset) == kDfdTransferSrgb;
+    return initializeTranscoder(is_supported, srgb);
+  }
+
+  if (supercompression != kSupercompressionNone) {
+    RENDY_LOG_ERROR("{} uses supercompression scheme {}, which is only supported for Basis Universal payloads", _name,
+                    supercompression);
+    return false;
+  }
+  _desc.format = fromVkFormat(vk_format);
+  if (_desc.format == Format::Undefined) {
+    RENDY_LOG_ERROR("{} uses VkFormat {}, which is not supported", _name, vk_format);
+    return false;
+  }
+  if (!is_supported(_desc.format)) {
+    RENDY_LOG_ERROR("{} uses VkFormat {}, which the device can't sample", _name, vk_format);
+    return false;
+  }
+  for (uint32_t level = 0; level < _desc.mip_levels; ++level) {
+    if (_levels[level].size < GetMipSize(_desc, level)) {
+      RENDY_LOG_ERROR("Level {} of {} is smaller than its extent requires", level, _name);
+      return false;
+    }
+  }
+  return true;
+}
+
+auto Ktx2TextureSource::initializeTranscoder(const FormatSupportQuery &is_supported, bool srgb) -> bool {
+#ifdef RENDY_HAS_BASISU
+  static std::once_flag init_flag;
+  std::call_once(init_flag, [] { basist::basisu_transcoder_init(); });
+
+  auto transcoder = std::make_unique<BasisTranscoder>();
+  const auto data = _file.GetData();
+  if (!transcoder->transcoder.init(data.data(), static_cast<uint32_t>(data.size())) ||
+      !transcoder->transcoder.start_transcoding()) {
+    RENDY_LOG_ERROR("{} holds an invalid Basis Universal payload", _name);
+    return false;
+  }
+
+  // Ordered by quality per byte; RGBA8 always works but takes four times the memory of the block formats
+  using enum basist::transcoder_texture_format;
+  const std::array<std::pair<Format, basist::transcoder_texture_format>, 3> targets = {{
+      {srgb ? Format::BC7Srgb : Format::BC7Unorm, cTFBC7_RGBA},
+      {srgb ? Format::ASTC4x4Srgb : Format::ASTC4x4Unorm, cTFASTC_4x4_RGBA},
+      {srgb ? Format::R8G8B8A8Srgb : Format::R8G8B8A8Unorm, cTFRGBA32},
+  }};
+  const auto target = std::ranges::find_if(targets, [&](const auto &entry) { return is_supported(entry.first); });
+  if (target == targets.end()) {
+    RENDY_LOG_ERROR("The device can't sample any format {} could be transcoded to", _name);
+    return false;
+  }
+  _desc.format = target->first;
+  transcoder->target = target->second;
+  _transcoder = std::move(transcoder);
+  RENDY_LOG_DEBUG("Transcoding {} to {}", _name, basist::basis_get_format_name(target->second));
+  return true;
+#else
+  (void)is_supported;
+  (void)srgb;
+  RENDY_LOG_ERROR("{} is Basis Universal encoded, which needs a build with RENDY_WITH_BASISU", _name);
+  return false;
+#endif
+}
+
+auto Ktx2TextureSource::LoadMip(uint32_t level, std::span<std::byte> dst) -> bool {
+  const auto size = GetMipSize(_desc, level);
+  if (level >= _desc.mip_levels || dst.size() < size) {
+    return false;
+  }
+
+#ifdef RENDY_HAS_BASISU
+  if (_transcoder != nullptr) {
+    // The buffer size is counted in blocks, or in pixels for uncompressed targets
+    const auto layer_size = size / _desc.array_layers;
+    const auto units = static_cast<uint32_t>(layer_size / GetFormatInfo(_desc.format).block_size);
+    for (uint32_t layer = 0; layer < _desc.array_layers; ++layer) {
+      if (!_transcoder->transcoder.transcode_image_level(level, layer, 0, dst.data() + (layer * layer_size), units,
+                                                         _transcoder->target)) {
+        return false;
+      }
+    }
+    return true;
+  }
+#endif
+
+  // Levels are stored with their layers tightly packed, which is the layout the staging buffer expects
+  const auto &index = _levels[level];
+  std::memcpy(dst.data(), _file.GetData().data() + index.offset, size);
+  return true;
+}
+
+} // namespace rendy::graphics::core
@@ -0,0 +1,93 @@
+#include "core/mapped_file.hpp"
+#include "common/log.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rendy::graphics::core {
+
+#ifdef _WIN32
+
+auto MappedFile::Open(const std::filesystem::path &path) -> bool {
+  Close();
+  auto *file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    RENDY_LOG_ERROR("Failed to open {}", path.string());
+    return false;
+  }
+  LARGE_INTEGER size{};
+  if (GetFileSizeEx(file, &size) == FALSE || size.QuadPart == 0) {
+    RENDY_LOG_ERROR("{} is empty or its size can't be read", path.string());
+    CloseHandle(file);
+    return false;
+  }
+  // The view keeps the mapping and the file alive, so both handles can be closed right away
+  auto *mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    RENDY_LOG_ERROR("Failed to map {}", path.string());
+    return false;
+  }
+  const auto *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (view == nullptr) {
+    RENDY_LOG_ERROR("Failed to map {}", path.string());
+    return false;
+  }
+  _data = std::span(static_cast<const std::byte *>(view), static_cast<size_t>(size.QuadPart));
+  return true;
+}
+
+void MappedFile::Close() {
+  if (!_data.empty()) {
+    UnmapViewOfFile(_data.data());
+    _data = {};
+  }
+}
+
+#else
+
+auto MappedFile::Open(const std::filesystem::path &path) -> bool {
+  Close();
+  const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    RENDY_LOG_ERROR("Failed to open {}", path.string());
+    return false;
+  }
+  struct stat info {};
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    RENDY_LOG_ERROR("{} is empty or its size can't be read", path.string());
+    close(fd);
+    return false;
+  }
+  const auto size = static_cast<size_t>(info.st_size);
+  // The mapping stays valid after the descriptor is closed
+  auto *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    RENDY_LOG_ERROR("Failed to map {}", path.string());
+    return false;
+  }
+  _data = std::span(static_cast<const std::byte *>(mapped), size);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (!_data.empty()) {
+    munmap(const_cast<std::byte *>(_data.data()), _data.size());
+    _data = {};
+  }
+}
+
+#endif
+
+} // namespace rendy::graphics::core
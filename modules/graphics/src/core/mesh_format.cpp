@@ -0,0 +1,104 @@
+#include "core/mesh_format.hpp"
+#include "common/log.hpp"
+#include <cstring>
+
+namespace rendy::graphics::core {
+
+auto MeshFile::Open(const std::filesystem::path &path) -> bool {
+  Close();
+  if (!_file.Open(path)) {
+    return false;
+  }
+  const auto data = _file.GetData();
+  if (data.size() < sizeof(MeshFileHeader)) {
+    RENDY_LOG_ERROR("{} is too small to be a mesh file", path.string());
+    Close();
+    return false;
+  }
+  std::memcpy(&_header, data.data(), sizeof(_header));
+  if (!validate(path)) {
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void MeshFile::Close() {
+  _file.Close();
+  _header = {};
+}
+
+auto MeshFile::GetSection(MeshSection section) const -> std::span<const std::byte> {
+  const auto &entry = _header.sections.at(static_cast<size_t>(section));
+  return _file.GetData().subspan(entry.offset, entry.size);
+}
+
+// Only the header, the LOD table and the meshlet table are checked. Checking every index would read the whole file
+// from disk before the upload does; the cooker is trusted to write indices within the vertex count.
+auto MeshFile::validate(const std::filesystem::path &path) const -> bool {
+  if (_header.magic != kMeshFileMagic) {
+    RENDY_LOG_ERROR("{} is not a mesh file", path.string());
+    return false;
+  }
+  if (_header.version != kMeshFileVersion) {
+    RENDY_LOG_ERROR("{} has format version {}, expected {}; cook it again", path.string(), _header.version,
+                    kMeshFileVersion);
+    return false;
+  }
+  if (_header.vertex_count == 0 || _header.lod_count == 0 || _header.lod_count > kMeshMaxLods) {
+    RENDY_LOG_ERROR("{} has {} vertices and {} LODs", path.string(), _header.vertex_count, _header.lod_count);
+    return false;
+  }
+
+  const auto file_size = _file.GetData().size();
+  const auto expect = [&](MeshSection section, uint64_t element_size, uint64_t count) {
+    const auto &entry = _header.sections.at(static_cast<size_t>(section));
+    const bool inside = entry.offset <= file_size && entry.size <= file_size - entry.offset;
+    if (entry.offset % kMeshSectionAlignment != 0 || !inside) {
+      RENDY_LOG_ERROR("{}: section {} lies outside the file", path.string(), static_cast<uint32_t>(section));
+      return false;
+    }
+    if (count != 0 ? entry.size != element_size * count : entry.size % element_size != 0) {
+      RENDY_LOG_ERROR("{}: section {} has {} bytes", path.string(), static_cast<uint32_t>(section), entry.size);
+      return false;
+    }
+    return true;
+  };
+  // Counts of zero only check that the section holds whole elements
+  if (!expect(MeshSection::Positions, sizeof(MeshPosition), _header.vertex_count) ||
+      !expect(MeshSection::Attributes, sizeof(MeshAttributes), _header.vertex_count) ||
+      !expect(MeshSection::Indices, sizeof(uint32_t), 0) ||
+      !expect(MeshSection::Lods, sizeof(MeshLod), _header.lod_count) ||
+      !expect(MeshSection::Meshlets, sizeof(MeshletDesc), _header.meshlet_count) ||
+      !expect(MeshSection::MeshletBounds, sizeof(MeshletBounds), _header.meshlet_count) ||
+      !expect(MeshSection::MeshletVertices, sizeof(uint32_t), 0) ||
+      !expect(MeshSection::MeshletTriangles, sizeof(uint32_t), 0)) {
+    return false;
+  }
+
+  const auto index_count = GetIndices().size();
+  for (const auto &lod : GetLods()) {
+    if (uint64_t{lod.index_offset} + lod.index_count > index_count ||
+        uint64_t{lod.meshlet_offset} + lod.meshlet_count > _header.meshlet_count) {
+      RENDY_LOG_ERROR("{}: a LOD refers past the end of the indices or meshlets", path.string());
+      return false;
+    }
+  }
+
+  // The meshlet shaders size their workgroups for the limits. Triangles start on a word, as the cooker pads them.
+  const auto meshlet_vertex_count = GetMeshletVertices().size();
+  const auto meshlet_triangle_bytes = GetMeshletTriangles().size();
+  for (const auto &meshlet : GetMeshlets()) {
+    if (meshlet.vertex_count > kMeshletMaxVertices || meshlet.triangle_count > kMeshletMaxTriangles ||
+        meshlet.triangle_offset % sizeof(uint32_t) != 0 ||
+        uint64_t{meshlet.vertex_offset} + meshlet.vertex_count > meshlet_vertex_count ||
+        uint64_t{meshlet.triangle_offset} + (uint64_t{meshlet.triangle_count} * 3) > meshlet_triangle_bytes) {
+      RENDY_LOG_ERROR("{}: a meshlet exceeds the meshlet limits or refers past the end of its vertices or triangles",
+                      path.string());
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace rendy::graphics::core
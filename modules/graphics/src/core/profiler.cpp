@@ -0,0 +1,75 @@
+#include "core/profiler.hpp"
+#include <chrono>
+#include <utility>
+
+namespace rendy::graphics::core {
+
+auto CpuProfiler::Get() -> CpuProfiler & {
+  static CpuProfiler profiler;
+  return profiler;
+}
+
+auto CpuProfiler::Now() -> uint64_t {
+  static const auto kEpoch = std::chrono::steady_clock::now();
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - kEpoch).count());
+}
+
+auto CpuProfiler::threadBuffer() -> ThreadBuffer & {
+  // The profiler keeps a reference too, so zones of threads that already exited can still be collected
+  thread_local std::shared_ptr<ThreadBuffer> buffer;
+  if (buffer == nullptr) {
+    buffer = std::make_shared<ThreadBuffer>();
+    const std::scoped_lock lock(_threads_mutex);
+    buffer->thread_id = static_cast<uint32_t>(_threads.size());
+    _threads.push_back(buffer);
+  }
+  return *buffer;
+}
+
+auto CpuProfiler::BeginZone() -> uint32_t { return threadBuffer().depth++; }
+
+void CpuProfiler::EndZone(const char *name, uint32_t depth, uint64_t begin_ns, uint64_t end_ns) {
+  auto &buffer = threadBuffer();
+  buffer.depth = depth;
+  const std::scoped_lock lock(buffer.mutex);
+  if (buffer.zones.size() >= kMaxZonesPerThread) {
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer.zones.push_back(CpuZoneRecord{
+      .name = name, .thread_id = buffer.thread_id, .depth = depth, .begin_ns = begin_ns, .end_ns = end_ns});
+}
+
+auto CpuProfiler::Collect() -> std::vector<CpuZoneRecord> {
+  std::vector<std::shared_ptr<ThreadBuffer>> threads;
+  {
+    const std::scoped_lock lock(_threads_mutex);
+    threads = _threads;
+  }
+  std::vector<CpuZoneRecord> zones;
+  for (const auto &thread : threads) {
+    std::vector<CpuZoneRecord> recorded;
+    {
+      const std::scoped_lock lock(thread->mutex);
+      recorded.swap(thread->zones);
+    }
+    zones.insert(zones.end(), recorded.begin(), recorded.end());
+  }
+  return zones;
+}
+
+CpuZone::CpuZone(const char *name) : _name(name), _active(CpuProfiler::Get().IsEnabled()) {
+  if (_active) {
+    _depth = CpuProfiler::Get().BeginZone();
+    _begin_ns = CpuProfiler::Now();
+  }
+}
+
+CpuZone::~CpuZone() {
+  if (_active) {
+    CpuProfiler::Get().EndZone(_name, _depth, _begin_ns, CpuProfiler::Now());
+  }
+}
+
+} // namespace rendy::graphics::core
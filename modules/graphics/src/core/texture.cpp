@@ -0,0 +1,92 @@
+#include "core/texture.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <utility>
+
+namespace rendy::graphics::core {
+
+namespace {
+
+constexpr uint32_t kChannels = 4;
+
+auto srgbToLinearTable() -> const std::array<float, 256> & {
+  static const auto table = [] {
+    std::array<float, 256> values{};
+    for (size_t i = 0; i < values.size(); ++i) {
+      const auto c = static_cast<float>(i) / 255.0F;
+      values.at(i) = c <= 0.04045F ? c / 12.92F : std::pow((c + 0.055F) / 1.055F, 2.4F);
+    }
+    return values;
+  }();
+  return table;
+}
+
+auto linearToSrgb(float value) -> float {
+  return value <= 0.0031308F ? value * 12.92F : (1.055F * std::pow(value, 1.0F / 2.4F)) - 0.055F;
+}
+
+} // namespace
+
+Rgba8TextureSource::Rgba8TextureSource(std::string name, ImageExtent extent, std::vector<std::byte> pixels, bool srgb)
+    : _name(std::move(name)),
+      _desc{.extent = extent,
+            .mip_levels = GetFullMipCount(extent),
+            .format = srgb ? Format::R8G8B8A8Srgb : Format::R8G8B8A8Unorm},
+      _pixels(std::move(pixels)) {}
+
+auto Rgba8TextureSource::LoadMip(uint32_t level, std::span<std::byte> dst) -> bool {
+  const auto base = _desc.extent;
+  if (level >= _desc.mip_levels || _pixels.size() < size_t{base.width} * base.height * kChannels ||
+      dst.size() < GetMipSize(_desc, level)) {
+    return false;
+  }
+  if (level == 0) {
+    std::ranges::copy(std::span(_pixels).first(dst.size()), dst.begin());
+    return true;
+  }
+
+  // Every texel of the level averages its footprint in the base level, clamped at the edges of odd sized images
+  const bool srgb = GetFormatInfo(_desc.format).srgb;
+  const auto &to_linear = srgbToLinearTable();
+  const auto extent = GetMipExtent(base, level);
+  const auto footprint = 1U << level;
+  for (uint32_t y = 0; y < extent.height; ++y) {
+    const auto y_end = std::min((y + 1) * footprint, base.height);
+    for (uint32_t x = 0; x < extent.width; ++x) {
+      const auto x_end = std::min((x + 1) * footprint, base.width);
+      std::array<float, kChannels> sum{};
+      for (auto sy = y * footprint; sy < y_end; ++sy) {
+        for (auto sx = x * footprint; sx < x_end; ++sx) {
+          const auto *texel = &_pixels[((size_t{sy} * base.width) + sx) * kChannels];
+          for (uint32_t c = 0; c < kChannels; ++c) {
+            const auto value = std::to_integer<uint8_t>(texel[c]);
+            // Alpha is linear in sRGB formats too
+            sum.at(c) += srgb && c < 3 ? to_linear.at(value) : static_cast<float>(value) / 255.0F;
+          }
+        }
+      }
+      const auto count = static_cast<float>((y_end - (y * footprint)) * (x_end - (x * footprint)));
+      auto *out = &dst[((size_t{y} * extent.width) + x) * kChannels];
+      for (uint32_t c = 0; c < kChannels; ++c) {
+        auto value = sum.at(c) / count;
+        value = srgb && c < 3 ? linearToSrgb(value) : value;
+        out[c] = static_cast<std::byte>(std::lround(std::clamp(value, 0.0F, 1.0F) * 255.0F));
+      }
+    }
+  }
+  return true;
+}
+
+auto GetMipTailStart(const ImageDesc &desc, uint64_t max_bytes) -> uint32_t {
+  if (desc.mip_levels == 0) {
+    return 0;
+  }
+  auto start = desc.mip_levels - 1;
+  while (start > 0 && GetMipChainSize(desc, start - 1) <= max_bytes) {
+    --start;
+  }
+  return start;
+}
+
+} // namespace rendy::graphics::core
@@ -0,0 +1,217 @@
+#include "vulkan/bindless_heap.hpp"
+#include "common/log.hpp"
+#include "vulkan/command_list.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/physical_device.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+constexpr std::array kDescriptorTypes{vk::DescriptorType::eSampledImage, vk::DescriptorType::eStorageImage,
+                                      vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eSampler};
+
+auto slotOf(BindlessResourceType type) -> size_t { return static_cast<size_t>(type); }
+
+} // namespace
+
+auto BindlessHeap::Initialize(const VulkanDevice &device, const BindlessHeapConfig &config) -> bool {
+  if (!device.GetCapabilities().bindless_support) {
+    RENDY_LOG_ERROR("Bindless heap needs descriptor indexing with update-after-bind, which the device doesn't support");
+    return false;
+  }
+  _device = &device;
+  const auto vk_device = device.Get();
+
+  // Every array is bounded by both the per-set and the per-stage update-after-bind limits
+  const auto &limits = device.GetPhysicalDevice().GetDescriptorIndexingProperties();
+  const std::array capacities{
+      std::min({config.max_sampled_images, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                limits.maxPerStageDescriptorUpdateAfterBindSampledImages}),
+      std::min({config.max_storage_images, limits.maxDescriptorSetUpdateAfterBindStorageImages,
+                limits.maxPerStageDescriptorUpdateAfterBindStorageImages}),
+      std::min({config.max_storage_buffers, limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers}),
+      std::min({config.max_samplers, limits.maxDescriptorSetUpdateAfterBindSamplers,
+                limits.maxPerStageDescriptorUpdateAfterBindSamplers}),
+  };
+
+  std::array<vk::DescriptorSetLayoutBinding, kTypeCount> bindings;
+  std::array<vk::DescriptorBindingFlags, kTypeCount> binding_flags;
+  std::array<vk::DescriptorPoolSize, kTypeCount> pool_sizes;
+  for (size_t i = 0; i < kTypeCount; ++i) {
+    _slots.at(i) = Slots{.capacity = capacities.at(i)};
+    bindings.at(i) = vk::DescriptorSetLayoutBinding{.binding = VkToU32(i),
+                                                    .descriptorType = kDescriptorTypes.at(i),
+                                                    .descriptorCount = capacities.at(i),
+                                                    .stageFlags = vk::ShaderStageFlagBits::eAll};
+    // Unwritten and released slots are fine as long as shaders never index them
+    binding_flags.at(i) = vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                          vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending |
+                          vk::DescriptorBindingFlagBits::ePartiallyBound;
+    pool_sizes.at(i) = vk::DescriptorPoolSize{.type = kDescriptorTypes.at(i), .descriptorCount = capacities.at(i)};
+  }
+
+  const vk::DescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{
+      .bindingCount = VkToU32(binding_flags.size()), .pBindingFlags = binding_flags.data()};
+  _set_layout = VkCheckAndUnwrap(
+      vk_device.createDescriptorSetLayout(
+          vk::DescriptorSetLayoutCreateInfo{.pNext = &binding_flags_info,
+                                            .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+                                            .bindingCount = VkToU32(bindings.size()),
+                                            .pBindings = bindings.data()}),
+      "Failed to create bindless descriptor set layout.");
+
+  _pool = VkCheckAndUnwrap(
+      vk_device.createDescriptorPool(vk::DescriptorPoolCreateInfo{
+          .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+          .maxSets = 1,
+          .poolSizeCount = VkToU32(pool_sizes.size()),
+          .pPoolSizes = pool_sizes.data()}),
+      "Failed to create bindless descriptor pool.");
+
+  const auto sets =
+      VkCheckAndUnwrap(vk_device.allocateDescriptorSets(vk::DescriptorSetAllocateInfo{
+                           .descriptorPool = _pool, .descriptorSetCount = 1, .pSetLayouts = &_set_layout}),
+                       "Failed to allocate bindless descriptor set.");
+  _set = sets.front();
+
+  RENDY_LOG_INFO("Created bindless heap with {} sampled images, {} storage images, {} storage buffers, {} samplers",
+                 capacities[0], capacities[1], capacities[2], capacities[3]);
+  return true;
+}
+
+void BindlessHeap::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  const auto vk_device = _device->Get();
+  // Destroying the pool frees the set
+  vk_device.destroyDescriptorPool(_pool);
+  vk_device.destroyDescriptorSetLayout(_set_layout);
+  _pool = nullptr;
+  _set_layout = nullptr;
+  _set = nullptr;
+  _slots = {};
+  _retired.clear();
+  _device = nullptr;
+}
+
+auto BindlessHeap::RegisterSampledImage(vk::ImageView view, vk::ImageLayout layout) -> BindlessHandle {
+  const auto handle = allocate(BindlessResourceType::SampledImage);
+  if (handle.IsValid()) {
+    UpdateSampledImage(handle, view, layout);
+  }
+  return handle;
+}
+
+void BindlessHeap::UpdateSampledImage(BindlessHandle handle, vk::ImageView view, vk::ImageLayout layout) {
+  const vk::DescriptorImageInfo image_info{.imageView = view, .imageLayout = layout};
+  write(handle, &image_info, nullptr);
+}
+
+auto BindlessHeap::RegisterStorageImage(vk::ImageView view) -> BindlessHandle {
+  const auto handle = allocate(BindlessResourceType::StorageImage);
+  if (!handle.IsValid()) {
+    return handle;
+  }
+  const vk::DescriptorImageInfo image_info{.imageView = view, .imageLayout = vk::ImageLayout::eGeneral};
+  write(handle, &image_info, nullptr);
+  return handle;
+}
+
+auto BindlessHeap::RegisterStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+    -> BindlessHandle {
+  const auto handle = allocate(BindlessResourceType::StorageBuffer);
+  if (!handle.IsValid()) {
+    return handle;
+  }
+  const vk::DescriptorBufferInfo buffer_info{.buffer = buffer, .offset = offset, .range = range};
+  write(handle, nullptr, &buffer_info);
+  return handle;
+}
+
+auto BindlessHeap::RegisterSampler(vk::Sampler sampler) -> BindlessHandle {
+  const auto handle = allocate(BindlessResourceType::Sampler);
+  if (!handle.IsValid()) {
+    return handle;
+  }
+  const vk::DescriptorImageInfo image_info{.sampler = sampler};
+  write(handle, &image_info, nullptr);
+  return handle;
+}
+
+void BindlessHeap::Release(BindlessHandle handle) {
+  if (!handle.IsValid()) {
+    return;
+  }
+  // Work submitted before this call may still index the slot, so it stays reserved until that work has executed
+  const std::scoped_lock lock(_mutex);
+  _retired.push_back(Retired{.handle = handle,
+                             .graphics_value = _device->GetTimeline(core::QueueType::Graphics).GetLastReserved(),
+                             .compute_value = _device->GetTimeline(core::QueueType::Compute).GetLastReserved()});
+}
+
+void BindlessHeap::Collect() {
+  const std::scoped_lock lock(_mutex);
+  collectLocked();
+}
+
+auto BindlessHeap::GetCapacity(BindlessResourceType type) const -> uint32_t { return _slots.at(slotOf(type)).capacity; }
+
+auto BindlessHeap::Matches(uint32_t binding, vk::DescriptorType type) const -> bool {
+  return binding < kDescriptorTypes.size() && kDescriptorTypes.at(binding) == type;
+}
+
+void BindlessHeap::Bind(VulkanCommandList &command_list, vk::PipelineBindPoint bind_point,
+                        vk::PipelineLayout layout) const {
+  command_list.Get().bindDescriptorSets(bind_point, layout, kSetIndex, _set, {});
+}
+
+auto BindlessHeap::allocate(BindlessResourceType type) -> BindlessHandle {
+  const std::scoped_lock lock(_mutex);
+  auto &slots = _slots.at(slotOf(type));
+  if (slots.free.empty() && slots.next == slots.capacity) {
+    collectLocked();
+  }
+  if (!slots.free.empty()) {
+    const auto index = slots.free.back();
+    slots.free.pop_back();
+    return BindlessHandle{.type = type, .index = index};
+  }
+  if (slots.next < slots.capacity) {
+    return BindlessHandle{.type = type, .index = slots.next++};
+  }
+  RENDY_LOG_ERROR("Bindless heap is out of slots for resource type {}", static_cast<uint32_t>(type));
+  return BindlessHandle{.type = type};
+}
+
+void BindlessHeap::write(BindlessHandle handle, const vk::DescriptorImageInfo *image_info,
+                         const vk::DescriptorBufferInfo *buffer_info) {
+  // vkUpdateDescriptorSets needs external synchronization of the set even with update-after-bind
+  const std::scoped_lock lock(_mutex);
+  _device->Get().updateDescriptorSets(vk::WriteDescriptorSet{.dstSet = _set,
+                                                             .dstBinding = VkToU32(slotOf(handle.type)),
+                                                             .dstArrayElement = handle.index,
+                                                             .descriptorCount = 1,
+                                                             .descriptorType = kDescriptorTypes.at(slotOf(handle.type)),
+                                                             .pImageInfo = image_info,
+                                                             .pBufferInfo = buffer_info},
+                                      {});
+}
+
+void BindlessHeap::collectLocked() {
+  const auto graphics_completed = _device->GetTimeline(core::QueueType::Graphics).GetCompletedValue();
+  const auto compute_completed = _device->GetTimeline(core::QueueType::Compute).GetCompletedValue();
+  std::erase_if(_retired, [&](const Retired &retired) {
+    if (retired.graphics_value > graphics_completed || retired.compute_value > compute_completed) {
+      return false;
+    }
+    _slots.at(slotOf(retired.handle.type)).free.push_back(retired.handle.index);
+    return true;
+  });
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,138 @@
+#include "vulkan/buffer.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/memory_allocator.hpp"
+#include "vulkan/physical_device.hpp"
+#include "vulkan/utils.hpp"
+#include <cstring>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+auto toVkBufferUsage(core::BufferUsage usage) -> vk::BufferUsageFlags {
+  vk::BufferUsageFlags flags;
+  if (core::HasFlag(usage, core::BufferUsage::Vertex)) {
+    flags |= vk::BufferUsageFlagBits::eVertexBuffer;
+  }
+  if (core::HasFlag(usage, core::BufferUsage::Index)) {
+    flags |= vk::BufferUsageFlagBits::eIndexBuffer;
+  }
+  if (core::HasFlag(usage, core::BufferUsage::Uniform)) {
+    flags |= vk::BufferUsageFlagBits::eUniformBuffer;
+  }
+  if (core::HasFlag(usage, core::BufferUsage::Storage)) {
+    flags |= vk::BufferUsageFlagBits::eStorageBuffer;
+  }
+  if (core::HasFlag(usage, core::BufferUsage::Indirect)) {
+    flags |= vk::BufferUsageFlagBits::eIndirectBuffer;
+  }
+  if (core::HasFlag(usage, core::BufferUsage::TransferSrc)) {
+    flags |= vk::BufferUsageFlagBits::eTransferSrc;
+  }
+  if (core::HasFlag(usage, core::BufferUsage::TransferDst)) {
+    flags |= vk::BufferUsageFlagBits::eTransferDst;
+  }
+  return flags;
+}
+
+} // namespace
+
+auto VulkanBuffer::Initialize(const VulkanDevice &device, const core::BufferDesc &desc) -> bool {
+  _device = &device;
+  _desc = desc;
+  const auto vk_device = device.Get();
+
+  // Every buffer has an address, so shaders can read any of them through pointers
+  auto usage = toVkBufferUsage(desc.usage) | vk::BufferUsageFlagBits::eShaderDeviceAddress;
+  if (desc.memory_usage != core::MemoryUsage::Upload) {
+    // Destination of staged uploads or of GPU writes that get read back
+    usage |= vk::BufferUsageFlagBits::eTransferDst;
+  }
+
+  // Shared between the graphics, compute and transfer queues without ownership transfers
+  const auto queue_families = device.GetUniqueQueueFamilyIndices();
+  const bool concurrent = queue_families.size() > 1;
+  _buffer = VkCheckAndUnwrap(
+      vk_device.createBuffer(vk::BufferCreateInfo{
+          .size = desc.size,
+          .usage = usage,
+          .sharingMode = concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+          .queueFamilyIndexCount = concurrent ? VkToU32(queue_families.size()) : 0,
+          .pQueueFamilyIndices = concurrent ? queue_families.data() : nullptr}),
+      "Failed to create buffer.");
+
+  auto &allocator = device.GetAllocator();
+  switch (desc.memory_usage) {
+  case core::MemoryUsage::GpuOnly:
+    _allocation = allocator.AllocateForBuffer(
+        _buffer, AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eDeviceLocal});
+    break;
+  case core::MemoryUsage::Upload:
+    _allocation = allocator.AllocateForBuffer(
+        _buffer, AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eHostVisible,
+                                      .preferred_flags = vk::MemoryPropertyFlagBits::eHostCoherent});
+    break;
+  case core::MemoryUsage::Readback:
+    _allocation = allocator.AllocateForBuffer(
+        _buffer, AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eHostVisible,
+                                      .preferred_flags = vk::MemoryPropertyFlagBits::eHostCached |
+                                                         vk::MemoryPropertyFlagBits::eHostCoherent});
+    break;
+  case core::MemoryUsage::Dynamic: {
+    // Zero copy when device local memory is also host visible (resizable BAR or unified memory)
+    const auto zero_copy_flags = vk::MemoryPropertyFlagBits::eDeviceLocal | vk::MemoryPropertyFlagBits::eHostVisible;
+    const auto requirements = vk_device.getBufferMemoryRequirements(_buffer);
+    if (device.GetPhysicalDevice().FindMemoryType(requirements.memoryTypeBits, zero_copy_flags).has_value()) {
+      _allocation = allocator.AllocateForBuffer(
+          _buffer, AllocationCreateInfo{.required_flags = zero_copy_flags,
+                                        .preferred_flags = vk::MemoryPropertyFlagBits::eHostCoherent});
+    }
+    if (_allocation == nullptr) {
+      _allocation = allocator.AllocateForBuffer(
+          _buffer, AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eDeviceLocal});
+    }
+    break;
+  }
+  }
+
+  if (_allocation == nullptr) {
+    RENDY_LOG_ERROR("Failed to allocate memory for a {} byte buffer", desc.size);
+    vk_device.destroyBuffer(_buffer);
+    _device = nullptr;
+    return false;
+  }
+  _device_address = vk_device.getBufferAddress(vk::BufferDeviceAddressInfo{.buffer = _buffer});
+  return true;
+}
+
+void VulkanBuffer::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  _device->Get().destroyBuffer(_buffer);
+  _device->GetAllocator().Free(_allocation);
+  _allocation = nullptr;
+  _device_address = 0;
+  _device = nullptr;
+}
+
+auto VulkanBuffer::GetMappedData() const -> std::byte * {
+  return _allocation != nullptr ? static_cast<std::byte *>(_allocation->mapped) : nullptr;
+}
+
+void VulkanBuffer::Upload(std::span<const std::byte> data, uint64_t offset) {
+  if (offset + data.size() > _desc.size) {
+    RENDY_LOG_ERROR("Upload of {} bytes at offset {} overflows a {} byte buffer", data.size(), offset, _desc.size);
+    return;
+  }
+
+  if (auto *mapped = GetMappedData(); mapped != nullptr) {
+    std::memcpy(mapped + offset, data.data(), data.size());
+    _device->GetAllocator().Flush(*_allocation, offset, data.size());
+    return;
+  }
+  _device->GetUploadContext().Enqueue(_buffer, offset, data);
+}
+
+} // namespace rendy::graphics::vulkan
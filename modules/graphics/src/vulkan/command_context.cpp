@@ -0,0 +1,133 @@
+#include "vulkan/command_context.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+auto queueSlot(core::QueueType queue_type) -> size_t {
+  switch (queue_type) {
+  case core::QueueType::Compute:
+    return 1;
+  case core::QueueType::Transfer:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+auto levelSlot(vk::CommandBufferLevel level) -> size_t { return level == vk::CommandBufferLevel::ePrimary ? 0 : 1; }
+
+} // namespace
+
+auto CommandContext::Initialize(const VulkanDevice &device, CommandContextConfig config) -> bool {
+  if (config.frames_in_flight == 0 || config.max_threads == 0) {
+    RENDY_LOG_ERROR("Command context needs at least one frame in flight and one thread");
+    return false;
+  }
+  _device = &device;
+  _config = config;
+  _frame_slot = 0;
+  // Pools are created lazily by their owning thread, so the storage must never reallocate afterwards
+  _pools = std::vector<ThreadPool>(static_cast<size_t>(config.frames_in_flight) * config.max_threads * kQueueSlotCount);
+  RENDY_LOG_INFO("Created command context for {} frames and {} recording threads", config.frames_in_flight,
+                 config.max_threads);
+  return true;
+}
+
+void CommandContext::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  const auto vk_device = _device->Get();
+  for (auto &pool : _pools) {
+    if (pool.pool) {
+      // Destroying the pool frees all of its command buffers
+      vk_device.destroyCommandPool(pool.pool);
+    }
+  }
+  _pools.clear();
+  _device = nullptr;
+}
+
+void CommandContext::BeginFrame(uint64_t frame_index) {
+  _frame_slot = static_cast<uint32_t>(frame_index % _config.frames_in_flight);
+  const auto vk_device = _device->Get();
+  const auto first = static_cast<size_t>(_frame_slot) * _config.max_threads * kQueueSlotCount;
+  for (size_t i = first; i < first + (static_cast<size_t>(_config.max_threads) * kQueueSlotCount); ++i) {
+    auto &pool = _pools[i];
+    if (!pool.pool || (pool.used[0] == 0 && pool.used[1] == 0)) {
+      continue;
+    }
+    VkCheck(vk_device.resetCommandPool(pool.pool), "Failed to reset command pool.");
+    pool.used = {};
+  }
+}
+
+auto CommandContext::Allocate(uint32_t thread_index, core::QueueType queue_type, vk::CommandBufferLevel level)
+    -> VulkanCommandList & {
+  if (thread_index >= _config.max_threads) {
+    throw std::runtime_error("Command list requested for a thread index above the configured maximum.");
+  }
+  auto &pool = poolFor(_frame_slot, thread_index, queue_type);
+  const auto slot = levelSlot(level);
+  auto &lists = pool.lists.at(slot);
+  auto &used = pool.used.at(slot);
+
+  if (used == lists.size()) {
+    // Grow geometrically so long recordings don't allocate one command buffer at a time
+    const auto count = std::max<size_t>(lists.size(), 4);
+    const auto command_buffers = VkCheckAndUnwrap(
+        _device->Get().allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+            .commandPool = pool.pool, .level = level, .commandBufferCount = VkToU32(count)}),
+        "Failed to allocate command buffers.");
+    lists.reserve(lists.size() + count);
+    for (const auto command_buffer : command_buffers) {
+      lists.push_back(std::make_unique<VulkanCommandList>(command_buffer, queue_type, level));
+    }
+  }
+  return *lists[used++];
+}
+
+auto CommandContext::Submit(core::QueueType queue_type, std::span<const SubmitBatch> batches) const -> uint64_t {
+  std::vector<std::vector<vk::CommandBufferSubmitInfo>> command_buffer_infos(batches.size());
+  std::vector<vk::SubmitInfo2> submit_infos;
+  submit_infos.reserve(batches.size());
+
+  for (size_t i = 0; i < batches.size(); ++i) {
+    const auto &batch = batches[i];
+    auto &infos = command_buffer_infos[i];
+    infos.reserve(batch.command_lists.size());
+    for (const auto *command_list : batch.command_lists) {
+      infos.push_back(vk::CommandBufferSubmitInfo{.commandBuffer = command_list->Get()});
+    }
+    submit_infos.push_back(vk::SubmitInfo2{.waitSemaphoreInfoCount = VkToU32(batch.wait_semaphores.size()),
+                                           .pWaitSemaphoreInfos = batch.wait_semaphores.data(),
+                                           .commandBufferInfoCount = VkToU32(infos.size()),
+                                           .pCommandBufferInfos = infos.data(),
+                                           .signalSemaphoreInfoCount = VkToU32(batch.signal_semaphores.size()),
+                                           .pSignalSemaphoreInfos = batch.signal_semaphores.data()});
+  }
+
+  return _device->Submit(queue_type, submit_infos);
+}
+
+auto CommandContext::poolFor(uint32_t frame_slot, uint32_t thread_index, core::QueueType queue_type) -> ThreadPool & {
+  const auto thread_slot = (static_cast<size_t>(frame_slot) * _config.max_threads) + thread_index;
+  const auto index = (thread_slot * kQueueSlotCount) + queueSlot(queue_type);
+  auto &pool = _pools[index];
+  if (!pool.pool) {
+    pool.pool = VkCheckAndUnwrap(
+        _device->Get().createCommandPool(vk::CommandPoolCreateInfo{
+            .flags = vk::CommandPoolCreateFlagBits::eTransient,
+            .queueFamilyIndex = _device->GetQueueFamilyIndex(queue_type)}),
+        "Failed to create command pool.");
+  }
+  return pool;
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,112 @@
+#include "vulkan/command_list.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/pipeline.hpp"
+#include "vulkan/utils.hpp"
+#include <vector>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+auto toVkBuffer(const core::Buffer &buffer) -> vk::Buffer { return static_cast<const VulkanBuffer &>(buffer).Get(); }
+
+} // namespace
+
+VulkanCommandList::VulkanCommandList(vk::CommandBuffer command_buffer, core::QueueType queue_type,
+                                     vk::CommandBufferLevel level)
+    : _command_buffer(command_buffer), _queue_type(queue_type), _level(level) {}
+
+void VulkanCommandList::Begin() {
+  VkCheck(_command_buffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit}),
+          "Failed to begin command list.");
+}
+
+void VulkanCommandList::BeginSecondary(const RenderingInheritance &inheritance) {
+  const vk::CommandBufferInheritanceRenderingInfo rendering_info{
+      .colorAttachmentCount = VkToU32(inheritance.color_formats.size()),
+      .pColorAttachmentFormats = inheritance.color_formats.data(),
+      .depthAttachmentFormat = inheritance.depth_format,
+      .stencilAttachmentFormat = inheritance.stencil_format,
+      .rasterizationSamples = inheritance.samples};
+  const vk::CommandBufferInheritanceInfo inheritance_info{.pNext = &rendering_info};
+  VkCheck(_command_buffer.begin(vk::CommandBufferBeginInfo{
+              .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+                       vk::CommandBufferUsageFlagBits::eRenderPassContinue,
+              .pInheritanceInfo = &inheritance_info}),
+          "Failed to begin secondary command list.");
+}
+
+void VulkanCommandList::End() { VkCheck(_command_buffer.end(), "Failed to end command list."); }
+
+void VulkanCommandList::BindPipeline(const core::Pipeline &pipeline) {
+  const auto &vulkan_pipeline = static_cast<const VulkanPipeline &>(pipeline);
+  _command_buffer.bindPipeline(vulkan_pipeline.GetBindPoint(), vulkan_pipeline.Get());
+}
+
+void VulkanCommandList::BindVertexBuffer(uint32_t binding, const core::Buffer &buffer, uint64_t offset) {
+  _command_buffer.bindVertexBuffers(binding, toVkBuffer(buffer), offset);
+}
+
+void VulkanCommandList::BindIndexBuffer(const core::Buffer &buffer, uint64_t offset, bool use_32_bit_indices) {
+  _command_buffer.bindIndexBuffer(toVkBuffer(buffer), offset,
+                                  use_32_bit_indices ? vk::IndexType::eUint32 : vk::IndexType::eUint16);
+}
+
+void VulkanCommandList::Draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex,
+                             uint32_t first_instance) {
+  _command_buffer.draw(vertex_count, instance_count, first_vertex, first_instance);
+}
+
+void VulkanCommandList::DrawIndexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index,
+                                    int32_t vertex_offset, uint32_t first_instance) {
+  _command_buffer.drawIndexed(index_count, instance_count, first_index, vertex_offset, first_instance);
+}
+
+void VulkanCommandList::DrawIndirect(const core::Buffer &buffer, uint64_t offset, uint32_t draw_count,
+                                     uint32_t stride) {
+  _command_buffer.drawIndirect(toVkBuffer(buffer), offset, draw_count, stride);
+}
+
+void VulkanCommandList::DrawIndexedIndirect(const core::Buffer &buffer, uint64_t offset, uint32_t draw_count,
+                                            uint32_t stride) {
+  _command_buffer.drawIndexedIndirect(toVkBuffer(buffer), offset, draw_count, stride);
+}
+
+void VulkanCommandList::DrawIndexedIndirectCount(const core::Buffer &buffer, uint64_t offset,
+                                                 const core::Buffer &count_buffer, uint64_t count_offset,
+                                                 uint32_t max_draw_count, uint32_t stride) {
+  _command_buffer.drawIndexedIndirectCount(toVkBuffer(buffer), offset, toVkBuffer(count_buffer), count_offset,
+                                           max_draw_count, stride);
+}
+
+void VulkanCommandList::DrawMeshTasks(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z) {
+  _command_buffer.drawMeshTasksEXT(group_count_x, group_count_y, group_count_z);
+}
+
+void VulkanCommandList::Dispatch(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z) {
+  _command_buffer.dispatch(group_count_x, group_count_y, group_count_z);
+}
+
+void VulkanCommandList::CopyBuffer(const core::Buffer &src, uint64_t src_offset, const core::Buffer &dst,
+                                   uint64_t dst_offset, uint64_t size) {
+  const vk::BufferCopy region{.srcOffset = src_offset, .dstOffset = dst_offset, .size = size};
+  _command_buffer.copyBuffer(toVkBuffer(src), toVkBuffer(dst), region);
+}
+
+void VulkanCommandList::GlobalBarrier(vk::PipelineStageFlags2 src_stages, vk::AccessFlags2 src_access,
+                                      vk::PipelineStageFlags2 dst_stages, vk::AccessFlags2 dst_access) {
+  const vk::MemoryBarrier2 barrier{
+      .srcStageMask = src_stages, .srcAccessMask = src_access, .dstStageMask = dst_stages, .dstAccessMask = dst_access};
+  _command_buffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = 1, .pMemoryBarriers = &barrier});
+}
+
+void VulkanCommandList::ExecuteSecondaries(std::span<VulkanCommandList *const> secondaries) {
+  std::vector<vk::CommandBuffer> command_buffers;
+  command_buffers.reserve(secondaries.size());
+  for (const auto *secondary : secondaries) {
+    command_buffers.push_back(secondary->Get());
+  }
+  _command_buffer.executeCommands(command_buffers);
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,202 @@
+#include "vulkan/compute_kernel.hpp"
+#include "common/log.hpp"
+#include "vulkan/bindless_heap.hpp"
+#include "vulkan/buffer.hpp"
+#include "vulkan/command_list.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/shader_library.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <utility>
+
+namespace rendy::graphics::vulkan {
+
+auto ComputeKernel::Initialize(const VulkanDevice &device, PipelineCompiler &compiler,
+                               std::shared_ptr<const Shader> shader, std::string_view entry_point,
+                               std::span<const SpecializationConstant> specialization,
+                               const BindlessHeap *bindless_heap) -> bool {
+  _device = &device;
+  _compiler = &compiler;
+  _bindless_heap = bindless_heap;
+  _shader = std::move(shader);
+  _entry_point = entry_point;
+  _specialization.assign(specialization.begin(), specialization.end());
+  if (!build()) {
+    _device = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void ComputeKernel::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  // The layout must outlive a compilation that is still running
+  static_cast<void>(_pipeline.Wait());
+  destroyLayouts();
+  _pipeline = {};
+  _shader.reset();
+  _device = nullptr;
+}
+
+auto ComputeKernel::Refresh() -> bool {
+  if (_device == nullptr || _shader->GetVersion() == _shader_version) {
+    return true;
+  }
+  static_cast<void>(_pipeline.Wait());
+  const auto previous_layout = _layout;
+  const auto previous_set_layout = _set_layout;
+  const auto previous = std::exchange(_pipeline, {});
+  if (!build()) {
+    _layout = previous_layout;
+    _set_layout = previous_set_layout;
+    _pipeline = previous;
+    // Don't retry every frame, the next reload bumps the version again
+    _shader_version = _shader->GetVersion();
+    return false;
+  }
+  // Command buffers that are pending execution don't need the layouts anymore, only recording does
+  _device->Get().destroyPipelineLayout(previous_layout);
+  _device->Get().destroyDescriptorSetLayout(previous_set_layout);
+  return true;
+}
+
+auto ComputeKernel::GetWorkgroupSize() const -> std::array<uint32_t, 3> {
+  auto size = _reflected.local_size;
+  for (size_t axis = 0; axis < size.size(); ++axis) {
+    const auto spec_id = _reflected.local_size_spec_ids.at(axis);
+    if (!spec_id) {
+      continue;
+    }
+    if (const auto it = std::ranges::find(_specialization, *spec_id, &SpecializationConstant::id);
+        it != _specialization.end()) {
+      size.at(axis) = it->value;
+    }
+  }
+  return size;
+}
+
+auto ComputeKernel::GetGroupCount(uint32_t invocations) const -> uint32_t {
+  const auto group_size = std::max(GetWorkgroupSize()[0], 1U);
+  return (invocations + group_size - 1) / group_size;
+}
+
+auto ComputeKernel::Record(VulkanCommandList &command_list, std::span<const ComputeBufferBinding> buffers,
+                           std::span<const std::byte> push_constants, uint32_t group_count_x, uint32_t group_count_y,
+                           uint32_t group_count_z) const -> bool {
+  const auto *pipeline = _pipeline.TryGet();
+  if (pipeline == nullptr) {
+    return false;
+  }
+  if (push_constants.size() > _push_constant_size) {
+    RENDY_LOG_ERROR("Kernel {} takes {} bytes of push constants, got {}", _entry_point, _push_constant_size,
+                    push_constants.size());
+    return false;
+  }
+
+  std::vector<vk::DescriptorBufferInfo> buffer_infos;
+  std::vector<vk::WriteDescriptorSet> writes;
+  buffer_infos.reserve(buffers.size());
+  writes.reserve(buffers.size());
+  for (const auto &binding : buffers) {
+    const auto it = std::ranges::find(_bindings, binding.binding, &ReflectedBinding::binding);
+    if (it == _bindings.end() || binding.buffer == nullptr) {
+      RENDY_LOG_ERROR("Kernel {} has no buffer binding {}", _entry_point, binding.binding);
+      return false;
+    }
+    buffer_infos.push_back(vk::DescriptorBufferInfo{.buffer = static_cast<const VulkanBuffer *>(binding.buffer)->Get(),
+                                                    .offset = binding.offset,
+                                                    .range = binding.range});
+    writes.push_back(vk::WriteDescriptorSet{.dstBinding = binding.binding,
+                                            .descriptorCount = 1,
+                                            .descriptorType = it->type,
+                                            .pBufferInfo = &buffer_infos.back()});
+  }
+
+  const auto command_buffer = command_list.Get();
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->Get());
+  if (!writes.empty()) {
+    command_buffer.pushDescriptorSetKHR(vk::PipelineBindPoint::eCompute, pipeline->GetLayout(), 0, writes);
+  }
+  if (_bindless_heap != nullptr) {
+    _bindless_heap->Bind(command_list, vk::PipelineBindPoint::eCompute, pipeline->GetLayout());
+  }
+  if (!push_constants.empty()) {
+    command_buffer.pushConstants(pipeline->GetLayout(), vk::ShaderStageFlagBits::eCompute, 0,
+                                 VkToU32(push_constants.size()), push_constants.data());
+  }
+  command_buffer.dispatch(group_count_x, group_count_y, group_count_z);
+  return true;
+}
+
+auto ComputeKernel::build() -> bool {
+  const auto &reflection = _shader->GetReflection();
+  const auto *entry_point = reflection.FindEntryPoint(_entry_point);
+  if (entry_point == nullptr || entry_point->stage != vk::ShaderStageFlagBits::eCompute) {
+    RENDY_LOG_ERROR("Shader {} has no compute entry point {}", _shader->GetName(), _entry_point);
+    return false;
+  }
+  for (const auto &binding : reflection.bindings) {
+    const bool in_heap = _bindless_heap != nullptr && binding.set == BindlessHeap::kSetIndex &&
+                         _bindless_heap->Matches(binding.binding, binding.type);
+    if (binding.set != 0 && !in_heap) {
+      RENDY_LOG_ERROR("Compute kernel {} binds {} at set {}, binding {}, which is neither pushed nor bindless",
+                      _entry_point, binding.name, binding.set, binding.binding);
+      return false;
+    }
+  }
+  auto set_bindings = reflection.GetSetLayoutBindings(0);
+  const auto max_push_descriptors = _device->GetPhysicalDevice().GetPushDescriptorProperties().maxPushDescriptors;
+  if (set_bindings.size() > max_push_descriptors) {
+    RENDY_LOG_ERROR("Compute kernel {} pushes {} bindings, the device supports at most {}", _entry_point,
+                    set_bindings.size(), max_push_descriptors);
+    return false;
+  }
+
+  const auto vk_device = _device->Get();
+  for (auto &binding : set_bindings) {
+    binding.stageFlags = vk::ShaderStageFlagBits::eCompute;
+  }
+  _set_layout = VkCheckAndUnwrap(vk_device.createDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo{
+                                     .flags = vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR,
+                                     .bindingCount = VkToU32(set_bindings.size()),
+                                     .pBindings = set_bindings.data()}),
+                                 "Failed to create compute descriptor set layout.");
+
+  static_assert(BindlessHeap::kSetIndex == 1, "The heap follows the push descriptor set");
+  const std::array set_layouts{
+      _set_layout, _bindless_heap != nullptr ? _bindless_heap->GetSetLayout() : vk::DescriptorSetLayout{}};
+  const vk::PushConstantRange push_constant_range{
+      .stageFlags = vk::ShaderStageFlagBits::eCompute, .offset = 0, .size = reflection.push_constant_size};
+  _layout = VkCheckAndUnwrap(
+      vk_device.createPipelineLayout(
+          vk::PipelineLayoutCreateInfo{.setLayoutCount = _bindless_heap != nullptr ? 2U : 1U,
+                                       .pSetLayouts = set_layouts.data(),
+                                       .pushConstantRangeCount = reflection.push_constant_size != 0 ? 1U : 0U,
+                                       .pPushConstantRanges = &push_constant_range}),
+      "Failed to create compute pipeline layout.");
+
+  auto stage = _shader->GetStage(_entry_point);
+  stage->specialization = _specialization;
+  _pipeline = _compiler->Request(ComputePipelineDesc{.shader = std::move(*stage), .layout = _layout});
+  _reflected = *entry_point;
+  _bindings.clear();
+  std::ranges::copy_if(reflection.bindings, std::back_inserter(_bindings),
+                       [](const auto &binding) { return binding.set == 0; });
+  _push_constant_size = reflection.push_constant_size;
+  _shader_version = _shader->GetVersion();
+  return true;
+}
+
+void ComputeKernel::destroyLayouts() {
+  const auto vk_device = _device->Get();
+  vk_device.destroyPipelineLayout(_layout);
+  vk_device.destroyDescriptorSetLayout(_set_layout);
+  _layout = nullptr;
+  _set_layout = nullptr;
+}
+
+} // namespace rendy::graphics::vulkan
@@ -1,87 +1,330 @@
 #include "vulkan/device.hpp"
+#include "common/log.hpp"
 #include "vulkan/physical_device.hpp"
 #include "vulkan/utils.hpp"
-#include <spdlog/spdlog.h>
 #include <utility>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_structs.hpp>
 
 namespace rendy::graphics::vulkan {
 
-VulkanDevice::VulkanDevice(std::shared_ptr<PhysicalDevice> physical_device)
-    : _physical_device(std::move(physical_device)) {}
+namespace {
+
+// Share of a heap assumed to be available without VK_EXT_memory_budget, leaving room for other processes
+constexpr vk::DeviceSize kFallbackBudgetNumerator = 4;
+constexpr vk::DeviceSize kFallbackBudgetDenominator = 5;
+
+auto queueKey(const QueueLocation &location) -> uint64_t {
+  return (static_cast<uint64_t>(location.family_index) << 32U) | location.queue_index;
+}
+
+} // namespace
+
+VulkanDevice::VulkanDevice(std::shared_ptr<PhysicalDevice> physical_device, QueueConfig queue_config)
+    : _physical_device(std::move(physical_device)), _queue_config(queue_config) {}
 
 auto VulkanDevice::GetGraphicsAPI() -> core::GraphicsAPI { return core::GraphicsAPI::Vulkan; }
 
 auto VulkanDevice::Initialize() -> bool {
-  // TODO:
-  // Add complex queue logic
-  //
-  // const auto &indices = _physical_device->GetQueueFamilyIndices();
-  // const auto &queue_props = _physical_device->Get().getQueueFamilyProperties();
-  //
-  // _queue_registry.RegisterFamily(indices.graphics_family, core::QueueType::Graphics | core::QueueType::Transfer, 1);
-  //
-  // if (indices.compute_family.has_value()) {
-  //   _queue_registry.RegisterFamily(indices.compute_family.value(), core::QueueType::Compute, 1);
-  //   _device_capabilities.compute_support = true;
-  // } else {
-  //   _device_capabilities.compute_support = false;
-  // }
-  //
-  // if (indices.transfer_family.has_value()) {
-  //   _queue_registry.RegisterFamily(indices.transfer_family.value(), core::QueueType::Transfer, 1);
-  // }
+  // Command recording relies on vkQueueSubmit2 and dynamic rendering from the 1.3 core
+  const auto api_version = _physical_device->GetProperties().apiVersion;
+  if (api_version < vk::ApiVersion13) {
+    RENDY_LOG_ERROR("Device supports Vulkan {}.{}, but 1.3 is required", vk::apiVersionMajor(api_version),
+                    vk::apiVersionMinor(api_version));
+    return false;
+  }
 
-  // Create device with consolidated queue create infos
-  // auto queue_create_infos = _queue_registry.GetQueueCreateInfos();
-  // for (const auto &info : queue_create_infos) {
-  //   spdlog::info("Count: {} - Index: {}", info.queueCount, info.queueFamilyIndex);
-  // }
+  const auto &indices = _physical_device->GetQueueFamilyIndices();
+  const auto &queue_props = _physical_device->GetQueueFamilyProperties();
+
+  const auto register_family = [&](uint32_t family_index) {
+    const auto flags = queue_props.at(family_index).queueFlags;
+    auto types = core::QueueType::Transfer; // Graphics and compute families implicitly support transfer
+    if (flags & vk::QueueFlagBits::eGraphics) {
+      types = types | core::QueueType::Graphics;
+    }
+    if (flags & vk::QueueFlagBits::eCompute) {
+      types = types | core::QueueType::Compute;
+    }
+    _queue_registry.RegisterFamily(family_index, types, queue_props.at(family_index).queueCount);
+  };
 
-  const std::vector<const char *> required_extensions{
+  register_family(indices.graphics_family);
+  const auto graphics = _queue_registry.AssignQueue(core::QueueType::Graphics, indices.graphics_family,
+                                                    _queue_config.graphics_priority);
+
+  if (indices.compute_family.has_value()) {
+    register_family(indices.compute_family.value());
+    const auto compute = _queue_registry.AssignQueue(core::QueueType::Compute, indices.compute_family.value(),
+                                                     _queue_config.compute_priority);
+    _device_capabilities.compute_support = true;
+    _device_capabilities.async_compute_support = compute != graphics;
+  } else {
+    _device_capabilities.compute_support = false;
+  }
+
+  if (indices.transfer_family.has_value()) {
+    register_family(indices.transfer_family.value());
+    const auto transfer = _queue_registry.AssignQueue(core::QueueType::Transfer, indices.transfer_family.value(),
+                                                      _queue_config.transfer_priority);
+    _device_capabilities.dedicated_transfer_support = transfer.family_index != graphics.family_index;
+  } else {
+    _queue_registry.AssignQueue(core::QueueType::Transfer, indices.graphics_family, _queue_config.transfer_priority);
+  }
+
+  // Everything the renderer can't run without: vkQueueSubmit2, dynamic rendering, push descriptors, timeline
+  // semaphores for queue synchronization, host query reset for the GPU profiler and buffer device addresses for
+  // shaders that read through pointers. Vulkan 1.3 guarantees all of the features.
+  using Vulkan12 = vk::PhysicalDeviceVulkan12Features;
+  const auto &physical_device = *_physical_device;
+  _features.Initialize(physical_device);
 #ifdef __APPLE__
-      "VK_KHR_portability_subset",
+  _features.RequireExtension("VK_KHR_portability_subset");
 #endif
-      vk::KHRDynamicRenderingExtensionName, vk::KHRPushDescriptorExtensionName};
+  _features.Require<vk::PhysicalDeviceVulkan13Features>(
+      "synchronization2 and dynamic rendering",
+      {&vk::PhysicalDeviceVulkan13Features::synchronization2, &vk::PhysicalDeviceVulkan13Features::dynamicRendering});
+  _features.Require<Vulkan12>("timeline semaphores and host query reset",
+                              {&Vulkan12::timelineSemaphore, &Vulkan12::hostQueryReset});
+  _features.Require<Vulkan12>("buffer device address", {&Vulkan12::bufferDeviceAddress});
+  _features.RequireExtension(vk::KHRPushDescriptorExtensionName);
+
+  // Swapchains are only needed when the device was picked for a surface
+  _device_capabilities.present_support = indices.present_family.has_value();
+  if (_device_capabilities.present_support) {
+    _features.RequireExtension(vk::KHRSwapchainExtensionName);
+    // Present fences let resized swapchains be retired without idling the device; the instance side lives in
+    // VK_EXT_surface_maintenance1
+    if (physical_device.IsInstanceExtensionEnabled(vk::EXTSurfaceMaintenance1ExtensionName)) {
+      _device_capabilities.swapchain_maintenance1_support =
+          _features.Request<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>(
+              "swapchain maintenance", {&vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT::swapchainMaintenance1});
+    }
+    if (_features.IsSupported<vk::PhysicalDevicePresentIdFeaturesKHR>(
+            {&vk::PhysicalDevicePresentIdFeaturesKHR::presentId})) {
+      _device_capabilities.present_wait_support =
+          _features.Request<vk::PhysicalDevicePresentWaitFeaturesKHR>(
+              "present wait", {&vk::PhysicalDevicePresentWaitFeaturesKHR::presentWait}) &&
+          _features.Request<vk::PhysicalDevicePresentIdFeaturesKHR>(
+              "present id", {&vk::PhysicalDevicePresentIdFeaturesKHR::presentId});
+    }
+  }
 
-  float queue_priority = 1.0F;
-  const auto queue_create_infos =
-      vk::DeviceQueueCreateInfo{.queueFamilyIndex = 0, .queueCount = 1, .pQueuePriorities = &queue_priority};
-  const vk::DeviceCreateInfo device_create_info{.queueCreateInfoCount = 1,
-                                                .pQueueCreateInfos = &queue_create_infos,
-                                                .enabledExtensionCount =
-                                                    static_cast<uint32_t>(required_extensions.size()),
-                                                .ppEnabledExtensionNames = required_extensions.data()};
+  // Optional fast paths; subsystems pick their code path from the capabilities
+
+  // Texture streaming sizes its budget from the driver's view of memory pressure when available
+  _device_capabilities.memory_budget_support = _features.RequestExtension(vk::EXTMemoryBudgetExtensionName);
+  _device_capabilities.pipeline_statistics_support = _features.Request<vk::PhysicalDeviceFeatures>(
+      "pipeline statistics", {&vk::PhysicalDeviceFeatures::pipelineStatisticsQuery});
+  _device_capabilities.sampler_anisotropy_support = _features.Request<vk::PhysicalDeviceFeatures>(
+      "anisotropic filtering", {&vk::PhysicalDeviceFeatures::samplerAnisotropy});
+  _device_capabilities.multi_draw_indirect_support = _features.Request<vk::PhysicalDeviceFeatures>(
+      "multi draw indirect", {&vk::PhysicalDeviceFeatures::multiDrawIndirect});
+  // GPU culling compacts its draws and lets the GPU read how many survived
+  _device_capabilities.draw_indirect_count_support =
+      _features.Request<Vulkan12>("draw indirect count", {&Vulkan12::drawIndirectCount});
+  // The bindless heap needs non-uniform indexing into partially bound arrays that are updated while in use
+  _device_capabilities.bindless_support = _features.Request<Vulkan12>(
+      "bindless descriptors",
+      {&Vulkan12::descriptorIndexing, &Vulkan12::runtimeDescriptorArray, &Vulkan12::descriptorBindingPartiallyBound,
+       &Vulkan12::descriptorBindingUpdateUnusedWhilePending, &Vulkan12::descriptorBindingSampledImageUpdateAfterBind,
+       &Vulkan12::descriptorBindingStorageImageUpdateAfterBind,
+       &Vulkan12::descriptorBindingStorageBufferUpdateAfterBind, &Vulkan12::shaderSampledImageArrayNonUniformIndexing,
+       &Vulkan12::shaderStorageBufferArrayNonUniformIndexing, &Vulkan12::shaderStorageImageArrayNonUniformIndexing});
+  // Meshlet rendering culls and expands clusters in task and mesh shaders when the device has them
+  _device_capabilities.mesh_shader_support = _features.Request<vk::PhysicalDeviceMeshShaderFeaturesEXT>(
+      "mesh shaders",
+      {&vk::PhysicalDeviceMeshShaderFeaturesEXT::taskShader, &vk::PhysicalDeviceMeshShaderFeaturesEXT::meshShader});
+
+  if (const auto missing = _features.GetMissing(); !missing.empty()) {
+    for (const auto feature : missing) {
+      RENDY_LOG_ERROR("Device lacks required {}", feature);
+    }
+    return false;
+  }
+
+  // Create device with consolidated queue create infos
+  const auto queue_create_infos = _queue_registry.GetQueueCreateInfos();
+  const auto &extensions = _features.GetExtensions();
+  const vk::DeviceCreateInfo device_create_info{.pNext = &_features.GetCreateChain(),
+                                                .queueCreateInfoCount = VkToU32(queue_create_infos.size()),
+                                                .pQueueCreateInfos = queue_create_infos.data(),
+                                                .enabledExtensionCount = VkToU32(extensions.size()),
+                                                .ppEnabledExtensionNames = extensions.data()};
 
   _device = VkCheckAndUnwrap(_physical_device->Get().createDevice(device_create_info), "Failed to create device.");
+  VULKAN_HPP_DEFAULT_DISPATCHER.init(_device);
+  _allocator =
+      std::make_unique<MemoryAllocator>(_device, *_physical_device, MemoryAllocatorConfig{.device_address = true});
 
   // Retrieve queue handles and populate map
-  //
-  // TODO: These are all wrong
-  _queues[core::QueueType::Graphics] = _device.getQueue(0, 0);
-  // _queues[core::QueueType::Graphics] = _device.getQueue(_queue_registry.GetFamilyFor(core::QueueType::Graphics), 0);
-  // // Transfer queue: use dedicated if available, otherwise use graphics queue
-  // auto transfer_family = _queue_registry.GetFamilyFor(core::QueueType::Transfer);
-  // _queues[core::QueueType::Transfer] = _device.getQueue(transfer_family, 0);
-  // // Compute queue: only if available
-  // if (_device_capabilities.compute_support) {
-  //   _queues[core::QueueType::Compute] = _device.getQueue(_queue_registry.GetFamilyFor(core::QueueType::Compute), 0);
-  // }
+  for (const auto type : {core::QueueType::Graphics, core::QueueType::Compute, core::QueueType::Transfer}) {
+    if (const auto location = _queue_registry.GetLocation(type); location.has_value()) {
+      _queues[type] = _device.getQueue(location->family_index, location->queue_index);
+      _queue_mutexes.try_emplace(queueKey(location.value()));
+      if (auto [it, inserted] = _queue_timelines.try_emplace(queueKey(location.value())); inserted) {
+        if (!it->second.Initialize(_device)) {
+          return false;
+        }
+      }
+    }
+  }
+
+  _upload_context = std::make_unique<UploadContext>();
+  if (!_upload_context->Initialize(*this)) {
+    return false;
+  }
 
+  RENDY_LOG_INFO("Async compute: {}, dedicated transfer: {}", _device_capabilities.async_compute_support,
+                 _device_capabilities.dedicated_transfer_support);
+  _features.LogReport();
   return true;
 }
 
+auto VulkanDevice::GetMemoryBudget() const -> std::vector<MemoryHeapBudget> {
+  const auto &memory_properties = _physical_device->GetMemoryProperties();
+  std::vector<MemoryHeapBudget> heaps(memory_properties.memoryHeapCount);
+  if (_device_capabilities.memory_budget_support) {
+    const auto properties =
+        _physical_device->Get()
+            .getMemoryProperties2<vk::PhysicalDeviceMemoryProperties2, vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    const auto &budget = properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    for (uint32_t i = 0; i < heaps.size(); ++i) {
+      heaps[i].budget = budget.heapBudget.at(i);
+      heaps[i].usage = budget.heapUsage.at(i);
+    }
+  } else {
+    const auto statistics = _allocator->GetStatistics();
+    for (uint32_t type = 0; type < memory_properties.memoryTypeCount; ++type) {
+      heaps.at(memory_properties.memoryTypes.at(type).heapIndex).usage +=
+          statistics.memory_types.at(type).bytes_reserved;
+    }
+    for (uint32_t i = 0; i < heaps.size(); ++i) {
+      heaps[i].budget =
+          memory_properties.memoryHeaps.at(i).size * kFallbackBudgetNumerator / kFallbackBudgetDenominator;
+    }
+  }
+  for (uint32_t i = 0; i < heaps.size(); ++i) {
+    const auto &heap = memory_properties.memoryHeaps.at(i);
+    heaps[i].device_local = static_cast<bool>(heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+  }
+  return heaps;
+}
+
 auto VulkanDevice::GetQueue(core::QueueType type) const -> vk::Queue {
   auto it = _queues.find(type);
   if (it != _queues.end()) {
     return it->second;
   }
 
-  spdlog::error("Requested queue type not available");
+  RENDY_LOG_ERROR("Requested queue type not available");
   return _queues.at(core::QueueType::Graphics); // Fallback to graphics
 }
 
-void VulkanDevice::Cleanup() { _device.destroy(); }
+auto VulkanDevice::GetPhysicalDevice() const -> const PhysicalDevice & { return *_physical_device; }
+
+auto VulkanDevice::GetQueueFamilyIndex(core::QueueType type) const -> uint32_t {
+  if (const auto location = _queue_registry.GetLocation(type); location.has_value()) {
+    return location->family_index;
+  }
+  return _queue_registry.GetLocation(core::QueueType::Graphics)->family_index;
+}
+
+auto VulkanDevice::GetAsyncComputeQueueType() const -> core::QueueType {
+  return _device_capabilities.async_compute_support ? core::QueueType::Compute : core::QueueType::Graphics;
+}
+
+auto VulkanDevice::GetUniqueQueueFamilyIndices() const -> std::vector<uint32_t> {
+  std::vector<uint32_t> family_indices;
+  for (const auto &[family_index, info] : _queue_registry.GetAllFamilies()) {
+    if (!info.priorities.empty()) {
+      family_indices.push_back(family_index);
+    }
+  }
+  return family_indices;
+}
+
+void VulkanDevice::ImmediateSubmit(core::QueueType type, const std::function<void(vk::CommandBuffer)> &record) const {
+  const auto command_pool = VkCheckAndUnwrap(
+      _device.createCommandPool(vk::CommandPoolCreateInfo{.flags = vk::CommandPoolCreateFlagBits::eTransient,
+                                                          .queueFamilyIndex = GetQueueFamilyIndex(type)}),
+      "Failed to create immediate command pool.");
+  const auto command_buffers = VkCheckAndUnwrap(
+      _device.allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+          .commandPool = command_pool, .level = vk::CommandBufferLevel::ePrimary, .commandBufferCount = 1}),
+      "Failed to allocate immediate command buffer.");
+  const auto command_buffer = command_buffers.front();
+
+  VkCheck(command_buffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit}),
+          "Failed to begin immediate command buffer.");
+  record(command_buffer);
+  VkCheck(command_buffer.end(), "Failed to end immediate command buffer.");
+
+  const vk::CommandBufferSubmitInfo command_buffer_info{.commandBuffer = command_buffer};
+  const vk::SubmitInfo2 submit_info{.commandBufferInfoCount = 1, .pCommandBufferInfos = &command_buffer_info};
+  const auto value = Submit(type, std::span(&submit_info, 1));
+  GetTimeline(type).Wait(value);
+
+  _device.destroyCommandPool(command_pool);
+}
+
+auto VulkanDevice::GetTimeline(core::QueueType type) const -> TimelineSemaphore & {
+  auto location = _queue_registry.GetLocation(type);
+  if (!location.has_value()) {
+    location = _queue_registry.GetLocation(core::QueueType::Graphics);
+  }
+  return _queue_timelines.at(queueKey(location.value()));
+}
+
+auto VulkanDevice::Submit(core::QueueType type, std::span<const vk::SubmitInfo2> submits) const -> uint64_t {
+  auto &timeline = GetTimeline(type);
+  std::vector<vk::SubmitInfo2> infos(submits.begin(), submits.end());
+  if (infos.empty()) {
+    infos.emplace_back();
+  }
+
+  // The timeline signal is appended to the signals the last batch already has
+  auto &last = infos.back();
+  std::vector<vk::SemaphoreSubmitInfo> signals(last.pSignalSemaphoreInfos,
+                                               last.pSignalSemaphoreInfos + last.signalSemaphoreInfoCount);
+  signals.push_back(vk::SemaphoreSubmitInfo{.semaphore = timeline.Get(),
+                                            .stageMask = vk::PipelineStageFlagBits2::eAllCommands});
+  last.signalSemaphoreInfoCount = VkToU32(signals.size());
+  last.pSignalSemaphoreInfos = signals.data();
+
+  const auto queue_lock = LockQueue(type);
+  const auto value = timeline.Reserve();
+  signals.back().value = value;
+  VkCheck(GetQueue(type).submit2(infos), "Failed to submit to queue.");
+  return value;
+}
+
+void VulkanDevice::WaitIdle() const {
+  for (const auto &[key, timeline] : _queue_timelines) {
+    timeline.Wait(timeline.GetLastReserved());
+  }
+}
+
+auto VulkanDevice::LockQueue(core::QueueType type) const -> std::unique_lock<std::mutex> {
+  auto location = _queue_registry.GetLocation(type);
+  if (!location.has_value()) {
+    location = _queue_registry.GetLocation(core::QueueType::Graphics);
+  }
+  return std::unique_lock(_queue_mutexes.at(queueKey(location.value())));
+}
+
+void VulkanDevice::Cleanup() {
+  WaitIdle();
+  if (_upload_context) {
+    _upload_context->Destroy();
+    _upload_context.reset();
+  }
+  for (auto &[key, timeline] : _queue_timelines) {
+    timeline.Destroy();
+  }
+  _queue_timelines.clear();
+  _allocator.reset();
+  _device.destroy();
+}
 
 } // namespace rendy::graphics::vulkan
@@ -0,0 +1,108 @@
+#include "vulkan/device_features.hpp"
+#include "common/log.hpp"
+#include "vulkan/physical_device.hpp"
+#include <algorithm>
+#include <string>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+template <typename T> void setLinked(DeviceFeatureChain &chain, bool linked) {
+  if (linked && !chain.isLinked<T>()) {
+    chain.relink<T>();
+  } else if (!linked && chain.isLinked<T>()) {
+    chain.unlink<T>();
+  }
+}
+
+// Chaining the struct of an extension that isn't there is invalid, both for queries and for device creation
+void linkExtensionStructs(DeviceFeatureChain &chain, const auto &has_extension) {
+  setLinked<vk::PhysicalDeviceMeshShaderFeaturesEXT>(
+      chain, has_extension(kFeatureExtension<vk::PhysicalDeviceMeshShaderFeaturesEXT>));
+  setLinked<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>(
+      chain, has_extension(kFeatureExtension<vk::PhysicalDeviceSwapchainMaintenance1FeaturesEXT>));
+  setLinked<vk::PhysicalDevicePresentIdFeaturesKHR>(
+      chain, has_extension(kFeatureExtension<vk::PhysicalDevicePresentIdFeaturesKHR>));
+  setLinked<vk::PhysicalDevicePresentWaitFeaturesKHR>(
+      chain, has_extension(kFeatureExtension<vk::PhysicalDevicePresentWaitFeaturesKHR>));
+}
+
+} // namespace
+
+void DeviceFeatures::Initialize(const PhysicalDevice &physical_device) {
+  _physical_device = &physical_device;
+  _supported = {};
+  _enabled = {};
+  _extensions.clear();
+  _report.clear();
+
+  linkExtensionStructs(_supported, [this](const char *name) { return isExtensionSupported(name); });
+  physical_device.Get().getFeatures2(&_supported.get<vk::PhysicalDeviceFeatures2>());
+}
+
+auto DeviceFeatures::RequestExtension(const char *name) -> bool {
+  if (!negotiate(name, false, isExtensionSupported(name))) {
+    return false;
+  }
+  enableExtension(name);
+  return true;
+}
+
+void DeviceFeatures::RequireExtension(const char *name) {
+  if (negotiate(name, true, isExtensionSupported(name))) {
+    enableExtension(name);
+  }
+}
+
+auto DeviceFeatures::IsExtensionEnabled(std::string_view name) const -> bool {
+  return std::ranges::any_of(_extensions, [name](const char *extension) { return name == extension; });
+}
+
+auto DeviceFeatures::GetMissing() const -> std::vector<std::string_view> {
+  std::vector<std::string_view> missing;
+  for (const auto &entry : _report) {
+    if (entry.required && !entry.enabled) {
+      missing.emplace_back(entry.name);
+    }
+  }
+  return missing;
+}
+
+void DeviceFeatures::LogReport() const {
+  std::string enabled;
+  std::string unsupported;
+  for (const auto &entry : _report) {
+    if (entry.required) {
+      continue;
+    }
+    auto &list = entry.enabled ? enabled : unsupported;
+    list += list.empty() ? entry.name : ", " + entry.name;
+  }
+  RENDY_LOG_INFO("Enabled optional device features: {}", enabled.empty() ? "none" : enabled);
+  if (!unsupported.empty()) {
+    RENDY_LOG_INFO("Unsupported optional device features: {}", unsupported);
+  }
+}
+
+auto DeviceFeatures::GetCreateChain() -> const vk::PhysicalDeviceFeatures2 & {
+  linkExtensionStructs(_enabled, [this](const char *name) { return IsExtensionEnabled(name); });
+  return _enabled.get<vk::PhysicalDeviceFeatures2>();
+}
+
+auto DeviceFeatures::isExtensionSupported(const char *name) const -> bool {
+  return _physical_device->IsExtensionSupported(name);
+}
+
+void DeviceFeatures::enableExtension(const char *name) {
+  if (!IsExtensionEnabled(name)) {
+    _extensions.push_back(name);
+  }
+}
+
+auto DeviceFeatures::negotiate(std::string_view name, bool required, bool supported) -> bool {
+  _report.push_back(DeviceFeatureReport{.name = std::string(name), .required = required, .enabled = supported});
+  return supported;
+}
+
+} // namespace rendy::graphics::vulkan
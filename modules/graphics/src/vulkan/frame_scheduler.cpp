@@ -0,0 +1,117 @@
+#include "vulkan/frame_scheduler.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace rendy::graphics::vulkan {
+
+auto FrameScheduler::Initialize(const VulkanDevice &device, FrameSchedulerConfig config) -> bool {
+  if (config.frames_in_flight == 0) {
+    RENDY_LOG_ERROR("Frame scheduler needs at least one frame in flight");
+    return false;
+  }
+  _device = &device;
+  _config = config;
+  _frame_index = 0;
+  _slots = std::vector<FrameSlot>(config.frames_in_flight);
+
+  if (!_command_context.Initialize(device, CommandContextConfig{.frames_in_flight = config.frames_in_flight,
+                                                                .max_threads = config.recording_threads})) {
+    return false;
+  }
+  RENDY_LOG_INFO("Frame scheduler running {} frames in flight", config.frames_in_flight);
+  return true;
+}
+
+void FrameScheduler::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  WaitIdle();
+  _command_context.Destroy();
+  _slots.clear();
+  _device = nullptr;
+}
+
+auto FrameScheduler::BeginFrame() -> FrameContext {
+  if (_in_frame) {
+    throw std::runtime_error("BeginFrame called twice without EndFrame.");
+  }
+  auto &slot = currentSlot();
+  waitForSlot(slot, UINT64_MAX);
+  slot.timeline_values.clear();
+
+  _command_context.BeginFrame(_frame_index);
+  _device->GetUploadContext().Poll();
+  _in_frame = true;
+  return FrameContext{.frame_index = _frame_index,
+                      .frame_slot = static_cast<uint32_t>(_frame_index % _config.frames_in_flight)};
+}
+
+auto FrameScheduler::Submit(core::QueueType queue_type, std::span<const SubmitBatch> batches) -> uint64_t {
+  const auto upload_value = _device->GetUploadContext().Flush();
+  auto &waited = _upload_waits[queue_type];
+
+  std::vector<SubmitBatch> patched_batches(batches.begin(), batches.end());
+  std::vector<vk::SemaphoreSubmitInfo> first_waits;
+  if (upload_value > waited && !patched_batches.empty()) {
+    auto &first = patched_batches.front();
+    first_waits.assign(first.wait_semaphores.begin(), first.wait_semaphores.end());
+    first_waits.push_back(
+        vk::SemaphoreSubmitInfo{.semaphore = _device->GetTimeline(core::QueueType::Transfer).Get(),
+                                .value = upload_value,
+                                .stageMask = vk::PipelineStageFlagBits2::eAllCommands});
+    first.wait_semaphores = first_waits;
+    waited = upload_value;
+  }
+
+  const auto value = _command_context.Submit(queue_type, patched_batches);
+  if (_in_frame) {
+    currentSlot().timeline_values[queue_type] = value;
+  }
+  return value;
+}
+
+void FrameScheduler::EndFrame() {
+  if (!_in_frame) {
+    throw std::runtime_error("EndFrame called without BeginFrame.");
+  }
+  // Uploads queued after the last submission of the frame still go out now instead of waiting for the next frame
+  // Flush returns the previous submission's value when nothing was queued, which can be older than one recorded by a
+  // transfer submission of this frame
+  const auto upload_value = _device->GetUploadContext().Flush();
+  auto &transfer_value = currentSlot().timeline_values[core::QueueType::Transfer];
+  transfer_value = std::max(transfer_value, upload_value);
+  _in_frame = false;
+  ++_frame_index;
+}
+
+auto FrameScheduler::WaitForFrame(uint64_t frame_index, uint64_t timeout_ns) const -> bool {
+  const auto begun_frames = _frame_index + (_in_frame ? 1 : 0);
+  if (frame_index >= begun_frames) {
+    return false; // Not submitted yet
+  }
+  if (frame_index + _config.frames_in_flight < begun_frames) {
+    return true; // The slot was already reused, which only happens after the frame completed
+  }
+  return waitForSlot(_slots[frame_index % _slots.size()], timeout_ns);
+}
+
+void FrameScheduler::WaitIdle() const {
+  for (const auto &slot : _slots) {
+    waitForSlot(slot, UINT64_MAX);
+  }
+}
+
+auto FrameScheduler::waitForSlot(const FrameSlot &slot, uint64_t timeout_ns) const -> bool {
+  for (const auto &[queue_type, value] : slot.timeline_values) {
+    if (!_device->GetTimeline(queue_type).Wait(value, timeout_ns)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,512 @@
+#include "vulkan/gpu_culling.hpp"
+#include "common/log.hpp"
+#include "vulkan/command_list.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/frame_scheduler.hpp"
+#include "vulkan/physical_device.hpp"
+#include "vulkan/shader_library.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <utility>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+// Mirrors CullObject in assets/culling.slang
+struct GpuObject {
+  std::array<float, 4> sphere;
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+  uint32_t reserved;
+};
+static_assert(sizeof(GpuObject) == 32);
+
+struct CullParams {
+  uint32_t object_count;
+  uint32_t pyramid;
+  uint32_t pyramid_levels;
+  uint32_t occlusion;
+  std::array<uint32_t, 2> pyramid_extent;
+};
+
+struct PyramidParams {
+  uint32_t source;
+  uint32_t destination;
+  std::array<uint32_t, 2> source_extent;
+  std::array<uint32_t, 2> destination_extent;
+  uint32_t from_depth;
+};
+
+constexpr uint32_t kCullGroupSize = 64;
+// Storage buffer offsets never need more than this
+constexpr vk::DeviceSize kFrameAlignment = 256;
+
+auto toGpuObject(const CullObject &object) -> GpuObject {
+  return {.sphere = object.sphere,
+          .index_count = object.index_count,
+          .first_index = object.first_index,
+          .vertex_offset = object.vertex_offset,
+          .reserved = 0};
+}
+
+} // namespace
+
+auto ExtractFrustumPlanes(const std::array<float, 16> &matrix) -> std::array<std::array<float, 4>, 6> {
+  const auto row = [&](size_t index) {
+    return std::array{matrix[index * 4], matrix[(index * 4) + 1], matrix[(index * 4) + 2], matrix[(index * 4) + 3]};
+  };
+  const auto combine = [](const std::array<float, 4> &lhs, const std::array<float, 4> &rhs, float sign) {
+    std::array<float, 4> plane{};
+    for (size_t i = 0; i < plane.size(); ++i) {
+      plane[i] = lhs[i] + (sign * rhs[i]);
+    }
+    const auto length = std::sqrt((plane[0] * plane[0]) + (plane[1] * plane[1]) + (plane[2] * plane[2]));
+    if (length > 0.0F) {
+      for (auto &value : plane) {
+        value /= length;
+      }
+    }
+    return plane;
+  };
+  const auto x = row(0);
+  const auto y = row(1);
+  const auto z = row(2);
+  const auto w = row(3);
+  return {combine(w, x, 1.0F), combine(w, x, -1.0F), combine(w, y, 1.0F),
+          combine(w, y, -1.0F), combine(z, z, 0.0F),  combine(w, z, -1.0F)};
+}
+
+auto GpuCulling::Initialize(const VulkanDevice &device, PipelineCompiler &compiler, ShaderLibrary &shader_library,
+                            BindlessHeap &bindless_heap, const FrameScheduler &scheduler,
+                            const GpuCullingConfig &config) -> bool {
+  _device = &device;
+  _scheduler = &scheduler;
+  _bindless_heap = &bindless_heap;
+  _config = config;
+  const auto &capabilities = device.GetCapabilities();
+  _multi_draw = capabilities.multi_draw_indirect_support;
+  _compact = capabilities.draw_indirect_count_support && _multi_draw;
+
+  const auto cull_shader = shader_library.Load("culling");
+  const auto pyramid_shader = shader_library.Load("depth_pyramid");
+  if (cull_shader == nullptr || pyramid_shader == nullptr) {
+    RENDY_LOG_ERROR("GPU culling shaders failed to load");
+    _device = nullptr;
+    return false;
+  }
+  const std::array specialization{SpecializationConstant{.id = 0, .value = kCullGroupSize},
+                                  SpecializationConstant{.id = 1, .value = _compact ? 1U : 0U}};
+  if (!_cull_kernel.Initialize(device, compiler, cull_shader, "cullObjects", specialization, &bindless_heap)) {
+    _device = nullptr;
+    return false;
+  }
+  if (!_pyramid_kernel.Initialize(device, compiler, pyramid_shader, "buildDepthPyramid", {}, &bindless_heap)) {
+    _cull_kernel.Destroy();
+    _device = nullptr;
+    return false;
+  }
+
+  const auto storage_alignment = device.GetPhysicalDevice().GetProperties().limits.minStorageBufferOffsetAlignment;
+  const auto frame_size = sizeof(FrameData) + (vk::DeviceSize{config.max_updates_per_frame} * sizeof(GpuObject));
+  const auto alignment = std::max(storage_alignment, kFrameAlignment);
+  _frame_stride = (frame_size + alignment - 1) / alignment * alignment;
+
+  const auto draw_stride = sizeof(vk::DrawIndexedIndirectCommand);
+  // The draws and the count are transfer sources so tests can read the survivors back
+  if (!_objects_buffer.Initialize(device, {.size = vk::DeviceSize{config.max_objects} * sizeof(GpuObject),
+                                           .usage = core::BufferUsage::Storage | core::BufferUsage::TransferDst,
+                                           .memory_usage = core::MemoryUsage::GpuOnly}) ||
+      !_frame_buffer.Initialize(device, {.size = _frame_stride * scheduler.GetFramesInFlight(),
+                                         .usage = core::BufferUsage::Storage | core::BufferUsage::TransferSrc,
+                                         .memory_usage = core::MemoryUsage::Upload}) ||
+      !_draws_buffer.Initialize(device, {.size = vk::DeviceSize{config.max_objects} * draw_stride,
+                                         .usage = core::BufferUsage::Storage | core::BufferUsage::Indirect |
+                                                  core::BufferUsage::TransferSrc,
+                                         .memory_usage = core::MemoryUsage::GpuOnly}) ||
+      !_count_buffer.Initialize(device, {.size = sizeof(uint32_t),
+                                         .usage = core::BufferUsage::Storage | core::BufferUsage::Indirect |
+                                                  core::BufferUsage::TransferSrc | core::BufferUsage::TransferDst,
+                                         .memory_usage = core::MemoryUsage::GpuOnly})) {
+    Destroy();
+    return false;
+  }
+  // Slots past the last update read as empty objects
+  device.ImmediateSubmit(core::QueueType::Graphics, [&](vk::CommandBuffer command_buffer) {
+    command_buffer.fillBuffer(_objects_buffer.Get(), 0, vk::WholeSize, 0);
+  });
+
+  _objects.reserve(config.max_objects);
+  _dirty.assign(config.max_objects, false);
+  _copies.reserve(config.max_updates_per_frame);
+  RENDY_LOG_INFO("GPU culling: {} objects, indirect count: {}, occlusion: {}", config.max_objects, _compact,
+                 config.occlusion);
+  return true;
+}
+
+void GpuCulling::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  retirePyramid();
+  // The caller has waited for the GPU, nothing uses the pyramids anymore
+  for (const auto &retired : _retired_pyramids) {
+    destroyRetired(retired);
+  }
+  _retired_pyramids.clear();
+  _cull_kernel.Destroy();
+  _pyramid_kernel.Destroy();
+  _objects_buffer.Destroy();
+  _frame_buffer.Destroy();
+  _draws_buffer.Destroy();
+  _count_buffer.Destroy();
+  _objects.clear();
+  _free_ids.clear();
+  _dirty_ids.clear();
+  _dirty.clear();
+  _object_count = 0;
+  _device = nullptr;
+}
+
+auto GpuCulling::AddObject(const CullObject &object) -> uint32_t {
+  uint32_t id = kInvalidObject;
+  if (!_free_ids.empty()) {
+    id = _free_ids.back();
+    _free_ids.pop_back();
+  } else if (_objects.size() < _config.max_objects) {
+    id = VkToU32(_objects.size());
+    _objects.emplace_back();
+  } else {
+    return kInvalidObject;
+  }
+  _object_count = std::max(_object_count, id + 1);
+  UpdateObject(id, object);
+  return id;
+}
+
+void GpuCulling::UpdateObject(uint32_t id, const CullObject &object) {
+  _objects[id] = object;
+  if (!_dirty[id]) {
+    _dirty[id] = true;
+    _dirty_ids.push_back(id);
+  }
+}
+
+void GpuCulling::RemoveObject(uint32_t id) {
+  // An object without indices is never drawn, the slot stays in the dispatch until it is reused
+  UpdateObject(id, CullObject{});
+  _free_ids.push_back(id);
+}
+
+auto GpuCulling::AddCullPass(RenderGraph &graph, vk::Extent2D depth_extent) -> std::optional<CullingResources> {
+  collectRetired();
+  if (_config.occlusion && depth_extent != _pyramid_extent) {
+    retirePyramid();
+    if (!createPyramid(depth_extent)) {
+      return std::nullopt;
+    }
+  }
+
+  const CullingResources resources{
+      .draws = graph.ImportBuffer("Culled Draws", _draws_buffer.Get(), _draws_buffer.GetDesc().size),
+      .draw_count = graph.ImportBuffer("Culled Draw Count", _count_buffer.Get(), _count_buffer.GetDesc().size)};
+  auto &pass = graph.AddPass("GPU Culling", PassType::AsyncCompute)
+                   .Write(resources.draws, ResourceAccess::StorageWrite)
+                   .Write(resources.draw_count, ResourceAccess::TransferWrite)
+                   .Write(resources.draw_count, ResourceAccess::StorageWrite)
+                   .SetExecute([this](PassContext &context) { recordCull(context.command_list); });
+  _pyramid_handle = {};
+  if (_pyramid) {
+    // Imported in the layout the pyramid pass leaves it in, General
+    _pyramid_handle = graph.ImportImage(
+        "Depth Pyramid", _pyramid, _pyramid_view,
+        {.extent = _pyramid_extent, .format = vk::Format::eR32Sfloat, .mip_levels = VkToU32(_pyramid_levels.size())},
+        vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral);
+    pass.Read(_pyramid_handle, ResourceAccess::SampledRead);
+  }
+  return resources;
+}
+
+void GpuCulling::AddDepthPyramidPass(RenderGraph &graph, RenderGraphHandle depth) {
+  if (!_pyramid_handle.IsValid()) {
+    return;
+  }
+  graph.AddPass("Depth Pyramid", PassType::Compute)
+      .Read(depth, ResourceAccess::SampledRead)
+      .Write(_pyramid_handle, ResourceAccess::StorageWrite)
+      .SetExecute([this, depth](PassContext &context) {
+        recordPyramid(context.command_list, context.graph.GetImageView(depth));
+      });
+}
+
+void GpuCulling::RecordDraws(VulkanCommandList &command_list) const {
+  if (!_culled || _object_count == 0) {
+    return;
+  }
+  const auto stride = VkToU32(sizeof(vk::DrawIndexedIndirectCommand));
+  if (_compact) {
+    command_list.DrawIndexedIndirectCount(_draws_buffer, 0, _count_buffer, 0, _object_count, stride);
+  } else if (_multi_draw) {
+    command_list.DrawIndexedIndirect(_draws_buffer, 0, _object_count, stride);
+  } else {
+    // Culled objects still cost a command here, but the draws themselves stay on the GPU
+    for (uint32_t id = 0; id < _object_count; ++id) {
+      command_list.DrawIndexedIndirect(_draws_buffer, uint64_t{id} * stride, 1, stride);
+    }
+  }
+}
+
+void GpuCulling::recordCull(VulkanCommandList &command_list) {
+  const auto frame_offset = (_scheduler->GetFrameIndex() % _scheduler->GetFramesInFlight()) * _frame_stride;
+  auto *frame = _frame_buffer.GetMappedData() + frame_offset;
+
+  const FrameData data{.frustum = ExtractFrustumPlanes(_view.view_projection),
+                       .pyramid_view_projection = {
+                           std::array{_pyramid_camera.view_projection[0], _pyramid_camera.view_projection[1],
+                                      _pyramid_camera.view_projection[2], _pyramid_camera.view_projection[3]},
+                           std::array{_pyramid_camera.view_projection[4], _pyramid_camera.view_projection[5],
+                                      _pyramid_camera.view_projection[6], _pyramid_camera.view_projection[7]},
+                           std::array{_pyramid_camera.view_projection[8], _pyramid_camera.view_projection[9],
+                                      _pyramid_camera.view_projection[10], _pyramid_camera.view_projection[11]},
+                           std::array{_pyramid_camera.view_projection[12], _pyramid_camera.view_projection[13],
+                                      _pyramid_camera.view_projection[14], _pyramid_camera.view_projection[15]}}};
+  std::memcpy(frame, &data, sizeof(data));
+
+  // Stage the changed objects, adjacent ids become one copy region
+  const auto update_count = std::min(_dirty_ids.size(), size_t{_config.max_updates_per_frame});
+  const auto updates = std::span(_dirty_ids).last(update_count);
+  _copies.clear();
+  for (size_t index = 0; index < updates.size(); ++index) {
+    const auto id = updates[index];
+    const auto object = toGpuObject(_objects[id]);
+    const auto src_offset = sizeof(FrameData) + (index * sizeof(GpuObject));
+    std::memcpy(frame + src_offset, &object, sizeof(object));
+    _dirty[id] = false;
+
+    const auto dst_offset = vk::DeviceSize{id} * sizeof(GpuObject);
+    if (!_copies.empty() && _copies.back().dstOffset + _copies.back().size == dst_offset &&
+        _copies.back().srcOffset + _copies.back().size == frame_offset + src_offset) {
+      _copies.back().size += sizeof(GpuObject);
+    } else {
+      _copies.push_back(
+          vk::BufferCopy{.srcOffset = frame_offset + src_offset, .dstOffset = dst_offset, .size = sizeof(GpuObject)});
+    }
+  }
+  _dirty_ids.resize(_dirty_ids.size() - update_count);
+  _device->GetAllocator().Flush(*_frame_buffer.GetAllocation(), frame_offset,
+                                sizeof(FrameData) + (update_count * sizeof(GpuObject)));
+
+  const auto command_buffer = command_list.Get();
+  // The previous frame's dispatch on this queue may still be reading the objects being replaced
+  command_list.GlobalBarrier(vk::PipelineStageFlagBits2::eComputeShader, {}, vk::PipelineStageFlagBits2::eTransfer,
+                             {});
+  if (!_copies.empty()) {
+    command_buffer.copyBuffer(_frame_buffer.Get(), _objects_buffer.Get(), _copies);
+  }
+  if (_compact) {
+    command_buffer.fillBuffer(_count_buffer.Get(), 0, sizeof(uint32_t), 0);
+  }
+  command_list.GlobalBarrier(vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite,
+                             vk::PipelineStageFlagBits2::eComputeShader,
+                             vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite);
+
+  const CullParams params{
+      .object_count = _object_count,
+      .pyramid = _pyramid_sampled.GetIndex(),
+      .pyramid_levels = VkToU32(_pyramid_levels.size()),
+      .occlusion = _pyramid_built ? 1U : 0U,
+      .pyramid_extent = {_pyramid_extent.width, _pyramid_extent.height},
+  };
+  const std::array bindings{
+      ComputeBufferBinding{.binding = 0, .buffer = &_objects_buffer},
+      ComputeBufferBinding{.binding = 1, .buffer = &_frame_buffer, .offset = frame_offset, .range = sizeof(FrameData)},
+      ComputeBufferBinding{.binding = 2, .buffer = &_draws_buffer},
+      ComputeBufferBinding{.binding = 3, .buffer = &_count_buffer},
+  };
+  _cull_kernel.Refresh();
+  _culled = _cull_kernel.Record(command_list, bindings, std::as_bytes(std::span(&params, 1)),
+                                _cull_kernel.GetGroupCount(_object_count));
+}
+
+void GpuCulling::recordPyramid(VulkanCommandList &command_list, vk::ImageView depth_view) {
+  if (depth_view != _depth_view) {
+    if (_depth_sampled.IsValid()) {
+      _bindless_heap->Release(_depth_sampled);
+    }
+    _depth_sampled = _bindless_heap->RegisterSampledImage(depth_view);
+    _depth_view = depth_view;
+  }
+  _pyramid_kernel.Refresh();
+  // Levels built by different frames would not match the view they are tested with
+  if (!_depth_sampled.IsValid() || !_pyramid_kernel.IsReady()) {
+    return;
+  }
+  const auto group_size = _pyramid_kernel.GetWorkgroupSize();
+  auto source_extent = _pyramid_extent;
+  for (uint32_t level = 0; level < _pyramid_levels.size(); ++level) {
+    const vk::Extent2D extent{.width = std::max(_pyramid_extent.width >> level, 1U),
+                              .height = std::max(_pyramid_extent.height >> level, 1U)};
+    const PyramidParams params{
+        .source = level == 0 ? _depth_sampled.GetIndex() : _pyramid_levels[level - 1].storage.GetIndex(),
+        .destination = _pyramid_levels[level].storage.GetIndex(),
+        .source_extent = {source_extent.width, source_extent.height},
+        .destination_extent = {extent.width, extent.height},
+        .from_depth = level == 0 ? 1U : 0U,
+    };
+    if (level > 0) {
+      command_list.GlobalBarrier(vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageWrite,
+                                 vk::PipelineStageFlagBits2::eComputeShader, vk::AccessFlagBits2::eShaderStorageRead);
+    }
+    if (!_pyramid_kernel.Record(command_list, {}, std::as_bytes(std::span(&params, 1)),
+                                (extent.width + group_size[0] - 1) / group_size[0],
+                                (extent.height + group_size[1] - 1) / group_size[1])) {
+      return;
+    }
+    source_extent = extent;
+  }
+  _pyramid_built = true;
+  _pyramid_camera = _view;
+}
+
+auto GpuCulling::createPyramid(vk::Extent2D extent) -> bool {
+  if (extent.width == 0 || extent.height == 0) {
+    return false;
+  }
+  const auto vk_device = _device->Get();
+  const auto level_count = VkToU32(std::bit_width(std::max(extent.width, extent.height)));
+  // Written on the graphics queue and read by culling on the compute queue
+  const auto queue_families = _device->GetUniqueQueueFamilyIndices();
+  const bool concurrent = queue_families.size() > 1;
+  _pyramid = VkCheckAndUnwrap(
+      vk_device.createImage(vk::ImageCreateInfo{
+          .imageType = vk::ImageType::e2D,
+          .format = vk::Format::eR32Sfloat,
+          .extent = vk::Extent3D{.width = extent.width, .height = extent.height, .depth = 1},
+          .mipLevels = level_count,
+          .arrayLayers = 1,
+          .samples = vk::SampleCountFlagBits::e1,
+          .tiling = vk::ImageTiling::eOptimal,
+          .usage = vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled,
+          .sharingMode = concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+          .queueFamilyIndexCount = concurrent ? VkToU32(queue_families.size()) : 0,
+          .pQueueFamilyIndices = concurrent ? queue_families.data() : nullptr,
+          .initialLayout = vk::ImageLayout::eUndefined}),
+      "Failed to create depth pyramid.");
+  _pyramid_allocation = _device->GetAllocator().AllocateForImage(
+      _pyramid, AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eDeviceLocal});
+  if (_pyramid_allocation == nullptr) {
+    RENDY_LOG_ERROR("Failed to allocate memory for a {}x{} depth pyramid", extent.width, extent.height);
+    vk_device.destroyImage(_pyramid);
+    _pyramid = nullptr;
+    return false;
+  }
+  _pyramid_extent = extent;
+
+  const auto create_view = [&](uint32_t base_level, uint32_t count) {
+    return VkCheckAndUnwrap(
+        vk_device.createImageView(vk::ImageViewCreateInfo{
+            .image = _pyramid,
+            .viewType = vk::ImageViewType::e2D,
+            .format = vk::Format::eR32Sfloat,
+            .subresourceRange = vk::ImageSubresourceRange{.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                          .baseMipLevel = base_level,
+                                                          .levelCount = count,
+                                                          .layerCount = 1}}),
+        "Failed to create depth pyramid view.");
+  };
+  _pyramid_view = create_view(0, level_count);
+  _pyramid_sampled = _bindless_heap->RegisterSampledImage(_pyramid_view);
+  for (uint32_t level = 0; level < level_count; ++level) {
+    const auto view = create_view(level, 1);
+    _pyramid_levels.push_back(PyramidLevel{.view = view, .storage = _bindless_heap->RegisterStorageImage(view)});
+  }
+  if (!_pyramid_sampled.IsValid() ||
+      std::ranges::any_of(_pyramid_levels, [](const auto &level) { return !level.storage.IsValid(); })) {
+    RENDY_LOG_ERROR("The bindless heap has no room for the depth pyramid");
+    retirePyramid();
+    return false;
+  }
+
+  // Every frame imports the pyramid in General, which the first frame has to find it in too
+  _device->ImmediateSubmit(core::QueueType::Graphics, [&](vk::CommandBuffer command_buffer) {
+    const vk::ImageMemoryBarrier2 barrier{
+        .dstStageMask = vk::PipelineStageFlagBits2::eComputeShader,
+        .oldLayout = vk::ImageLayout::eUndefined,
+        .newLayout = vk::ImageLayout::eGeneral,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = _pyramid,
+        .subresourceRange = vk::ImageSubresourceRange{
+            .aspectMask = vk::ImageAspectFlagBits::eColor, .levelCount = level_count, .layerCount = 1}};
+    command_buffer.pipelineBarrier2(vk::DependencyInfo{.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &barrier});
+  });
+  _pyramid_built = false;
+  return true;
+}
+
+void GpuCulling::retirePyramid() {
+  if (_depth_sampled.IsValid()) {
+    _bindless_heap->Release(_depth_sampled);
+  }
+  _depth_sampled = {};
+  _depth_view = nullptr;
+  _pyramid_handle = {};
+  _pyramid_built = false;
+  _pyramid_extent = vk::Extent2D{};
+  if (!_pyramid) {
+    return;
+  }
+
+  // Frames in flight may still build the pyramid on the graphics queue or cull against it on the compute queue. The
+  // bindless slots are released with the same deferral.
+  RetiredPyramid retired{.image = _pyramid,
+                         .allocation = _pyramid_allocation,
+                         .views = {},
+                         .graphics_value = _device->GetTimeline(core::QueueType::Graphics).GetLastReserved(),
+                         .compute_value = _device->GetTimeline(core::QueueType::Compute).GetLastReserved()};
+  for (const auto &level : _pyramid_levels) {
+    if (level.storage.IsValid()) {
+      _bindless_heap->Release(level.storage);
+    }
+    retired.views.push_back(level.view);
+  }
+  if (_pyramid_sampled.IsValid()) {
+    _bindless_heap->Release(_pyramid_sampled);
+  }
+  retired.views.push_back(_pyramid_view);
+  _retired_pyramids.push_back(std::move(retired));
+
+  _pyramid_levels.clear();
+  _pyramid_sampled = {};
+  _pyramid_view = nullptr;
+  _pyramid = nullptr;
+  _pyramid_allocation = nullptr;
+}
+
+void GpuCulling::collectRetired() {
+  const auto graphics_completed = _device->GetTimeline(core::QueueType::Graphics).GetCompletedValue();
+  const auto compute_completed = _device->GetTimeline(core::QueueType::Compute).GetCompletedValue();
+  std::erase_if(_retired_pyramids, [&](const RetiredPyramid &retired) {
+    if (retired.graphics_value > graphics_completed || retired.compute_value > compute_completed) {
+      return false;
+    }
+    destroyRetired(retired);
+    return true;
+  });
+}
+
+void GpuCulling::destroyRetired(const RetiredPyramid &retired) {
+  const auto vk_device = _device->Get();
+  for (const auto view : retired.views) {
+    vk_device.destroyImageView(view);
+  }
+  vk_device.destroyImage(retired.image);
+  _device->GetAllocator().Free(retired.allocation);
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,328 @@
+#include "vulkan/gpu_profiler.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/physical_device.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+// Results are written in bit order, which matches the member order of PipelineStatistics
+constexpr auto kStatisticFlags = vk::QueryPipelineStatisticFlagBits::eInputAssemblyVertices |
+                                 vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+                                 vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+                                 vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+                                 vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+                                 vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+constexpr uint32_t kStatisticCount = 6;
+constexpr int kCpuProcess = 1;
+constexpr int kGpuProcess = 2;
+
+auto queueName(core::QueueType queue_type) -> const char * {
+  switch (queue_type) {
+  case core::QueueType::Compute:
+    return "Compute queue";
+  case core::QueueType::Transfer:
+    return "Transfer queue";
+  default:
+    return "Graphics queue";
+  }
+}
+
+auto toMicroseconds(uint64_t ns) -> double { return static_cast<double>(ns) / 1e3; }
+
+} // namespace
+
+auto GpuProfiler::Initialize(const VulkanDevice &device, uint32_t frames_in_flight, const GpuProfilerConfig &config)
+    -> bool {
+  if (frames_in_flight == 0 || config.max_zones_per_frame == 0) {
+    RENDY_LOG_ERROR("GPU profiler needs at least one frame in flight and one zone per frame");
+    return false;
+  }
+  _device = &device;
+  _config = config;
+  const auto &physical_device = device.GetPhysicalDevice();
+  _timestamp_period = physical_device.GetProperties().limits.timestampPeriod;
+
+  // Families report how many bits of a timestamp are valid; zero means the queue can't write timestamps at all
+  const auto &families = physical_device.GetQueueFamilyProperties();
+  for (const auto type : {core::QueueType::Graphics, core::QueueType::Compute, core::QueueType::Transfer}) {
+    const auto valid_bits = families.at(device.GetQueueFamilyIndex(type)).timestampValidBits;
+    if (valid_bits > 0) {
+      _timestamp_masks[type] = valid_bits >= 64 ? UINT64_MAX : (uint64_t{1} << valid_bits) - 1;
+    }
+  }
+  if (!_timestamp_masks.contains(core::QueueType::Graphics)) {
+    RENDY_LOG_WARN("The graphics queue doesn't support timestamps, GPU zones won't be timed");
+  }
+
+  const auto vk_device = device.Get();
+  const auto zone_count = frames_in_flight * config.max_zones_per_frame;
+  _timestamp_pool = VkCheckAndUnwrap(
+      vk_device.createQueryPool(vk::QueryPoolCreateInfo{.queryType = vk::QueryType::eTimestamp,
+                                                        .queryCount = zone_count * 2}),
+      "Failed to create timestamp query pool.");
+  vk_device.resetQueryPool(_timestamp_pool, 0, zone_count * 2);
+  if (config.pipeline_statistics && device.GetCapabilities().pipeline_statistics_support) {
+    _statistics_pool = VkCheckAndUnwrap(
+        vk_device.createQueryPool(vk::QueryPoolCreateInfo{.queryType = vk::QueryType::ePipelineStatistics,
+                                                          .queryCount = zone_count,
+                                                          .pipelineStatistics = kStatisticFlags}),
+        "Failed to create pipeline statistics query pool.");
+    vk_device.resetQueryPool(_statistics_pool, 0, zone_count);
+  }
+
+  _slots = std::vector<FrameSlot>(frames_in_flight);
+  _slot = 0;
+  _in_frame = false;
+  _history.clear();
+  RENDY_LOG_INFO("GPU profiler using {} zones per frame, timestamp period {} ns, pipeline statistics: {}",
+                 config.max_zones_per_frame, _timestamp_period, static_cast<bool>(_statistics_pool));
+  return true;
+}
+
+void GpuProfiler::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  const auto vk_device = _device->Get();
+  vk_device.destroyQueryPool(_timestamp_pool);
+  vk_device.destroyQueryPool(_statistics_pool);
+  _timestamp_pool = nullptr;
+  _statistics_pool = nullptr;
+  _slots.clear();
+  _open_zones.clear();
+  _history.clear();
+  _device = nullptr;
+}
+
+void GpuProfiler::BeginFrame(const FrameContext &frame) {
+  const std::scoped_lock lock(_mutex);
+  // CPU zones recorded since the last call belong to the previous frame
+  if (_in_frame) {
+    auto cpu_zones = core::CpuProfiler::Get().Collect();
+    auto &previous = _slots[_slot].cpu_zones;
+    previous.insert(previous.end(), cpu_zones.begin(), cpu_zones.end());
+  }
+
+  _slot = frame.frame_slot % static_cast<uint32_t>(_slots.size());
+  auto &slot = _slots[_slot];
+  if (slot.recorded) {
+    resolve(slot, _slot);
+  }
+  slot.frame_index = frame.frame_index;
+  slot.zones.clear();
+  slot.cpu_zones.clear();
+  slot.recorded = true;
+  _open_zones.clear();
+  _in_frame = true;
+}
+
+void GpuProfiler::resolve(FrameSlot &slot, uint32_t slot_index) {
+  const auto vk_device = _device->Get();
+  const auto first_zone = slot_index * _config.max_zones_per_frame;
+  const auto zone_count = VkToU32(slot.zones.size());
+
+  GpuFrameResult result{.frame_index = slot.frame_index, .cpu_zones = std::move(slot.cpu_zones)};
+  if (zone_count > 0) {
+    // The scheduler already waited for the slot. Zones whose command list was never submitted or ended stay
+    // unavailable, which is why availability is queried alongside the values.
+    std::vector<uint64_t> timestamps(static_cast<size_t>(zone_count) * 2 * 2);
+    const auto timestamp_result = vk_device.getQueryPoolResults(
+        _timestamp_pool, first_zone * 2, zone_count * 2, timestamps.size() * sizeof(uint64_t), timestamps.data(),
+        2 * sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+
+    std::vector<uint64_t> statistics;
+    auto statistics_result = vk::Result::eNotReady;
+    if (_statistics_pool) {
+      statistics.resize(static_cast<size_t>(zone_count) * (kStatisticCount + 1));
+      statistics_result = vk_device.getQueryPoolResults(
+          _statistics_pool, first_zone, zone_count, statistics.size() * sizeof(uint64_t), statistics.data(),
+          (kStatisticCount + 1) * sizeof(uint64_t),
+          vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+    }
+
+    if (timestamp_result == vk::Result::eSuccess || timestamp_result == vk::Result::eNotReady) {
+      for (uint32_t index = 0; index < zone_count; ++index) {
+        const auto &zone = slot.zones[index];
+        const auto *values = &timestamps[static_cast<size_t>(index) * 4];
+        if (values[1] == 0 || values[3] == 0) {
+          continue;
+        }
+        const auto mask = _timestamp_masks.at(zone.queue);
+        const auto ticks = (values[2] - values[0]) & mask;
+        const auto begin_ns = static_cast<uint64_t>(static_cast<double>(values[0] & mask) * _timestamp_period);
+        GpuZoneResult zone_result{
+            .name = zone.name,
+            .queue = zone.queue,
+            .depth = zone.depth,
+            .begin_ns = begin_ns,
+            .end_ns = begin_ns + static_cast<uint64_t>(static_cast<double>(ticks) * _timestamp_period)};
+
+        const auto *counters = zone.statistics && !statistics.empty()
+                                   ? &statistics[static_cast<size_t>(index) * (kStatisticCount + 1)]
+                                   : nullptr;
+        if (counters != nullptr && counters[kStatisticCount] != 0 &&
+            (statistics_result == vk::Result::eSuccess || statistics_result == vk::Result::eNotReady)) {
+          zone_result.statistics = PipelineStatistics{.input_assembly_vertices = counters[0],
+                                                      .input_assembly_primitives = counters[1],
+                                                      .vertex_shader_invocations = counters[2],
+                                                      .clipping_primitives = counters[3],
+                                                      .fragment_shader_invocations = counters[4],
+                                                      .compute_shader_invocations = counters[5]};
+        }
+        result.zones.push_back(std::move(zone_result));
+      }
+    } else {
+      RENDY_LOG_WARN("Failed to read GPU profiler timestamps: {}", vk::to_string(timestamp_result));
+    }
+
+    vk_device.resetQueryPool(_timestamp_pool, first_zone * 2, zone_count * 2);
+    if (_statistics_pool) {
+      vk_device.resetQueryPool(_statistics_pool, first_zone, zone_count);
+    }
+  }
+
+  _history.push_back(std::move(result));
+  while (_history.size() > std::max(_config.history_frames, 1U)) {
+    _history.pop_front();
+  }
+}
+
+auto GpuProfiler::BeginZone(VulkanCommandList &command_list, std::string_view name) -> GpuZone {
+  const auto queue = command_list.GetQueueType();
+  const auto command_buffer = command_list.Get();
+  uint32_t index = 0;
+  bool statistics = false;
+  {
+    const std::scoped_lock lock(_mutex);
+    auto &slot = _slots[_slot];
+    if (!_in_frame || !_timestamp_masks.contains(queue) || slot.zones.size() >= _config.max_zones_per_frame) {
+      return GpuZone{};
+    }
+    // Statistics queries of one pool can't nest, so only the outermost zone of a graphics command list gets them
+    auto &open = _open_zones[command_buffer];
+    statistics = _statistics_pool && queue == core::QueueType::Graphics && !open.statistics_active;
+    open.statistics_active = open.statistics_active || statistics;
+    index = VkToU32(slot.zones.size());
+    slot.zones.push_back(
+        ZoneRecord{.name = std::string(name), .queue = queue, .depth = open.depth++, .statistics = statistics});
+  }
+
+  const auto query = (_slot * _config.max_zones_per_frame) + index;
+  command_buffer.writeTimestamp2(vk::PipelineStageFlagBits2::eTopOfPipe, _timestamp_pool, query * 2);
+  if (statistics) {
+    command_buffer.beginQuery(_statistics_pool, query, {});
+  }
+  return GpuZone{.index = index};
+}
+
+void GpuProfiler::EndZone(VulkanCommandList &command_list, GpuZone zone) {
+  if (zone.index == GpuZone::kInvalid) {
+    return;
+  }
+  const auto command_buffer = command_list.Get();
+  bool statistics = false;
+  {
+    const std::scoped_lock lock(_mutex);
+    statistics = _slots[_slot].zones[zone.index].statistics;
+    auto &open = _open_zones[command_buffer];
+    open.depth = open.depth > 0 ? open.depth - 1 : 0;
+    open.statistics_active = open.statistics_active && !statistics;
+  }
+
+  const auto query = (_slot * _config.max_zones_per_frame) + zone.index;
+  if (statistics) {
+    command_buffer.endQuery(_statistics_pool, query);
+  }
+  command_buffer.writeTimestamp2(vk::PipelineStageFlagBits2::eBottomOfPipe, _timestamp_pool, (query * 2) + 1);
+}
+
+auto GpuProfiler::GetLatestFrame() const -> const GpuFrameResult * {
+  return _history.empty() ? nullptr : &_history.back();
+}
+
+auto GpuProfiler::ExportChromeTrace(const std::filesystem::path &path) const -> bool {
+  auto events = nlohmann::json::array();
+  const auto metadata = [&](const char *kind, int pid, std::optional<int> tid, const std::string &name) {
+    nlohmann::json event{{"name", kind}, {"ph", "M"}, {"pid", pid}, {"args", {{"name", name}}}};
+    if (tid.has_value()) {
+      event["tid"] = tid.value();
+    }
+    events.push_back(std::move(event));
+  };
+  metadata("process_name", kCpuProcess, std::nullopt, "CPU");
+  metadata("process_name", kGpuProcess, std::nullopt, "GPU");
+  for (const auto &[queue, mask] : _timestamp_masks) {
+    metadata("thread_name", kGpuProcess, static_cast<int>(queue), queueName(queue));
+  }
+
+  // GPU timestamps start at an arbitrary point; shift them so the retained history starts at zero
+  uint64_t gpu_base = UINT64_MAX;
+  for (const auto &frame : _history) {
+    for (const auto &zone : frame.zones) {
+      gpu_base = std::min(gpu_base, zone.begin_ns);
+    }
+  }
+
+  for (const auto &frame : _history) {
+    for (const auto &zone : frame.cpu_zones) {
+      events.push_back({{"name", zone.name},
+                        {"cat", "cpu"},
+                        {"ph", "X"},
+                        {"ts", toMicroseconds(zone.begin_ns)},
+                        {"dur", toMicroseconds(zone.end_ns - zone.begin_ns)},
+                        {"pid", kCpuProcess},
+                        {"tid", zone.thread_id},
+                        {"args", {{"frame", frame.frame_index}}}});
+    }
+    for (const auto &zone : frame.zones) {
+      nlohmann::json args{{"frame", frame.frame_index}};
+      if (zone.statistics.has_value()) {
+        const auto &statistics = zone.statistics.value();
+        args["input_assembly_vertices"] = statistics.input_assembly_vertices;
+        args["input_assembly_primitives"] = statistics.input_assembly_primitives;
+        args["vertex_shader_invocations"] = statistics.vertex_shader_invocations;
+        args["clipping_primitives"] = statistics.clipping_primitives;
+        args["fragment_shader_invocations"] = statistics.fragment_shader_invocations;
+        args["compute_shader_invocations"] = statistics.compute_shader_invocations;
+      }
+      events.push_back({{"name", zone.name},
+                        {"cat", "gpu"},
+                        {"ph", "X"},
+                        {"ts", toMicroseconds(zone.begin_ns - gpu_base)},
+                        {"dur", toMicroseconds(zone.end_ns - zone.begin_ns)},
+                        {"pid", kGpuProcess},
+                        {"tid", static_cast<int>(zone.queue)},
+                        {"args", std::move(args)}});
+    }
+  }
+
+  std::ofstream file(path);
+  if (!file) {
+    RENDY_LOG_ERROR("Failed to open {} for writing", path.string());
+    return false;
+  }
+  file << nlohmann::json{{"displayTimeUnit", "ms"}, {"traceEvents", std::move(events)}};
+  RENDY_LOG_INFO("Wrote {} frames of profiling data to {}", _history.size(), path.string());
+  return static_cast<bool>(file);
+}
+
+GpuScope::GpuScope(GpuProfiler *profiler, VulkanCommandList &command_list, std::string_view name)
+    : _profiler(profiler), _command_list(command_list) {
+  if (_profiler != nullptr) {
+    _zone = _profiler->BeginZone(_command_list, name);
+  }
+}
+
+GpuScope::~GpuScope() {
+  if (_profiler != nullptr) {
+    _profiler->EndZone(_command_list, _zone);
+  }
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,147 @@
+#include "vulkan/image.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/memory_allocator.hpp"
+#include "vulkan/utils.hpp"
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+auto toVkImageUsage(core::ImageUsage usage) -> vk::ImageUsageFlags {
+  vk::ImageUsageFlags flags;
+  if (core::HasFlag(usage, core::ImageUsage::Sampled)) {
+    flags |= vk::ImageUsageFlagBits::eSampled;
+  }
+  if (core::HasFlag(usage, core::ImageUsage::Storage)) {
+    flags |= vk::ImageUsageFlagBits::eStorage;
+  }
+  if (core::HasFlag(usage, core::ImageUsage::ColorAttachment)) {
+    flags |= vk::ImageUsageFlagBits::eColorAttachment;
+  }
+  if (core::HasFlag(usage, core::ImageUsage::DepthStencilAttachment)) {
+    flags |= vk::ImageUsageFlagBits::eDepthStencilAttachment;
+  }
+  if (core::HasFlag(usage, core::ImageUsage::TransferSrc)) {
+    flags |= vk::ImageUsageFlagBits::eTransferSrc;
+  }
+  if (core::HasFlag(usage, core::ImageUsage::TransferDst)) {
+    flags |= vk::ImageUsageFlagBits::eTransferDst;
+  }
+  return flags;
+}
+
+} // namespace
+
+auto ToVkFormat(core::Format format) -> vk::Format {
+  switch (format) {
+  case core::Format::Undefined:
+    return vk::Format::eUndefined;
+  case core::Format::R8Unorm:
+    return vk::Format::eR8Unorm;
+  case core::Format::R8G8Unorm:
+    return vk::Format::eR8G8Unorm;
+  case core::Format::R8G8B8A8Unorm:
+    return vk::Format::eR8G8B8A8Unorm;
+  case core::Format::R8G8B8A8Srgb:
+    return vk::Format::eR8G8B8A8Srgb;
+  case core::Format::B8G8R8A8Unorm:
+    return vk::Format::eB8G8R8A8Unorm;
+  case core::Format::B8G8R8A8Srgb:
+    return vk::Format::eB8G8R8A8Srgb;
+  case core::Format::R16G16B16A16Sfloat:
+    return vk::Format::eR16G16B16A16Sfloat;
+  case core::Format::R32G32B32A32Sfloat:
+    return vk::Format::eR32G32B32A32Sfloat;
+  case core::Format::BC1RgbaUnorm:
+    return vk::Format::eBc1RgbaUnormBlock;
+  case core::Format::BC1RgbaSrgb:
+    return vk::Format::eBc1RgbaSrgbBlock;
+  case core::Format::BC3Unorm:
+    return vk::Format::eBc3UnormBlock;
+  case core::Format::BC3Srgb:
+    return vk::Format::eBc3SrgbBlock;
+  case core::Format::BC4Unorm:
+    return vk::Format::eBc4UnormBlock;
+  case core::Format::BC5Unorm:
+    return vk::Format::eBc5UnormBlock;
+  case core::Format::BC6HUfloat:
+    return vk::Format::eBc6HUfloatBlock;
+  case core::Format::BC7Unorm:
+    return vk::Format::eBc7UnormBlock;
+  case core::Format::BC7Srgb:
+    return vk::Format::eBc7SrgbBlock;
+  case core::Format::ASTC4x4Unorm:
+    return vk::Format::eAstc4x4UnormBlock;
+  case core::Format::ASTC4x4Srgb:
+    return vk::Format::eAstc4x4SrgbBlock;
+  case core::Format::ASTC6x6Unorm:
+    return vk::Format::eAstc6x6UnormBlock;
+  case core::Format::ASTC6x6Srgb:
+    return vk::Format::eAstc6x6SrgbBlock;
+  case core::Format::ASTC8x8Unorm:
+    return vk::Format::eAstc8x8UnormBlock;
+  case core::Format::ASTC8x8Srgb:
+    return vk::Format::eAstc8x8SrgbBlock;
+  }
+  return vk::Format::eUndefined;
+}
+
+auto VulkanImage::Initialize(const VulkanDevice &device, const core::ImageDesc &desc) -> bool {
+  const auto format = ToVkFormat(desc.format);
+  if (format == vk::Format::eUndefined || desc.mip_levels == 0 || desc.array_layers == 0) {
+    RENDY_LOG_ERROR("Invalid image description");
+    return false;
+  }
+  _device = &device;
+  _desc = desc;
+  const auto vk_device = device.Get();
+
+  _image = VkCheckAndUnwrap(
+      vk_device.createImage(vk::ImageCreateInfo{
+          .imageType = vk::ImageType::e2D,
+          .format = format,
+          .extent = vk::Extent3D{.width = desc.extent.width, .height = desc.extent.height, .depth = 1},
+          .mipLevels = desc.mip_levels,
+          .arrayLayers = desc.array_layers,
+          .samples = vk::SampleCountFlagBits::e1,
+          .tiling = vk::ImageTiling::eOptimal,
+          .usage = toVkImageUsage(desc.usage),
+          .sharingMode = vk::SharingMode::eExclusive,
+          .initialLayout = vk::ImageLayout::eUndefined}),
+      "Failed to create image.");
+
+  _allocation = device.GetAllocator().AllocateForImage(
+      _image, AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eDeviceLocal});
+  if (_allocation == nullptr) {
+    RENDY_LOG_ERROR("Failed to allocate memory for a {}x{} image", desc.extent.width, desc.extent.height);
+    vk_device.destroyImage(_image);
+    _device = nullptr;
+    return false;
+  }
+
+  _view = VkCheckAndUnwrap(
+      vk_device.createImageView(vk::ImageViewCreateInfo{
+          .image = _image,
+          .viewType = desc.array_layers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D,
+          .format = format,
+          .subresourceRange = vk::ImageSubresourceRange{.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                                        .levelCount = desc.mip_levels,
+                                                        .layerCount = desc.array_layers}}),
+      "Failed to create image view.");
+  return true;
+}
+
+void VulkanImage::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  const auto vk_device = _device->Get();
+  vk_device.destroyImageView(_view);
+  vk_device.destroyImage(_image);
+  _device->GetAllocator().Free(_allocation);
+  _allocation = nullptr;
+  _device = nullptr;
+}
+
+} // namespace rendy::graphics::vulkan
@@ -1,8 +1,12 @@
 #include "vulkan/instance.hpp"
+#include "common/log.hpp"
 #include "vulkan/utils.hpp"
 #include <algorithm>
+#include <chrono>
+#include <functional>
 #include <spdlog/fmt/ranges.h>
 #include <spdlog/spdlog.h>
+#include <string_view>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
@@ -15,7 +19,19 @@ VKAPI_ATTR static auto VKAPI_CALL DebugCallback(vk::DebugUtilsMessageSeverityFla
                                                 vk::DebugUtilsMessageTypeFlagsEXT message_type,
                                                 vk::DebugUtilsMessengerCallbackDataEXT const *callback_data,
                                                 void * /*p_user_data*/) -> vk::Bool32 {
-  auto message_type_to_string = [](vk::DebugUtilsMessageTypeFlagsEXT type) -> std::string {
+  // The same validation message tends to fire every frame; a few per second are enough to act on
+  static rendy::common::LogRateLimiter rate_limiter(5, std::chrono::seconds(1));
+  // Messages without an id, e.g. from the loader, are told apart by their text
+  const uint64_t id = callback_data->messageIdNumber != 0
+                          ? static_cast<uint32_t>(callback_data->messageIdNumber)
+                          : std::hash<std::string_view>{}(callback_data->pMessage);
+  const auto key = (id * 31U) + static_cast<uint32_t>(message_severity);
+  uint32_t suppressed = 0;
+  if (!rate_limiter.Allow(key, suppressed)) {
+    return vk::False;
+  }
+
+  auto message_type_to_string = [](vk::DebugUtilsMessageTypeFlagsEXT type) -> std::string_view {
     if (type & vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral) {
       return "General";
     }
@@ -27,23 +43,30 @@ VKAPI_ATTR static auto VKAPI_CALL DebugCallback(vk::DebugUtilsMessageSeverityFla
     }
     return "Unknown";
   };
+  auto level = spdlog::level::trace;
   switch (message_severity) {
   case vk::DebugUtilsMessageSeverityFlagBitsEXT::eVerbose:
-    spdlog::debug("[Vulkan {}] {}", message_type_to_string(message_type), callback_data->pMessage);
+    level = spdlog::level::debug;
     break;
   case vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo:
-    spdlog::info("[Vulkan {}] {}", message_type_to_string(message_type), callback_data->pMessage);
+    level = spdlog::level::info;
     break;
   case vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning:
-    spdlog::warn("[Vulkan {}] {}", message_type_to_string(message_type), callback_data->pMessage);
+    level = spdlog::level::warn;
     break;
   case vk::DebugUtilsMessageSeverityFlagBitsEXT::eError:
-    spdlog::error("[Vulkan {}] {}", message_type_to_string(message_type), callback_data->pMessage);
+    level = spdlog::level::err;
     break;
   default:
-    spdlog::trace("[Vulkan {}] {}", message_type_to_string(message_type), callback_data->pMessage);
     break;
   }
+  // Validation messages often exceed the size of a log ring slot, so they go through spdlog's async logger whole
+  if (suppressed > 0) {
+    spdlog::log(level, "[Vulkan {}] {} ({} repeats suppressed)", message_type_to_string(message_type),
+                callback_data->pMessage, suppressed);
+  } else {
+    spdlog::log(level, "[Vulkan {}] {}", message_type_to_string(message_type), callback_data->pMessage);
+  }
   return vk::False;
 }
 
@@ -60,23 +83,24 @@ constexpr auto kEngineName = "Rendy Engine";
 
 constexpr auto kValidationLayer = "VK_LAYER_KHRONOS_validation";
 
-auto Instance::Initialize(std::span<const char *const> window_extensions) -> bool {
+auto Instance::Initialize(std::span<const char *const> window_extensions,
+                          std::span<const char *const> optional_extensions) -> bool {
   VULKAN_HPP_DEFAULT_DISPATCHER.init();
 
   uint32_t vk_version{};
   if (const auto version_result = vk::enumerateInstanceVersion(&vk_version); version_result != vk::Result::eSuccess) {
-    spdlog::error("Failed to enumerate instance version.");
+    RENDY_LOG_ERROR("Failed to enumerate instance version.");
     return false;
   }
-  spdlog::info("Vulkan Instance Version: {}.{}.{}", vk::apiVersionMajor(vk_version), vk::apiVersionMinor(vk_version),
-               vk::apiVersionPatch(vk_version));
+  RENDY_LOG_INFO("Vulkan Instance Version: {}.{}.{}", vk::apiVersionMajor(vk_version), vk::apiVersionMinor(vk_version),
+                 vk::apiVersionPatch(vk_version));
 
   _vk_api_version = vk::makeApiVersion(0, 1, 4, 0);
 
   if (vk_version < _vk_api_version) {
-    spdlog::error("Vulkan instance doesn't support requested version.");
-    spdlog::error("Requested Version: {}.{}.{}", vk::apiVersionMajor(vk_version), vk::apiVersionMinor(vk_version),
-                  vk::apiVersionPatch(vk_version));
+    RENDY_LOG_ERROR("Vulkan instance doesn't support requested version.");
+    RENDY_LOG_ERROR("Requested Version: {}.{}.{}", vk::apiVersionMajor(vk_version), vk::apiVersionMinor(vk_version),
+                    vk::apiVersionPatch(vk_version));
     return false;
   }
 
@@ -85,11 +109,22 @@ auto Instance::Initialize(std::span<const char *const> window_extensions) -> boo
 
   std::vector<const char *> required_extensions;
   required_extensions.assign(window_extensions.begin(), window_extensions.end());
+  if (!optional_extensions.empty()) {
+    const auto available_extensions = VkCheckAndUnwrap(vk::enumerateInstanceExtensionProperties(),
+                                                       "Failed to enumerate instance extension properties.");
+    for (const auto *extension_name : optional_extensions) {
+      const std::string_view name(extension_name);
+      if (!std::ranges::contains(required_extensions, name) &&
+          std::ranges::contains(available_extensions, name, &VkExtensionProperties::extensionName)) {
+        required_extensions.push_back(extension_name);
+      }
+    }
+  }
 
   std::vector<const char *> required_layers;
   void const *p_next = nullptr;
   if (kRendyDebug) {
-    spdlog::info("This is a debug build. Validation Layers are enabled.");
+    RENDY_LOG_INFO("This is a debug build. Validation Layers are enabled.");
     createDebugUtilsMessengerCreateInfo();
 
     required_extensions.emplace_back(vk::EXTDebugUtilsExtensionName);
@@ -99,16 +134,16 @@ auto Instance::Initialize(std::span<const char *const> window_extensions) -> boo
   }
 
   for (const auto &layer : required_layers) {
-    spdlog::info("{}", std::string_view(layer));
+    RENDY_LOG_INFO("{}", std::string_view(layer));
   }
   if (!validateExtensions(required_extensions) || !validateLayers(required_layers)) {
-    spdlog::error("Some of the extensions and/or layers are not supported by this device.");
+    RENDY_LOG_ERROR("Some of the extensions and/or layers are not supported by this device.");
     return false;
   }
 
-  spdlog::info("Enabling Extensions({}): {}", required_extensions.size(), fmt::join(required_extensions, ", "));
+  RENDY_LOG_INFO("Enabling Extensions({}): {}", required_extensions.size(), fmt::join(required_extensions, ", "));
   if (!required_layers.empty()) {
-    spdlog::info("Enabling Layers({}): {}", required_layers.size(), fmt::join(required_layers, ", "));
+    RENDY_LOG_INFO("Enabling Layers({}): {}", required_layers.size(), fmt::join(required_layers, ", "));
   }
 
 #ifdef __APPLE__
@@ -127,13 +162,15 @@ auto Instance::Initialize(std::span<const char *const> window_extensions) -> boo
   };
 
   _vk_instance = VkCheckAndUnwrap(vk::createInstance(instance_create_info, nullptr), "Failed to create instance.");
+  _enabled_extensions.clear();
+  _enabled_extensions.insert(required_extensions.begin(), required_extensions.end());
   VULKAN_HPP_DEFAULT_DISPATCHER.init(_vk_instance);
-  spdlog::info("Vulkan instance created.");
+  RENDY_LOG_INFO("Vulkan instance created.");
 
   if (kRendyDebug) {
     initializeDebugUtilsMessenger();
   }
-  spdlog::info("Vulkan validation messenger created.");
+  RENDY_LOG_INFO("Vulkan validation messenger created.");
   return true;
 }
 
@@ -142,7 +179,7 @@ void Instance::Destroy() const {
     _vk_instance.destroyDebugUtilsMessengerEXT(_vk_debug_utils_messenger);
   }
   vkDestroyInstance(_vk_instance, nullptr);
-  spdlog::info("Vulkan instance destroyed.");
+  RENDY_LOG_INFO("Vulkan instance destroyed.");
 }
 
 void Instance::createDebugUtilsMessengerCreateInfo() {
@@ -171,7 +208,7 @@ auto Instance::validateExtensions(const std::vector<const char *> &required_exte
     const auto iter = std::ranges::find(available_extensions, std::string_view(extension_name),
                                         &VkExtensionProperties::extensionName);
     if (iter == available_extensions.end()) {
-      spdlog::warn("Extension {} not supported by this device.", std::string_view(iter->extensionName));
+      RENDY_LOG_WARN("Extension {} not supported by this device.", std::string_view(extension_name));
       return false;
     }
     return true;
@@ -183,12 +220,12 @@ auto Instance::validateLayers(const std::vector<const char *> &required_layers)
       VkCheckAndUnwrap(vk::enumerateInstanceLayerProperties(), "Failed to enumerate instance layer properties");
 
   for (const auto &layer_name : required_layers) {
-    spdlog::warn("Required layer {}", layer_name);
+    RENDY_LOG_WARN("Required layer {}", layer_name);
   }
   return std::ranges::all_of(required_layers, [&](const char *layer_name) {
     const auto iter = std::ranges::find(available_layers, std::string_view(layer_name), &VkLayerProperties::layerName);
     if (iter == available_layers.end()) {
-      spdlog::warn("Layer {} not supported by this device.", std::string_view(iter->layerName));
+      RENDY_LOG_WARN("Layer {} not supported by this device.", std::string_view(layer_name));
       return false;
     }
     return true;
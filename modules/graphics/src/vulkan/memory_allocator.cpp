@@ -0,0 +1,652 @@
+#include "vulkan/memory_allocator.hpp"
+#include "common/log.hpp"
+#include "vulkan/physical_device.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <bit>
+#include <set>
+#include <unordered_set>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+constexpr vk::DeviceSize kSmallHeapSize = 1024ULL * 1024 * 1024;
+
+auto alignUp(vk::DeviceSize value, vk::DeviceSize alignment) -> vk::DeviceSize {
+  return alignment <= 1 ? value : (value + alignment - 1) / alignment * alignment;
+}
+
+auto alignDown(vk::DeviceSize value, vk::DeviceSize alignment) -> vk::DeviceSize {
+  return alignment <= 1 ? value : value / alignment * alignment;
+}
+
+auto offsetPointer(void *base, vk::DeviceSize offset) -> void * {
+  return base == nullptr ? nullptr : static_cast<std::byte *>(base) + offset;
+}
+
+} // namespace
+
+// Power of two sized vk::DeviceMemory split into buddies, down to min_size
+class MemoryBlock {
+public:
+  vk::DeviceMemory memory;
+  vk::DeviceSize size{0};
+  vk::DeviceSize min_size{0};
+  void *mapped{nullptr};
+  uint32_t memory_type{0};
+  vk::DeviceSize bytes_used{0};
+  uint32_t pending_moves{0}; // Defragmentation destinations reserved in this block
+  std::unordered_set<Allocation *> allocations;
+  std::vector<std::set<vk::DeviceSize>> free_lists; // Free offsets per order, order 0 being min_size
+
+  MemoryBlock(vk::DeviceMemory block_memory, vk::DeviceSize block_size, vk::DeviceSize block_min_size,
+              void *block_mapped, uint32_t block_memory_type)
+      : memory(block_memory), size(block_size), min_size(block_min_size), mapped(block_mapped),
+        memory_type(block_memory_type) {
+    free_lists.resize(std::countr_zero(size / min_size) + 1);
+    free_lists.back().insert(0);
+  }
+
+  [[nodiscard]] auto OrderSize(uint32_t order) const -> vk::DeviceSize { return min_size << order; }
+
+  [[nodiscard]] auto OrderFor(vk::DeviceSize request_size) const -> std::optional<uint32_t> {
+    for (uint32_t order = 0; order < free_lists.size(); order++) {
+      if (OrderSize(order) >= request_size) {
+        return order;
+      }
+    }
+    return std::nullopt;
+  }
+
+  [[nodiscard]] auto Allocate(uint32_t order) -> std::optional<vk::DeviceSize> {
+    auto current = order;
+    while (current < free_lists.size() && free_lists[current].empty()) {
+      current++;
+    }
+    if (current == free_lists.size()) {
+      return std::nullopt;
+    }
+
+    const auto offset = *free_lists[current].begin();
+    free_lists[current].erase(free_lists[current].begin());
+    // Split down to the requested order, returning the upper halves to the free lists
+    while (current > order) {
+      current--;
+      free_lists[current].insert(offset + OrderSize(current));
+    }
+    return offset;
+  }
+
+  void Free(vk::DeviceSize offset, uint32_t order) {
+    // Merge with the buddy for as long as it is free
+    while (order + 1 < free_lists.size()) {
+      const auto buddy = offset ^ OrderSize(order);
+      if (free_lists[order].erase(buddy) == 0) {
+        break;
+      }
+      offset = std::min(offset, buddy);
+      order++;
+    }
+    free_lists[order].insert(offset);
+  }
+
+  [[nodiscard]] auto FreeBytes() const -> vk::DeviceSize {
+    vk::DeviceSize free_bytes = 0;
+    for (uint32_t order = 0; order < free_lists.size(); order++) {
+      free_bytes += free_lists[order].size() * OrderSize(order);
+    }
+    return free_bytes;
+  }
+
+  [[nodiscard]] auto LargestFreeRange() const -> vk::DeviceSize {
+    for (auto order = static_cast<uint32_t>(free_lists.size()); order > 0; order--) {
+      if (!free_lists[order - 1].empty()) {
+        return OrderSize(order - 1);
+      }
+    }
+    return 0;
+  }
+
+  [[nodiscard]] auto IsEmpty() const -> bool { return allocations.empty() && pending_moves == 0; }
+};
+
+LinearPool::LinearPool(vk::DeviceMemory memory, vk::DeviceSize capacity, void *mapped, uint32_t memory_type)
+    : _memory(memory), _capacity(capacity), _mapped(mapped), _memory_type(memory_type) {}
+
+auto LinearPool::Allocate(vk::DeviceSize size, vk::DeviceSize alignment) -> std::optional<Allocation> {
+  const auto offset = alignUp(_head, alignment);
+  if (offset + size > _capacity) {
+    return std::nullopt;
+  }
+  _head = offset + size;
+  return Allocation{.memory = _memory,
+                    .offset = offset,
+                    .size = size,
+                    .mapped = offsetPointer(_mapped, offset),
+                    .memory_type = _memory_type};
+}
+
+RingPool::RingPool(vk::DeviceMemory memory, vk::DeviceSize capacity, void *mapped, uint32_t memory_type)
+    : _memory(memory), _capacity(capacity), _mapped(mapped), _memory_type(memory_type) {}
+
+auto RingPool::Allocate(vk::DeviceSize size, vk::DeviceSize alignment) -> std::optional<Allocation> {
+  if (size > _capacity) {
+    return std::nullopt;
+  }
+
+  auto offset = alignUp(_head, alignment);
+  vk::DeviceSize padding = 0;
+  // Free space is [head, tail) once the head has wrapped around behind the tail
+  const bool head_behind_tail = _head < _tail || (_head == _tail && GetUsed() > 0);
+  if (head_behind_tail) {
+    if (offset + size > _tail) {
+      return std::nullopt;
+    }
+    padding = offset - _head;
+  } else if (offset + size <= _capacity) {
+    padding = offset - _head;
+  } else {
+    // Wrap around and waste the end of the ring
+    if (size > _tail) {
+      return std::nullopt;
+    }
+    padding = _capacity - _head;
+    offset = 0;
+  }
+
+  _total_allocated += padding + size;
+  _head = offset + size;
+  return Allocation{.memory = _memory,
+                    .offset = offset,
+                    .size = size,
+                    .mapped = offsetPointer(_mapped, offset),
+                    .memory_type = _memory_type};
+}
+
+void RingPool::EndFrame(uint64_t frame) {
+  _frames.push_back(FrameMarker{.frame = frame, .head = _head, .total_allocated = _total_allocated});
+}
+
+void RingPool::ReleaseFrames(uint64_t completed_frame) {
+  while (!_frames.empty() && _frames.front().frame <= completed_frame) {
+    _tail = _frames.front().head;
+    _total_released = _frames.front().total_allocated;
+    _frames.pop_front();
+  }
+}
+
+MemoryAllocator::MemoryAllocator(vk::Device device, const PhysicalDevice &physical_device,
+                                 MemoryAllocatorConfig config)
+    : _device(device), _physical_device(&physical_device), _config(config) {
+  const auto &limits = physical_device.GetProperties().limits;
+  // Rounding every sub-allocation up to the granularity keeps linear and optimal resources off shared pages
+  _min_block_size = std::bit_ceil(std::max<vk::DeviceSize>(256, limits.bufferImageGranularity));
+  _non_coherent_atom_size = std::max<vk::DeviceSize>(1, limits.nonCoherentAtomSize);
+  _config.block_size = std::bit_ceil(std::max(_config.block_size, _min_block_size));
+}
+
+MemoryAllocator::~MemoryAllocator() {
+  const std::scoped_lock lock(_mutex);
+
+  if (!_allocations.empty()) {
+    RENDY_LOG_WARN("Destroying memory allocator with {} live allocations", _allocations.size());
+  }
+  for (const auto &[allocation, owned] : _allocations) {
+    if (allocation->dedicated) {
+      freeDeviceMemory(allocation->memory);
+    }
+  }
+  for (auto &pool : _pools) {
+    for (const auto &block : pool) {
+      freeDeviceMemory(block->memory);
+    }
+  }
+  for (const auto &pool_memory : _pool_memories) {
+    freeDeviceMemory(pool_memory.memory);
+  }
+}
+
+auto MemoryAllocator::Allocate(const vk::MemoryRequirements &requirements, const AllocationCreateInfo &create_info)
+    -> Allocation * {
+  return allocate(requirements, create_info, false, nullptr);
+}
+
+auto MemoryAllocator::AllocateForBuffer(vk::Buffer buffer, const AllocationCreateInfo &create_info) -> Allocation * {
+  const auto requirements =
+      _device.getBufferMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+          vk::BufferMemoryRequirementsInfo2{.buffer = buffer});
+  const auto &dedicated_requirements = requirements.get<vk::MemoryDedicatedRequirements>();
+  const vk::MemoryDedicatedAllocateInfo dedicated_info{.buffer = buffer};
+
+  auto *allocation = allocate(requirements.get<vk::MemoryRequirements2>().memoryRequirements, create_info,
+                              dedicated_requirements.prefersDedicatedAllocation == vk::True ||
+                                  dedicated_requirements.requiresDedicatedAllocation == vk::True,
+                              &dedicated_info);
+  if (allocation != nullptr) {
+    VkCheck(_device.bindBufferMemory(buffer, allocation->memory, allocation->offset), "Failed to bind buffer memory.");
+  }
+  return allocation;
+}
+
+auto MemoryAllocator::AllocateForImage(vk::Image image, const AllocationCreateInfo &create_info) -> Allocation * {
+  const auto requirements =
+      _device.getImageMemoryRequirements2<vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+          vk::ImageMemoryRequirementsInfo2{.image = image});
+  const auto &dedicated_requirements = requirements.get<vk::MemoryDedicatedRequirements>();
+  const vk::MemoryDedicatedAllocateInfo dedicated_info{.image = image};
+
+  auto *allocation = allocate(requirements.get<vk::MemoryRequirements2>().memoryRequirements, create_info,
+                              dedicated_requirements.prefersDedicatedAllocation == vk::True ||
+                                  dedicated_requirements.requiresDedicatedAllocation == vk::True,
+                              &dedicated_info);
+  if (allocation != nullptr) {
+    VkCheck(_device.bindImageMemory(image, allocation->memory, allocation->offset), "Failed to bind image memory.");
+  }
+  return allocation;
+}
+
+void MemoryAllocator::Free(Allocation *allocation) {
+  if (allocation == nullptr) {
+    return;
+  }
+
+  const std::scoped_lock lock(_mutex);
+  if (allocation->dedicated) {
+    freeDeviceMemory(allocation->memory);
+  } else {
+    auto *block = allocation->block;
+    block->Free(allocation->offset, allocation->order);
+    block->allocations.erase(allocation);
+    block->bytes_used -= allocation->size;
+    if (block->IsEmpty()) {
+      releaseEmptyBlocks(block->memory_type);
+    }
+  }
+  _allocations.erase(allocation);
+}
+
+auto MemoryAllocator::CreateLinearPool(vk::DeviceSize size, const AllocationCreateInfo &create_info,
+                                       uint32_t memory_type_bits) -> std::unique_ptr<LinearPool> {
+  const std::scoped_lock lock(_mutex);
+  const auto pool_memory = createPoolMemory(size, create_info, memory_type_bits);
+  if (!pool_memory.has_value()) {
+    return nullptr;
+  }
+  return std::make_unique<LinearPool>(pool_memory->memory, size, pool_memory->mapped, pool_memory->memory_type);
+}
+
+auto MemoryAllocator::CreateRingPool(vk::DeviceSize size, const AllocationCreateInfo &create_info,
+                                     uint32_t memory_type_bits) -> std::unique_ptr<RingPool> {
+  const std::scoped_lock lock(_mutex);
+  const auto pool_memory = createPoolMemory(size, create_info, memory_type_bits);
+  if (!pool_memory.has_value()) {
+    return nullptr;
+  }
+  return std::make_unique<RingPool>(pool_memory->memory, size, pool_memory->mapped, pool_memory->memory_type);
+}
+
+void MemoryAllocator::DestroyPool(vk::DeviceMemory pool_memory) {
+  const std::scoped_lock lock(_mutex);
+  const auto it = std::ranges::find(_pool_memories, pool_memory, &PoolMemory::memory);
+  if (it == _pool_memories.end()) {
+    RENDY_LOG_ERROR("Tried to destroy a memory pool that was not created by this allocator");
+    return;
+  }
+  freeDeviceMemory(it->memory);
+  _pool_memories.erase(it);
+}
+
+void MemoryAllocator::Flush(const Allocation &allocation, vk::DeviceSize offset, vk::DeviceSize size) const {
+  if (isHostCoherent(allocation.memory_type)) {
+    return;
+  }
+  VkCheck(_device.flushMappedMemoryRanges(alignedRange(allocation, offset, size)), "Failed to flush mapped memory.");
+}
+
+void MemoryAllocator::Invalidate(const Allocation &allocation, vk::DeviceSize offset, vk::DeviceSize size) const {
+  if (isHostCoherent(allocation.memory_type)) {
+    return;
+  }
+  VkCheck(_device.invalidateMappedMemoryRanges(alignedRange(allocation, offset, size)),
+          "Failed to invalidate mapped memory.");
+}
+
+auto MemoryAllocator::BeginDefragmentation(vk::DeviceSize max_bytes) -> std::vector<DefragmentationMove> {
+  const std::scoped_lock lock(_mutex);
+
+  std::vector<DefragmentationMove> moves;
+  vk::DeviceSize moved_bytes = 0;
+
+  for (auto &pool : _pools) {
+    if (pool.size() < 2) {
+      continue;
+    }
+
+    // Densest blocks first; allocations move from the back of the list towards the front
+    std::vector<MemoryBlock *> blocks;
+    blocks.reserve(pool.size());
+    for (const auto &block : pool) {
+      blocks.push_back(block.get());
+    }
+    std::ranges::sort(blocks, std::ranges::greater{}, &MemoryBlock::bytes_used);
+
+    for (auto src_index = blocks.size() - 1; src_index > 0; src_index--) {
+      const auto *src_block = blocks[src_index];
+      for (auto *allocation : src_block->allocations) {
+        const auto reserved_size = src_block->OrderSize(allocation->order);
+        if (!allocation->movable || moved_bytes + reserved_size > max_bytes) {
+          continue;
+        }
+
+        for (size_t dst_index = 0; dst_index < src_index; dst_index++) {
+          auto *dst_block = blocks[dst_index];
+          if (const auto dst_offset = dst_block->Allocate(allocation->order); dst_offset.has_value()) {
+            dst_block->pending_moves++;
+            moved_bytes += reserved_size;
+            moves.push_back(DefragmentationMove{.allocation = allocation,
+                                                .src_memory = allocation->memory,
+                                                .src_offset = allocation->offset,
+                                                .dst_memory = dst_block->memory,
+                                                .dst_offset = dst_offset.value(),
+                                                .size = allocation->size,
+                                                .dst_block = dst_block});
+            break;
+          }
+        }
+      }
+    }
+  }
+
+  if (!moves.empty()) {
+    RENDY_LOG_INFO("Defragmentation planned {} moves ({} bytes)", moves.size(), moved_bytes);
+  }
+  return moves;
+}
+
+void MemoryAllocator::EndDefragmentation(std::span<const DefragmentationMove> moves) {
+  const std::scoped_lock lock(_mutex);
+
+  std::set<uint32_t> touched_types;
+  for (const auto &move : moves) {
+    auto *allocation = move.allocation;
+    auto *src_block = allocation->block;
+    auto *dst_block = move.dst_block;
+
+    src_block->Free(allocation->offset, allocation->order);
+    src_block->allocations.erase(allocation);
+    src_block->bytes_used -= allocation->size;
+
+    allocation->memory = move.dst_memory;
+    allocation->offset = move.dst_offset;
+    allocation->mapped = offsetPointer(dst_block->mapped, move.dst_offset);
+    allocation->block = dst_block;
+
+    dst_block->allocations.insert(allocation);
+    dst_block->bytes_used += allocation->size;
+    dst_block->pending_moves--;
+    touched_types.insert(allocation->memory_type);
+  }
+
+  for (const auto memory_type : touched_types) {
+    releaseEmptyBlocks(memory_type);
+  }
+}
+
+auto MemoryAllocator::GetStatistics() const -> MemoryStatistics {
+  const std::scoped_lock lock(_mutex);
+
+  MemoryStatistics statistics{};
+  std::array<vk::DeviceSize, VK_MAX_MEMORY_TYPES> free_bytes{};
+  vk::DeviceSize total_free_bytes = 0;
+
+  for (uint32_t memory_type = 0; memory_type < VK_MAX_MEMORY_TYPES; memory_type++) {
+    auto &type_statistics = statistics.memory_types.at(memory_type);
+    for (const auto &block : _pools.at(memory_type)) {
+      type_statistics.block_count++;
+      type_statistics.allocation_count += static_cast<uint32_t>(block->allocations.size());
+      type_statistics.bytes_reserved += block->size;
+      type_statistics.bytes_used += block->bytes_used;
+      type_statistics.largest_free_range = std::max(type_statistics.largest_free_range, block->LargestFreeRange());
+      free_bytes.at(memory_type) += block->FreeBytes();
+    }
+  }
+
+  for (const auto &[allocation, owned] : _allocations) {
+    if (allocation->dedicated) {
+      auto &type_statistics = statistics.memory_types.at(allocation->memory_type);
+      type_statistics.allocation_count++;
+      type_statistics.dedicated_allocation_count++;
+      type_statistics.bytes_reserved += allocation->size;
+      type_statistics.bytes_used += allocation->size;
+    }
+  }
+
+  for (const auto &pool_memory : _pool_memories) {
+    auto &type_statistics = statistics.memory_types.at(pool_memory.memory_type);
+    type_statistics.bytes_reserved += pool_memory.size;
+    type_statistics.bytes_used += pool_memory.size;
+  }
+
+  auto &total = statistics.total;
+  for (uint32_t memory_type = 0; memory_type < VK_MAX_MEMORY_TYPES; memory_type++) {
+    auto &type_statistics = statistics.memory_types.at(memory_type);
+    const auto type_free_bytes = free_bytes.at(memory_type);
+    if (type_free_bytes > 0) {
+      type_statistics.fragmentation =
+          1.0F - static_cast<float>(type_statistics.largest_free_range) / static_cast<float>(type_free_bytes);
+    }
+
+    total.block_count += type_statistics.block_count;
+    total.allocation_count += type_statistics.allocation_count;
+    total.dedicated_allocation_count += type_statistics.dedicated_allocation_count;
+    total.bytes_reserved += type_statistics.bytes_reserved;
+    total.bytes_used += type_statistics.bytes_used;
+    total.largest_free_range = std::max(total.largest_free_range, type_statistics.largest_free_range);
+    total_free_bytes += type_free_bytes;
+  }
+  if (total_free_bytes > 0) {
+    total.fragmentation = 1.0F - static_cast<float>(total.largest_free_range) / static_cast<float>(total_free_bytes);
+  }
+  statistics.device_memory_count = _device_memory_count;
+
+  return statistics;
+}
+
+auto MemoryAllocator::GetMemoryTypeFlags(uint32_t memory_type) const -> vk::MemoryPropertyFlags {
+  return _physical_device->GetMemoryProperties().memoryTypes.at(memory_type).propertyFlags;
+}
+
+auto MemoryAllocator::findMemoryType(uint32_t type_bits, const AllocationCreateInfo &create_info) const
+    -> std::optional<uint32_t> {
+  if (const auto memory_type =
+          _physical_device->FindMemoryType(type_bits, create_info.required_flags | create_info.preferred_flags);
+      memory_type.has_value()) {
+    return memory_type;
+  }
+  return _physical_device->FindMemoryType(type_bits, create_info.required_flags);
+}
+
+auto MemoryAllocator::allocateDeviceMemory(vk::DeviceSize size, uint32_t memory_type, const void *p_next)
+    -> std::optional<std::pair<vk::DeviceMemory, void *>> {
+  const auto max_allocations = _physical_device->GetProperties().limits.maxMemoryAllocationCount;
+  if (_device_memory_count >= max_allocations) {
+    RENDY_LOG_ERROR("Reached maxMemoryAllocationCount ({})", max_allocations);
+    return std::nullopt;
+  }
+
+  const vk::MemoryAllocateFlagsInfo flags_info{.pNext = p_next, .flags = vk::MemoryAllocateFlagBits::eDeviceAddress};
+  const auto memory_result = _device.allocateMemory(
+      vk::MemoryAllocateInfo{.pNext = _config.device_address ? &flags_info : p_next,
+                             .allocationSize = size,
+                             .memoryTypeIndex = memory_type});
+  if (memory_result.result != vk::Result::eSuccess) {
+    RENDY_LOG_ERROR("Failed to allocate {} bytes from memory type {}: {}", size, memory_type,
+                    vk::to_string(memory_result.result));
+    return std::nullopt;
+  }
+
+  void *mapped = nullptr;
+  if (GetMemoryTypeFlags(memory_type) & vk::MemoryPropertyFlagBits::eHostVisible) {
+    mapped = VkCheckAndUnwrap(_device.mapMemory(memory_result.value, 0, vk::WholeSize), "Failed to map memory.");
+  }
+
+  _device_memory_count++;
+  return std::pair{memory_result.value, mapped};
+}
+
+void MemoryAllocator::freeDeviceMemory(vk::DeviceMemory memory) {
+  _device.freeMemory(memory);
+  _device_memory_count--;
+}
+
+auto MemoryAllocator::blockSizeFor(uint32_t memory_type) const -> vk::DeviceSize {
+  const auto &memory_properties = _physical_device->GetMemoryProperties();
+  const auto heap_size =
+      memory_properties.memoryHeaps.at(memory_properties.memoryTypes.at(memory_type).heapIndex).size;
+  // Small heaps (e.g. the 256MB BAR window) would be exhausted by a few full sized blocks
+  if (heap_size <= kSmallHeapSize) {
+    return std::max(_min_block_size, std::min(_config.block_size, std::bit_floor(heap_size / 8)));
+  }
+  return _config.block_size;
+}
+
+auto MemoryAllocator::allocateFromPools(const vk::MemoryRequirements &requirements, uint32_t memory_type,
+                                        const AllocationCreateInfo &create_info) -> Allocation * {
+  auto &pool = _pools.at(memory_type);
+  const auto request_size = std::max({requirements.size, requirements.alignment, _min_block_size});
+
+  const auto track = [&](MemoryBlock &block, vk::DeviceSize offset, uint32_t order) {
+    auto allocation = std::make_unique<Allocation>(Allocation{.memory = block.memory,
+                                                              .offset = offset,
+                                                              .size = requirements.size,
+                                                              .mapped = offsetPointer(block.mapped, offset),
+                                                              .memory_type = memory_type,
+                                                              .dedicated = false,
+                                                              .movable = create_info.movable,
+                                                              .block = &block,
+                                                              .order = order});
+    auto *handle = allocation.get();
+    block.allocations.insert(handle);
+    block.bytes_used += requirements.size;
+    _allocations.emplace(handle, std::move(allocation));
+    return handle;
+  };
+
+  for (const auto &block : pool) {
+    const auto order = block->OrderFor(request_size);
+    if (!order.has_value()) {
+      continue;
+    }
+    if (const auto offset = block->Allocate(order.value()); offset.has_value()) {
+      return track(*block, offset.value(), order.value());
+    }
+  }
+
+  const auto block_size = blockSizeFor(memory_type);
+  if (request_size > block_size) {
+    return nullptr;
+  }
+  const auto memory = allocateDeviceMemory(block_size, memory_type, nullptr);
+  if (!memory.has_value()) {
+    return nullptr;
+  }
+  auto &block = pool.emplace_back(
+      std::make_unique<MemoryBlock>(memory->first, block_size, _min_block_size, memory->second, memory_type));
+  RENDY_LOG_DEBUG("Created {} byte memory block for memory type {}", block_size, memory_type);
+
+  const auto order = block->OrderFor(request_size).value();
+  return track(*block, block->Allocate(order).value(), order);
+}
+
+auto MemoryAllocator::allocateDedicated(const vk::MemoryRequirements &requirements, uint32_t memory_type,
+                                        const AllocationCreateInfo &create_info,
+                                        const vk::MemoryDedicatedAllocateInfo *dedicated_info) -> Allocation * {
+  const auto memory = allocateDeviceMemory(requirements.size, memory_type, dedicated_info);
+  if (!memory.has_value()) {
+    return nullptr;
+  }
+  auto allocation = std::make_unique<Allocation>(Allocation{.memory = memory->first,
+                                                            .offset = 0,
+                                                            .size = requirements.size,
+                                                            .mapped = memory->second,
+                                                            .memory_type = memory_type,
+                                                            .dedicated = true,
+                                                            .movable = create_info.movable});
+  auto *handle = allocation.get();
+  _allocations.emplace(handle, std::move(allocation));
+  return handle;
+}
+
+auto MemoryAllocator::allocate(const vk::MemoryRequirements &requirements, const AllocationCreateInfo &create_info,
+                               bool prefers_dedicated, const vk::MemoryDedicatedAllocateInfo *dedicated_info)
+    -> Allocation * {
+  const std::scoped_lock lock(_mutex);
+
+  const auto memory_type = findMemoryType(requirements.memoryTypeBits, create_info);
+  if (!memory_type.has_value()) {
+    RENDY_LOG_ERROR("No memory type matches the requested properties ({})", vk::to_string(create_info.required_flags));
+    return nullptr;
+  }
+
+  const bool dedicated = create_info.dedicated || prefers_dedicated ||
+                         requirements.size > blockSizeFor(memory_type.value()) / _config.dedicated_threshold_divisor;
+  if (!dedicated) {
+    if (auto *allocation = allocateFromPools(requirements, memory_type.value(), create_info); allocation != nullptr) {
+      return allocation;
+    }
+  }
+  return allocateDedicated(requirements, memory_type.value(), create_info, dedicated_info);
+}
+
+auto MemoryAllocator::createPoolMemory(vk::DeviceSize size, const AllocationCreateInfo &create_info,
+                                       uint32_t memory_type_bits) -> std::optional<PoolMemory> {
+  const auto memory_type = findMemoryType(memory_type_bits, create_info);
+  if (!memory_type.has_value()) {
+    RENDY_LOG_ERROR("No memory type matches the requested pool properties ({})",
+                    vk::to_string(create_info.required_flags));
+    return std::nullopt;
+  }
+  const auto memory = allocateDeviceMemory(size, memory_type.value(), nullptr);
+  if (!memory.has_value()) {
+    return std::nullopt;
+  }
+  return _pool_memories.emplace_back(
+      PoolMemory{.memory = memory->first, .size = size, .mapped = memory->second, .memory_type = memory_type.value()});
+}
+
+void MemoryAllocator::releaseEmptyBlocks(uint32_t memory_type) {
+  auto &pool = _pools.at(memory_type);
+  // Keep one empty block around so a free/allocate pattern doesn't keep hitting vkAllocateMemory
+  bool kept_empty = false;
+  std::erase_if(pool, [&](const std::unique_ptr<MemoryBlock> &block) {
+    if (!block->IsEmpty()) {
+      return false;
+    }
+    if (!kept_empty) {
+      kept_empty = true;
+      return false;
+    }
+    freeDeviceMemory(block->memory);
+    return true;
+  });
+}
+
+auto MemoryAllocator::isHostCoherent(uint32_t memory_type) const -> bool {
+  return static_cast<bool>(GetMemoryTypeFlags(memory_type) & vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+auto MemoryAllocator::alignedRange(const Allocation &allocation, vk::DeviceSize offset, vk::DeviceSize size) const
+    -> vk::MappedMemoryRange {
+  const auto begin = allocation.offset + offset;
+  const auto aligned_begin = alignDown(begin, _non_coherent_atom_size);
+  const auto end = size == vk::WholeSize ? allocation.offset + allocation.size : begin + size;
+  auto aligned_size = alignUp(end - aligned_begin, _non_coherent_atom_size);
+  // Rounding up must not run past the end of the vk::DeviceMemory, whose size is only known for blocks
+  if (allocation.block == nullptr || aligned_begin + aligned_size > allocation.block->size) {
+    aligned_size = vk::WholeSize;
+  }
+  return vk::MappedMemoryRange{.memory = allocation.memory, .offset = aligned_begin, .size = aligned_size};
+}
+
+} // namespace rendy::graphics::vulkan
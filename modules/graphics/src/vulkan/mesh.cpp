@@ -0,0 +1,62 @@
+#include "vulkan/mesh.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/upload_context.hpp"
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+auto usageFor(core::MeshSection section) -> core::BufferUsage {
+  switch (section) {
+  case core::MeshSection::Positions:
+  case core::MeshSection::Attributes:
+    return core::BufferUsage::Vertex | core::BufferUsage::Storage;
+  case core::MeshSection::Indices:
+    return core::BufferUsage::Index | core::BufferUsage::Storage;
+  default:
+    return core::BufferUsage::Storage;
+  }
+}
+
+} // namespace
+
+auto VulkanMesh::Initialize(const VulkanDevice &device, const core::MeshFile &file) -> bool {
+  _header = file.GetHeader();
+  const auto lods = file.GetLods();
+  _lods.assign(lods.begin(), lods.end());
+
+  for (size_t index = 0; index < _buffers.size(); ++index) {
+    const auto section = static_cast<core::MeshSection>(index);
+    const auto data = file.GetSection(section);
+    if (data.empty()) {
+      continue;
+    }
+    auto buffer = std::make_unique<VulkanBuffer>();
+    if (!buffer->Initialize(device, core::BufferDesc{.size = data.size(),
+                                                     .usage = usageFor(section),
+                                                     .memory_usage = core::MemoryUsage::GpuOnly})) {
+      RENDY_LOG_ERROR("Failed to create a buffer for mesh section {}", index);
+      Destroy();
+      return false;
+    }
+    // Copies from the mapping into the staging ring, faulting the pages in as it goes
+    buffer->Upload(data);
+    _buffers.at(index) = std::move(buffer);
+  }
+  _upload_value = device.GetUploadContext().Flush();
+  return true;
+}
+
+void VulkanMesh::Destroy() {
+  for (auto &buffer : _buffers) {
+    if (buffer) {
+      buffer->Destroy();
+      buffer.reset();
+    }
+  }
+  _lods.clear();
+  _upload_value = 0;
+}
+
+} // namespace rendy::graphics::vulkan
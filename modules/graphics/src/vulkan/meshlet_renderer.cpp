@@ -0,0 +1,392 @@
+#include "vulkan/meshlet_renderer.hpp"
+#include "common/log.hpp"
+#include "vulkan/command_list.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/frame_scheduler.hpp"
+#include "vulkan/mesh.hpp"
+#include "vulkan/physical_device.hpp"
+#include "vulkan/shader_library.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+using Row = std::array<float, 4>;
+
+// Mirror MeshletFrame and MeshletDraw in assets/include/meshlet_common.slang
+struct GpuFrame {
+  std::array<Row, 4> view_projection;
+  std::array<Row, 6> frustum;
+  Row camera_position;
+};
+
+struct GpuDraw {
+  std::array<Row, 3> model;
+  Row position_offset; // w holds the largest axis scale of the model
+  Row position_scale;
+  uint32_t meshlet_offset;
+  uint32_t meshlet_count;
+  uint32_t visible_offset;
+  uint32_t padding;
+};
+static_assert(sizeof(GpuDraw) == 96);
+
+// Mirrors MeshletParams, the push constants of every meshlet shader
+struct GpuParams {
+  vk::DeviceAddress frame;
+  vk::DeviceAddress draws;
+  vk::DeviceAddress positions;
+  vk::DeviceAddress attributes;
+  vk::DeviceAddress meshlets;
+  vk::DeviceAddress meshlet_vertices;
+  vk::DeviceAddress meshlet_triangles;
+  vk::DeviceAddress meshlet_bounds;
+  vk::DeviceAddress visible_meshlets;
+  uint32_t draw;
+  uint32_t padding;
+};
+static_assert(sizeof(GpuParams) == 80);
+
+// Outputs of meshlet_cull.slang, which stay descriptors for their atomics
+constexpr uint32_t kVisibleBinding = 0;
+constexpr uint32_t kCommandsBinding = 1;
+
+constexpr uint32_t kCullGroupSize = 64;
+// Meshlets culled by one task workgroup, mirrors meshlet_mesh.slang
+constexpr uint32_t kTaskGroupSize = 32;
+// The frame constants, the draws and the initial indirect commands each start on this alignment within a frame slot.
+// Storage buffer offsets never need more.
+constexpr vk::DeviceSize kFrameAlignment = 256;
+static_assert(sizeof(GpuFrame) <= kFrameAlignment);
+
+auto alignUp(vk::DeviceSize value, vk::DeviceSize alignment) -> vk::DeviceSize {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+auto rowOf(const std::array<float, 16> &matrix, size_t row) -> Row {
+  return {matrix.at(row * 4), matrix.at((row * 4) + 1), matrix.at((row * 4) + 2), matrix.at((row * 4) + 3)};
+}
+
+// frame is the address of the frame slot, the draws follow it
+auto toGpuParams(const VulkanMesh &mesh, vk::DeviceAddress frame, vk::DeviceAddress visible_meshlets, uint32_t draw)
+    -> GpuParams {
+  const auto address = [&mesh](core::MeshSection section) -> vk::DeviceAddress {
+    const auto *buffer = mesh.GetBuffer(section);
+    return buffer != nullptr ? buffer->GetDeviceAddress() : 0;
+  };
+  return {.frame = frame,
+          .draws = frame + kFrameAlignment,
+          .positions = address(core::MeshSection::Positions),
+          .attributes = address(core::MeshSection::Attributes),
+          .meshlets = address(core::MeshSection::Meshlets),
+          .meshlet_vertices = address(core::MeshSection::MeshletVertices),
+          .meshlet_triangles = address(core::MeshSection::MeshletTriangles),
+          .meshlet_bounds = address(core::MeshSection::MeshletBounds),
+          .visible_meshlets = visible_meshlets,
+          .draw = draw,
+          .padding = 0};
+}
+
+auto toGpuDraw(const VulkanMesh &mesh, const std::array<float, 16> &model, uint32_t meshlet_offset,
+               uint32_t meshlet_count, uint32_t visible_offset) -> GpuDraw {
+  // Bounding spheres scale with the longest axis of the model
+  float max_scale_squared = 0.0F;
+  for (size_t column = 0; column < 3; ++column) {
+    const auto x = model.at(column);
+    const auto y = model.at(4 + column);
+    const auto z = model.at(8 + column);
+    max_scale_squared = std::max(max_scale_squared, (x * x) + (y * y) + (z * z));
+  }
+  const auto &header = mesh.GetHeader();
+  return {.model = {rowOf(model, 0), rowOf(model, 1), rowOf(model, 2)},
+          .position_offset = {header.position_offset[0], header.position_offset[1], header.position_offset[2],
+                              std::sqrt(max_scale_squared)},
+          .position_scale = {header.position_scale[0], header.position_scale[1], header.position_scale[2], 0.0F},
+          .meshlet_offset = meshlet_offset,
+          .meshlet_count = meshlet_count,
+          .visible_offset = visible_offset,
+          .padding = 0};
+}
+
+} // namespace
+
+auto MeshletRenderer::Initialize(const VulkanDevice &device, PipelineCompiler &compiler, ShaderLibrary &shader_library,
+                                 const FrameScheduler &scheduler, const MeshletRendererConfig &config) -> bool {
+  _device = &device;
+  _compiler = &compiler;
+  _scheduler = &scheduler;
+  _config = config;
+  _path = device.GetCapabilities().mesh_shader_support && !config.force_emulation ? MeshletPath::MeshShader
+                                                                                  : MeshletPath::Emulated;
+  const bool emulated = _path == MeshletPath::Emulated;
+
+  _shader = shader_library.Load(emulated ? "meshlet_draw" : "meshlet_mesh");
+  const auto cull_shader = emulated ? shader_library.Load("meshlet_cull") : nullptr;
+  if (_shader == nullptr || (emulated && cull_shader == nullptr)) {
+    RENDY_LOG_ERROR("Meshlet shaders failed to load");
+    _shader.reset();
+    _device = nullptr;
+    return false;
+  }
+  if (!build()) {
+    _shader.reset();
+    _device = nullptr;
+    return false;
+  }
+  const std::array specialization{SpecializationConstant{.id = 0, .value = kCullGroupSize}};
+  if (emulated && !_cull_kernel.Initialize(device, compiler, cull_shader, "cullMeshlets", specialization)) {
+    Destroy();
+    return false;
+  }
+
+  const auto storage_alignment = device.GetPhysicalDevice().GetProperties().limits.minStorageBufferOffsetAlignment;
+  const auto command_stride = sizeof(vk::DrawIndirectCommand);
+  _commands_offset = alignUp(kFrameAlignment + (vk::DeviceSize{config.max_draws} * sizeof(GpuDraw)), kFrameAlignment);
+  const auto frame_size = _commands_offset + (emulated ? vk::DeviceSize{config.max_draws} * command_stride : 0);
+  _frame_stride = alignUp(frame_size, std::max(storage_alignment, kFrameAlignment));
+
+  if (!_frame_buffer.Initialize(device, {.size = _frame_stride * scheduler.GetFramesInFlight(),
+                                         .usage = core::BufferUsage::Storage | core::BufferUsage::TransferSrc,
+                                         .memory_usage = core::MemoryUsage::Upload}) ||
+      (emulated &&
+       (!_commands_buffer.Initialize(device, {.size = vk::DeviceSize{config.max_draws} * command_stride,
+                                              .usage = core::BufferUsage::Storage | core::BufferUsage::Indirect |
+                                                       core::BufferUsage::TransferDst,
+                                              .memory_usage = core::MemoryUsage::GpuOnly}) ||
+        !_visible_buffer.Initialize(device, {.size = vk::DeviceSize{config.max_meshlets} * sizeof(uint32_t),
+                                             .usage = core::BufferUsage::Storage,
+                                             .memory_usage = core::MemoryUsage::GpuOnly})))) {
+    Destroy();
+    return false;
+  }
+
+  _pending.reserve(config.max_draws);
+  _draws.reserve(config.max_draws);
+  RENDY_LOG_INFO("Meshlet renderer: {} path, {} draws", emulated ? "emulated" : "mesh shader", config.max_draws);
+  return true;
+}
+
+void MeshletRenderer::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  // The layout must outlive a compilation that is still running
+  static_cast<void>(_pipeline.Wait());
+  destroyLayout();
+  _pipeline = {};
+  _cull_kernel.Destroy();
+  _frame_buffer.Destroy();
+  _commands_buffer.Destroy();
+  _visible_buffer.Destroy();
+  _shader.reset();
+  _pending.clear();
+  _pending_meshlets = 0;
+  _draws.clear();
+  _culled = false;
+  _device = nullptr;
+}
+
+auto MeshletRenderer::Submit(const VulkanMesh &mesh, const MeshletInstance &instance) -> bool {
+  const auto lods = mesh.GetLods();
+  if (_pending.size() >= _config.max_draws || lods.empty() ||
+      mesh.GetBuffer(core::MeshSection::Meshlets) == nullptr) {
+    return false;
+  }
+  const auto &lod = lods[std::min<size_t>(instance.lod, lods.size() - 1)];
+  if (_path == MeshletPath::Emulated && uint64_t{_pending_meshlets} + lod.meshlet_count > _config.max_meshlets) {
+    return false;
+  }
+  _pending.push_back(Draw{.mesh = &mesh,
+                          .model = instance.model,
+                          .meshlet_offset = lod.meshlet_offset,
+                          .meshlet_count = lod.meshlet_count,
+                          .visible_offset = _pending_meshlets});
+  _pending_meshlets += lod.meshlet_count;
+  return true;
+}
+
+void MeshletRenderer::AddCullPass(RenderGraph &graph) {
+  refresh();
+  _draws.swap(_pending);
+  _pending.clear();
+  _pending_meshlets = 0;
+  _commands_handle = {};
+  _visible_handle = {};
+  _culled = false;
+  writeFrame();
+  if (_path == MeshletPath::MeshShader || _draws.empty()) {
+    return;
+  }
+
+  _commands_handle = graph.ImportBuffer("Meshlet Draws", _commands_buffer.Get(), _commands_buffer.GetDesc().size);
+  _visible_handle = graph.ImportBuffer("Visible Meshlets", _visible_buffer.Get(), _visible_buffer.GetDesc().size);
+  graph.AddPass("Meshlet Culling", PassType::Compute)
+      .Write(_commands_handle, ResourceAccess::TransferWrite)
+      .Write(_commands_handle, ResourceAccess::StorageWrite)
+      .Write(_visible_handle, ResourceAccess::StorageWrite)
+      .SetExecute([this](PassContext &context) { recordCull(context.command_list); });
+}
+
+void MeshletRenderer::ReadDraws(RenderGraphPass &pass) const {
+  if (_commands_handle.IsValid()) {
+    pass.Read(_commands_handle, ResourceAccess::IndirectRead).Read(_visible_handle, ResourceAccess::StorageRead);
+  }
+}
+
+void MeshletRenderer::RecordDraws(VulkanCommandList &command_list) const {
+  const auto *pipeline = _pipeline.TryGet();
+  const bool emulated = _path == MeshletPath::Emulated;
+  if (pipeline == nullptr || _draws.empty() || (emulated && !_culled)) {
+    return;
+  }
+
+  const auto command_buffer = command_list.Get();
+  command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline->Get());
+  const auto command_stride = VkToU32(sizeof(vk::DrawIndirectCommand));
+  const auto frame = _frame_buffer.GetDeviceAddress() + _frame_offset;
+  const auto visible_meshlets = emulated ? _visible_buffer.GetDeviceAddress() : 0;
+  for (uint32_t index = 0; index < _draws.size(); ++index) {
+    const auto &draw = _draws[index];
+    // Everything is read through addresses, so a draw only updates its push constants
+    const auto params = toGpuParams(*draw.mesh, frame, visible_meshlets, index);
+    command_buffer.pushConstants(pipeline->GetLayout(), _stages, 0, sizeof(params), &params);
+
+    if (emulated) {
+      command_list.DrawIndirect(_commands_buffer, uint64_t{index} * command_stride, 1, command_stride);
+    } else {
+      command_list.DrawMeshTasks((draw.meshlet_count + kTaskGroupSize - 1) / kTaskGroupSize);
+    }
+  }
+}
+
+auto MeshletRenderer::IsReady() const -> bool {
+  return _pipeline.IsReady() && (_path == MeshletPath::MeshShader || _cull_kernel.IsReady());
+}
+
+void MeshletRenderer::writeFrame() {
+  _frame_offset = (_scheduler->GetFrameIndex() % _scheduler->GetFramesInFlight()) * _frame_stride;
+  auto *slot = _frame_buffer.GetMappedData() + _frame_offset;
+
+  const auto &view_projection = _view.view_projection;
+  const GpuFrame frame{
+      .view_projection = {rowOf(view_projection, 0), rowOf(view_projection, 1), rowOf(view_projection, 2),
+                          rowOf(view_projection, 3)},
+      .frustum = ExtractFrustumPlanes(view_projection),
+      .camera_position = {_view.camera_position[0], _view.camera_position[1], _view.camera_position[2], 1.0F}};
+  std::memcpy(slot, &frame, sizeof(frame));
+
+  const bool emulated = _path == MeshletPath::Emulated;
+  // The cull pass grows the vertex count of every command from zero
+  constexpr vk::DrawIndirectCommand kEmptyCommand{.vertexCount = 0, .instanceCount = 1};
+  for (size_t index = 0; index < _draws.size(); ++index) {
+    const auto &draw = _draws[index];
+    const auto gpu_draw =
+        toGpuDraw(*draw.mesh, draw.model, draw.meshlet_offset, draw.meshlet_count, draw.visible_offset);
+    std::memcpy(slot + kFrameAlignment + (index * sizeof(GpuDraw)), &gpu_draw, sizeof(gpu_draw));
+    if (emulated) {
+      std::memcpy(slot + _commands_offset + (index * sizeof(kEmptyCommand)), &kEmptyCommand, sizeof(kEmptyCommand));
+    }
+  }
+  _device->GetAllocator().Flush(*_frame_buffer.GetAllocation(), _frame_offset, _frame_stride);
+}
+
+void MeshletRenderer::recordCull(VulkanCommandList &command_list) {
+  const auto command_buffer = command_list.Get();
+  // The previous frame's draws on this queue may still be reading the commands and the visible list
+  command_list.GlobalBarrier(vk::PipelineStageFlagBits2::eDrawIndirect | vk::PipelineStageFlagBits2::eVertexShader, {},
+                             vk::PipelineStageFlagBits2::eTransfer | vk::PipelineStageFlagBits2::eComputeShader, {});
+  command_buffer.copyBuffer(_frame_buffer.Get(), _commands_buffer.Get(),
+                            vk::BufferCopy{.srcOffset = _frame_offset + _commands_offset,
+                                           .dstOffset = 0,
+                                           .size = _draws.size() * sizeof(vk::DrawIndirectCommand)});
+  command_list.GlobalBarrier(vk::PipelineStageFlagBits2::eTransfer, vk::AccessFlagBits2::eTransferWrite,
+                             vk::PipelineStageFlagBits2::eComputeShader,
+                             vk::AccessFlagBits2::eShaderStorageRead | vk::AccessFlagBits2::eShaderStorageWrite);
+
+  _cull_kernel.Refresh();
+  const auto frame = _frame_buffer.GetDeviceAddress() + _frame_offset;
+  for (uint32_t index = 0; index < _draws.size(); ++index) {
+    const auto &draw = _draws[index];
+    const std::array bindings{
+        ComputeBufferBinding{.binding = kVisibleBinding, .buffer = &_visible_buffer},
+        ComputeBufferBinding{.binding = kCommandsBinding, .buffer = &_commands_buffer},
+    };
+    const auto params = toGpuParams(*draw.mesh, frame, _visible_buffer.GetDeviceAddress(), index);
+    // A draw left uncounted would render nothing, skip the frame's meshlets instead
+    if (!_cull_kernel.Record(command_list, bindings, std::as_bytes(std::span(&params, 1)),
+                             _cull_kernel.GetGroupCount(draw.meshlet_count))) {
+      return;
+    }
+  }
+  _culled = true;
+}
+
+void MeshletRenderer::refresh() {
+  if (_shader->GetVersion() == _shader_version) {
+    return;
+  }
+  static_cast<void>(_pipeline.Wait());
+  const auto previous_layout = _layout;
+  const auto previous = std::exchange(_pipeline, {});
+  if (!build()) {
+    _layout = previous_layout;
+    _pipeline = previous;
+    // Don't retry every frame, the next reload bumps the version again
+    _shader_version = _shader->GetVersion();
+    return;
+  }
+  _device->Get().destroyPipelineLayout(previous_layout);
+}
+
+auto MeshletRenderer::build() -> bool {
+  constexpr std::array<std::string_view, 3> kMeshShaderEntryPoints{"meshletTask", "meshletMesh", "meshletFragment"};
+  constexpr std::array<std::string_view, 2> kEmulatedEntryPoints{"meshletVertex", "meshletFragment"};
+  const auto entry_points = _path == MeshletPath::MeshShader ? std::span<const std::string_view>(kMeshShaderEntryPoints)
+                                                             : std::span<const std::string_view>(kEmulatedEntryPoints);
+  std::vector<ShaderStageDesc> stages;
+  vk::ShaderStageFlags stage_flags;
+  for (const auto entry_point : entry_points) {
+    auto stage = _shader->GetStage(entry_point);
+    if (!stage) {
+      RENDY_LOG_ERROR("Shader {} has no entry point {}", _shader->GetName(), entry_point);
+      return false;
+    }
+    stage_flags |= stage->stage;
+    stages.push_back(std::move(*stage));
+  }
+
+  const auto &reflection = _shader->GetReflection();
+  if (!reflection.bindings.empty()) {
+    RENDY_LOG_ERROR("Meshlet shader {} binds {}, draws read everything through the addresses in their push constants",
+                    _shader->GetName(), reflection.bindings.front().name);
+    return false;
+  }
+  const vk::PushConstantRange push_constant_range{.stageFlags = stage_flags, .offset = 0, .size = sizeof(GpuParams)};
+  _layout = VkCheckAndUnwrap(_device->Get().createPipelineLayout(vk::PipelineLayoutCreateInfo{
+                                 .pushConstantRangeCount = 1, .pPushConstantRanges = &push_constant_range}),
+                             "Failed to create meshlet pipeline layout.");
+
+  _pipeline = _compiler->Request(GraphicsPipelineDesc{.stages = std::move(stages),
+                                                      .layout = _layout,
+                                                      .depth_test = _config.depth_format != vk::Format::eUndefined,
+                                                      .depth_write = _config.depth_format != vk::Format::eUndefined,
+                                                      .color_formats = _config.color_formats,
+                                                      .depth_format = _config.depth_format});
+  _stages = stage_flags;
+  _shader_version = _shader->GetVersion();
+  return true;
+}
+
+void MeshletRenderer::destroyLayout() {
+  _device->Get().destroyPipelineLayout(_layout);
+  _layout = nullptr;
+}
+
+} // namespace rendy::graphics::vulkan
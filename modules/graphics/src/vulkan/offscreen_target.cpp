@@ -0,0 +1,187 @@
+#include "vulkan/offscreen_target.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/utils.hpp"
+#include <cstring>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+auto bytesPerPixel(vk::Format format) -> uint32_t {
+  switch (format) {
+  case vk::Format::eR8G8B8A8Unorm:
+  case vk::Format::eR8G8B8A8Srgb:
+  case vk::Format::eB8G8R8A8Unorm:
+  case vk::Format::eB8G8R8A8Srgb:
+  case vk::Format::eA2B10G10R10UnormPack32:
+    return 4;
+  case vk::Format::eR16G16B16A16Sfloat:
+    return 8;
+  case vk::Format::eR32G32B32A32Sfloat:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+auto accessMaskFor(vk::ImageLayout layout) -> vk::AccessFlags {
+  switch (layout) {
+  case vk::ImageLayout::eColorAttachmentOptimal:
+    return vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite;
+  case vk::ImageLayout::eTransferDstOptimal:
+    return vk::AccessFlagBits::eTransferWrite;
+  case vk::ImageLayout::eTransferSrcOptimal:
+    return vk::AccessFlagBits::eTransferRead;
+  case vk::ImageLayout::eShaderReadOnlyOptimal:
+    return vk::AccessFlagBits::eShaderRead;
+  default:
+    return {};
+  }
+}
+
+} // namespace
+
+auto OffscreenTarget::Initialize(const VulkanDevice &device, vk::Extent2D extent, vk::Format format) -> bool {
+  if (bytesPerPixel(format) == 0) {
+    RENDY_LOG_ERROR("Offscreen target format {} is not supported for readback", vk::to_string(format));
+    return false;
+  }
+
+  _device = &device;
+  _extent = extent;
+  _format = format;
+  _layout = vk::ImageLayout::eUndefined;
+
+  const auto vk_device = device.Get();
+
+  _image = VkCheckAndUnwrap(
+      vk_device.createImage(vk::ImageCreateInfo{
+          .imageType = vk::ImageType::e2D,
+          .format = format,
+          .extent = vk::Extent3D{.width = extent.width, .height = extent.height, .depth = 1},
+          .mipLevels = 1,
+          .arrayLayers = 1,
+          .samples = vk::SampleCountFlagBits::e1,
+          .tiling = vk::ImageTiling::eOptimal,
+          .usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc |
+                   vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
+          .sharingMode = vk::SharingMode::eExclusive,
+          .initialLayout = vk::ImageLayout::eUndefined}),
+      "Failed to create offscreen image.");
+
+  auto &allocator = device.GetAllocator();
+  _image_allocation = allocator.AllocateForImage(
+      _image, AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eDeviceLocal});
+  if (_image_allocation == nullptr) {
+    RENDY_LOG_ERROR("Failed to allocate offscreen image memory");
+    return false;
+  }
+
+  _image_view = VkCheckAndUnwrap(
+      vk_device.createImageView(vk::ImageViewCreateInfo{
+          .image = _image,
+          .viewType = vk::ImageViewType::e2D,
+          .format = format,
+          .subresourceRange = vk::ImageSubresourceRange{
+              .aspectMask = vk::ImageAspectFlagBits::eColor, .levelCount = 1, .layerCount = 1}}),
+      "Failed to create offscreen image view.");
+
+  _readback_buffer = VkCheckAndUnwrap(vk_device.createBuffer(vk::BufferCreateInfo{
+                                          .size = readbackSize(),
+                                          .usage = vk::BufferUsageFlagBits::eTransferDst,
+                                          .sharingMode = vk::SharingMode::eExclusive}),
+                                      "Failed to create offscreen readback buffer.");
+
+  // Cached host memory makes the CPU read of the copied pixels much faster, but it is not always available
+  _readback_allocation = allocator.AllocateForBuffer(
+      _readback_buffer,
+      AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eHostVisible,
+                           .preferred_flags =
+                               vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostCached});
+  if (_readback_allocation == nullptr) {
+    RENDY_LOG_ERROR("Failed to allocate offscreen readback memory");
+    return false;
+  }
+
+  RENDY_LOG_INFO("Created {}x{} offscreen target ({})", extent.width, extent.height, vk::to_string(format));
+  return true;
+}
+
+void OffscreenTarget::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  const auto vk_device = _device->Get();
+  auto &allocator = _device->GetAllocator();
+  vk_device.destroyBuffer(_readback_buffer);
+  allocator.Free(_readback_allocation);
+  vk_device.destroyImageView(_image_view);
+  vk_device.destroyImage(_image);
+  allocator.Free(_image_allocation);
+  _device = nullptr;
+}
+
+void OffscreenTarget::Clear(const std::array<float, 4> &color) {
+  _device->ImmediateSubmit(core::QueueType::Graphics, [&](vk::CommandBuffer command_buffer) {
+    transitionLayout(command_buffer, vk::ImageLayout::eTransferDstOptimal);
+    const vk::ClearColorValue clear_value{.float32 = color};
+    const vk::ImageSubresourceRange range{
+        .aspectMask = vk::ImageAspectFlagBits::eColor, .levelCount = 1, .layerCount = 1};
+    command_buffer.clearColorImage(_image, vk::ImageLayout::eTransferDstOptimal, clear_value, range);
+    transitionLayout(command_buffer, vk::ImageLayout::eColorAttachmentOptimal);
+  });
+}
+
+auto OffscreenTarget::Readback() -> std::vector<std::byte> {
+  _device->ImmediateSubmit(core::QueueType::Graphics, [&](vk::CommandBuffer command_buffer) {
+    const auto previous_layout = _layout;
+    transitionLayout(command_buffer, vk::ImageLayout::eTransferSrcOptimal);
+    const vk::BufferImageCopy region{
+        .imageSubresource = vk::ImageSubresourceLayers{.aspectMask = vk::ImageAspectFlagBits::eColor, .layerCount = 1},
+        .imageExtent = vk::Extent3D{.width = _extent.width, .height = _extent.height, .depth = 1}};
+    command_buffer.copyImageToBuffer(_image, vk::ImageLayout::eTransferSrcOptimal, _readback_buffer, region);
+
+    const vk::BufferMemoryBarrier host_barrier{.srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+                                               .dstAccessMask = vk::AccessFlagBits::eHostRead,
+                                               .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                               .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                               .buffer = _readback_buffer,
+                                               .size = vk::WholeSize};
+    command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, {},
+                                   host_barrier, {});
+    if (previous_layout != vk::ImageLayout::eUndefined) {
+      transitionLayout(command_buffer, previous_layout);
+    }
+  });
+
+  _device->GetAllocator().Invalidate(*_readback_allocation);
+  std::vector<std::byte> pixels(readbackSize());
+  std::memcpy(pixels.data(), _readback_allocation->mapped, pixels.size());
+  return pixels;
+}
+
+void OffscreenTarget::transitionLayout(vk::CommandBuffer command_buffer, vk::ImageLayout new_layout) {
+  if (_layout == new_layout) {
+    return;
+  }
+  const vk::ImageMemoryBarrier barrier{
+      .srcAccessMask = accessMaskFor(_layout),
+      .dstAccessMask = accessMaskFor(new_layout),
+      .oldLayout = _layout,
+      .newLayout = new_layout,
+      .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .image = _image,
+      .subresourceRange =
+          vk::ImageSubresourceRange{.aspectMask = vk::ImageAspectFlagBits::eColor, .levelCount = 1, .layerCount = 1}};
+  command_buffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, vk::PipelineStageFlagBits::eAllCommands, {},
+                                 {}, {}, barrier);
+  _layout = new_layout;
+}
+
+auto OffscreenTarget::readbackSize() const -> vk::DeviceSize {
+  return static_cast<vk::DeviceSize>(_extent.width) * _extent.height * bytesPerPixel(_format);
+}
+
+} // namespace rendy::graphics::vulkan
@@ -1,86 +1,64 @@
 #include "vulkan/physical_device.hpp"
+#include "common/log.hpp"
 #include "vulkan/instance.hpp"
 #include "vulkan/utils.hpp"
-#include <set>
-#include <spdlog/spdlog.h>
+#include <algorithm>
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_handles.hpp>
 
 namespace rendy::graphics::vulkan {
 
 auto PhysicalDevice::Initialize(Instance &instance, vk::SurfaceKHR surface) -> bool {
-  auto physical_devices =
+  const auto physical_devices =
       VkCheckAndUnwrap(instance.Get().enumeratePhysicalDevices(), "Failed to enumerate physical devices");
-
   if (physical_devices.empty()) {
-    spdlog::error("Couldn't find a physical device.");
+    RENDY_LOG_ERROR("Couldn't find a physical device.");
     return false;
   }
 
-  // Find the best suitable device, with fallback to any device if none are ideal
-  vk::PhysicalDevice best_device;
+  // Prefer devices with every required capability, then the highest score
+  std::vector<Candidate> candidates;
+  candidates.reserve(physical_devices.size());
+  size_t best = 0;
+  bool best_suitable = false;
   uint32_t best_score = 0;
-  bool found_suitable = false;
-
-  // First pass: try to find an ideal device
   for (const auto &device : physical_devices) {
-    if (isDeviceSuitable(device, surface)) {
-      uint32_t score = scoreDevice(device);
-      if (score > best_score) {
-        best_score = score;
-        best_device = device;
-        found_suitable = true;
-      }
+    candidates.push_back(probe(device, surface));
+    const auto &candidate = candidates.back();
+    const bool suitable = findMissingCapabilities(candidate, static_cast<bool>(surface)).empty();
+    const auto score = scoreDevice(candidate);
+    RENDY_LOG_DEBUG("{}: score {}{}", candidate.properties.deviceName.data(), score,
+                    suitable ? "" : ", lacks required capabilities");
+    if (candidates.size() == 1 || (suitable && !best_suitable) || (suitable == best_suitable && score > best_score)) {
+      best = candidates.size() - 1;
+      best_suitable = suitable;
+      best_score = score;
     }
   }
 
-  // Fallback: if no suitable device found, pick the best scoring device anyway
-  if (!found_suitable) {
-    spdlog::warn("No ideal GPU found, selecting best available device with limited capabilities");
-    best_score = 0;
-
-    for (const auto &device : physical_devices) {
-      uint32_t score = scoreDevice(device);
-      spdlog::warn("Score {}", score);
-      if (score > best_score) {
-        best_score = score;
-        best_device = device;
-      }
-    }
-  }
+  const auto missing = findMissingCapabilities(candidates[best], static_cast<bool>(surface));
+  _instance_extensions = instance.GetEnabledExtensions();
+  queryDeviceInfo(std::move(candidates[best]));
+  _queue_family_indices = FindQueueFamilies(_vk_queue_family_properties, _present_support);
 
-  _vk_physical_device = best_device;
-  _queue_family_indices = findQueueFamilies(_vk_physical_device, surface);
-  _swapchain_support = querySwapChainSupport(_vk_physical_device, surface);
-  queryDeviceInfo();
-
-  // Log device capabilities and any missing features
-  spdlog::info("Selected GPU: {}", _vk_properties.deviceName.data());
-
-  spdlog::info("Graphics queue family: {}", _queue_family_indices.graphics_family);
+  RENDY_LOG_INFO("Selected GPU: {}", _vk_properties.deviceName.data());
+  RENDY_LOG_INFO("Graphics queue family: {}", _queue_family_indices.graphics_family);
   if (_queue_family_indices.compute_family.has_value()) {
-    spdlog::info("Compute queue family: {}", _queue_family_indices.compute_family.value());
+    RENDY_LOG_INFO("Compute queue family: {}", _queue_family_indices.compute_family.value());
   } else {
-    spdlog::info("No compute queue family found (compute shaders unavailable)");
+    RENDY_LOG_INFO("No compute queue family found (compute shaders unavailable)");
   }
-
-  if (found_suitable) {
-    spdlog::info("Device has all required capabilities");
+  if (!surface) {
+    RENDY_LOG_INFO("No surface provided, running headless");
+  }
+  if (missing.empty()) {
+    RENDY_LOG_INFO("Device has all required capabilities");
   } else {
-    // Log what capabilities are missing for awareness
-    if (!checkDeviceExtensionSupport(_vk_physical_device)) {
-      spdlog::warn("Device doesn't support required extensions (e.g., VK_KHR_swapchain)");
-    }
-
-    if (!_swapchain_support.IsAdequate()) {
-      spdlog::warn("Device has inadequate swapchain support");
-    }
-
-    if (_vk_features.samplerAnisotropy == vk::False) {
-      spdlog::warn("Device doesn't support anisotropic filtering");
+    RENDY_LOG_WARN("No ideal GPU found, selected the best available device with limited capabilities");
+    for (const auto capability : missing) {
+      RENDY_LOG_WARN("Device lacks {}", capability);
     }
   }
-
   return true;
 }
 
@@ -96,113 +74,130 @@ auto PhysicalDevice::GetFeatures() const -> const vk::PhysicalDeviceFeatures & {
 
 auto PhysicalDevice::GetProperties() const -> const vk::PhysicalDeviceProperties & { return _vk_properties; }
 
-auto PhysicalDevice::GetMemoryProperties() const -> const vk::PhysicalDeviceMemoryProperties & {
-  return _vk_memory_properties;
+auto PhysicalDevice::GetPushDescriptorProperties() const -> const vk::PhysicalDevicePushDescriptorPropertiesKHR & {
+  return _vk_push_descriptor_properties;
 }
 
-void PhysicalDevice::queryDeviceInfo() {
-  _vk_features = _vk_physical_device.getFeatures();
-  _vk_properties = _vk_physical_device.getProperties();
-  _vk_memory_properties = _vk_physical_device.getMemoryProperties();
-  _vk_queue_family_properties = _vk_physical_device.getQueueFamilyProperties();
+auto PhysicalDevice::GetDescriptorIndexingProperties() const
+    -> const vk::PhysicalDeviceDescriptorIndexingProperties & {
+  return _vk_descriptor_indexing_properties;
 }
 
-auto PhysicalDevice::findQueueFamilies(vk::PhysicalDevice device, vk::SurfaceKHR surface) -> QueueFamilyIndices {
-  QueueFamilyIndices indices;
-
-  auto queue_families = device.getQueueFamilyProperties();
-
-  for (uint32_t i = 0; i < queue_families.size(); i++) {
-    const auto &queue_family = queue_families[i];
-
-    auto present_support = VkCheckAndUnwrap(device.getSurfaceSupportKHR(i, surface), "Failed to get surface support");
-    if (queue_family.queueFlags & vk::QueueFlagBits::eGraphics && present_support != vk::False) {
-      indices.graphics_family = i;
-    }
-
-    if (queue_family.queueFlags & vk::QueueFlagBits::eCompute) {
-      indices.compute_family = i;
-    }
-  }
-
-  return indices;
+auto PhysicalDevice::GetMemoryProperties() const -> const vk::PhysicalDeviceMemoryProperties & {
+  return _vk_memory_properties;
 }
 
-auto PhysicalDevice::querySwapChainSupport(vk::PhysicalDevice device, vk::SurfaceKHR surface)
-    -> SwapChainSupportDetails {
-  SwapChainSupportDetails details;
+auto PhysicalDevice::GetQueueFamilyProperties() const -> const std::vector<vk::QueueFamilyProperties> & {
+  return _vk_queue_family_properties;
+}
 
-  spdlog::info("Querying Device Capabilities");
+auto PhysicalDevice::IsExtensionSupported(std::string_view name) const -> bool {
+  return std::ranges::binary_search(_extensions, name);
+}
 
-  // First check if device supports presentation on any queue family for this surface
-  bool presentation_supported = false;
-  auto queue_families = device.getQueueFamilyProperties();
-  for (uint32_t i = 0; i < queue_families.size(); i++) {
-    if (VkCheckAndUnwrap(device.getSurfaceSupportKHR(i, surface), "Failed to get surface support") == vk::True) {
-      presentation_supported = true;
-      spdlog::debug("Queue family {} supports presentation", i);
+auto PhysicalDevice::FindMemoryType(uint32_t type_bits, vk::MemoryPropertyFlags properties) const
+    -> std::optional<uint32_t> {
+  for (uint32_t i = 0; i < _vk_memory_properties.memoryTypeCount; i++) {
+    if ((type_bits & (1U << i)) != 0U &&
+        (_vk_memory_properties.memoryTypes.at(i).propertyFlags & properties) == properties) {
+      return i;
     }
   }
+  return std::nullopt;
+}
 
-  if (!presentation_supported) {
-    spdlog::warn("Physical device doesn't support presentation for this surface");
-    return details; // Return empty details
+auto PhysicalDevice::IsFormatSupported(vk::Format format, vk::FormatFeatureFlags features) const -> bool {
+  if (format == vk::Format::eUndefined) {
+    return false;
   }
-
-  details.capabilities =
-      VkCheckAndUnwrap(device.getSurfaceCapabilitiesKHR(surface), "Failed to get surface capabilities");
-
-  spdlog::info("Querying Device Formats");
-  details.formats = VkCheckAndUnwrap(device.getSurfaceFormatsKHR(surface), "Failed to get surface formats");
-
-  details.present_modes =
-      VkCheckAndUnwrap(device.getSurfacePresentModesKHR(surface), "Failed to get surface present modes");
-
-  return details;
+  return (_vk_physical_device.getFormatProperties(format).optimalTilingFeatures & features) == features;
 }
 
-auto PhysicalDevice::checkDeviceExtensionSupport(vk::PhysicalDevice device) -> bool {
-  static const std::vector<const char *> kDeviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
-
-  auto available_extensions =
-      VkCheckAndUnwrap(device.enumerateDeviceExtensionProperties(), "Failed to enumerate device extensions");
-
-  std::set<std::string> required_extensions(kDeviceExtensions.begin(), kDeviceExtensions.end());
+void PhysicalDevice::queryDeviceInfo(Candidate &&candidate) {
+  _vk_physical_device = candidate.device;
+  _vk_features = candidate.features;
+  _vk_properties = candidate.properties;
+  _vk_queue_family_properties = std::move(candidate.queue_families);
+  _present_support = std::move(candidate.present_support);
+  _extensions = std::move(candidate.extensions);
+  _swapchain_support = std::move(candidate.swapchain_support);
+
+  // Only needed for the selected device
+  const auto properties =
+      _vk_physical_device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDevicePushDescriptorPropertiesKHR,
+                                         vk::PhysicalDeviceDescriptorIndexingProperties>();
+  _vk_push_descriptor_properties = properties.get<vk::PhysicalDevicePushDescriptorPropertiesKHR>();
+  _vk_push_descriptor_properties.pNext = nullptr;
+  _vk_descriptor_indexing_properties = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+  _vk_descriptor_indexing_properties.pNext = nullptr;
+  _vk_memory_properties = _vk_physical_device.getMemoryProperties();
+}
 
-  for (const auto &extension : available_extensions) {
-    required_extensions.erase(extension.extensionName);
+auto PhysicalDevice::probe(vk::PhysicalDevice device, vk::SurfaceKHR surface) -> Candidate {
+  Candidate candidate{.device = device,
+                      .properties = device.getProperties(),
+                      .features = device.getFeatures(),
+                      .queue_families = device.getQueueFamilyProperties()};
+  for (const auto &extension :
+       VkCheckAndUnwrap(device.enumerateDeviceExtensionProperties(), "Failed to enumerate device extensions")) {
+    candidate.extensions.emplace_back(extension.extensionName.data());
+  }
+  std::ranges::sort(candidate.extensions);
+  if (!surface) {
+    return candidate;
   }
 
-  return required_extensions.empty();
+  candidate.present_support.reserve(candidate.queue_families.size());
+  for (uint32_t family = 0; family < candidate.queue_families.size(); ++family) {
+    candidate.present_support.push_back(
+        VkCheckAndUnwrap(device.getSurfaceSupportKHR(family, surface), "Failed to get surface support"));
+  }
+  if (std::ranges::contains(candidate.present_support, vk::True)) {
+    auto &details = candidate.swapchain_support;
+    details.capabilities =
+        VkCheckAndUnwrap(device.getSurfaceCapabilitiesKHR(surface), "Failed to get surface capabilities");
+    details.formats = VkCheckAndUnwrap(device.getSurfaceFormatsKHR(surface), "Failed to get surface formats");
+    details.present_modes =
+        VkCheckAndUnwrap(device.getSurfacePresentModesKHR(surface), "Failed to get surface present modes");
+  }
+  return candidate;
 }
 
-auto PhysicalDevice::isDeviceSuitable(vk::PhysicalDevice device, vk::SurfaceKHR surface) -> bool {
-  bool extensions_supported = checkDeviceExtensionSupport(device);
-
-  bool swapchain_adequate = false;
-  if (extensions_supported) {
-    auto swapchain_support = querySwapChainSupport(device, surface);
-    swapchain_adequate = swapchain_support.IsAdequate();
+auto PhysicalDevice::findMissingCapabilities(const Candidate &candidate, bool has_surface)
+    -> std::vector<std::string_view> {
+  std::vector<std::string_view> missing;
+  const bool has_graphics = std::ranges::any_of(candidate.queue_families, [](const vk::QueueFamilyProperties &family) {
+    return static_cast<bool>(family.queueFlags & vk::QueueFlagBits::eGraphics);
+  });
+  if (!has_graphics) {
+    missing.emplace_back("a graphics queue");
   }
-
-  auto supported_features = device.getFeatures();
-
-  return extensions_supported && swapchain_adequate && supported_features.samplerAnisotropy == vk::True;
+  // Optional features are negotiated when the device is created, see DeviceFeatures
+  if (candidate.properties.apiVersion < vk::ApiVersion13) {
+    missing.emplace_back("Vulkan 1.3");
+  }
+  // Headless rendering doesn't present, so the rest is only required with a surface
+  if (has_surface) {
+    if (!std::ranges::binary_search(candidate.extensions, std::string_view(vk::KHRSwapchainExtensionName))) {
+      missing.emplace_back(vk::KHRSwapchainExtensionName);
+    }
+    if (!std::ranges::contains(candidate.present_support, vk::True)) {
+      missing.emplace_back("presentation to the surface");
+    } else if (!candidate.swapchain_support.IsAdequate()) {
+      missing.emplace_back("adequate swapchain support");
+    }
+  }
+  return missing;
 }
 
-auto PhysicalDevice::scoreDevice(vk::PhysicalDevice device) -> uint32_t {
-  auto device_properties = device.getProperties();
-
+auto PhysicalDevice::scoreDevice(const Candidate &candidate) -> uint32_t {
   uint32_t score = 0;
-
-  if (device_properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu) {
+  if (candidate.properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu) {
     score += 1000;
-  } else if (device_properties.deviceType == vk::PhysicalDeviceType::eIntegratedGpu) {
+  } else if (candidate.properties.deviceType == vk::PhysicalDeviceType::eIntegratedGpu) {
     score += 10;
   }
-
-  score += device_properties.limits.maxImageDimension2D;
-
+  score += candidate.properties.limits.maxImageDimension2D;
   return score;
 }
 
@@ -0,0 +1,52 @@
+#include "vulkan/pipeline.hpp"
+#include "core/hash.hpp"
+#include <span>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+auto hashStage(const ShaderStageDesc &stage, uint64_t seed) -> uint64_t {
+  auto hash = core::HashValue(stage.stage, seed);
+  hash = core::HashSpan(std::span<const uint32_t>(stage.spirv), hash);
+  hash = core::HashString(stage.entry_point, hash);
+  return core::HashSpan(std::span<const SpecializationConstant>(stage.specialization), hash);
+}
+
+} // namespace
+
+auto GraphicsPipelineDesc::Hash() const -> uint64_t {
+  auto hash = core::HashValue(core::PipelineType::Graphics);
+  for (const auto &stage : stages) {
+    hash = hashStage(stage, hash);
+  }
+  hash = core::HashValue(static_cast<VkPipelineLayout>(layout), hash);
+  hash = core::HashSpan(std::span<const vk::VertexInputBindingDescription>(vertex_bindings), hash);
+  hash = core::HashSpan(std::span<const vk::VertexInputAttributeDescription>(vertex_attributes), hash);
+  hash = core::HashValue(topology, hash);
+  hash = core::HashValue(polygon_mode, hash);
+  hash = core::HashValue(static_cast<VkCullModeFlags>(cull_mode), hash);
+  hash = core::HashValue(front_face, hash);
+  hash = core::HashValue(depth_test, hash);
+  hash = core::HashValue(depth_write, hash);
+  hash = core::HashValue(depth_compare, hash);
+  hash = core::HashValue(alpha_blend, hash);
+  hash = core::HashSpan(std::span<const vk::Format>(color_formats), hash);
+  hash = core::HashValue(depth_format, hash);
+  return core::HashValue(samples, hash);
+}
+
+auto ComputePipelineDesc::Hash() const -> uint64_t {
+  const auto hash = hashStage(shader, core::HashValue(core::PipelineType::Compute));
+  return core::HashValue(static_cast<VkPipelineLayout>(layout), hash);
+}
+
+VulkanPipeline::VulkanPipeline(vk::Pipeline pipeline, vk::PipelineLayout layout, core::PipelineType type,
+                               uint64_t state_hash)
+    : _pipeline(pipeline), _layout(layout), _type(type), _state_hash(state_hash) {}
+
+auto VulkanPipeline::GetBindPoint() const -> vk::PipelineBindPoint {
+  return _type == core::PipelineType::Compute ? vk::PipelineBindPoint::eCompute : vk::PipelineBindPoint::eGraphics;
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,137 @@
+#include "vulkan/pipeline_cache.hpp"
+#include "common/log.hpp"
+#include "core/hash.hpp"
+#include "vulkan/physical_device.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+// Written in front of the driver blob so truncated or corrupted files are caught before the driver sees them
+struct CacheFileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t data_size;
+  uint64_t data_hash;
+};
+
+constexpr uint32_t kCacheFileMagic = 0x43505952; // "RYPC"
+constexpr uint32_t kCacheFileVersion = 1;
+
+auto readCacheFile(const std::filesystem::path &path) -> std::vector<std::byte> {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return {};
+  }
+  const auto size = static_cast<size_t>(file.tellg());
+  if (size < sizeof(CacheFileHeader)) {
+    return {};
+  }
+  file.seekg(0);
+  CacheFileHeader header{};
+  file.read(reinterpret_cast<char *>(&header), sizeof(header));
+  if (header.magic != kCacheFileMagic || header.version != kCacheFileVersion ||
+      header.data_size != size - sizeof(header)) {
+    RENDY_LOG_WARN("Ignoring pipeline cache {}: unknown format or truncated", path.string());
+    return {};
+  }
+
+  std::vector<std::byte> data(header.data_size);
+  file.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(data.size()));
+  if (!file || core::HashBytes(data) != header.data_hash) {
+    RENDY_LOG_WARN("Ignoring pipeline cache {}: checksum mismatch", path.string());
+    return {};
+  }
+  return data;
+}
+
+auto matchesDevice(std::span<const std::byte> data, const vk::PhysicalDeviceProperties &properties) -> bool {
+  VkPipelineCacheHeaderVersionOne header{};
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  return header.headerSize >= sizeof(header) && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+         std::ranges::equal(header.pipelineCacheUUID, properties.pipelineCacheUUID);
+}
+
+} // namespace
+
+auto PipelineCache::Read(const PhysicalDevice &physical_device, const std::filesystem::path &directory)
+    -> PipelineCacheBlob {
+  const auto &properties = physical_device.GetProperties();
+  PipelineCacheBlob blob{
+      .path = directory / fmt::format("pipelines_{:04x}_{:04x}.bin", properties.vendorID, properties.deviceID)};
+  blob.data = readCacheFile(blob.path);
+  if (!blob.data.empty() && !matchesDevice(blob.data, properties)) {
+    RENDY_LOG_INFO("Pipeline cache {} was written by another device or driver, starting empty", blob.path.string());
+    blob.data.clear();
+  }
+  return blob;
+}
+
+auto PipelineCache::Initialize(vk::Device device, const PhysicalDevice &physical_device,
+                               const std::filesystem::path &directory) -> bool {
+  return Initialize(device, Read(physical_device, directory));
+}
+
+auto PipelineCache::Initialize(vk::Device device, PipelineCacheBlob blob) -> bool {
+  _device = device;
+  _path = std::move(blob.path);
+  const auto &data = blob.data;
+  _cache = VkCheckAndUnwrap(
+      _device.createPipelineCache(vk::PipelineCacheCreateInfo{.initialDataSize = data.size(),
+                                                               .pInitialData = data.empty() ? nullptr : data.data()}),
+      "Failed to create pipeline cache.");
+  RENDY_LOG_INFO("Loaded pipeline cache {} ({} KiB)", _path.string(), data.size() / 1024);
+  return true;
+}
+
+void PipelineCache::Destroy() {
+  if (!_cache) {
+    return;
+  }
+  Save();
+  _device.destroyPipelineCache(_cache);
+  _cache = nullptr;
+}
+
+void PipelineCache::Save() const {
+  const auto data = VkCheckAndUnwrap(_device.getPipelineCacheData(_cache), "Failed to read pipeline cache data.");
+  const auto bytes = std::as_bytes(std::span(data));
+  const CacheFileHeader header{.magic = kCacheFileMagic,
+                               .version = kCacheFileVersion,
+                               .data_size = bytes.size(),
+                               .data_hash = core::HashBytes(bytes)};
+
+  std::error_code error;
+  std::filesystem::create_directories(_path.parent_path(), error);
+  // Write next to the target and rename, so a crash mid-write never leaves a torn cache behind
+  auto temp_path = _path;
+  temp_path += ".tmp";
+  {
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file) {
+      RENDY_LOG_WARN("Failed to write pipeline cache {}", temp_path.string());
+      return;
+    }
+  }
+  std::filesystem::rename(temp_path, _path, error);
+  if (error) {
+    RENDY_LOG_WARN("Failed to replace pipeline cache {}: {}", _path.string(), error.message());
+    return;
+  }
+  RENDY_LOG_DEBUG("Saved pipeline cache {} ({} KiB)", _path.string(), bytes.size() / 1024);
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,240 @@
+#include "vulkan/pipeline_compiler.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/utils.hpp"
+#include <array>
+#include <chrono>
+#include <type_traits>
+#include <vector>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+struct StageStorage {
+  std::vector<vk::SpecializationMapEntry> entries;
+  std::vector<uint32_t> data;
+  vk::SpecializationInfo info;
+};
+
+auto buildSpecialization(const ShaderStageDesc &stage, StageStorage &storage) -> const vk::SpecializationInfo * {
+  if (stage.specialization.empty()) {
+    return nullptr;
+  }
+  for (const auto &constant : stage.specialization) {
+    storage.entries.push_back(vk::SpecializationMapEntry{.constantID = constant.id,
+                                                         .offset = VkToU32(storage.data.size() * sizeof(uint32_t)),
+                                                         .size = sizeof(uint32_t)});
+    storage.data.push_back(constant.value);
+  }
+  storage.info = vk::SpecializationInfo{.mapEntryCount = VkToU32(storage.entries.size()),
+                                        .pMapEntries = storage.entries.data(),
+                                        .dataSize = storage.data.size() * sizeof(uint32_t),
+                                        .pData = storage.data.data()};
+  return &storage.info;
+}
+
+// Destroys the shader modules of a pipeline on every way out of its creation, exceptions included
+class ShaderModules {
+  vk::Device _device;
+  std::vector<vk::ShaderModule> _modules;
+
+public:
+  explicit ShaderModules(vk::Device device) : _device(device) {}
+  ShaderModules(const ShaderModules &) = delete;
+  ShaderModules(ShaderModules &&) = delete;
+  auto operator=(const ShaderModules &) -> ShaderModules & = delete;
+  auto operator=(ShaderModules &&) -> ShaderModules & = delete;
+  ~ShaderModules() {
+    for (const auto module : _modules) {
+      _device.destroyShaderModule(module);
+    }
+  }
+
+  auto Add(vk::ShaderModule module) -> vk::ShaderModule {
+    _modules.push_back(module);
+    return module;
+  }
+};
+
+} // namespace
+
+auto PipelineRequest::IsReady() const -> bool {
+  return _future.valid() && _future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+auto PipelineRequest::TryGet() const -> VulkanPipeline * { return IsReady() ? _future.get() : nullptr; }
+
+auto PipelineRequest::Wait() const -> VulkanPipeline * { return _future.valid() ? _future.get() : nullptr; }
+
+auto PipelineCompiler::Initialize(const VulkanDevice &device, common::JobSystem &job_system,
+                                  const PipelineCompilerConfig &config) -> bool {
+  return Initialize(device, job_system, PipelineCache::Read(device.GetPhysicalDevice(), config.cache_directory));
+}
+
+auto PipelineCompiler::Initialize(const VulkanDevice &device, common::JobSystem &job_system, PipelineCacheBlob cache)
+    -> bool {
+  _device = &device;
+  _job_system = &job_system;
+  return _cache.Initialize(device.Get(), std::move(cache));
+}
+
+void PipelineCompiler::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  // Let queued compilations finish so every promise is fulfilled before the pipelines go away
+  _job_system->Wait(_compiling);
+
+  const auto vk_device = _device->Get();
+  for (auto &[hash, entry] : _pipelines) {
+    if (entry.pipeline) {
+      vk_device.destroyPipeline(entry.pipeline->Get());
+    }
+  }
+  _pipelines.clear();
+  _cache.Destroy();
+  _device = nullptr;
+}
+
+auto PipelineCompiler::Request(const GraphicsPipelineDesc &desc) -> PipelineRequest {
+  return request(desc, core::PipelineType::Graphics);
+}
+
+auto PipelineCompiler::Request(const ComputePipelineDesc &desc) -> PipelineRequest {
+  return request(desc, core::PipelineType::Compute);
+}
+
+template <typename Desc> auto PipelineCompiler::request(Desc desc, core::PipelineType type) -> PipelineRequest {
+  const auto hash = desc.Hash();
+  const std::scoped_lock lock(_mutex);
+  if (const auto it = _pipelines.find(hash); it != _pipelines.end()) {
+    return PipelineRequest(it->second.future, hash);
+  }
+
+  auto promise = std::make_shared<std::promise<VulkanPipeline *>>();
+  auto &entry = _pipelines[hash];
+  entry.future = promise->get_future().share();
+
+  auto compile = [this, promise, hash, type, desc = std::move(desc)] {
+    const auto start = std::chrono::steady_clock::now();
+    VulkanPipeline *result = nullptr;
+    try {
+      vk::Pipeline pipeline;
+      if constexpr (std::is_same_v<Desc, GraphicsPipelineDesc>) {
+        pipeline = compileGraphics(desc);
+      } else {
+        pipeline = compileCompute(desc);
+      }
+      auto compiled = std::make_unique<VulkanPipeline>(pipeline, desc.layout, type, hash);
+      result = compiled.get();
+      {
+        const std::scoped_lock entry_lock(_mutex);
+        _pipelines[hash].pipeline = std::move(compiled);
+      }
+      const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+      RENDY_LOG_DEBUG("Compiled pipeline {:016x} in {:.2f} ms", hash, elapsed.count());
+    } catch (const std::exception &exception) {
+      RENDY_LOG_ERROR("Failed to compile pipeline {:016x}: {}", hash, exception.what());
+      // Later requests, e.g. after the shader was fixed and hot reloaded, compile again instead of getting the failure
+      const std::scoped_lock entry_lock(_mutex);
+      _pipelines.erase(hash);
+    }
+    promise->set_value(result);
+  };
+  _job_system->Run(std::move(compile), &_compiling);
+  return PipelineRequest(entry.future, hash);
+}
+
+auto PipelineCompiler::createShaderModule(const ShaderStageDesc &stage) const -> vk::ShaderModule {
+  return VkCheckAndUnwrap(_device->Get().createShaderModule(vk::ShaderModuleCreateInfo{
+                              .codeSize = stage.spirv.size() * sizeof(uint32_t), .pCode = stage.spirv.data()}),
+                          "Failed to create shader module.");
+}
+
+auto PipelineCompiler::compileGraphics(const GraphicsPipelineDesc &desc) const -> vk::Pipeline {
+  const auto vk_device = _device->Get();
+  ShaderModules modules(vk_device);
+  std::vector<StageStorage> storage(desc.stages.size());
+  std::vector<vk::PipelineShaderStageCreateInfo> stages;
+  for (size_t i = 0; i < desc.stages.size(); ++i) {
+    const auto &stage = desc.stages[i];
+    stages.push_back(vk::PipelineShaderStageCreateInfo{.stage = stage.stage,
+                                                       .module = modules.Add(createShaderModule(stage)),
+                                                       .pName = stage.entry_point.c_str(),
+                                                       .pSpecializationInfo = buildSpecialization(stage, storage[i])});
+  }
+
+  const vk::PipelineVertexInputStateCreateInfo vertex_input{
+      .vertexBindingDescriptionCount = VkToU32(desc.vertex_bindings.size()),
+      .pVertexBindingDescriptions = desc.vertex_bindings.data(),
+      .vertexAttributeDescriptionCount = VkToU32(desc.vertex_attributes.size()),
+      .pVertexAttributeDescriptions = desc.vertex_attributes.data()};
+  const vk::PipelineInputAssemblyStateCreateInfo input_assembly{.topology = desc.topology};
+  const vk::PipelineViewportStateCreateInfo viewport{.viewportCount = 1, .scissorCount = 1};
+  const vk::PipelineRasterizationStateCreateInfo rasterization{.polygonMode = desc.polygon_mode,
+                                                               .cullMode = desc.cull_mode,
+                                                               .frontFace = desc.front_face,
+                                                               .lineWidth = 1.0F};
+  const vk::PipelineMultisampleStateCreateInfo multisample{.rasterizationSamples = desc.samples};
+  const vk::PipelineDepthStencilStateCreateInfo depth_stencil{.depthTestEnable = desc.depth_test ? vk::True : vk::False,
+                                                              .depthWriteEnable =
+                                                                  desc.depth_write ? vk::True : vk::False,
+                                                              .depthCompareOp = desc.depth_compare};
+
+  const auto color_write_mask = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+  const vk::PipelineColorBlendAttachmentState blend_attachment{
+      .blendEnable = desc.alpha_blend ? vk::True : vk::False,
+      .srcColorBlendFactor = vk::BlendFactor::eSrcAlpha,
+      .dstColorBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+      .colorBlendOp = vk::BlendOp::eAdd,
+      .srcAlphaBlendFactor = vk::BlendFactor::eOne,
+      .dstAlphaBlendFactor = vk::BlendFactor::eOneMinusSrcAlpha,
+      .alphaBlendOp = vk::BlendOp::eAdd,
+      .colorWriteMask = color_write_mask};
+  const std::vector blend_attachments(desc.color_formats.size(), blend_attachment);
+  const vk::PipelineColorBlendStateCreateInfo color_blend{.attachmentCount = VkToU32(blend_attachments.size()),
+                                                          .pAttachments = blend_attachments.data()};
+
+  const std::array dynamic_states{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+  const vk::PipelineDynamicStateCreateInfo dynamic_state{.dynamicStateCount = VkToU32(dynamic_states.size()),
+                                                         .pDynamicStates = dynamic_states.data()};
+
+  const vk::PipelineRenderingCreateInfo rendering_info{.colorAttachmentCount = VkToU32(desc.color_formats.size()),
+                                                       .pColorAttachmentFormats = desc.color_formats.data(),
+                                                       .depthAttachmentFormat = desc.depth_format};
+
+  const auto pipeline = vk_device.createGraphicsPipeline(
+      _cache.Get(), vk::GraphicsPipelineCreateInfo{.pNext = &rendering_info,
+                                                   .stageCount = VkToU32(stages.size()),
+                                                   .pStages = stages.data(),
+                                                   .pVertexInputState = &vertex_input,
+                                                   .pInputAssemblyState = &input_assembly,
+                                                   .pViewportState = &viewport,
+                                                   .pRasterizationState = &rasterization,
+                                                   .pMultisampleState = &multisample,
+                                                   .pDepthStencilState = &depth_stencil,
+                                                   .pColorBlendState = &color_blend,
+                                                   .pDynamicState = &dynamic_state,
+                                                   .layout = desc.layout});
+  return VkCheckAndUnwrap(pipeline, "Failed to create graphics pipeline.");
+}
+
+auto PipelineCompiler::compileCompute(const ComputePipelineDesc &desc) const -> vk::Pipeline {
+  const auto vk_device = _device->Get();
+  StageStorage storage;
+  ShaderModules modules(vk_device);
+  const auto module = modules.Add(createShaderModule(desc.shader));
+  const auto pipeline = vk_device.createComputePipeline(
+      _cache.Get(),
+      vk::ComputePipelineCreateInfo{
+          .stage = vk::PipelineShaderStageCreateInfo{.stage = vk::ShaderStageFlagBits::eCompute,
+                                                     .module = module,
+                                                     .pName = desc.shader.entry_point.c_str(),
+                                                     .pSpecializationInfo = buildSpecialization(desc.shader, storage)},
+          .layout = desc.layout});
+  return VkCheckAndUnwrap(pipeline, "Failed to create compute pipeline.");
+}
+
+} // namespace rendy::graphics::vulkan
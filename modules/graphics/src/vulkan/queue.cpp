@@ -1,109 +1,115 @@
 #include "vulkan/queue.hpp"
+#include "common/log.hpp"
 #include "vulkan/utils.hpp"
+#include <algorithm>
+#include <array>
 #include <fmt/ranges.h>
-#include <spdlog/spdlog.h>
+#include <span>
+#include <string_view>
+#include <utility>
 
 namespace rendy::graphics::vulkan {
 
 void QueueRegistry::RegisterFamily(uint32_t family_index, core::QueueType types, uint32_t count) {
+  if (_families.contains(family_index)) {
+    return;
+  }
   _families[family_index] =
       QueueFamilyInfo{.family_index = family_index, .queue_count = count, .supported_types = types};
 
-  std::vector<std::string> type_names;
-  if (static_cast<uint32_t>(types & core::QueueType::Graphics) != 0) {
-    type_names.emplace_back("Graphics");
-  }
-  if (static_cast<uint32_t>(types & core::QueueType::Compute) != 0) {
-    type_names.emplace_back("Compute");
+  std::array<std::string_view, 3> type_names{};
+  size_t type_count = 0;
+  for (const auto &[type, name] : {std::pair{core::QueueType::Graphics, "Graphics"},
+                                   std::pair{core::QueueType::Compute, "Compute"},
+                                   std::pair{core::QueueType::Transfer, "Transfer"}}) {
+    if (static_cast<uint32_t>(types & type) != 0) {
+      type_names.at(type_count++) = name;
+    }
   }
-  if (static_cast<uint32_t>(types & core::QueueType::Transfer) != 0) {
-    type_names.emplace_back("Transfer");
+
+  RENDY_LOG_INFO("Registered queue family {}: {} queues, supports [{}]", family_index, count,
+                 fmt::join(std::span(type_names).first(type_count), ", "));
+}
+
+auto QueueRegistry::AssignQueue(core::QueueType type, uint32_t family_index, float priority) -> QueueLocation {
+  auto &family = _families.at(family_index);
+  QueueLocation location{.family_index = family_index};
+
+  if (family.priorities.size() < family.queue_count) {
+    location.queue_index = VkToU32(family.priorities.size());
+    family.priorities.push_back(priority);
+  } else {
+    location.queue_index = VkToU32(family.priorities.size() - 1);
+    family.priorities.back() = std::max(family.priorities.back(), priority);
+    RENDY_LOG_INFO("Queue family {} has no free queues, sharing queue {}", family_index, location.queue_index);
   }
 
-  spdlog::info("Registered queue family {}: {} queues, supports [{}]", family_index, count,
-               fmt::join(type_names, ", "));
+  _locations[type] = location;
+  return location;
 }
 
 auto QueueRegistry::GetQueueCreateInfos() const -> std::vector<vk::DeviceQueueCreateInfo> {
-  std::vector<vk::DeviceQueueCreateInfo> create_infos(_families.size());
+  std::vector<vk::DeviceQueueCreateInfo> create_infos;
+  create_infos.reserve(_families.size());
 
   for (const auto &[family_idx, info] : _families) {
+    if (info.priorities.empty()) {
+      continue;
+    }
     create_infos.emplace_back(vk::DeviceQueueCreateInfo{.queueFamilyIndex = family_idx,
-                                                        .queueCount = 1, // Request 1 queue per family for now
-                                                        .pQueuePriorities = _queue_priorities.data()});
+                                                        .queueCount = VkToU32(info.priorities.size()),
+                                                        .pQueuePriorities = info.priorities.data()});
   }
 
-  spdlog::info("Creating {} unique queue families", create_infos.size());
+  RENDY_LOG_INFO("Creating {} unique queue families", create_infos.size());
   return create_infos;
 }
 
-auto QueueRegistry::GetFamilyFor(core::QueueType type) const -> uint32_t {
-  uint32_t best_family = 0;
-  uint32_t best_capability_count = UINT32_MAX;
-  bool found_any = false;
-
-  for (const auto &[family_idx, info] : _families) {
-    // Check if this family supports the requested type
-    if (static_cast<uint32_t>(info.supported_types & type) != 0) {
-      if (!found_any) {
-        // First supported family found - use as fallback
-        best_family = family_idx;
-        found_any = true;
-      }
-
-      // Count how many capabilities this family has (fewer = more dedicated)
-      uint32_t capability_count = 0;
-      auto types_val = static_cast<uint32_t>(info.supported_types);
-
-      if ((types_val & static_cast<uint32_t>(core::QueueType::Graphics)) != 0U) {
-        capability_count++;
-      }
-      if ((types_val & static_cast<uint32_t>(core::QueueType::Compute)) != 0U) {
-        capability_count++;
-      }
-      if ((types_val & static_cast<uint32_t>(core::QueueType::Transfer)) != 0U) {
-        capability_count++;
-      }
-
-      // Prefer queues with fewer capabilities (more dedicated)
-      if (capability_count < best_capability_count) {
-        best_family = family_idx;
-        best_capability_count = capability_count;
-      }
-    }
+auto QueueRegistry::GetLocation(core::QueueType type) const -> std::optional<QueueLocation> {
+  if (const auto it = _locations.find(type); it != _locations.end()) {
+    return it->second;
   }
-
-  if (!found_any) {
-    // spdlog::error("No queue family found for requested type");
-    return _families.begin()->first; // Return first available family as last resort
-  }
-
-  return best_family;
+  return std::nullopt;
 }
 
 auto QueueRegistry::GetAllFamilies() const -> const std::map<uint32_t, QueueFamilyInfo> & { return _families; }
 
-auto FindQueueFamilies(vk::PhysicalDevice device, vk::SurfaceKHR surface) -> QueueFamilyIndices {
-  auto queue_families = device.getQueueFamilyProperties();
-
+auto FindQueueFamilies(std::span<const vk::QueueFamilyProperties> queue_families,
+                       std::span<const vk::Bool32> present_support) -> QueueFamilyIndices {
+  const bool has_surface = !present_support.empty();
   QueueFamilyIndices indices{};
+  bool found_graphics = false;
   bool found_graphics_with_present = false;
 
   for (uint32_t i = 0; i < queue_families.size(); i++) {
     const auto &queue_family = queue_families[i];
 
-    // Graphics with presentation support (required)
+    // Presentation (optional, only meaningful with a surface)
+    const bool can_present = has_surface && present_support[i] != vk::False;
+    if (can_present && !indices.present_family.has_value()) {
+      indices.present_family = i;
+    }
+
+    // Graphics (required), prefer a family that can also present
     if (!found_graphics_with_present && (queue_family.queueFlags & vk::QueueFlagBits::eGraphics)) {
-      auto present_support = VkCheckAndUnwrap(device.getSurfaceSupportKHR(i, surface), "Failed to get surface support");
-      if (present_support != vk::False) {
+      if (can_present) {
         indices.graphics_family = i;
+        indices.present_family = i;
         found_graphics_with_present = true;
+        found_graphics = true;
+      } else if (!found_graphics) {
+        indices.graphics_family = i;
+        found_graphics = true;
       }
     }
 
-    // Compute (optional)
-    if (!indices.compute_family.has_value() && (queue_family.queueFlags & vk::QueueFlagBits::eCompute)) {
-      indices.compute_family = i;
+    // Compute (optional) - prefer async compute families without graphics
+    if (queue_family.queueFlags & vk::QueueFlagBits::eCompute) {
+      bool is_async = !(queue_family.queueFlags & vk::QueueFlagBits::eGraphics);
+
+      if (is_async || !indices.compute_family.has_value()) {
+        indices.compute_family = i;
+      }
     }
 
     // Transfer (optional) - prefer dedicated transfer queues
@@ -118,8 +124,10 @@ auto FindQueueFamilies(vk::PhysicalDevice device, vk::SurfaceKHR surface) -> Que
     }
   }
 
-  if (!found_graphics_with_present) {
-    spdlog::error("No graphics queue family with presentation support found");
+  if (!found_graphics) {
+    RENDY_LOG_ERROR("No graphics queue family found");
+  } else if (has_surface && !found_graphics_with_present) {
+    RENDY_LOG_ERROR("No graphics queue family with presentation support found");
   }
 
   return indices;
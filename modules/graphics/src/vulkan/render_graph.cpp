@@ -0,0 +1,888 @@
+#include "vulkan/render_graph.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/frame_scheduler.hpp"
+#include "vulkan/gpu_profiler.hpp"
+#include "vulkan/memory_allocator.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+struct AccessInfo {
+  vk::PipelineStageFlags2 stages;
+  vk::AccessFlags2 access;
+  vk::ImageLayout layout{vk::ImageLayout::eUndefined};
+  bool write{false};
+};
+
+auto shaderStages(PassType type) -> vk::PipelineStageFlags2 {
+  return type == PassType::Raster
+             ? vk::PipelineStageFlagBits2::eVertexShader | vk::PipelineStageFlagBits2::eFragmentShader
+             : vk::PipelineStageFlags2{vk::PipelineStageFlagBits2::eComputeShader};
+}
+
+auto accessInfo(ResourceAccess access, PassType type) -> AccessInfo {
+  using Stage = vk::PipelineStageFlagBits2;
+  using Access = vk::AccessFlagBits2;
+  using Layout = vk::ImageLayout;
+  switch (access) {
+  case ResourceAccess::ColorAttachment:
+    return {.stages = Stage::eColorAttachmentOutput,
+            .access = Access::eColorAttachmentRead | Access::eColorAttachmentWrite,
+            .layout = Layout::eColorAttachmentOptimal,
+            .write = true};
+  case ResourceAccess::DepthAttachment:
+    return {.stages = Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+            .access = Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite,
+            .layout = Layout::eDepthStencilAttachmentOptimal,
+            .write = true};
+  case ResourceAccess::DepthRead:
+    return {.stages = Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+            .access = Access::eDepthStencilAttachmentRead,
+            .layout = Layout::eDepthStencilReadOnlyOptimal};
+  case ResourceAccess::SampledRead:
+    return {.stages = shaderStages(type),
+            .access = Access::eShaderSampledRead,
+            .layout = Layout::eShaderReadOnlyOptimal};
+  case ResourceAccess::StorageRead:
+    return {.stages = shaderStages(type), .access = Access::eShaderStorageRead, .layout = Layout::eGeneral};
+  case ResourceAccess::StorageWrite:
+    return {.stages = shaderStages(type),
+            .access = Access::eShaderStorageRead | Access::eShaderStorageWrite,
+            .layout = Layout::eGeneral,
+            .write = true};
+  case ResourceAccess::UniformRead:
+    return {.stages = shaderStages(type), .access = Access::eUniformRead};
+  case ResourceAccess::VertexRead:
+    return {.stages = Stage::eVertexAttributeInput, .access = Access::eVertexAttributeRead};
+  case ResourceAccess::IndexRead:
+    return {.stages = Stage::eIndexInput, .access = Access::eIndexRead};
+  case ResourceAccess::IndirectRead:
+    return {.stages = Stage::eDrawIndirect, .access = Access::eIndirectCommandRead};
+  case ResourceAccess::TransferRead:
+    return {.stages = Stage::eTransfer, .access = Access::eTransferRead, .layout = Layout::eTransferSrcOptimal};
+  case ResourceAccess::TransferWrite:
+    return {.stages = Stage::eTransfer,
+            .access = Access::eTransferWrite,
+            .layout = Layout::eTransferDstOptimal,
+            .write = true};
+  }
+  return {};
+}
+
+auto imageUsageFor(ResourceAccess access) -> vk::ImageUsageFlags {
+  switch (access) {
+  case ResourceAccess::ColorAttachment:
+    return vk::ImageUsageFlagBits::eColorAttachment;
+  case ResourceAccess::DepthAttachment:
+  case ResourceAccess::DepthRead:
+    return vk::ImageUsageFlagBits::eDepthStencilAttachment;
+  case ResourceAccess::SampledRead:
+    return vk::ImageUsageFlagBits::eSampled;
+  case ResourceAccess::StorageRead:
+  case ResourceAccess::StorageWrite:
+    return vk::ImageUsageFlagBits::eStorage;
+  case ResourceAccess::TransferRead:
+    return vk::ImageUsageFlagBits::eTransferSrc;
+  case ResourceAccess::TransferWrite:
+    return vk::ImageUsageFlagBits::eTransferDst;
+  default:
+    return {};
+  }
+}
+
+auto bufferUsageFor(ResourceAccess access) -> vk::BufferUsageFlags {
+  switch (access) {
+  // Storage buffers may be read and written through their device address as well
+  case ResourceAccess::StorageRead:
+  case ResourceAccess::StorageWrite:
+    return vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eShaderDeviceAddress;
+  case ResourceAccess::UniformRead:
+    return vk::BufferUsageFlagBits::eUniformBuffer;
+  case ResourceAccess::VertexRead:
+    return vk::BufferUsageFlagBits::eVertexBuffer;
+  case ResourceAccess::IndexRead:
+    return vk::BufferUsageFlagBits::eIndexBuffer;
+  case ResourceAccess::IndirectRead:
+    return vk::BufferUsageFlagBits::eIndirectBuffer;
+  case ResourceAccess::TransferRead:
+    return vk::BufferUsageFlagBits::eTransferSrc;
+  case ResourceAccess::TransferWrite:
+    return vk::BufferUsageFlagBits::eTransferDst;
+  default:
+    return {};
+  }
+}
+
+auto aspectFor(vk::Format format) -> vk::ImageAspectFlags {
+  switch (format) {
+  case vk::Format::eD16Unorm:
+  case vk::Format::eX8D24UnormPack32:
+  case vk::Format::eD32Sfloat:
+    return vk::ImageAspectFlagBits::eDepth;
+  case vk::Format::eD16UnormS8Uint:
+  case vk::Format::eD24UnormS8Uint:
+  case vk::Format::eD32SfloatS8Uint:
+    return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+  case vk::Format::eS8Uint:
+    return vk::ImageAspectFlagBits::eStencil;
+  default:
+    return vk::ImageAspectFlagBits::eColor;
+  }
+}
+
+} // namespace
+
+auto RenderGraphPass::Read(RenderGraphHandle resource, ResourceAccess access) -> RenderGraphPass & {
+  _uses.push_back(Use{.resource = resource, .access = access});
+  return *this;
+}
+
+auto RenderGraphPass::Write(RenderGraphHandle resource, ResourceAccess access) -> RenderGraphPass & {
+  _uses.push_back(Use{.resource = resource, .access = access});
+  return *this;
+}
+
+auto RenderGraphPass::WriteColor(RenderGraphHandle resource, std::optional<std::array<float, 4>> clear)
+    -> RenderGraphPass & {
+  _uses.push_back(Use{.resource = resource, .access = ResourceAccess::ColorAttachment});
+  Attachment attachment{.resource = resource};
+  if (clear.has_value()) {
+    attachment.clear = vk::ClearValue{.color = vk::ClearColorValue{.float32 = clear.value()}};
+  }
+  _color_attachments.push_back(attachment);
+  return *this;
+}
+
+auto RenderGraphPass::WriteDepth(RenderGraphHandle resource, std::optional<float> clear) -> RenderGraphPass & {
+  _uses.push_back(Use{.resource = resource, .access = ResourceAccess::DepthAttachment});
+  Attachment attachment{.resource = resource};
+  if (clear.has_value()) {
+    attachment.clear = vk::ClearValue{.depthStencil = vk::ClearDepthStencilValue{.depth = clear.value()}};
+  }
+  _depth_attachment = attachment;
+  return *this;
+}
+
+auto RenderGraphPass::ReadDepth(RenderGraphHandle resource) -> RenderGraphPass & {
+  _uses.push_back(Use{.resource = resource, .access = ResourceAccess::DepthRead});
+  _depth_attachment = Attachment{.resource = resource, .read_only = true};
+  return *this;
+}
+
+auto RenderGraphPass::SetSideEffects() -> RenderGraphPass & {
+  _side_effects = true;
+  return *this;
+}
+
+auto RenderGraphPass::SetExecute(std::function<void(PassContext &)> execute) -> RenderGraphPass & {
+  _execute = std::move(execute);
+  return *this;
+}
+
+auto RenderGraph::Initialize(const VulkanDevice &device) -> bool {
+  _device = &device;
+  // Transient resources are shared between the graphics and async compute queues without ownership transfers
+  _concurrent_families = {device.GetQueueFamilyIndex(core::QueueType::Graphics)};
+  if (device.GetCapabilities().async_compute_support) {
+    const auto compute_family = device.GetQueueFamilyIndex(core::QueueType::Compute);
+    if (compute_family != _concurrent_families.front()) {
+      _concurrent_families.push_back(compute_family);
+    }
+  }
+  return true;
+}
+
+void RenderGraph::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  Reset();
+  _device = nullptr;
+}
+
+void RenderGraph::Reset() {
+  destroyTransients();
+  _resources.clear();
+  _passes.clear();
+  _schedule.clear();
+  _batches.clear();
+  _last_signals.clear();
+  _statistics = {};
+  _compiled = false;
+}
+
+auto RenderGraph::ImportImage(std::string_view name, vk::Image image, vk::ImageView view,
+                              const RenderGraphImageDesc &desc, vk::ImageLayout initial_layout,
+                              vk::ImageLayout final_layout) -> RenderGraphHandle {
+  Resource resource;
+  resource.name = name;
+  resource.imported = true;
+  resource.image_desc = desc;
+  resource.initial_layout = initial_layout;
+  resource.final_layout = final_layout;
+  resource.image = image;
+  resource.view = view;
+  return addResource(std::move(resource));
+}
+
+void RenderGraph::SetImportedImage(RenderGraphHandle handle, vk::Image image, vk::ImageView view) {
+  auto &resource = _resources.at(handle.index);
+  if (!resource.imported || !resource.is_image) {
+    throw std::runtime_error("SetImportedImage called on a resource that is not an imported image.");
+  }
+  resource.image = image;
+  resource.view = view;
+}
+
+auto RenderGraph::ImportBuffer(std::string_view name, vk::Buffer buffer, vk::DeviceSize size) -> RenderGraphHandle {
+  Resource resource;
+  resource.name = name;
+  resource.is_image = false;
+  resource.imported = true;
+  resource.buffer_desc = RenderGraphBufferDesc{.size = size};
+  resource.buffer = buffer;
+  return addResource(std::move(resource));
+}
+
+auto RenderGraph::CreateImage(std::string_view name, const RenderGraphImageDesc &desc) -> RenderGraphHandle {
+  Resource resource;
+  resource.name = name;
+  resource.image_desc = desc;
+  return addResource(std::move(resource));
+}
+
+auto RenderGraph::CreateBuffer(std::string_view name, const RenderGraphBufferDesc &desc) -> RenderGraphHandle {
+  Resource resource;
+  resource.name = name;
+  resource.is_image = false;
+  resource.buffer_desc = desc;
+  return addResource(std::move(resource));
+}
+
+auto RenderGraph::AddPass(std::string_view name, PassType type) -> RenderGraphPass & {
+  _compiled = false;
+  return *_passes.emplace_back(std::make_unique<RenderGraphPass>(name, type));
+}
+
+void RenderGraph::MarkOutput(RenderGraphHandle handle) {
+  _resources.at(handle.index).output = true;
+  _compiled = false;
+}
+
+auto RenderGraph::addResource(Resource resource) -> RenderGraphHandle {
+  _compiled = false;
+  _resources.push_back(std::move(resource));
+  return RenderGraphHandle{.index = VkToU32(_resources.size() - 1)};
+}
+
+auto RenderGraph::queueFor(PassType type) const -> core::QueueType {
+  return type == PassType::AsyncCompute ? _device->GetAsyncComputeQueueType() : core::QueueType::Graphics;
+}
+
+auto RenderGraph::Compile() -> bool {
+  destroyTransients();
+  _statistics = {};
+  _statistics.declared_passes = VkToU32(_passes.size());
+
+  for (auto &resource : _resources) {
+    resource.first_use = UINT32_MAX;
+    resource.last_use = 0;
+    resource.batches.clear();
+    if (!resource.imported) {
+      resource.image_usage = {};
+      resource.buffer_usage = {};
+    }
+  }
+
+  for (const auto &pass : _passes) {
+    for (const auto &use : pass->_uses) {
+      if (use.resource.index >= _resources.size()) {
+        RENDY_LOG_ERROR("Render graph pass '{}' uses an invalid resource handle", pass->_name);
+        return false;
+      }
+      auto &resource = _resources[use.resource.index];
+      if (resource.is_image) {
+        resource.image_usage |= imageUsageFor(use.access);
+      } else {
+        resource.buffer_usage |= bufferUsageFor(use.access);
+      }
+    }
+    for (const auto &attachment : pass->_color_attachments) {
+      if (!_resources[attachment.resource.index].is_image) {
+        RENDY_LOG_ERROR("Render graph pass '{}' binds buffer '{}' as an attachment", pass->_name,
+                        _resources[attachment.resource.index].name);
+        return false;
+      }
+    }
+  }
+
+  cullPasses();
+  buildBatches();
+  if (!allocateTransients()) {
+    destroyTransients();
+    return false;
+  }
+
+  _last_signals.clear();
+  _compiled = true;
+  RENDY_LOG_INFO("Compiled render graph: {} of {} passes in {} batches, transient memory {} KiB aliased into {} KiB",
+                 _schedule.size(), _passes.size(), _batches.size(), _statistics.transient_bytes / 1024,
+                 _statistics.allocated_bytes / 1024);
+  return true;
+}
+
+void RenderGraph::cullPasses() {
+  const auto pass_count = _passes.size();
+  std::vector<std::vector<uint32_t>> producers(pass_count);
+  std::vector<uint32_t> last_writer(_resources.size(), UINT32_MAX);
+  std::vector<bool> needed(pass_count, false);
+
+  for (uint32_t pass_index = 0; pass_index < pass_count; ++pass_index) {
+    const auto &pass = *_passes[pass_index];
+    needed[pass_index] = pass._side_effects;
+    for (const auto &use : pass._uses) {
+      const auto resource_index = use.resource.index;
+      if (last_writer[resource_index] != UINT32_MAX) {
+        producers[pass_index].push_back(last_writer[resource_index]);
+      }
+      const auto &resource = _resources[resource_index];
+      if (accessInfo(use.access, pass._type).write && (resource.imported || resource.output)) {
+        needed[pass_index] = true;
+      }
+    }
+    for (const auto &use : pass._uses) {
+      if (accessInfo(use.access, pass._type).write) {
+        last_writer[use.resource.index] = pass_index;
+      }
+    }
+  }
+
+  // Producers always come earlier, so one backwards sweep propagates liveness through the whole chain
+  for (auto pass_index = static_cast<int64_t>(pass_count) - 1; pass_index >= 0; --pass_index) {
+    if (needed[pass_index]) {
+      for (const auto producer : producers[pass_index]) {
+        needed[producer] = true;
+      }
+    }
+  }
+
+  _schedule.clear();
+  for (uint32_t pass_index = 0; pass_index < pass_count; ++pass_index) {
+    if (needed[pass_index]) {
+      _schedule.push_back(pass_index);
+    } else {
+      RENDY_LOG_DEBUG("Culled render graph pass '{}'", _passes[pass_index]->_name);
+    }
+  }
+  _statistics.culled_passes = VkToU32(pass_count - _schedule.size());
+}
+
+void RenderGraph::buildBatches() {
+  _batches.clear();
+  std::vector<uint32_t> last_batch(_resources.size(), UINT32_MAX);
+
+  for (uint32_t position = 0; position < _schedule.size(); ++position) {
+    const auto pass_index = _schedule[position];
+    const auto &pass = *_passes[pass_index];
+    const auto queue = queueFor(pass._type);
+    if (_batches.empty() || _batches.back().queue != queue) {
+      const bool first_on_queue =
+          std::ranges::none_of(_batches, [&](const Batch &batch) { return batch.queue == queue; });
+      _batches.push_back(Batch{.queue = queue, .first_on_queue = first_on_queue});
+    }
+    const auto batch_index = VkToU32(_batches.size() - 1);
+    auto &batch = _batches.back();
+    batch.positions.push_back(position);
+
+    for (const auto &use : pass._uses) {
+      const auto resource_index = use.resource.index;
+      const auto previous = last_batch[resource_index];
+      if (previous != UINT32_MAX && _batches[previous].queue != queue &&
+          std::ranges::find(batch.waits, previous) == batch.waits.end()) {
+        batch.waits.push_back(previous);
+      }
+      last_batch[resource_index] = batch_index;
+
+      auto &resource = _resources[resource_index];
+      resource.first_use = std::min(resource.first_use, position);
+      resource.last_use = std::max(resource.last_use, position);
+      if (resource.batches.empty() || resource.batches.back() != batch_index) {
+        resource.batches.push_back(batch_index);
+      }
+    }
+  }
+
+  // Timeline values only grow, so waiting on the latest batch of each queue covers the earlier ones
+  for (auto &batch : _batches) {
+    std::map<core::QueueType, uint32_t> latest;
+    for (const auto wait : batch.waits) {
+      auto &entry = latest[_batches[wait].queue];
+      entry = std::max(entry, wait);
+    }
+    batch.waits.clear();
+    for (const auto &[queue, wait] : latest) {
+      batch.waits.push_back(wait);
+    }
+    if (batch.queue == core::QueueType::Compute) {
+      ++_statistics.async_compute_batches;
+    }
+  }
+  _statistics.batches = VkToU32(_batches.size());
+}
+
+auto RenderGraph::allocateTransients() -> bool {
+  const auto vk_device = _device->Get();
+  const bool concurrent = _concurrent_families.size() > 1;
+  const auto sharing_mode = concurrent ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive;
+  const auto family_count = concurrent ? VkToU32(_concurrent_families.size()) : 0;
+  const auto *families = concurrent ? _concurrent_families.data() : nullptr;
+
+  std::vector<uint32_t> transients;
+  for (uint32_t index = 0; index < _resources.size(); ++index) {
+    auto &resource = _resources[index];
+    if (resource.imported || resource.first_use == UINT32_MAX) {
+      continue;
+    }
+    if (resource.is_image) {
+      const auto &desc = resource.image_desc;
+      resource.image = VkCheckAndUnwrap(
+          vk_device.createImage(vk::ImageCreateInfo{
+              .imageType = vk::ImageType::e2D,
+              .format = desc.format,
+              .extent = vk::Extent3D{.width = desc.extent.width, .height = desc.extent.height, .depth = 1},
+              .mipLevels = desc.mip_levels,
+              .arrayLayers = 1,
+              .samples = desc.samples,
+              .tiling = vk::ImageTiling::eOptimal,
+              .usage = resource.image_usage,
+              .sharingMode = sharing_mode,
+              .queueFamilyIndexCount = family_count,
+              .pQueueFamilyIndices = families,
+              .initialLayout = vk::ImageLayout::eUndefined}),
+          "Failed to create render graph image.");
+      resource.requirements = vk_device.getImageMemoryRequirements(resource.image);
+    } else {
+      resource.buffer = VkCheckAndUnwrap(vk_device.createBuffer(vk::BufferCreateInfo{
+                                             .size = resource.buffer_desc.size,
+                                             .usage = resource.buffer_usage,
+                                             .sharingMode = sharing_mode,
+                                             .queueFamilyIndexCount = family_count,
+                                             .pQueueFamilyIndices = families}),
+                                         "Failed to create render graph buffer.");
+      resource.requirements = vk_device.getBufferMemoryRequirements(resource.buffer);
+    }
+    _statistics.transient_bytes += resource.requirements.size;
+    transients.push_back(index);
+  }
+
+  // batch_order[b][a] is true when batch a is guaranteed to finish before batch b starts, either through submission
+  // order on the same queue or through a chain of timeline waits
+  const auto batch_count = _batches.size();
+  std::vector<std::vector<bool>> batch_order(batch_count, std::vector<bool>(batch_count, false));
+  for (size_t later = 0; later < batch_count; ++later) {
+    for (size_t earlier = 0; earlier < later; ++earlier) {
+      const auto &waits = _batches[later].waits;
+      if (_batches[earlier].queue != _batches[later].queue &&
+          std::ranges::find(waits, static_cast<uint32_t>(earlier)) == waits.end()) {
+        continue;
+      }
+      batch_order[later][earlier] = true;
+      for (size_t transitive = 0; transitive < earlier; ++transitive) {
+        if (batch_order[earlier][transitive]) {
+          batch_order[later][transitive] = true;
+        }
+      }
+    }
+  }
+
+  // Largest first, so smaller resources fill slots that are already big enough
+  std::ranges::sort(transients, [&](uint32_t lhs, uint32_t rhs) {
+    return _resources[lhs].requirements.size > _resources[rhs].requirements.size;
+  });
+  _alias_slots.clear();
+  for (const auto index : transients) {
+    const auto &resource = _resources[index];
+    AliasSlot *target = nullptr;
+    for (auto &slot : _alias_slots) {
+      // Buffers and optimal tiling images stay apart to keep bufferImageGranularity out of the picture
+      if (slot.is_image != resource.is_image ||
+          (slot.requirements.memoryTypeBits & resource.requirements.memoryTypeBits) == 0) {
+        continue;
+      }
+      if (std::ranges::all_of(slot.resources,
+                              [&](uint32_t member) { return canAlias(_resources[member], resource, batch_order); })) {
+        target = &slot;
+        break;
+      }
+    }
+    if (target == nullptr) {
+      target = &_alias_slots.emplace_back(
+          AliasSlot{.is_image = resource.is_image, .requirements = resource.requirements});
+    } else {
+      target->requirements.size = std::max(target->requirements.size, resource.requirements.size);
+      target->requirements.alignment = std::max(target->requirements.alignment, resource.requirements.alignment);
+      target->requirements.memoryTypeBits &= resource.requirements.memoryTypeBits;
+    }
+    target->resources.push_back(index);
+  }
+
+  auto &allocator = _device->GetAllocator();
+  for (auto &slot : _alias_slots) {
+    slot.allocation = allocator.Allocate(
+        slot.requirements, AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eDeviceLocal});
+    if (slot.allocation == nullptr) {
+      RENDY_LOG_ERROR("Failed to allocate {} bytes of render graph memory", slot.requirements.size);
+      return false;
+    }
+    _statistics.allocated_bytes += slot.requirements.size;
+
+    for (const auto index : slot.resources) {
+      auto &resource = _resources[index];
+      if (!resource.is_image) {
+        VkCheck(vk_device.bindBufferMemory(resource.buffer, slot.allocation->memory, slot.allocation->offset),
+                "Failed to bind render graph buffer memory.");
+        continue;
+      }
+      VkCheck(vk_device.bindImageMemory(resource.image, slot.allocation->memory, slot.allocation->offset),
+              "Failed to bind render graph image memory.");
+      resource.view = VkCheckAndUnwrap(
+          vk_device.createImageView(vk::ImageViewCreateInfo{
+              .image = resource.image,
+              .viewType = vk::ImageViewType::e2D,
+              .format = resource.image_desc.format,
+              .subresourceRange = vk::ImageSubresourceRange{.aspectMask = aspectFor(resource.image_desc.format),
+                                                            .levelCount = resource.image_desc.mip_levels,
+                                                            .layerCount = 1}}),
+          "Failed to create render graph image view.");
+    }
+  }
+  return true;
+}
+
+auto RenderGraph::canAlias(const Resource &lhs, const Resource &rhs,
+                           const std::vector<std::vector<bool>> &batch_order) const -> bool {
+  const auto finishes_before = [&](const Resource &first, const Resource &second) {
+    for (const auto first_batch : first.batches) {
+      for (const auto second_batch : second.batches) {
+        if (first_batch == second_batch ? first.last_use >= second.first_use
+                                        : !batch_order[second_batch][first_batch]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  };
+  return finishes_before(lhs, rhs) || finishes_before(rhs, lhs);
+}
+
+void RenderGraph::destroyTransients() {
+  if (_device == nullptr) {
+    return;
+  }
+  const bool has_transients = std::ranges::any_of(
+      _resources, [](const Resource &resource) { return !resource.imported && (resource.image || resource.buffer); });
+  if (!has_transients && _alias_slots.empty()) {
+    return;
+  }
+
+  // Earlier executions may still be using the memory
+  _device->WaitIdle();
+  const auto vk_device = _device->Get();
+  for (auto &resource : _resources) {
+    if (resource.imported) {
+      continue;
+    }
+    vk_device.destroyImageView(resource.view);
+    vk_device.destroyImage(resource.image);
+    vk_device.destroyBuffer(resource.buffer);
+    resource.view = nullptr;
+    resource.image = nullptr;
+    resource.buffer = nullptr;
+  }
+  for (auto &slot : _alias_slots) {
+    _device->GetAllocator().Free(slot.allocation);
+  }
+  _alias_slots.clear();
+}
+
+void RenderGraph::Execute(FrameScheduler &scheduler, uint32_t thread_index) {
+  if (!_compiled) {
+    throw std::runtime_error("Render graph executed before it was compiled.");
+  }
+  RENDY_PROFILE_ZONE("RenderGraph::Execute");
+  _statistics.barrier_calls = 0;
+  _statistics.image_barriers = 0;
+
+  std::vector<AccessState> states(_resources.size());
+  for (size_t index = 0; index < _resources.size(); ++index) {
+    const auto &resource = _resources[index];
+    auto &state = states[index];
+    state.layout = resource.imported ? resource.initial_layout : vk::ImageLayout::eUndefined;
+    // Whatever used the memory before, an earlier execution or another aliased resource, has to be done with it
+    state.write_stages = vk::PipelineStageFlagBits2::eAllCommands;
+    state.write_access = vk::AccessFlagBits2::eMemoryWrite;
+  }
+
+  auto &command_context = scheduler.GetCommandContext();
+  std::vector<uint64_t> batch_values(_batches.size(), 0);
+  std::map<core::QueueType, uint64_t> signals;
+
+  for (size_t batch_index = 0; batch_index < _batches.size(); ++batch_index) {
+    const auto &batch = _batches[batch_index];
+    auto &command_list = command_context.Allocate(thread_index, batch.queue);
+    command_list.Begin();
+    for (const auto position : batch.positions) {
+      recordPass(position, command_list, batch.queue, states);
+    }
+    if (batch_index + 1 == _batches.size()) {
+      recordFinalTransitions(command_list, batch.queue, states);
+    }
+    command_list.End();
+
+    std::vector<vk::SemaphoreSubmitInfo> waits;
+    for (const auto wait : batch.waits) {
+      waits.push_back(vk::SemaphoreSubmitInfo{.semaphore = _device->GetTimeline(_batches[wait].queue).Get(),
+                                              .value = batch_values[wait],
+                                              .stageMask = vk::PipelineStageFlagBits2::eAllCommands});
+    }
+    if (batch.first_on_queue) {
+      // Transient memory is reused every execution, so the other queue must be done with the previous one
+      for (const auto &[queue, value] : _last_signals) {
+        if (queue != batch.queue) {
+          waits.push_back(vk::SemaphoreSubmitInfo{.semaphore = _device->GetTimeline(queue).Get(),
+                                                  .value = value,
+                                                  .stageMask = vk::PipelineStageFlagBits2::eAllCommands});
+        }
+      }
+    }
+
+    const std::array<VulkanCommandList *, 1> command_lists{&command_list};
+    const SubmitBatch submit{.command_lists = command_lists, .wait_semaphores = waits};
+    batch_values[batch_index] = scheduler.Submit(batch.queue, std::span(&submit, 1));
+    signals[batch.queue] = batch_values[batch_index];
+  }
+  _last_signals = std::move(signals);
+}
+
+void RenderGraph::recordPass(uint32_t position, VulkanCommandList &command_list, core::QueueType queue,
+                             std::vector<AccessState> &states) {
+  const auto &pass = *_passes[_schedule[position]];
+  const GpuScope zone(_profiler, command_list, pass._name);
+
+  // A pass may touch a resource more than once, e.g. sample and store. One barrier per resource has to cover all of it.
+  std::map<uint32_t, AccessInfo> merged;
+  for (const auto &use : pass._uses) {
+    const auto info = accessInfo(use.access, pass._type);
+    auto [it, inserted] = merged.try_emplace(use.resource.index, info);
+    if (!inserted) {
+      auto &combined = it->second;
+      combined.stages |= info.stages;
+      combined.access |= info.access;
+      combined.write = combined.write || info.write;
+      if (combined.layout != info.layout) {
+        combined.layout = vk::ImageLayout::eGeneral;
+      }
+    }
+  }
+
+  std::vector<vk::ImageMemoryBarrier2> image_barriers;
+  vk::MemoryBarrier2 memory_barrier{};
+  bool has_memory_barrier = false;
+
+  for (const auto &[resource_index, info] : merged) {
+    const auto &resource = _resources[resource_index];
+    auto &state = states[resource_index];
+    if (state.queue.has_value() && state.queue.value() != queue) {
+      // The timeline wait between the batches already made the other queue's work available
+      state.write_stages = vk::PipelineStageFlagBits2::eAllCommands;
+      state.write_access = {};
+      state.synced_read_stages = {};
+      state.pending_read_stages = {};
+    }
+    state.queue = queue;
+
+    const auto new_layout = resource.is_image ? info.layout : vk::ImageLayout::eUndefined;
+    const bool layout_change = resource.is_image && state.layout != new_layout;
+    vk::PipelineStageFlags2 src_stages;
+    vk::AccessFlags2 src_access;
+    bool needs_barrier = false;
+
+    if (info.write || layout_change) {
+      src_stages = state.write_stages | state.pending_read_stages;
+      src_access = state.write_access;
+      needs_barrier = layout_change || src_stages;
+      state.write_stages = info.stages;
+      state.write_access = info.write ? info.access : vk::AccessFlags2{};
+      state.synced_read_stages = info.write ? vk::PipelineStageFlags2{} : info.stages;
+      state.pending_read_stages = state.synced_read_stages;
+    } else {
+      if (state.write_stages && (state.synced_read_stages & info.stages) != info.stages) {
+        src_stages = state.write_stages;
+        src_access = state.write_access;
+        needs_barrier = true;
+        state.synced_read_stages |= info.stages;
+      }
+      state.pending_read_stages |= info.stages;
+    }
+    if (!needs_barrier) {
+      continue;
+    }
+    if (!src_stages) {
+      src_stages = vk::PipelineStageFlagBits2::eNone;
+    }
+
+    if (resource.is_image) {
+      image_barriers.push_back(vk::ImageMemoryBarrier2{
+          .srcStageMask = src_stages,
+          .srcAccessMask = src_access,
+          .dstStageMask = info.stages,
+          .dstAccessMask = info.access,
+          .oldLayout = state.layout,
+          .newLayout = new_layout,
+          .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+          .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+          .image = resource.image,
+          .subresourceRange = vk::ImageSubresourceRange{.aspectMask = aspectFor(resource.image_desc.format),
+                                                        .levelCount = resource.image_desc.mip_levels,
+                                                        .layerCount = 1}});
+      state.layout = new_layout;
+    } else {
+      // Buffers have no layout, so all their hazards collapse into one global memory barrier
+      memory_barrier.srcStageMask |= src_stages;
+      memory_barrier.srcAccessMask |= src_access;
+      memory_barrier.dstStageMask |= info.stages;
+      memory_barrier.dstAccessMask |= info.access;
+      has_memory_barrier = true;
+    }
+  }
+
+  const auto command_buffer = command_list.Get();
+  if (!image_barriers.empty() || has_memory_barrier) {
+    command_buffer.pipelineBarrier2(vk::DependencyInfo{.memoryBarrierCount = has_memory_barrier ? 1U : 0U,
+                                                       .pMemoryBarriers = &memory_barrier,
+                                                       .imageMemoryBarrierCount = VkToU32(image_barriers.size()),
+                                                       .pImageMemoryBarriers = image_barriers.data()});
+    ++_statistics.barrier_calls;
+    _statistics.image_barriers += VkToU32(image_barriers.size());
+  }
+
+  const bool renders = pass._type == PassType::Raster &&
+                       (!pass._color_attachments.empty() || pass._depth_attachment.has_value());
+  if (renders) {
+    vk::Extent2D extent{};
+    const auto attachment_info = [&](const RenderGraphPass::Attachment &attachment) {
+      const auto &resource = _resources[attachment.resource.index];
+      extent = resource.image_desc.extent;
+      // Transient contents don't need to be loaded before their first write or stored after their last use
+      const bool transient = !resource.imported && !resource.output;
+      auto load_op = vk::AttachmentLoadOp::eLoad;
+      if (attachment.clear.has_value()) {
+        load_op = vk::AttachmentLoadOp::eClear;
+      } else if (transient && resource.first_use == position && !attachment.read_only) {
+        load_op = vk::AttachmentLoadOp::eDontCare;
+      }
+      auto store_op = vk::AttachmentStoreOp::eStore;
+      if (attachment.read_only) {
+        store_op = vk::AttachmentStoreOp::eNone;
+      } else if (transient && resource.last_use == position) {
+        store_op = vk::AttachmentStoreOp::eDontCare;
+      }
+      return vk::RenderingAttachmentInfo{.imageView = resource.view,
+                                         .imageLayout = states[attachment.resource.index].layout,
+                                         .loadOp = load_op,
+                                         .storeOp = store_op,
+                                         .clearValue = attachment.clear.value_or(vk::ClearValue{})};
+    };
+
+    std::vector<vk::RenderingAttachmentInfo> color_attachments;
+    color_attachments.reserve(pass._color_attachments.size());
+    for (const auto &attachment : pass._color_attachments) {
+      color_attachments.push_back(attachment_info(attachment));
+    }
+    vk::RenderingAttachmentInfo depth_attachment{};
+    bool has_stencil = false;
+    if (pass._depth_attachment.has_value()) {
+      depth_attachment = attachment_info(pass._depth_attachment.value());
+      const auto format = _resources[pass._depth_attachment->resource.index].image_desc.format;
+      has_stencil = static_cast<bool>(aspectFor(format) & vk::ImageAspectFlagBits::eStencil);
+    }
+
+    command_buffer.beginRendering(vk::RenderingInfo{
+        .renderArea = vk::Rect2D{.extent = extent},
+        .layerCount = 1,
+        .colorAttachmentCount = VkToU32(color_attachments.size()),
+        .pColorAttachments = color_attachments.data(),
+        .pDepthAttachment = pass._depth_attachment.has_value() ? &depth_attachment : nullptr,
+        .pStencilAttachment = has_stencil ? &depth_attachment : nullptr});
+  }
+
+  if (pass._execute) {
+    PassContext context{.command_list = command_list, .graph = *this};
+    pass._execute(context);
+  }
+
+  if (renders) {
+    command_buffer.endRendering();
+  }
+}
+
+void RenderGraph::recordFinalTransitions(VulkanCommandList &command_list, core::QueueType queue,
+                                         std::vector<AccessState> &states) {
+  std::vector<vk::ImageMemoryBarrier2> barriers;
+  for (size_t index = 0; index < _resources.size(); ++index) {
+    const auto &resource = _resources[index];
+    auto &state = states[index];
+    if (!resource.imported || !resource.is_image || resource.final_layout == vk::ImageLayout::eUndefined ||
+        resource.final_layout == state.layout) {
+      continue;
+    }
+    const bool other_queue = state.queue.has_value() && state.queue.value() != queue;
+    barriers.push_back(vk::ImageMemoryBarrier2{
+        .srcStageMask = other_queue ? vk::PipelineStageFlagBits2::eAllCommands
+                                    : state.write_stages | state.pending_read_stages,
+        .srcAccessMask = other_queue ? vk::AccessFlags2{} : state.write_access,
+        .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+        .oldLayout = state.layout,
+        .newLayout = resource.final_layout,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = resource.image,
+        .subresourceRange = vk::ImageSubresourceRange{.aspectMask = aspectFor(resource.image_desc.format),
+                                                      .levelCount = resource.image_desc.mip_levels,
+                                                      .layerCount = 1}});
+    state.layout = resource.final_layout;
+  }
+  if (barriers.empty()) {
+    return;
+  }
+  command_list.Get().pipelineBarrier2(
+      vk::DependencyInfo{.imageMemoryBarrierCount = VkToU32(barriers.size()), .pImageMemoryBarriers = barriers.data()});
+  ++_statistics.barrier_calls;
+  _statistics.image_barriers += VkToU32(barriers.size());
+}
+
+auto RenderGraph::GetImage(RenderGraphHandle handle) const -> vk::Image { return _resources.at(handle.index).image; }
+
+auto RenderGraph::GetImageView(RenderGraphHandle handle) const -> vk::ImageView {
+  return _resources.at(handle.index).view;
+}
+
+auto RenderGraph::GetBuffer(RenderGraphHandle handle) const -> vk::Buffer { return _resources.at(handle.index).buffer; }
+
+auto RenderGraph::GetBufferAddress(RenderGraphHandle handle) const -> vk::DeviceAddress {
+  const auto &resource = _resources.at(handle.index);
+  // The graph only knows the usage of the buffers it creates; imported ones may lack eShaderDeviceAddress
+  if (resource.imported || resource.is_image ||
+      !(resource.buffer_usage & vk::BufferUsageFlagBits::eShaderDeviceAddress)) {
+    throw std::runtime_error("GetBufferAddress called on a resource that is not a graph buffer with storage access.");
+  }
+  return _device->Get().getBufferAddress(vk::BufferDeviceAddressInfo{.buffer = resource.buffer});
+}
+
+} // namespace rendy::graphics::vulkan
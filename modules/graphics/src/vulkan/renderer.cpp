@@ -1,52 +1,354 @@
 #include "vulkan/renderer.hpp"
+#include "common/log.hpp"
 #include "vulkan/device.hpp"
 #include "vulkan/instance.hpp"
+#include "vulkan/utils.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <memory>
 #include <span>
-#include <spdlog/spdlog.h>
+#include <string_view>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_core.h>
 
 namespace rendy::graphics::vulkan {
 
-void Renderer::Initialize(GLFWwindow &window) {
+namespace {
+
+// Enabled when available; together they provide the instance side of VK_EXT_swapchain_maintenance1
+constexpr std::array<const char *, 2> kSurfaceMaintenanceExtensions{vk::KHRGetSurfaceCapabilities2ExtensionName,
+                                                                     vk::EXTSurfaceMaintenance1ExtensionName};
+constexpr std::array<const char *, 2> kHeadlessSurfaceExtensions{vk::KHRSurfaceExtensionName,
+                                                                 vk::EXTHeadlessSurfaceExtensionName};
+// Modules the renderer's own passes load, compiled while the device is being created
+constexpr std::array<std::string_view, 2> kPreloadedShaders{"culling", "depth_pyramid"};
+
+// Orders every earlier and later command on the queue against the layout change, so nothing recorded between
+// BeginFrame and EndFrame needs to know about the acquire and present
+void transitionBackbuffer(const VulkanCommandList &command_list, vk::Image image, vk::ImageLayout old_layout,
+                          vk::ImageLayout new_layout) {
+  const vk::ImageMemoryBarrier2 barrier{
+      .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+      .srcAccessMask = vk::AccessFlagBits2::eMemoryWrite,
+      .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+      .dstAccessMask = vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite,
+      .oldLayout = old_layout,
+      .newLayout = new_layout,
+      .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .image = image,
+      .subresourceRange =
+          vk::ImageSubresourceRange{.aspectMask = vk::ImageAspectFlagBits::eColor, .levelCount = 1, .layerCount = 1}};
+  command_list.Get().pipelineBarrier2(
+      vk::DependencyInfo{.imageMemoryBarrierCount = 1, .pImageMemoryBarriers = &barrier});
+}
+
+} // namespace
+
+void Renderer::Initialize(GLFWwindow &window, const FrameSchedulerConfig &frame_config,
+                          const SwapchainConfig &swapchain_config) {
   if (glfwVulkanSupported() == GLFW_FALSE) {
     throw std::runtime_error("Glfw Vulkan support not found.");
   }
+  beginStartup();
 
   uint32_t glfw_instance_extensions_count{};
   const auto *glfw_instance_extensions = glfwGetRequiredInstanceExtensions(&glfw_instance_extensions_count);
   const auto glfw_instance_extensions_span = std::span{glfw_instance_extensions, glfw_instance_extensions_count};
 
-  _instance = std::make_unique<Instance>();
-  if (!_instance->Initialize(glfw_instance_extensions_span)) {
-    throw std::runtime_error("Failed to create Vulkan instance.");
+  {
+    const auto phase = _startup_timer.Measure("Instance");
+    _instance = std::make_unique<Instance>();
+    if (!_instance->Initialize(glfw_instance_extensions_span, kSurfaceMaintenanceExtensions)) {
+      throw std::runtime_error("Failed to create Vulkan instance.");
+    }
   }
   VkSurfaceKHR surface{};
   if (glfwCreateWindowSurface(_instance->Get(), &window, nullptr, &surface) != VK_SUCCESS) {
     const char *error{};
     glfwGetError(&error);
-    spdlog::error("Window could not be created! GLFW Error: {}", error);
+    RENDY_LOG_ERROR("Window could not be created! GLFW Error: {}", error);
     throw std::runtime_error("Failed to create Vulkan surface.");
   }
   _surface = std::make_unique<vk::SurfaceKHR>(surface);
-  _physical_device = std::make_unique<PhysicalDevice>();
-  if (!_physical_device->Initialize(*_instance, *_surface)) {
-    throw std::runtime_error("Failed to choose a valid Vulkan physical device.");
+  _window = &window;
+  initializeDevice(*_surface, frame_config);
+  initializeSwapchain(swapchain_config);
+  finishStartup();
+}
+
+void Renderer::InitializeHeadless(vk::Extent2D extent, const FrameSchedulerConfig &frame_config) {
+  beginStartup();
+  {
+    const auto phase = _startup_timer.Measure("Instance");
+    _instance = std::make_unique<Instance>();
+    if (!_instance->Initialize({})) {
+      throw std::runtime_error("Failed to create Vulkan instance.");
+    }
+  }
+  initializeDevice(nullptr, frame_config);
+
+  {
+    const auto phase = _startup_timer.Measure("Offscreen target");
+    _offscreen_target = std::make_unique<OffscreenTarget>();
+    if (!_offscreen_target->Initialize(*_device, extent)) {
+      throw std::runtime_error("Failed to create offscreen target.");
+    }
+  }
+  finishStartup();
+}
+
+void Renderer::InitializeHeadlessSurface(vk::Extent2D extent, const FrameSchedulerConfig &frame_config,
+                                         const SwapchainConfig &swapchain_config) {
+  beginStartup();
+  {
+    const auto phase = _startup_timer.Measure("Instance");
+    _instance = std::make_unique<Instance>();
+    if (!_instance->Initialize(kHeadlessSurfaceExtensions, kSurfaceMaintenanceExtensions)) {
+      throw std::runtime_error("Failed to create Vulkan instance.");
+    }
+  }
+  const auto surface = VkCheckAndUnwrap(_instance->Get().createHeadlessSurfaceEXT(vk::HeadlessSurfaceCreateInfoEXT{}),
+                                        "Failed to create headless surface.");
+  _surface = std::make_unique<vk::SurfaceKHR>(surface);
+  _surface_extent = extent;
+  initializeDevice(*_surface, frame_config);
+  initializeSwapchain(swapchain_config);
+  finishStartup();
+}
+
+void Renderer::beginStartup() {
+  _first_frame.reset();
+  _startup_timer.Reset();
+  {
+    const auto phase = _startup_timer.Measure("Job system");
+    _job_system = std::make_unique<common::JobSystem>();
+    if (!_job_system->Initialize()) {
+      throw std::runtime_error("Failed to create job system.");
+    }
+  }
+
+  // Shaders only need the file system, so they compile while the driver creates the instance and device
+  _shader_library = std::make_unique<ShaderLibrary>();
+  _job_system->Run(
+      [this] {
+        const auto phase = _startup_timer.Measure("Shader library");
+        _shader_library_ready = _shader_library->Initialize();
+        if (_shader_library_ready) {
+          _shader_library->Preload(kPreloadedShaders, *_job_system);
+        }
+      },
+      &_startup_jobs);
+}
+
+void Renderer::finishStartup() {
+  _startup_timer.LogReport();
+  _first_frame.emplace(_startup_timer, "First frame");
+}
+
+void Renderer::initializeDevice(vk::SurfaceKHR surface, const FrameSchedulerConfig &frame_config) {
+  {
+    const auto phase = _startup_timer.Measure("Physical device");
+    _physical_device = std::make_unique<PhysicalDevice>();
+    if (!_physical_device->Initialize(*_instance, surface)) {
+      throw std::runtime_error("Failed to choose a valid Vulkan physical device.");
+    }
+  }
+  RENDY_LOG_INFO("Selected a physical device.");
+
+  // The cache file is validated against the physical device only, so reading it overlaps device creation
+  _job_system->Run(
+      [this] {
+        const auto phase = _startup_timer.Measure("Pipeline cache read");
+        _pipeline_cache = PipelineCache::Read(*_physical_device, PipelineCompilerConfig{}.cache_directory);
+      },
+      &_pipeline_cache_read);
+
+  {
+    const auto phase = _startup_timer.Measure("Device");
+    _device = std::make_unique<VulkanDevice>(_physical_device);
+    if (!_device->Initialize()) {
+      throw std::runtime_error("Failed to create Vulkan device");
+    }
+  }
+
+  {
+    const auto phase = _startup_timer.Measure("Frame scheduler");
+    // Lets every job system thread record into its own command pools, indexed by GetThreadIndex
+    auto scheduler_config = frame_config;
+    scheduler_config.recording_threads = std::max(frame_config.recording_threads, _job_system->GetWorkerCount() + 1);
+    _frame_scheduler = std::make_unique<FrameScheduler>();
+    if (!_frame_scheduler->Initialize(*_device, scheduler_config)) {
+      throw std::runtime_error("Failed to create frame scheduler.");
+    }
+  }
+
+  _gpu_profiler = std::make_unique<GpuProfiler>();
+  if (!_gpu_profiler->Initialize(*_device, _frame_scheduler->GetFramesInFlight())) {
+    throw std::runtime_error("Failed to create GPU profiler.");
+  }
+
+  _job_system->Wait(_pipeline_cache_read);
+  {
+    const auto phase = _startup_timer.Measure("Pipeline compiler");
+    _pipeline_compiler = std::make_unique<PipelineCompiler>();
+    if (!_pipeline_compiler->Initialize(*_device, *_job_system, std::move(_pipeline_cache))) {
+      throw std::runtime_error("Failed to create pipeline compiler.");
+    }
+  }
+
+  if (_device->GetCapabilities().bindless_support) {
+    const auto phase = _startup_timer.Measure("Bindless heap");
+    _bindless_heap = std::make_unique<BindlessHeap>();
+    if (!_bindless_heap->Initialize(*_device)) {
+      throw std::runtime_error("Failed to create bindless heap.");
+    }
+  } else {
+    RENDY_LOG_WARN("Descriptor indexing is unavailable, resources can only be bound through push descriptors");
+  }
+
+  {
+    const auto phase = _startup_timer.Measure("Texture streamer");
+    _texture_streamer = std::make_unique<TextureStreamer>();
+    if (!_texture_streamer->Initialize(*_device, *_job_system, _bindless_heap.get())) {
+      throw std::runtime_error("Failed to create texture streamer.");
+    }
   }
-  spdlog::info("Selected a physical device.");
 
-  _device = std::make_unique<VulkanDevice>(_physical_device);
-  if (!_device->Initialize()) {
-    throw std::runtime_error("Failed to create Vulkan device");
+  _job_system->Wait(_startup_jobs);
+  if (!_shader_library_ready) {
+    throw std::runtime_error("Failed to create shader library.");
   }
 }
 
+void Renderer::initializeSwapchain(const SwapchainConfig &swapchain_config) {
+  const auto phase = _startup_timer.Measure("Swapchain");
+  _swapchain = std::make_unique<Swapchain>();
+  if (!_swapchain->Initialize(*_device, *_surface, surfaceExtent(), swapchain_config)) {
+    throw std::runtime_error("Failed to create swapchain.");
+  }
+}
+
+auto Renderer::surfaceExtent() const -> vk::Extent2D {
+  if (_window == nullptr) {
+    return _surface_extent;
+  }
+  int width = 0;
+  int height = 0;
+  glfwGetFramebufferSize(_window, &width, &height);
+  return vk::Extent2D{.width = static_cast<uint32_t>(width), .height = static_cast<uint32_t>(height)};
+}
+
+void Renderer::WaitForLatency() const {
+  if (_swapchain) {
+    _swapchain->WaitForLatency();
+  }
+}
+
+auto Renderer::BeginFrame() -> FrameContext {
+  // Reload callbacks run before any recording so the frame only sees the new shaders
+  _shader_library->ProcessReloads();
+  auto frame = _frame_scheduler->BeginFrame();
+  _gpu_profiler->BeginFrame(frame);
+  RENDY_PROFILE_ZONE("Renderer::BeginFrame");
+  if (_bindless_heap) {
+    _bindless_heap->Collect();
+  }
+  _texture_streamer->Update(frame.frame_index);
+  if (_swapchain) {
+    acquireBackbuffer();
+  }
+  return frame;
+}
+
+void Renderer::EndFrame() {
+  if (_backbuffer.has_value()) {
+    presentBackbuffer();
+  }
+  _frame_scheduler->EndFrame();
+  if (_first_frame.has_value()) {
+    _first_frame.reset();
+    RENDY_LOG_INFO("First frame ended {:.1f} ms after startup began",
+                   std::chrono::duration<double, std::milli>(_startup_timer.GetTotal()).count());
+  }
+}
+
+void Renderer::acquireBackbuffer() {
+  const auto extent = surfaceExtent();
+  if (_swapchain->NeedsRecreate() || extent != _swapchain->GetExtent()) {
+    // Old swapchain images still queued for presentation are retired, not waited for
+    if (!_swapchain->Recreate(extent)) {
+      return;
+    }
+  }
+  _backbuffer = _swapchain->AcquireNextImage();
+  if (!_backbuffer.has_value()) {
+    return;
+  }
+
+  auto &command_list = _frame_scheduler->GetCommandContext().Allocate(0, core::QueueType::Graphics);
+  command_list.Begin();
+  // The previous contents are discarded, the frame is expected to write the whole image
+  transitionBackbuffer(command_list, _backbuffer->image, vk::ImageLayout::eUndefined,
+                       vk::ImageLayout::eColorAttachmentOptimal);
+  command_list.End();
+  const std::array<VulkanCommandList *, 1> command_lists{&command_list};
+  const vk::SemaphoreSubmitInfo wait{.semaphore = _backbuffer->acquired,
+                                     .stageMask = vk::PipelineStageFlagBits2::eAllCommands};
+  const SubmitBatch batch{.command_lists = command_lists, .wait_semaphores = std::span(&wait, 1)};
+  _frame_scheduler->Submit(core::QueueType::Graphics, std::span(&batch, 1));
+}
+
+void Renderer::presentBackbuffer() {
+  auto &command_list = _frame_scheduler->GetCommandContext().Allocate(0, core::QueueType::Graphics);
+  command_list.Begin();
+  transitionBackbuffer(command_list, _backbuffer->image, vk::ImageLayout::eColorAttachmentOptimal,
+                       vk::ImageLayout::ePresentSrcKHR);
+  command_list.End();
+  const std::array<VulkanCommandList *, 1> command_lists{&command_list};
+  const vk::SemaphoreSubmitInfo signal{.semaphore = _backbuffer->rendered,
+                                       .stageMask = vk::PipelineStageFlagBits2::eAllCommands};
+  const SubmitBatch batch{.command_lists = command_lists, .signal_semaphores = std::span(&signal, 1)};
+  _frame_scheduler->Submit(core::QueueType::Graphics, std::span(&batch, 1));
+  _swapchain->Present(_backbuffer.value());
+  _backbuffer.reset();
+}
+
 void Renderer::Destroy() {
+  if (_frame_scheduler) {
+    _frame_scheduler->Destroy();
+  }
+  if (_swapchain) {
+    _swapchain->Destroy();
+  }
+  if (_shader_library) {
+    _shader_library->Destroy();
+  }
+  if (_texture_streamer) {
+    _texture_streamer->Destroy();
+  }
+  if (_bindless_heap) {
+    _bindless_heap->Destroy();
+  }
+  if (_pipeline_compiler) {
+    _pipeline_compiler->Destroy();
+  }
+  if (_gpu_profiler) {
+    _gpu_profiler->Destroy();
+  }
+  if (_offscreen_target) {
+    _offscreen_target->Destroy();
+  }
   _device->Cleanup();
-  _instance->Get().destroySurfaceKHR(*_surface);
+  if (_surface) {
+    _instance->Get().destroySurfaceKHR(*_surface);
+  }
   _instance->Destroy();
+  if (_job_system) {
+    _job_system->Destroy();
+  }
 }
 
 } // namespace rendy::graphics::vulkan
@@ -0,0 +1,401 @@
+#include "vulkan/shader_library.hpp"
+#include "common/log.hpp"
+#include "core/hash.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace rendy::graphics::vulkan {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Keep in sync with rendy_add_shaders in cmake/RendyShaders.cmake so runtime and build output match
+constexpr std::string_view kCompilerOptions = "-target spirv -fvk-use-entrypoint-name";
+
+#ifdef _WIN32
+constexpr std::string_view kExecutableSuffix = ".exe";
+constexpr char kPathSeparator = ';';
+#else
+constexpr std::string_view kExecutableSuffix;
+constexpr char kPathSeparator = ':';
+#endif
+
+auto readFile(const fs::path &path) -> std::optional<std::string> {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return std::nullopt;
+  }
+  std::ostringstream stream;
+  stream << file.rdbuf();
+  return std::move(stream).str();
+}
+
+auto readSpirv(const fs::path &path) -> std::vector<uint32_t> {
+  const auto bytes = readFile(path);
+  if (!bytes || bytes->empty() || bytes->size() % sizeof(uint32_t) != 0) {
+    return {};
+  }
+  std::vector<uint32_t> spirv(bytes->size() / sizeof(uint32_t));
+  std::memcpy(spirv.data(), bytes->data(), bytes->size());
+  return spirv;
+}
+
+auto isExecutable(const fs::path &path) -> bool {
+  std::error_code error;
+  return !path.empty() && fs::is_regular_file(path, error);
+}
+
+auto findCompiler(const fs::path &configured) -> fs::path {
+  if (!configured.empty()) {
+    return isExecutable(configured) ? configured : fs::path{};
+  }
+  if (const auto *env = std::getenv("RENDY_SLANGC"); env != nullptr && isExecutable(env)) {
+    return env;
+  }
+  const auto name = std::string("slangc") + std::string(kExecutableSuffix);
+  if (const auto *sdk = std::getenv("VULKAN_SDK"); sdk != nullptr && isExecutable(fs::path(sdk) / "bin" / name)) {
+    return fs::path(sdk) / "bin" / name;
+  }
+  if (const auto *path = std::getenv("PATH"); path != nullptr) {
+    std::string_view remaining = path;
+    while (!remaining.empty()) {
+      const auto separator = remaining.find(kPathSeparator);
+      const auto directory = remaining.substr(0, separator);
+      if (!directory.empty() && isExecutable(fs::path(directory) / name)) {
+        return fs::path(directory) / name;
+      }
+      remaining = separator == std::string_view::npos ? std::string_view{} : remaining.substr(separator + 1);
+    }
+  }
+  return {};
+}
+
+auto trim(std::string_view value) -> std::string_view {
+  const auto first = value.find_first_not_of(" \t\r");
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  return value.substr(first, value.find_last_not_of(" \t\r") - first + 1);
+}
+
+// Files named by `import a.b;` and `#include "c.slang"`, resolved the way slangc resolves them
+auto directDependencies(const fs::path &source, std::string_view contents, const fs::path &root)
+    -> std::vector<fs::path> {
+  std::vector<fs::path> result;
+  std::istringstream stream{std::string(contents)};
+  for (std::string line; std::getline(stream, line);) {
+    const auto statement = trim(line);
+    if (statement.starts_with("import ")) {
+      auto module = std::string(trim(statement.substr(7)));
+      if (const auto end = module.find(';'); end != std::string::npos) {
+        module.resize(end);
+      }
+      std::ranges::replace(module, '.', '/');
+      auto hyphenated = module;
+      std::ranges::replace(hyphenated, '_', '-');
+      for (const auto &directory : {source.parent_path(), root}) {
+        for (const auto &candidate : {module, hyphenated}) {
+          if (const auto path = directory / (candidate + ".slang"); fs::exists(path)) {
+            result.push_back(path);
+          }
+        }
+      }
+    } else if (statement.starts_with("#include")) {
+      const auto open = statement.find('"');
+      const auto close = statement.rfind('"');
+      if (open != std::string_view::npos && close > open) {
+        result.push_back(source.parent_path() / statement.substr(open + 1, close - open - 1));
+      }
+    }
+  }
+  return result;
+}
+
+// Runs a command line through the shell and returns its exit status
+auto runCommand(const std::string &command) -> int {
+#ifdef _WIN32
+  // cmd strips the outer quotes, which would otherwise break a quoted executable path
+  return std::system(fmt::format("\"{}\"", command).c_str());
+#else
+  return std::system(command.c_str());
+#endif
+}
+
+} // namespace
+
+auto Shader::GetStage(std::string_view entry_point) const -> std::optional<ShaderStageDesc> {
+  const auto *reflected = _reflection.FindEntryPoint(entry_point);
+  if (reflected == nullptr) {
+    RENDY_LOG_ERROR("Shader {} has no entry point {}", _name, entry_point);
+    return std::nullopt;
+  }
+  return ShaderStageDesc{.stage = reflected->stage, .spirv = _spirv, .entry_point = reflected->name};
+}
+
+auto ShaderLibrary::Initialize(const ShaderLibraryConfig &config) -> bool {
+  _config = config;
+  _compiler = findCompiler(config.compiler);
+  if (_compiler.empty()) {
+    RENDY_LOG_WARN("slangc not found, shaders load from {} and are not hot reloaded",
+                   config.precompiled_directory.string());
+  } else {
+    RENDY_LOG_INFO("Compiling shaders with {}", _compiler.string());
+  }
+
+  std::error_code error;
+  fs::create_directories(config.cache_directory, error);
+  if (error) {
+    RENDY_LOG_ERROR("Failed to create shader cache directory {}: {}", config.cache_directory.string(), error.message());
+    return false;
+  }
+
+  if (config.hot_reload && !_compiler.empty()) {
+    _watcher = std::jthread([this](const std::stop_token &stop_token) {
+      std::unique_lock lock(_watch_mutex);
+      while (!_watch_condition.wait_for(lock, stop_token, _config.poll_interval,
+                                        [&stop_token] { return stop_token.stop_requested(); })) {
+        pollSourcesLocked();
+      }
+    });
+  }
+  return true;
+}
+
+void ShaderLibrary::Destroy() {
+  if (_watcher.joinable()) {
+    _watcher.request_stop();
+    _watcher.join();
+  }
+  _reload_callbacks.clear();
+  _watched_files.clear();
+  _dirty.clear();
+  _shaders.clear();
+}
+
+auto ShaderLibrary::Load(std::string_view name) -> std::shared_ptr<Shader> {
+  if (const auto it = _shaders.find(name); it != _shaders.end()) {
+    return it->second;
+  }
+
+  auto shader = std::make_shared<Shader>();
+  shader->_name = name;
+  shader->_source_path = _config.source_directory / (shader->_name + ".slang");
+  if (!compile(*shader)) {
+    return nullptr;
+  }
+  if (_watcher.joinable()) {
+    watch(*shader);
+  }
+  _shaders.emplace(shader->_name, shader);
+  return shader;
+}
+
+auto ShaderLibrary::Preload(std::span<const std::string_view> names, common::JobSystem &job_system) -> size_t {
+  std::vector<std::shared_ptr<Shader>> shaders;
+  for (const auto name : names) {
+    const bool pending = std::ranges::any_of(shaders, [&](const auto &shader) { return shader->_name == name; });
+    if (pending || _shaders.contains(name)) {
+      continue;
+    }
+    auto shader = std::make_shared<Shader>();
+    shader->_name = name;
+    shader->_source_path = _config.source_directory / (shader->_name + ".slang");
+    shaders.push_back(std::move(shader));
+  }
+
+  // Compiling only reads the library's configuration, the shared state is updated afterwards on this thread
+  std::vector<uint8_t> compiled(shaders.size());
+  job_system.ParallelFor(shaders.size(), 1, [&](size_t begin, size_t end) {
+    for (auto index = begin; index < end; ++index) {
+      compiled[index] = compile(*shaders[index]) ? 1 : 0;
+    }
+  });
+
+  size_t loaded = 0;
+  for (size_t index = 0; index < shaders.size(); ++index) {
+    if (compiled[index] == 0) {
+      continue;
+    }
+    if (_watcher.joinable()) {
+      watch(*shaders[index]);
+    }
+    _shaders.emplace(shaders[index]->_name, shaders[index]);
+    ++loaded;
+  }
+  return loaded;
+}
+
+auto ShaderLibrary::ProcessReloads() -> size_t {
+  std::set<std::string, std::less<>> dirty;
+  {
+    std::scoped_lock lock(_watch_mutex);
+    dirty.swap(_dirty);
+  }
+
+  size_t reloaded = 0;
+  for (const auto &name : dirty) {
+    const auto it = _shaders.find(name);
+    if (it == _shaders.end()) {
+      continue;
+    }
+    auto &shader = *it->second;
+    auto candidate = shader;
+    if (!compile(candidate)) {
+      RENDY_LOG_ERROR("Reload of shader {} failed, keeping the previous version", name);
+      continue;
+    }
+    // Dependencies may have changed even when the output didn't
+    watch(candidate);
+    if (candidate._content_hash == shader._content_hash) {
+      continue;
+    }
+    candidate._version = shader._version + 1;
+    shader = std::move(candidate);
+    ++reloaded;
+    RENDY_LOG_INFO("Reloaded shader {} (version {})", name, shader._version);
+    for (const auto &callback : _reload_callbacks) {
+      callback(shader);
+    }
+  }
+  return reloaded;
+}
+
+void ShaderLibrary::AddReloadCallback(std::function<void(const Shader &)> callback) {
+  _reload_callbacks.push_back(std::move(callback));
+}
+
+auto ShaderLibrary::compile(Shader &shader) const -> bool {
+  std::error_code error;
+  if (!fs::exists(shader._source_path, error)) {
+    // Shipped without sources, fall back to what the build produced
+    return loadPrecompiled(shader);
+  }
+
+  // The cache key covers every source the module pulls in, so editing an imported module invalidates it too
+  auto hash = core::HashString(kCompilerOptions);
+  std::vector<fs::path> pending{shader._source_path};
+  std::set<fs::path> visited;
+  shader._dependencies.clear();
+  while (!pending.empty()) {
+    const auto path = pending.back();
+    pending.pop_back();
+    if (!visited.insert(path).second) {
+      continue;
+    }
+    const auto contents = readFile(path);
+    if (!contents) {
+      RENDY_LOG_ERROR("Failed to read shader source {}", path.string());
+      return false;
+    }
+    hash = core::HashString(path.generic_string(), hash);
+    hash = core::HashString(*contents, hash);
+    if (path != shader._source_path) {
+      shader._dependencies.push_back(path);
+    }
+    std::ranges::copy(directDependencies(path, *contents, _config.source_directory), std::back_inserter(pending));
+  }
+
+  auto cache_name = shader._name;
+  std::ranges::replace(cache_name, '/', '_');
+  const auto cache_path = _config.cache_directory / fmt::format("{}_{:016x}.spv", cache_name, hash);
+  if (!fs::exists(cache_path, error)) {
+    if (_compiler.empty()) {
+      RENDY_LOG_WARN("No compiled SPIR-V for the current source of {}, using the build output", shader._name);
+      return loadPrecompiled(shader);
+    }
+    if (!compileToCache(shader, cache_path)) {
+      return false;
+    }
+  }
+
+  auto spirv = readSpirv(cache_path);
+  auto reflection = ReflectSpirv(spirv);
+  if (!reflection) {
+    RENDY_LOG_ERROR("Cached SPIR-V {} is invalid, removing it", cache_path.string());
+    fs::remove(cache_path, error);
+    return false;
+  }
+  shader._spirv = std::move(spirv);
+  shader._reflection = std::move(*reflection);
+  shader._content_hash = hash;
+  return true;
+}
+
+auto ShaderLibrary::loadPrecompiled(Shader &shader) const -> bool {
+  const auto path = _config.precompiled_directory / (shader._name + ".spv");
+  auto spirv = readSpirv(path);
+  auto reflection = ReflectSpirv(spirv);
+  if (!reflection) {
+    RENDY_LOG_ERROR("Shader {} has no usable source at {} nor valid SPIR-V at {}", shader._name,
+                    shader._source_path.string(), path.string());
+    return false;
+  }
+  shader._content_hash = core::HashSpan(std::span<const uint32_t>(spirv));
+  shader._spirv = std::move(spirv);
+  shader._reflection = std::move(*reflection);
+  return true;
+}
+
+auto ShaderLibrary::compileToCache(const Shader &shader, const fs::path &output) const -> bool {
+  // Written under a temporary name so a crash mid compile never leaves a truncated entry behind
+  auto temporary = output;
+  temporary += ".tmp";
+  auto log = output;
+  log += ".log";
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto command = fmt::format(R"("{}" "{}" {} -o "{}" > "{}" 2>&1)", _compiler.string(),
+                                   shader._source_path.string(), kCompilerOptions, temporary.string(), log.string());
+  const auto status = runCommand(command);
+
+  std::error_code error;
+  if (status != 0 || !fs::exists(temporary, error)) {
+    RENDY_LOG_ERROR("Failed to compile shader {}:\n{}", shader._name, readFile(log).value_or("no compiler output"));
+    fs::remove(temporary, error);
+    fs::remove(log, error);
+    return false;
+  }
+  fs::remove(log, error);
+  fs::rename(temporary, output, error);
+  if (error) {
+    RENDY_LOG_ERROR("Failed to store compiled shader {}: {}", output.string(), error.message());
+    return false;
+  }
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+  RENDY_LOG_INFO("Compiled shader {} in {} ms", shader._name, elapsed.count());
+  return true;
+}
+
+void ShaderLibrary::watch(const Shader &shader) {
+  std::scoped_lock lock(_watch_mutex);
+  std::vector<fs::path> files{shader._source_path};
+  files.insert(files.end(), shader._dependencies.begin(), shader._dependencies.end());
+  for (const auto &file : files) {
+    std::error_code error;
+    auto &watched = _watched_files[file];
+    if (watched.shaders.empty()) {
+      watched.last_write = fs::last_write_time(file, error);
+    }
+    watched.shaders.insert(shader._name);
+  }
+}
+
+void ShaderLibrary::pollSourcesLocked() {
+  for (auto &[path, watched] : _watched_files) {
+    std::error_code error;
+    const auto last_write = fs::last_write_time(path, error);
+    // Editors that save by replacing the file briefly remove it, so a missing file is checked again on the next poll
+    if (error || last_write == watched.last_write) {
+      continue;
+    }
+    watched.last_write = last_write;
+    _dirty.insert(watched.shaders.begin(), watched.shaders.end());
+  }
+}
+
+} // namespace rendy::graphics::vulkan
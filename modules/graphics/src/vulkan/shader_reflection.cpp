@@ -0,0 +1,496 @@
+#include "vulkan/shader_reflection.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <tuple>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+constexpr uint32_t kSpirvMagic = 0x07230203;
+constexpr size_t kSpirvHeaderWords = 5;
+
+// Opcodes, decorations and enumerants from the SPIR-V specification that the reflector understands
+enum Op : uint16_t {
+  kOpName = 5,
+  kOpEntryPoint = 15,
+  kOpExecutionMode = 16,
+  kOpTypeInt = 21,
+  kOpTypeFloat = 22,
+  kOpTypeVector = 23,
+  kOpTypeMatrix = 24,
+  kOpTypeImage = 25,
+  kOpTypeSampler = 26,
+  kOpTypeSampledImage = 27,
+  kOpTypeArray = 28,
+  kOpTypeRuntimeArray = 29,
+  kOpTypeStruct = 30,
+  kOpTypePointer = 32,
+  kOpConstant = 43,
+  kOpSpecConstant = 50,
+  kOpVariable = 59,
+  kOpExecutionModeId = 331,
+  kOpDecorate = 71,
+  kOpMemberDecorate = 72,
+  kOpTypeAccelerationStructure = 5341,
+};
+
+enum Decoration : uint32_t {
+  kDecorationSpecId = 1,
+  kDecorationBlock = 2,
+  kDecorationBufferBlock = 3,
+  kDecorationArrayStride = 6,
+  kDecorationMatrixStride = 7,
+  kDecorationBinding = 33,
+  kDecorationDescriptorSet = 34,
+  kDecorationOffset = 35,
+};
+
+enum StorageClass : uint32_t {
+  kStorageUniformConstant = 0,
+  kStorageUniform = 2,
+  kStoragePushConstant = 9,
+  kStorageStorageBuffer = 12,
+};
+
+constexpr uint32_t kExecutionModeLocalSize = 17;
+constexpr uint32_t kExecutionModeLocalSizeId = 38;
+constexpr uint32_t kDimBuffer = 5;
+
+struct TypeInfo {
+  uint16_t op{0};
+  std::vector<uint32_t> operands; // Words after the result id
+};
+
+struct IdInfo {
+  std::string name;
+  std::optional<uint32_t> set;
+  std::optional<uint32_t> binding;
+  std::optional<uint32_t> spec_id;
+  std::optional<uint32_t> array_stride;
+  bool block{false};
+  bool buffer_block{false};
+  std::map<uint32_t, uint32_t> member_offsets;
+  std::map<uint32_t, uint32_t> member_matrix_strides;
+};
+
+struct Variable {
+  uint32_t id;
+  uint32_t pointer_type;
+  uint32_t storage_class;
+};
+
+struct RawEntryPoint {
+  uint32_t id;
+  ReflectedEntryPoint entry_point;
+  std::set<uint32_t> interface;
+};
+
+auto toShaderStage(uint32_t execution_model) -> std::optional<vk::ShaderStageFlagBits> {
+  switch (execution_model) {
+  case 0:
+    return vk::ShaderStageFlagBits::eVertex;
+  case 1:
+    return vk::ShaderStageFlagBits::eTessellationControl;
+  case 2:
+    return vk::ShaderStageFlagBits::eTessellationEvaluation;
+  case 3:
+    return vk::ShaderStageFlagBits::eGeometry;
+  case 4:
+    return vk::ShaderStageFlagBits::eFragment;
+  case 5:
+    return vk::ShaderStageFlagBits::eCompute;
+  case 5364:
+    return vk::ShaderStageFlagBits::eTaskEXT;
+  case 5365:
+    return vk::ShaderStageFlagBits::eMeshEXT;
+  default:
+    return std::nullopt;
+  }
+}
+
+// Operand words, after the opcode word, an instruction needs for the operands the parser reads
+auto minOperandCount(uint16_t op) -> size_t {
+  switch (op) {
+  case kOpTypeSampler:
+  case kOpTypeStruct:
+  case kOpTypeAccelerationStructure:
+    return 1;
+  case kOpName:
+  case kOpExecutionMode:
+  case kOpExecutionModeId:
+  case kOpDecorate:
+  case kOpTypeFloat:
+  case kOpTypeSampledImage:
+  case kOpTypeRuntimeArray:
+    return 2;
+  case kOpEntryPoint:
+  case kOpConstant:
+  case kOpSpecConstant:
+  case kOpVariable:
+  case kOpMemberDecorate:
+  case kOpTypeInt:
+  case kOpTypeVector:
+  case kOpTypeMatrix:
+  case kOpTypeArray:
+  case kOpTypePointer:
+    return 3;
+  case kOpTypeImage:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+auto readString(std::span<const uint32_t> words, size_t &word_count) -> std::string {
+  std::string result;
+  for (const auto word : words) {
+    ++word_count;
+    for (uint32_t byte = 0; byte < 4; ++byte) {
+      const auto c = static_cast<char>((word >> (byte * 8)) & 0xFFU);
+      if (c == '\0') {
+        return result;
+      }
+      result.push_back(c);
+    }
+  }
+  return result;
+}
+
+class Parser {
+  std::map<uint32_t, TypeInfo> _types;
+  std::map<uint32_t, IdInfo> _ids;
+  std::map<uint32_t, uint32_t> _constants;
+  std::vector<Variable> _variables;
+  std::vector<RawEntryPoint> _entry_points;
+  std::vector<std::pair<uint32_t, std::array<uint32_t, 3>>> _local_size_ids;
+
+  // Returns false for an instruction too short for its opcode
+  auto parseInstruction(uint16_t op, std::span<const uint32_t> operands) -> bool {
+    if (operands.size() < minOperandCount(op)) {
+      return false;
+    }
+    switch (op) {
+    case kOpName: {
+      size_t words = 0;
+      _ids[operands[0]].name = readString(operands.subspan(1), words);
+      break;
+    }
+    case kOpEntryPoint: {
+      const auto stage = toShaderStage(operands[0]);
+      if (!stage) {
+        break;
+      }
+      RawEntryPoint raw{.id = operands[1], .entry_point = {.stage = *stage}, .interface = {}};
+      size_t words = 0;
+      raw.entry_point.name = readString(operands.subspan(2), words);
+      raw.interface.insert(operands.begin() + 2 + static_cast<std::ptrdiff_t>(words), operands.end());
+      _entry_points.push_back(std::move(raw));
+      break;
+    }
+    case kOpExecutionMode:
+      if (operands.size() >= 5 && operands[1] == kExecutionModeLocalSize) {
+        for (auto &raw : _entry_points) {
+          if (raw.id == operands[0]) {
+            raw.entry_point.local_size = {operands[2], operands[3], operands[4]};
+          }
+        }
+      }
+      break;
+    case kOpExecutionModeId: // Resolved once all constants are known
+      if (operands.size() >= 5 && operands[1] == kExecutionModeLocalSizeId) {
+        _local_size_ids.emplace_back(operands[0], std::array{operands[2], operands[3], operands[4]});
+      }
+      break;
+    case kOpConstant:
+    case kOpSpecConstant:
+      _constants[operands[1]] = operands[2];
+      break;
+    case kOpVariable:
+      _variables.push_back({.id = operands[1], .pointer_type = operands[0], .storage_class = operands[2]});
+      break;
+    case kOpDecorate:
+      decorate(_ids[operands[0]], operands[1], operands.size() > 2 ? operands[2] : 0);
+      break;
+    case kOpMemberDecorate:
+      if (operands.size() > 3 && operands[2] == kDecorationOffset) {
+        _ids[operands[0]].member_offsets[operands[1]] = operands[3];
+      } else if (operands.size() > 3 && operands[2] == kDecorationMatrixStride) {
+        _ids[operands[0]].member_matrix_strides[operands[1]] = operands[3];
+      }
+      break;
+    case kOpTypeInt:
+    case kOpTypeFloat:
+    case kOpTypeVector:
+    case kOpTypeMatrix:
+    case kOpTypeImage:
+    case kOpTypeSampler:
+    case kOpTypeSampledImage:
+    case kOpTypeArray:
+    case kOpTypeRuntimeArray:
+    case kOpTypeStruct:
+    case kOpTypePointer:
+    case kOpTypeAccelerationStructure:
+      _types[operands[0]] = TypeInfo{.op = op, .operands = {operands.begin() + 1, operands.end()}};
+      break;
+    default:
+      break;
+    }
+    return true;
+  }
+
+  static void decorate(IdInfo &info, uint32_t decoration, uint32_t value) {
+    switch (decoration) {
+    case kDecorationSpecId:
+      info.spec_id = value;
+      break;
+    case kDecorationBlock:
+      info.block = true;
+      break;
+    case kDecorationBufferBlock:
+      info.buffer_block = true;
+      break;
+    case kDecorationArrayStride:
+      info.array_stride = value;
+      break;
+    case kDecorationBinding:
+      info.binding = value;
+      break;
+    case kDecorationDescriptorSet:
+      info.set = value;
+      break;
+    default:
+      break;
+    }
+  }
+
+  [[nodiscard]] auto type(uint32_t id) const -> const TypeInfo * {
+    const auto it = _types.find(id);
+    return it != _types.end() ? &it->second : nullptr;
+  }
+
+  [[nodiscard]] auto info(uint32_t id) const -> const IdInfo * {
+    const auto it = _ids.find(id);
+    return it != _ids.end() ? &it->second : nullptr;
+  }
+
+  // Size of a type laid out with explicit offsets and strides, as push constant blocks are
+  [[nodiscard]] auto sizeOf(uint32_t type_id, uint32_t matrix_stride = 0) const -> uint32_t {
+    const auto *t = type(type_id);
+    if (t == nullptr) {
+      return 0;
+    }
+    switch (t->op) {
+    case kOpTypeInt:
+    case kOpTypeFloat:
+      return t->operands[0] / 8;
+    case kOpTypeVector:
+      return sizeOf(t->operands[0]) * t->operands[1];
+    case kOpTypeMatrix:
+      return (matrix_stride != 0 ? matrix_stride : sizeOf(t->operands[0])) * t->operands[1];
+    case kOpTypeArray: {
+      const auto length = _constants.contains(t->operands[1]) ? _constants.at(t->operands[1]) : 0;
+      const auto *decorations = info(type_id);
+      const auto stride = decorations != nullptr && decorations->array_stride ? *decorations->array_stride
+                                                                              : sizeOf(t->operands[0]);
+      return stride * length;
+    }
+    case kOpTypeStruct: {
+      const auto *decorations = info(type_id);
+      uint32_t size = 0;
+      for (uint32_t member = 0; member < t->operands.size(); ++member) {
+        uint32_t offset = size;
+        uint32_t stride = 0;
+        if (decorations != nullptr) {
+          if (const auto it = decorations->member_offsets.find(member); it != decorations->member_offsets.end()) {
+            offset = it->second;
+          }
+          if (const auto it = decorations->member_matrix_strides.find(member);
+              it != decorations->member_matrix_strides.end()) {
+            stride = it->second;
+          }
+        }
+        size = std::max(size, offset + sizeOf(t->operands[member], stride));
+      }
+      return size;
+    }
+    default:
+      return 0;
+    }
+  }
+
+  [[nodiscard]] auto descriptorType(uint32_t type_id, uint32_t storage_class) const
+      -> std::optional<vk::DescriptorType> {
+    const auto *t = type(type_id);
+    if (t == nullptr) {
+      return std::nullopt;
+    }
+    switch (t->op) {
+    case kOpTypeSampler:
+      return vk::DescriptorType::eSampler;
+    case kOpTypeSampledImage:
+      return vk::DescriptorType::eCombinedImageSampler;
+    case kOpTypeImage: {
+      const bool buffer = t->operands[1] == kDimBuffer;
+      if (t->operands[5] == 2) {
+        return buffer ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eStorageImage;
+      }
+      return buffer ? vk::DescriptorType::eUniformTexelBuffer : vk::DescriptorType::eSampledImage;
+    }
+    case kOpTypeAccelerationStructure:
+      return vk::DescriptorType::eAccelerationStructureKHR;
+    case kOpTypeStruct: {
+      const auto *decorations = info(type_id);
+      if (storage_class == kStorageStorageBuffer || (decorations != nullptr && decorations->buffer_block)) {
+        return vk::DescriptorType::eStorageBuffer;
+      }
+      return vk::DescriptorType::eUniformBuffer;
+    }
+    default:
+      return std::nullopt;
+    }
+  }
+
+  [[nodiscard]] auto stagesUsing(uint32_t variable, bool interface_lists_globals) const -> vk::ShaderStageFlags {
+    vk::ShaderStageFlags stages;
+    for (const auto &raw : _entry_points) {
+      // Before SPIR-V 1.4 the interface only lists inputs and outputs, so every entry point may use the resource
+      if (!interface_lists_globals || raw.interface.contains(variable)) {
+        stages |= raw.entry_point.stage;
+      }
+    }
+    return stages;
+  }
+
+public:
+  [[nodiscard]] auto Parse(std::span<const uint32_t> spirv) -> std::optional<ShaderReflection> {
+    if (spirv.size() < kSpirvHeaderWords || spirv[0] != kSpirvMagic) {
+      return std::nullopt;
+    }
+    const bool interface_lists_globals = spirv[1] >= 0x00010400;
+
+    for (size_t offset = kSpirvHeaderWords; offset < spirv.size();) {
+      const auto word_count = spirv[offset] >> 16U;
+      const auto op = static_cast<uint16_t>(spirv[offset] & 0xFFFFU);
+      if (word_count == 0 || offset + word_count > spirv.size()) {
+        return std::nullopt;
+      }
+      if (!parseInstruction(op, spirv.subspan(offset + 1, word_count - 1))) {
+        return std::nullopt;
+      }
+      offset += word_count;
+    }
+
+    for (const auto &[entry_id, ids] : _local_size_ids) {
+      for (auto &raw : _entry_points) {
+        if (raw.id != entry_id) {
+          continue;
+        }
+        for (size_t axis = 0; axis < 3; ++axis) {
+          if (const auto it = _constants.find(ids.at(axis)); it != _constants.end()) {
+            raw.entry_point.local_size.at(axis) = it->second;
+          }
+          if (const auto *decorations = info(ids.at(axis)); decorations != nullptr) {
+            raw.entry_point.local_size_spec_ids.at(axis) = decorations->spec_id;
+          }
+        }
+      }
+    }
+
+    ShaderReflection reflection;
+    for (const auto &raw : _entry_points) {
+      reflection.entry_points.push_back(raw.entry_point);
+    }
+
+    for (const auto &variable : _variables) {
+      const auto *pointer = type(variable.pointer_type);
+      if (pointer == nullptr || pointer->op != kOpTypePointer) {
+        continue;
+      }
+      const auto pointee = pointer->operands[1];
+      const auto stages = stagesUsing(variable.id, interface_lists_globals);
+
+      if (variable.storage_class == kStoragePushConstant) {
+        reflection.push_constant_size = std::max(reflection.push_constant_size, sizeOf(pointee));
+        reflection.push_constant_stages |= stages;
+        continue;
+      }
+      if (variable.storage_class != kStorageUniformConstant && variable.storage_class != kStorageUniform &&
+          variable.storage_class != kStorageStorageBuffer) {
+        continue;
+      }
+      const auto *decorations = info(variable.id);
+      if (decorations == nullptr || !decorations->binding) {
+        continue;
+      }
+
+      // Arrays of descriptors, runtime sized ones count as unbounded
+      auto element = pointee;
+      uint32_t count = 1;
+      while (const auto *t = type(element)) {
+        if (t->op == kOpTypeArray) {
+          count *= _constants.contains(t->operands[1]) ? _constants.at(t->operands[1]) : 1;
+        } else if (t->op == kOpTypeRuntimeArray) {
+          count = 0;
+        } else {
+          break;
+        }
+        element = t->operands[0];
+      }
+
+      const auto descriptor_type = descriptorType(element, variable.storage_class);
+      if (!descriptor_type) {
+        continue;
+      }
+      std::string name = decorations->name;
+      if (const auto *type_info = info(element); name.empty() && type_info != nullptr) {
+        name = type_info->name;
+      }
+      reflection.bindings.push_back(ReflectedBinding{.name = std::move(name),
+                                                     .set = decorations->set.value_or(0),
+                                                     .binding = *decorations->binding,
+                                                     .type = *descriptor_type,
+                                                     .count = count,
+                                                     .stages = stages});
+    }
+
+    std::ranges::sort(reflection.bindings, [](const auto &lhs, const auto &rhs) {
+      return std::tie(lhs.set, lhs.binding) < std::tie(rhs.set, rhs.binding);
+    });
+    return reflection;
+  }
+};
+
+} // namespace
+
+auto ShaderReflection::FindEntryPoint(std::string_view name) const -> const ReflectedEntryPoint * {
+  const auto it = std::ranges::find(entry_points, name, &ReflectedEntryPoint::name);
+  return it != entry_points.end() ? &*it : nullptr;
+}
+
+auto ShaderReflection::GetSetLayoutBindings(uint32_t set) const -> std::vector<vk::DescriptorSetLayoutBinding> {
+  std::vector<vk::DescriptorSetLayoutBinding> result;
+  for (const auto &binding : bindings) {
+    if (binding.set != set) {
+      continue;
+    }
+    result.push_back(vk::DescriptorSetLayoutBinding{.binding = binding.binding,
+                                                    .descriptorType = binding.type,
+                                                    .descriptorCount = std::max(binding.count, 1U),
+                                                    .stageFlags = binding.stages});
+  }
+  return result;
+}
+
+auto ShaderReflection::GetPushConstantRange() const -> std::optional<vk::PushConstantRange> {
+  if (push_constant_size == 0) {
+    return std::nullopt;
+  }
+  return vk::PushConstantRange{.stageFlags = push_constant_stages, .offset = 0, .size = push_constant_size};
+}
+
+auto ReflectSpirv(std::span<const uint32_t> spirv) -> std::optional<ShaderReflection> { return Parser{}.Parse(spirv); }
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,396 @@
+#include "vulkan/swapchain.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/physical_device.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+// A present that never reaches the screen, e.g. of a hidden window, must not stall the frame loop forever
+constexpr uint64_t kPresentWaitTimeoutNs = 100'000'000;
+
+auto toVkPresentMode(PresentMode mode) -> vk::PresentModeKHR {
+  switch (mode) {
+  case PresentMode::FifoRelaxed:
+    return vk::PresentModeKHR::eFifoRelaxed;
+  case PresentMode::Mailbox:
+    return vk::PresentModeKHR::eMailbox;
+  case PresentMode::Immediate:
+    return vk::PresentModeKHR::eImmediate;
+  default:
+    return vk::PresentModeKHR::eFifo;
+  }
+}
+
+} // namespace
+
+auto Swapchain::Initialize(const VulkanDevice &device, vk::SurfaceKHR surface, vk::Extent2D extent,
+                           const SwapchainConfig &config) -> bool {
+  // The physical device was selected for this surface and cached what it supports
+  const auto &physical_device = device.GetPhysicalDevice();
+  const auto graphics_family = device.GetQueueFamilyIndex(core::QueueType::Graphics);
+  if (!physical_device.IsPresentSupported(graphics_family)) {
+    // Presenting from another family would need queue ownership transfers of every swapchain image
+    RENDY_LOG_ERROR("The graphics queue family {} can't present to the surface", graphics_family);
+    return false;
+  }
+
+  _device = &device;
+  _surface = surface;
+  _config = config;
+  _config.max_queued_frames = std::clamp<uint32_t>(config.max_queued_frames, 1, kLatencyHistory);
+  _maintenance1 = device.GetCapabilities().swapchain_maintenance1_support;
+  _present_wait = device.GetCapabilities().present_wait_support;
+  _supported_present_modes = physical_device.GetSwapChainSupport().present_modes;
+  _surface_format = chooseSurfaceFormat();
+
+  if (!createGeneration(extent, nullptr)) {
+    return false;
+  }
+  RENDY_LOG_INFO("Swapchain maintenance1: {}, present wait: {}, low latency: {}", _maintenance1, _present_wait,
+                 _config.low_latency);
+  return true;
+}
+
+void Swapchain::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  // Only teardown idles the whole device: without swapchain maintenance1 nothing else says when presents are done
+  VkCheck(_device->Get().waitIdle(), "Failed to wait for the device to become idle.");
+  for (auto &generation : _retired) {
+    destroyGeneration(generation);
+  }
+  _retired.clear();
+  destroyGeneration(_current);
+  _current = {};
+  for (const auto &acquire : _acquire_semaphores) {
+    _device->Get().destroySemaphore(acquire.semaphore);
+  }
+  _acquire_semaphores.clear();
+  _pending_acquire.reset();
+  _device = nullptr;
+}
+
+auto Swapchain::Recreate(vk::Extent2D extent) -> bool {
+  if (extent.width == 0 || extent.height == 0) {
+    return false;
+  }
+  auto old = std::exchange(_current, Generation{});
+  if (!createGeneration(extent, old.swapchain)) {
+    // Nothing replaced the old swapchain, so it stays in use
+    _current = std::move(old);
+    return false;
+  }
+  if (old.swapchain) {
+    // Presents already queued on the old swapchain are followed by the next graphics submission
+    old.retire_value = _device->GetTimeline(core::QueueType::Graphics).GetLastReserved() + 1;
+    _retired.push_back(std::move(old));
+  }
+  ++_recreate_count;
+  return true;
+}
+
+void Swapchain::SetPresentMode(PresentMode mode) {
+  _config.present_mode = mode;
+  const auto present_mode = choosePresentMode(mode);
+  if (present_mode == _present_mode) {
+    return;
+  }
+  if (std::ranges::contains(_compatible_present_modes, present_mode)) {
+    _present_mode = present_mode;
+    RENDY_LOG_INFO("Switched present mode to {} without recreating the swapchain", vk::to_string(present_mode));
+    return;
+  }
+  _needs_recreate = true;
+}
+
+void Swapchain::WaitForLatency() const {
+  if (!_config.low_latency || _present_id < _config.max_queued_frames) {
+    return;
+  }
+  // After the next present at most max_queued_frames may still be waiting for the display
+  const auto target = _present_id + 1 - _config.max_queued_frames;
+  if (target < _first_present_id) {
+    return; // Made to a retired swapchain
+  }
+  if (_present_wait) {
+    const auto result = _device->Get().waitForPresentKHR(_current.swapchain, target, kPresentWaitTimeoutNs);
+    if (result != vk::Result::eSuccess && result != vk::Result::eTimeout && result != vk::Result::eSuboptimalKHR &&
+        result != vk::Result::eErrorOutOfDateKHR) {
+      VkCheck(result, "Failed to wait for present.");
+    }
+    return;
+  }
+  // Without present wait the best available signal is the GPU finishing the frame that was presented
+  _device->GetTimeline(core::QueueType::Graphics).Wait(_present_timeline_values.at(target % kLatencyHistory));
+}
+
+auto Swapchain::AcquireNextImage() -> std::optional<SwapchainImage> {
+  collectRetired();
+  if (_needs_recreate || !_current.swapchain) {
+    return std::nullopt;
+  }
+
+  auto &acquire = _acquire_semaphores.at(_next_acquire);
+  _device->GetTimeline(core::QueueType::Graphics).Wait(acquire.release_value);
+  const auto acquired = _device->Get().acquireNextImageKHR(_current.swapchain, UINT64_MAX, acquire.semaphore, nullptr);
+  const auto result = acquired.result;
+  const auto image_index = acquired.value;
+  if (result == vk::Result::eErrorOutOfDateKHR) {
+    _needs_recreate = true;
+    return std::nullopt;
+  }
+  if (result == vk::Result::eSuboptimalKHR) {
+    // The image is acquired and its semaphore will be signaled, so the frame still goes ahead
+    _needs_recreate = true;
+  } else {
+    VkCheck(result, "Failed to acquire swapchain image.");
+  }
+
+  if (_maintenance1) {
+    // The image's previous present has to be done with its fence before the fence is handed out again
+    const auto fence = _current.present_fences.at(image_index);
+    VkCheck(_device->Get().waitForFences(fence, vk::True, UINT64_MAX), "Failed to wait for present fence.");
+    VkCheck(_device->Get().resetFences(fence), "Failed to reset present fence.");
+  }
+
+  _pending_acquire = _next_acquire;
+  _next_acquire = (_next_acquire + 1) % _acquire_semaphores.size();
+  return SwapchainImage{.image = _current.images.at(image_index),
+                        .view = _current.views.at(image_index),
+                        .index = image_index,
+                        .acquired = acquire.semaphore,
+                        .rendered = _current.rendered_semaphores.at(image_index)};
+}
+
+void Swapchain::Present(const SwapchainImage &image) {
+  auto &timeline = _device->GetTimeline(core::QueueType::Graphics);
+  // The submission that waited on the acquire semaphore went out before the one signaling the rendered semaphore
+  if (_pending_acquire.has_value()) {
+    _acquire_semaphores.at(_pending_acquire.value()).release_value = timeline.GetLastReserved();
+    _pending_acquire.reset();
+  }
+
+  const auto present_id = ++_present_id;
+  const void *next = nullptr;
+  const vk::PresentIdKHR present_id_info{.swapchainCount = 1, .pPresentIds = &present_id};
+  if (_present_wait) {
+    next = &present_id_info;
+  }
+  const vk::SwapchainPresentModeInfoEXT present_mode_info{
+      .pNext = next, .swapchainCount = 1, .pPresentModes = &_present_mode};
+  if (_maintenance1 && !_compatible_present_modes.empty()) {
+    next = &present_mode_info;
+  }
+  vk::SwapchainPresentFenceInfoEXT present_fence_info{.pNext = next, .swapchainCount = 1};
+  if (_maintenance1) {
+    present_fence_info.pFences = &_current.present_fences.at(image.index);
+    next = &present_fence_info;
+  }
+  const vk::PresentInfoKHR present_info{.pNext = next,
+                                        .waitSemaphoreCount = 1,
+                                        .pWaitSemaphores = &image.rendered,
+                                        .swapchainCount = 1,
+                                        .pSwapchains = &_current.swapchain,
+                                        .pImageIndices = &image.index};
+
+  vk::Result result{};
+  {
+    const auto queue_lock = _device->LockQueue(core::QueueType::Graphics);
+    result = _device->GetQueue(core::QueueType::Graphics).presentKHR(present_info);
+    _present_timeline_values.at(present_id % kLatencyHistory) = timeline.GetLastReserved();
+  }
+  if (result == vk::Result::eSuboptimalKHR || result == vk::Result::eErrorOutOfDateKHR) {
+    _needs_recreate = true;
+  } else {
+    VkCheck(result, "Failed to present swapchain image.");
+  }
+}
+
+auto Swapchain::createGeneration(vk::Extent2D extent, vk::SwapchainKHR old_swapchain) -> bool {
+  const auto vk_device = _device->Get();
+  const auto capabilities = VkCheckAndUnwrap(_device->GetPhysicalDevice().Get().getSurfaceCapabilitiesKHR(_surface),
+                                             "Failed to get surface capabilities");
+  // A current extent of UINT32_MAX means the surface takes whatever size the swapchain has
+  if (capabilities.currentExtent.width != UINT32_MAX) {
+    extent = capabilities.currentExtent;
+  } else {
+    extent.width = std::clamp(extent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+    extent.height = std::clamp(extent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+  }
+  if (extent.width == 0 || extent.height == 0) {
+    return false;
+  }
+
+  auto image_count = std::max(_config.image_count, capabilities.minImageCount);
+  if (capabilities.maxImageCount > 0) {
+    image_count = std::min(image_count, capabilities.maxImageCount);
+  }
+
+  auto composite_alpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
+  for (const auto candidate : {vk::CompositeAlphaFlagBitsKHR::eOpaque, vk::CompositeAlphaFlagBitsKHR::eInherit,
+                               vk::CompositeAlphaFlagBitsKHR::ePreMultiplied,
+                               vk::CompositeAlphaFlagBitsKHR::ePostMultiplied}) {
+    if (capabilities.supportedCompositeAlpha & candidate) {
+      composite_alpha = candidate;
+      break;
+    }
+  }
+
+  auto usage = vk::ImageUsageFlags(vk::ImageUsageFlagBits::eColorAttachment);
+  if (capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst) {
+    usage |= vk::ImageUsageFlagBits::eTransferDst;
+  }
+
+  _present_mode = choosePresentMode(_config.present_mode);
+  queryCompatiblePresentModes();
+  const vk::SwapchainPresentModesCreateInfoEXT present_modes_info{
+      .presentModeCount = VkToU32(_compatible_present_modes.size()),
+      .pPresentModes = _compatible_present_modes.data()};
+
+  const auto graphics_family = _device->GetQueueFamilyIndex(core::QueueType::Graphics);
+  _current.swapchain = VkCheckAndUnwrap(
+      vk_device.createSwapchainKHR(vk::SwapchainCreateInfoKHR{
+          .pNext = _compatible_present_modes.empty() ? nullptr : &present_modes_info,
+          .surface = _surface,
+          .minImageCount = image_count,
+          .imageFormat = _surface_format.format,
+          .imageColorSpace = _surface_format.colorSpace,
+          .imageExtent = extent,
+          .imageArrayLayers = 1,
+          .imageUsage = usage,
+          .imageSharingMode = vk::SharingMode::eExclusive,
+          .queueFamilyIndexCount = 1,
+          .pQueueFamilyIndices = &graphics_family,
+          .preTransform = capabilities.currentTransform,
+          .compositeAlpha = composite_alpha,
+          .presentMode = _present_mode,
+          .clipped = vk::True,
+          .oldSwapchain = old_swapchain}),
+      "Failed to create swapchain.");
+  _current.images =
+      VkCheckAndUnwrap(vk_device.getSwapchainImagesKHR(_current.swapchain), "Failed to get swapchain images.");
+
+  for (const auto image : _current.images) {
+    _current.views.push_back(VkCheckAndUnwrap(
+        vk_device.createImageView(vk::ImageViewCreateInfo{
+            .image = image,
+            .viewType = vk::ImageViewType::e2D,
+            .format = _surface_format.format,
+            .subresourceRange = vk::ImageSubresourceRange{
+                .aspectMask = vk::ImageAspectFlagBits::eColor, .levelCount = 1, .layerCount = 1}}),
+        "Failed to create swapchain image view."));
+    _current.rendered_semaphores.push_back(
+        VkCheckAndUnwrap(vk_device.createSemaphore({}), "Failed to create swapchain semaphore."));
+    if (_maintenance1) {
+      // Created signaled so the first acquire of each image doesn't wait on a present that never happened
+      _current.present_fences.push_back(VkCheckAndUnwrap(
+          vk_device.createFence(vk::FenceCreateInfo{.flags = vk::FenceCreateFlagBits::eSignaled}),
+          "Failed to create present fence."));
+    }
+  }
+
+  // One more acquire semaphore than images lets the next acquire start before the previous one is released
+  while (_acquire_semaphores.size() < _current.images.size() + 1) {
+    _acquire_semaphores.push_back(AcquireSemaphore{
+        .semaphore = VkCheckAndUnwrap(vk_device.createSemaphore({}), "Failed to create acquire semaphore.")});
+  }
+
+  _extent = extent;
+  _needs_recreate = false;
+  _first_present_id = _present_id + 1;
+  RENDY_LOG_INFO("Created {}x{} swapchain with {} images ({}, {})", extent.width, extent.height,
+                 _current.images.size(), vk::to_string(_surface_format.format), vk::to_string(_present_mode));
+  return true;
+}
+
+void Swapchain::destroyGeneration(Generation &generation) const {
+  const auto vk_device = _device->Get();
+  for (const auto fence : generation.present_fences) {
+    vk_device.destroyFence(fence);
+  }
+  for (const auto semaphore : generation.rendered_semaphores) {
+    vk_device.destroySemaphore(semaphore);
+  }
+  for (const auto view : generation.views) {
+    vk_device.destroyImageView(view);
+  }
+  if (generation.swapchain) {
+    vk_device.destroySwapchainKHR(generation.swapchain);
+  }
+}
+
+void Swapchain::collectRetired() {
+  const auto vk_device = _device->Get();
+  const auto &timeline = _device->GetTimeline(core::QueueType::Graphics);
+  std::erase_if(_retired, [&](Generation &generation) {
+    bool done = false;
+    if (_maintenance1) {
+      // Present fences are signaled once the presentation engine no longer needs the image or its semaphore
+      done = std::ranges::all_of(generation.present_fences, [&](vk::Fence fence) {
+        return vk_device.getFenceStatus(fence) == vk::Result::eSuccess;
+      });
+    } else {
+      done = timeline.IsComplete(generation.retire_value);
+    }
+    if (done) {
+      destroyGeneration(generation);
+    }
+    return done;
+  });
+}
+
+auto Swapchain::chooseSurfaceFormat() const -> vk::SurfaceFormatKHR {
+  const auto &formats = _device->GetPhysicalDevice().GetSwapChainSupport().formats;
+  const auto preferred = _config.srgb ? std::array{vk::Format::eB8G8R8A8Srgb, vk::Format::eR8G8B8A8Srgb}
+                                      : std::array{vk::Format::eB8G8R8A8Unorm, vk::Format::eR8G8B8A8Unorm};
+  for (const auto format : preferred) {
+    const auto it = std::ranges::find_if(formats, [&](const vk::SurfaceFormatKHR &surface_format) {
+      return surface_format.format == format && surface_format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear;
+    });
+    if (it != formats.end()) {
+      return *it;
+    }
+  }
+  return formats.front();
+}
+
+auto Swapchain::choosePresentMode(PresentMode mode) const -> vk::PresentModeKHR {
+  const auto present_mode = toVkPresentMode(mode);
+  if (std::ranges::contains(_supported_present_modes, present_mode)) {
+    return present_mode;
+  }
+  RENDY_LOG_WARN("Present mode {} is not supported by the surface, falling back to FIFO", vk::to_string(present_mode));
+  return vk::PresentModeKHR::eFifo;
+}
+
+void Swapchain::queryCompatiblePresentModes() {
+  _compatible_present_modes.clear();
+  if (!_maintenance1) {
+    return;
+  }
+  vk::SurfacePresentModeEXT present_mode{.presentMode = _present_mode};
+  const vk::PhysicalDeviceSurfaceInfo2KHR surface_info{.pNext = &present_mode, .surface = _surface};
+  std::array<vk::PresentModeKHR, 8> modes{};
+  vk::SurfacePresentModeCompatibilityEXT compatibility{.presentModeCount = VkToU32(modes.size()),
+                                                       .pPresentModes = modes.data()};
+  vk::SurfaceCapabilities2KHR capabilities{.pNext = &compatibility};
+  VkCheck(_device->GetPhysicalDevice().Get().getSurfaceCapabilities2KHR(&surface_info, &capabilities),
+          "Failed to get surface present mode compatibility");
+
+  for (uint32_t i = 0; i < std::min<uint32_t>(compatibility.presentModeCount, modes.size()); ++i) {
+    if (std::ranges::contains(_supported_present_modes, modes.at(i))) {
+      _compatible_present_modes.push_back(modes.at(i));
+    }
+  }
+  if (!std::ranges::contains(_compatible_present_modes, _present_mode)) {
+    _compatible_present_modes.push_back(_present_mode);
+  }
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,593 @@
+#include "vulkan/texture_streamer.hpp"
+#include "common/log.hpp"
+#include "core/ktx2.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/memory_allocator.hpp"
+#include "vulkan/utils.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+constexpr vk::DeviceSize kStagingAlignment = 16;
+constexpr uint32_t kNoRequest = UINT32_MAX;
+
+auto alignUp(vk::DeviceSize value, vk::DeviceSize alignment) -> vk::DeviceSize {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+auto colorLevels(uint32_t base_level, uint32_t level_count, uint32_t layer_count) -> vk::ImageSubresourceRange {
+  return vk::ImageSubresourceRange{.aspectMask = vk::ImageAspectFlagBits::eColor,
+                                   .baseMipLevel = base_level,
+                                   .levelCount = level_count,
+                                   .baseArrayLayer = 0,
+                                   .layerCount = layer_count};
+}
+
+auto colorLayers(uint32_t level, uint32_t layer_count) -> vk::ImageSubresourceLayers {
+  return vk::ImageSubresourceLayers{
+      .aspectMask = vk::ImageAspectFlagBits::eColor, .mipLevel = level, .baseArrayLayer = 0, .layerCount = layer_count};
+}
+
+auto toExtent3D(core::ImageExtent extent) -> vk::Extent3D {
+  return vk::Extent3D{.width = extent.width, .height = extent.height, .depth = 1};
+}
+
+} // namespace
+
+VulkanTexture::VulkanTexture(std::unique_ptr<core::TextureSource> source, uint64_t mip_tail_bytes)
+    : _source(std::move(source)), _desc(_source->GetDesc()), _tail_start(core::GetMipTailStart(_desc, mip_tail_bytes)),
+      _resident_mip(_desc.mip_levels) {
+  // Reallocations copy the levels that stay resident from the previous image
+  _desc.usage = core::ImageUsage::Sampled | core::ImageUsage::TransferSrc | core::ImageUsage::TransferDst;
+}
+
+void VulkanTexture::RequestMip(uint32_t level) {
+  level = std::min(level, _desc.mip_levels - 1);
+  auto current = _requested_mip.load();
+  while (level < current && !_requested_mip.compare_exchange_weak(current, level)) {
+  }
+}
+
+auto TextureStreamer::Initialize(const VulkanDevice &device, common::JobSystem &job_system, BindlessHeap *bindless_heap,
+                                 const TextureStreamerConfig &config) -> bool {
+  _device = &device;
+  _job_system = &job_system;
+  _bindless_heap = bindless_heap;
+  _config = config;
+  const auto vk_device = device.Get();
+
+  for (auto [ring, queue] : {std::pair{&_transfer_commands, core::QueueType::Transfer},
+                             std::pair{&_graphics_commands, core::QueueType::Graphics}}) {
+    ring->queue = queue;
+    ring->pool = VkCheckAndUnwrap(vk_device.createCommandPool(vk::CommandPoolCreateInfo{
+                                      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer |
+                                               vk::CommandPoolCreateFlagBits::eTransient,
+                                      .queueFamilyIndex = device.GetQueueFamilyIndex(queue)}),
+                                  "Failed to create texture streaming command pool.");
+  }
+
+  _abandoning = false;
+  _budget = queryBudget();
+  RENDY_LOG_INFO("Texture streamer has a {} MiB budget", _budget >> 20U);
+  return true;
+}
+
+void TextureStreamer::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  // Decodes already running finish, queued ones are skipped
+  _abandoning = true;
+  _job_system->Wait(_decoding);
+  _completed.clear();
+  for (const auto &job : _jobs) {
+    job->staging->Destroy();
+  }
+  _jobs.clear();
+
+  retire(true);
+  for (const auto &texture : _textures) {
+    if (texture->_image) {
+      texture->_image->Destroy();
+      texture->_image.reset();
+    }
+    texture->_resident_mip = texture->_desc.mip_levels;
+  }
+  _textures.clear();
+
+  const auto vk_device = _device->Get();
+  for (auto *ring : {&_transfer_commands, &_graphics_commands}) {
+    vk_device.destroyCommandPool(ring->pool);
+    ring->in_flight.clear();
+    ring->free.clear();
+  }
+  _in_flight_bytes = 0;
+  _resident_bytes = 0;
+  _device = nullptr;
+}
+
+auto TextureStreamer::Load(std::unique_ptr<core::TextureSource> source) -> std::shared_ptr<VulkanTexture> {
+  const auto &desc = source->GetDesc();
+  if (desc.mip_levels == 0 || core::GetFormatInfo(desc.format).block_size == 0) {
+    RENDY_LOG_ERROR("Texture {} has no levels or an unknown format", source->GetName());
+    return nullptr;
+  }
+  if (!IsFormatSupported(desc.format)) {
+    RENDY_LOG_ERROR("Texture {} uses a format the device can't sample", source->GetName());
+    return nullptr;
+  }
+  auto texture = std::make_shared<VulkanTexture>(std::move(source), _config.mip_tail_bytes);
+  _textures.push_back(texture);
+  return texture;
+}
+
+auto TextureStreamer::LoadKtx2(const std::filesystem::path &path) -> std::shared_ptr<VulkanTexture> {
+  auto source =
+      core::Ktx2TextureSource::Open(path, [this](core::Format format) { return IsFormatSupported(format); });
+  if (source == nullptr) {
+    return nullptr;
+  }
+  return Load(std::move(source));
+}
+
+auto TextureStreamer::IsFormatSupported(core::Format format) const -> bool {
+  return _device->GetPhysicalDevice().IsFormatSupported(
+      ToVkFormat(format), vk::FormatFeatureFlagBits::eSampledImage | vk::FormatFeatureFlagBits::eTransferSrc |
+                              vk::FormatFeatureFlagBits::eTransferDst);
+}
+
+void TextureStreamer::Update(uint64_t frame_index) {
+  retire(false);
+  unloadUnused();
+  _budget = queryBudget();
+
+  std::vector<Reallocation> reallocations;
+  for (const auto &[texture, mip] : plan(frame_index)) {
+    if (mip < texture->GetResidentMip()) {
+      startLoad(texture, mip);
+    } else {
+      // Dropping levels needs no new data, the remaining ones are copied into a smaller image
+      reallocations.push_back(Reallocation{.texture = texture, .mip = mip});
+    }
+  }
+
+  std::vector<LoadJob *> completed;
+  {
+    const std::scoped_lock lock(_completed_mutex);
+    completed.swap(_completed);
+  }
+  for (auto *job : completed) {
+    _in_flight_bytes -= job->staging->GetDesc().size;
+    if (job->succeeded) {
+      reallocations.push_back(Reallocation{.texture = job->texture, .mip = job->first_mip, .job = job});
+    } else {
+      RENDY_LOG_ERROR("Failed to load levels {}-{} of texture {}", job->first_mip, job->last_mip - 1,
+                      job->texture->GetName());
+      job->texture->_failed = true;
+      job->texture->_busy = false;
+    }
+  }
+
+  if (!reallocations.empty()) {
+    submit(reallocations);
+  }
+
+  // Staging buffers of submitted jobs now belong to the retired list
+  std::erase_if(_jobs, [&](const std::unique_ptr<LoadJob> &job) {
+    if (std::ranges::find(completed, job.get()) == completed.end()) {
+      return false;
+    }
+    if (job->staging) {
+      job->staging->Destroy();
+    }
+    return true;
+  });
+}
+
+void TextureStreamer::decode(LoadJob &job) {
+  if (_abandoning) {
+    return;
+  }
+  auto &texture = *job.texture;
+  auto *mapped = job.staging->GetMappedData();
+  job.succeeded = true;
+  try {
+    for (auto level = job.first_mip; level < job.last_mip && job.succeeded; ++level) {
+      const auto offset = job.offsets[level - job.first_mip];
+      job.succeeded =
+          texture._source->LoadMip(level, std::span(mapped + offset, core::GetMipSize(texture._desc, level)));
+    }
+  } catch (const std::exception &e) {
+    RENDY_LOG_ERROR("Texture source {} threw: {}", texture.GetName(), e.what());
+    job.succeeded = false;
+  }
+  if (job.succeeded) {
+    _device->GetAllocator().Flush(*job.staging->GetAllocation());
+  }
+
+  const std::scoped_lock lock(_completed_mutex);
+  _completed.push_back(&job);
+}
+
+auto TextureStreamer::queryBudget() const -> uint64_t {
+  // Textures may grow into whatever the rest of the process leaves of the device local heaps
+  uint64_t budget = 0;
+  uint64_t usage = 0;
+  for (const auto &heap : _device->GetMemoryBudget()) {
+    if (heap.device_local) {
+      budget += heap.budget;
+      usage += heap.usage;
+    }
+  }
+  const auto other_usage = usage - std::min(usage, _resident_bytes);
+  const auto available = budget - std::min(budget, other_usage);
+  auto texture_budget = static_cast<uint64_t>(static_cast<double>(available) * _config.budget_fraction);
+  if (_config.max_budget != 0) {
+    texture_budget = std::min(texture_budget, _config.max_budget);
+  }
+  return texture_budget;
+}
+
+auto TextureStreamer::plan(uint64_t frame_index) -> std::vector<std::pair<std::shared_ptr<VulkanTexture>, uint32_t>> {
+  // Tails and in-flight loads are committed, the rest of the budget goes to the most recently requested textures
+  uint64_t committed = 0;
+  std::vector<std::shared_ptr<VulkanTexture>> candidates;
+  for (const auto &texture : _textures) {
+    if (const auto requested = texture->_requested_mip.exchange(kNoRequest); requested != kNoRequest) {
+      texture->_wanted_mip = requested;
+      texture->_last_request_frame = frame_index;
+    }
+    const auto &desc = texture->_desc;
+    const auto resident = texture->GetResidentMip();
+    if (texture->_busy) {
+      committed += core::GetMipChainSize(desc, std::min(resident, texture->_target_mip));
+    } else if (texture->_failed) {
+      committed += core::GetMipChainSize(desc, resident);
+    } else {
+      committed += core::GetMipChainSize(desc, texture->_tail_start);
+      candidates.push_back(texture);
+    }
+  }
+  std::ranges::stable_sort(candidates, std::greater{},
+                           [](const auto &texture) { return texture->_last_request_frame; });
+
+  auto remaining = _budget - std::min(_budget, committed);
+  std::vector<std::pair<std::shared_ptr<VulkanTexture>, uint32_t>> changes;
+  for (const auto &texture : candidates) {
+    const auto &desc = texture->_desc;
+    const auto resident = texture->GetResidentMip();
+    // Until anything is resident only the tail is uploaded, so every texture shows up quickly
+    auto target = texture->_tail_start;
+    if (resident < desc.mip_levels) {
+      const bool idle = texture->_last_request_frame.has_value() &&
+                        frame_index - *texture->_last_request_frame > _config.idle_frames;
+      const auto wanted = idle ? texture->_tail_start : std::min(texture->_wanted_mip, texture->_tail_start);
+      const auto tail_size = core::GetMipChainSize(desc, texture->_tail_start);
+      for (auto mip = wanted; mip < texture->_tail_start; ++mip) {
+        const auto extra = core::GetMipChainSize(desc, mip) - tail_size;
+        if (extra <= remaining) {
+          target = mip;
+          remaining -= extra;
+          break;
+        }
+      }
+    }
+    if (target != resident) {
+      changes.emplace_back(texture, target);
+    }
+  }
+  return changes;
+}
+
+void TextureStreamer::startLoad(const std::shared_ptr<VulkanTexture> &texture, uint32_t mip) {
+  const auto &desc = texture->_desc;
+  auto job = std::make_unique<LoadJob>(
+      LoadJob{.texture = texture, .first_mip = mip, .last_mip = texture->GetResidentMip()});
+  vk::DeviceSize size = 0;
+  for (auto level = job->first_mip; level < job->last_mip; ++level) {
+    job->offsets.push_back(size);
+    size = alignUp(size + core::GetMipSize(desc, level), kStagingAlignment);
+  }
+  // The first load always goes through, so a texture larger than the limit still streams on its own
+  if (!_jobs.empty() && _in_flight_bytes + size > _config.max_in_flight_bytes) {
+    return;
+  }
+
+  job->staging = std::make_unique<VulkanBuffer>();
+  if (!job->staging->Initialize(*_device, core::BufferDesc{.size = size,
+                                                          .usage = core::BufferUsage::TransferSrc,
+                                                          .memory_usage = core::MemoryUsage::Upload})) {
+    return;
+  }
+  texture->_busy = true;
+  texture->_target_mip = mip;
+  _in_flight_bytes += size;
+  _job_system->Run([this, job = job.get()] { decode(*job); }, &_decoding);
+  _jobs.push_back(std::move(job));
+}
+
+void TextureStreamer::submit(std::vector<Reallocation> &reallocations) {
+  for (auto &reallocation : reallocations) {
+    reallocation.image = createImage(*reallocation.texture, reallocation.mip);
+  }
+  std::erase_if(reallocations, [](const Reallocation &reallocation) {
+    if (reallocation.image != nullptr) {
+      return false;
+    }
+    // Out of memory: keep the current levels and let a later update try again
+    reallocation.texture->_busy = false;
+    return true;
+  });
+  if (reallocations.empty()) {
+    return;
+  }
+
+  const auto transfer_family = _device->GetQueueFamilyIndex(core::QueueType::Transfer);
+  const auto graphics_family = _device->GetQueueFamilyIndex(core::QueueType::Graphics);
+  const bool transfer_ownership = transfer_family != graphics_family;
+  const auto src_family = transfer_ownership ? transfer_family : vk::QueueFamilyIgnored;
+  const auto dst_family = transfer_ownership ? graphics_family : vk::QueueFamilyIgnored;
+
+  // Transfer queue: copy the new levels out of staging and release them to the graphics family
+  uint64_t transfer_value = 0;
+  const auto has_job = [](const Reallocation &reallocation) { return reallocation.job != nullptr; };
+  if (std::ranges::any_of(reallocations, has_job)) {
+    const auto command_buffer = acquireCommandBuffer(_transfer_commands);
+    std::vector<vk::ImageMemoryBarrier2> barriers;
+    for (const auto &[texture, mip, image, job] : reallocations) {
+      if (job != nullptr) {
+        barriers.push_back(vk::ImageMemoryBarrier2{
+            .srcStageMask = vk::PipelineStageFlagBits2::eNone,
+            .srcAccessMask = vk::AccessFlagBits2::eNone,
+            .dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+            .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+            .oldLayout = vk::ImageLayout::eUndefined,
+            .newLayout = vk::ImageLayout::eTransferDstOptimal,
+            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+            .image = image->Get(),
+            .subresourceRange = colorLevels(0, job->last_mip - job->first_mip, texture->_desc.array_layers)});
+      }
+    }
+    command_buffer.pipelineBarrier2(vk::DependencyInfo{.imageMemoryBarrierCount = VkToU32(barriers.size()),
+                                                       .pImageMemoryBarriers = barriers.data()});
+
+    for (const auto &[texture, mip, image, job] : reallocations) {
+      if (job == nullptr) {
+        continue;
+      }
+      std::vector<vk::BufferImageCopy> regions;
+      for (auto level = job->first_mip; level < job->last_mip; ++level) {
+        regions.push_back(vk::BufferImageCopy{
+            .bufferOffset = job->offsets[level - job->first_mip],
+            .imageSubresource = colorLayers(level - job->first_mip, texture->_desc.array_layers),
+            .imageExtent = toExtent3D(core::GetMipExtent(texture->_desc.extent, level))});
+      }
+      command_buffer.copyBufferToImage(job->staging->Get(), image->Get(), vk::ImageLayout::eTransferDstOptimal,
+                                       regions);
+    }
+
+    // The release half of the ownership transfer also performs the layout transition
+    for (auto &barrier : barriers) {
+      barrier.srcStageMask = vk::PipelineStageFlagBits2::eCopy;
+      barrier.srcAccessMask = vk::AccessFlagBits2::eTransferWrite;
+      barrier.dstStageMask = vk::PipelineStageFlagBits2::eNone;
+      barrier.dstAccessMask = vk::AccessFlagBits2::eNone;
+      barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+      barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+      barrier.srcQueueFamilyIndex = src_family;
+      barrier.dstQueueFamilyIndex = dst_family;
+    }
+    command_buffer.pipelineBarrier2(vk::DependencyInfo{.imageMemoryBarrierCount = VkToU32(barriers.size()),
+                                                       .pImageMemoryBarriers = barriers.data()});
+    transfer_value = submitCommandBuffer(_transfer_commands, command_buffer, {});
+  }
+
+  // Graphics queue: acquire the new levels and copy over the levels the previous image already had. Frames submitted
+  // later on the graphics queue are ordered after these barriers.
+  const auto command_buffer = acquireCommandBuffer(_graphics_commands);
+  std::vector<vk::ImageMemoryBarrier2> before;
+  std::vector<vk::ImageMemoryBarrier2> after;
+  for (const auto &[texture, mip, image, job] : reallocations) {
+    const auto &desc = texture->_desc;
+    const auto layers = desc.array_layers;
+    if (job != nullptr) {
+      // Chains the transfer timeline wait to every later submission on the graphics queue. Across families this is
+      // the acquire half of the ownership transfer, which has to repeat the release's layout transition.
+      before.push_back(vk::ImageMemoryBarrier2{
+          .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+          .srcAccessMask = vk::AccessFlagBits2::eNone,
+          .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+          .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+          .oldLayout = transfer_ownership ? vk::ImageLayout::eTransferDstOptimal
+                                          : vk::ImageLayout::eShaderReadOnlyOptimal,
+          .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+          .srcQueueFamilyIndex = src_family,
+          .dstQueueFamilyIndex = dst_family,
+          .image = image->Get(),
+          .subresourceRange = colorLevels(0, job->last_mip - job->first_mip, layers)});
+    }
+    if (texture->_image == nullptr) {
+      continue;
+    }
+    const auto resident = texture->GetResidentMip();
+    const auto first_kept = std::max(mip, resident);
+    const auto kept_range = colorLevels(first_kept - mip, desc.mip_levels - first_kept, layers);
+    before.push_back(vk::ImageMemoryBarrier2{
+        .srcStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+        .srcAccessMask = vk::AccessFlagBits2::eNone,
+        .dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+        .dstAccessMask = vk::AccessFlagBits2::eTransferRead,
+        .oldLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+        .newLayout = vk::ImageLayout::eTransferSrcOptimal,
+        .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+        .image = texture->_image->Get(),
+        .subresourceRange = colorLevels(0, desc.mip_levels - resident, layers)});
+    before.push_back(vk::ImageMemoryBarrier2{.srcStageMask = vk::PipelineStageFlagBits2::eNone,
+                                             .srcAccessMask = vk::AccessFlagBits2::eNone,
+                                             .dstStageMask = vk::PipelineStageFlagBits2::eCopy,
+                                             .dstAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                                             .oldLayout = vk::ImageLayout::eUndefined,
+                                             .newLayout = vk::ImageLayout::eTransferDstOptimal,
+                                             .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                             .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                             .image = image->Get(),
+                                             .subresourceRange = kept_range});
+    after.push_back(vk::ImageMemoryBarrier2{.srcStageMask = vk::PipelineStageFlagBits2::eCopy,
+                                            .srcAccessMask = vk::AccessFlagBits2::eTransferWrite,
+                                            .dstStageMask = vk::PipelineStageFlagBits2::eAllCommands,
+                                            .dstAccessMask = vk::AccessFlagBits2::eShaderSampledRead,
+                                            .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+                                            .newLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
+                                            .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                            .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
+                                            .image = image->Get(),
+                                            .subresourceRange = kept_range});
+  }
+  command_buffer.pipelineBarrier2(vk::DependencyInfo{.imageMemoryBarrierCount = VkToU32(before.size()),
+                                                     .pImageMemoryBarriers = before.data()});
+  for (const auto &[texture, mip, image, job] : reallocations) {
+    if (texture->_image == nullptr) {
+      continue;
+    }
+    const auto &desc = texture->_desc;
+    const auto resident = texture->GetResidentMip();
+    std::vector<vk::ImageCopy> regions;
+    for (auto level = std::max(mip, resident); level < desc.mip_levels; ++level) {
+      regions.push_back(vk::ImageCopy{.srcSubresource = colorLayers(level - resident, desc.array_layers),
+                                      .dstSubresource = colorLayers(level - mip, desc.array_layers),
+                                      .extent = toExtent3D(core::GetMipExtent(desc.extent, level))});
+    }
+    command_buffer.copyImage(texture->_image->Get(), vk::ImageLayout::eTransferSrcOptimal, image->Get(),
+                             vk::ImageLayout::eTransferDstOptimal, regions);
+  }
+  if (!after.empty()) {
+    command_buffer.pipelineBarrier2(vk::DependencyInfo{.imageMemoryBarrierCount = VkToU32(after.size()),
+                                                       .pImageMemoryBarriers = after.data()});
+  }
+
+  std::vector<vk::SemaphoreSubmitInfo> waits;
+  if (transfer_value != 0) {
+    waits.push_back(vk::SemaphoreSubmitInfo{.semaphore = _device->GetTimeline(core::QueueType::Transfer).Get(),
+                                            .value = transfer_value,
+                                            .stageMask = vk::PipelineStageFlagBits2::eAllCommands});
+  }
+  const auto graphics_value = submitCommandBuffer(_graphics_commands, command_buffer, waits);
+
+  // Swap in the new images. The old ones and their bindless slots live on until the frames using them are done.
+  for (auto &[texture, mip, image, job] : reallocations) {
+    Retired retired{.image = std::move(texture->_image),
+                    .staging = job != nullptr ? std::move(job->staging) : nullptr,
+                    .graphics_value = graphics_value,
+                    .transfer_value = transfer_value};
+    _resident_bytes -= core::GetMipChainSize(texture->_desc, texture->GetResidentMip());
+    _resident_bytes += core::GetMipChainSize(texture->_desc, mip);
+    texture->_image = std::move(image);
+    if (_bindless_heap != nullptr) {
+      _bindless_heap->Release(texture->_bindless);
+      texture->_bindless = _bindless_heap->RegisterSampledImage(texture->_image->GetView());
+    }
+    texture->_resident_mip = mip;
+    texture->_busy = false;
+    _retired.push_back(std::move(retired));
+  }
+}
+
+void TextureStreamer::retire(bool wait) {
+  const auto &graphics = _device->GetTimeline(core::QueueType::Graphics);
+  const auto &transfer = _device->GetTimeline(core::QueueType::Transfer);
+  if (wait) {
+    graphics.Wait(graphics.GetLastReserved());
+    transfer.Wait(transfer.GetLastReserved());
+  }
+  const auto graphics_completed = graphics.GetCompletedValue();
+  const auto transfer_completed = transfer.GetCompletedValue();
+
+  std::erase_if(_retired, [&](Retired &retired) {
+    if (retired.graphics_value > graphics_completed || retired.transfer_value > transfer_completed) {
+      return false;
+    }
+    if (retired.image) {
+      retired.image->Destroy();
+    }
+    if (retired.staging) {
+      retired.staging->Destroy();
+    }
+    return true;
+  });
+
+  for (auto [ring, completed] : {std::pair{&_transfer_commands, transfer_completed},
+                                 std::pair{&_graphics_commands, graphics_completed}}) {
+    while (!ring->in_flight.empty() && ring->in_flight.front().first <= completed) {
+      ring->free.push_back(ring->in_flight.front().second);
+      ring->in_flight.pop_front();
+    }
+  }
+}
+
+void TextureStreamer::unloadUnused() {
+  const auto last_graphics_value = _device->GetTimeline(core::QueueType::Graphics).GetLastReserved();
+  std::erase_if(_textures, [&](const std::shared_ptr<VulkanTexture> &texture) {
+    // Load jobs hold a reference of their own
+    if (texture.use_count() > 1) {
+      return false;
+    }
+    _resident_bytes -= core::GetMipChainSize(texture->_desc, texture->GetResidentMip());
+    if (_bindless_heap != nullptr) {
+      _bindless_heap->Release(texture->_bindless);
+    }
+    if (texture->_image) {
+      _retired.push_back(Retired{.image = std::move(texture->_image), .graphics_value = last_graphics_value});
+    }
+    return true;
+  });
+}
+
+auto TextureStreamer::createImage(const VulkanTexture &texture, uint32_t mip) const -> std::unique_ptr<VulkanImage> {
+  auto desc = texture._desc;
+  desc.extent = core::GetMipExtent(desc.extent, mip);
+  desc.mip_levels -= mip;
+  auto image = std::make_unique<VulkanImage>();
+  if (!image->Initialize(*_device, desc)) {
+    return nullptr;
+  }
+  return image;
+}
+
+auto TextureStreamer::acquireCommandBuffer(CommandRing &ring) -> vk::CommandBuffer {
+  vk::CommandBuffer command_buffer;
+  if (!ring.free.empty()) {
+    command_buffer = ring.free.back();
+    ring.free.pop_back();
+    VkCheck(command_buffer.reset(), "Failed to reset texture streaming command buffer.");
+  } else {
+    command_buffer =
+        VkCheckAndUnwrap(_device->Get().allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+                             .commandPool = ring.pool, .level = vk::CommandBufferLevel::ePrimary,
+                             .commandBufferCount = 1}),
+                         "Failed to allocate texture streaming command buffer.")
+            .front();
+  }
+  VkCheck(command_buffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit}),
+          "Failed to begin texture streaming command buffer.");
+  return command_buffer;
+}
+
+auto TextureStreamer::submitCommandBuffer(CommandRing &ring, vk::CommandBuffer command_buffer,
+                                          std::span<const vk::SemaphoreSubmitInfo> waits) -> uint64_t {
+  VkCheck(command_buffer.end(), "Failed to end texture streaming command buffer.");
+  const vk::CommandBufferSubmitInfo command_buffer_info{.commandBuffer = command_buffer};
+  const vk::SubmitInfo2 submit_info{.waitSemaphoreInfoCount = VkToU32(waits.size()),
+                                    .pWaitSemaphoreInfos = waits.data(),
+                                    .commandBufferInfoCount = 1,
+                                    .pCommandBufferInfos = &command_buffer_info};
+  const auto value = _device->Submit(ring.queue, std::span(&submit_info, 1));
+  ring.in_flight.emplace_back(value, command_buffer);
+  return value;
+}
+
+} // namespace rendy::graphics::vulkan
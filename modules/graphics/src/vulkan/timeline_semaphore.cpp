@@ -0,0 +1,47 @@
+#include "vulkan/timeline_semaphore.hpp"
+#include "vulkan/utils.hpp"
+
+namespace rendy::graphics::vulkan {
+
+auto TimelineSemaphore::Initialize(vk::Device device, uint64_t initial_value) -> bool {
+  _device = device;
+  const vk::SemaphoreTypeCreateInfo type_info{.semaphoreType = vk::SemaphoreType::eTimeline,
+                                              .initialValue = initial_value};
+  _semaphore = VkCheckAndUnwrap(_device.createSemaphore(vk::SemaphoreCreateInfo{.pNext = &type_info}),
+                                "Failed to create timeline semaphore.");
+  _last_reserved = initial_value;
+  return true;
+}
+
+void TimelineSemaphore::Destroy() {
+  if (!_semaphore) {
+    return;
+  }
+  _device.destroySemaphore(_semaphore);
+  _semaphore = nullptr;
+}
+
+auto TimelineSemaphore::GetCompletedValue() const -> uint64_t {
+  return VkCheckAndUnwrap(_device.getSemaphoreCounterValue(_semaphore), "Failed to query timeline semaphore.");
+}
+
+auto TimelineSemaphore::Wait(uint64_t value, uint64_t timeout_ns) const -> bool {
+  const vk::SemaphoreWaitInfo wait_info{.semaphoreCount = 1, .pSemaphores = &_semaphore, .pValues = &value};
+  const auto result = _device.waitSemaphores(wait_info, timeout_ns);
+  if (result == vk::Result::eTimeout) {
+    return false;
+  }
+  VkCheck(result, "Failed to wait for timeline semaphore.");
+  return true;
+}
+
+void TimelineSemaphore::Signal(uint64_t value) {
+  // Keep later reservations above host signaled values
+  auto reserved = _last_reserved.load();
+  while (reserved < value && !_last_reserved.compare_exchange_weak(reserved, value)) {
+  }
+  VkCheck(_device.signalSemaphore(vk::SemaphoreSignalInfo{.semaphore = _semaphore, .value = value}),
+          "Failed to signal timeline semaphore.");
+}
+
+} // namespace rendy::graphics::vulkan
@@ -0,0 +1,223 @@
+#include "vulkan/upload_context.hpp"
+#include "common/log.hpp"
+#include "vulkan/device.hpp"
+#include "vulkan/memory_allocator.hpp"
+#include "vulkan/utils.hpp"
+#include <cstring>
+
+namespace rendy::graphics::vulkan {
+
+namespace {
+
+constexpr vk::DeviceSize kStagingAlignment = 16;
+
+// Regions of one vkCmdCopyBuffer must not overlap in the destination, so uploads that overwrite each other within a
+// batch are split into separate copies to keep their order
+auto splitIntoCopyBatches(const std::vector<vk::BufferCopy> &regions) -> std::vector<std::vector<vk::BufferCopy>> {
+  std::vector<std::vector<vk::BufferCopy>> batches(1);
+  std::map<vk::DeviceSize, vk::DeviceSize> batch_ranges; // dst begin -> dst end
+
+  const auto overlaps = [&](const vk::BufferCopy &region) {
+    const auto end = region.dstOffset + region.size;
+    auto it = batch_ranges.lower_bound(end);
+    if (it == batch_ranges.begin()) {
+      return false;
+    }
+    --it;
+    return it->second > region.dstOffset;
+  };
+
+  for (const auto &region : regions) {
+    auto &batch = batches.back();
+    // Merge with the previous region when both source and destination continue it
+    if (!batch.empty()) {
+      auto &last = batch.back();
+      if (last.srcOffset + last.size == region.srcOffset && last.dstOffset + last.size == region.dstOffset &&
+          !overlaps(region)) {
+        batch_ranges.erase(last.dstOffset);
+        last.size += region.size;
+        batch_ranges[last.dstOffset] = last.dstOffset + last.size;
+        continue;
+      }
+    }
+    if (overlaps(region)) {
+      batches.emplace_back();
+      batch_ranges.clear();
+    }
+    batches.back().push_back(region);
+    batch_ranges[region.dstOffset] = region.dstOffset + region.size;
+  }
+  return batches;
+}
+
+} // namespace
+
+auto UploadContext::Initialize(const VulkanDevice &device, UploadContextConfig config) -> bool {
+  _device = &device;
+  _config = config;
+  const auto vk_device = device.Get();
+
+  _staging_buffer = VkCheckAndUnwrap(vk_device.createBuffer(vk::BufferCreateInfo{
+                                         .size = _config.staging_size,
+                                         .usage = vk::BufferUsageFlagBits::eTransferSrc,
+                                         .sharingMode = vk::SharingMode::eExclusive}),
+                                     "Failed to create staging buffer.");
+  const auto requirements = vk_device.getBufferMemoryRequirements(_staging_buffer);
+  _staging_ring = device.GetAllocator().CreateRingPool(
+      requirements.size,
+      AllocationCreateInfo{.required_flags = vk::MemoryPropertyFlagBits::eHostVisible,
+                           .preferred_flags = vk::MemoryPropertyFlagBits::eHostCoherent},
+      requirements.memoryTypeBits);
+  if (_staging_ring == nullptr) {
+    RENDY_LOG_ERROR("Failed to allocate {} byte staging ring", requirements.size);
+    return false;
+  }
+  VkCheck(vk_device.bindBufferMemory(_staging_buffer, _staging_ring->GetMemory(), 0),
+          "Failed to bind staging buffer memory.");
+
+  _command_pool = VkCheckAndUnwrap(
+      vk_device.createCommandPool(vk::CommandPoolCreateInfo{
+          .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient,
+          .queueFamilyIndex = device.GetQueueFamilyIndex(core::QueueType::Transfer)}),
+      "Failed to create upload command pool.");
+
+  RENDY_LOG_INFO("Created {} byte staging ring", _config.staging_size);
+  return true;
+}
+
+void UploadContext::Destroy() {
+  if (_device == nullptr) {
+    return;
+  }
+  const std::scoped_lock lock(_mutex);
+  const auto vk_device = _device->Get();
+
+  while (!_in_flight.empty()) {
+    retireLocked(true);
+  }
+  _free_submissions.clear();
+
+  vk_device.destroyCommandPool(_command_pool);
+  vk_device.destroyBuffer(_staging_buffer);
+  _device->GetAllocator().DestroyPool(_staging_ring->GetMemory());
+  _staging_ring.reset();
+  _device = nullptr;
+}
+
+void UploadContext::Enqueue(vk::Buffer dst, vk::DeviceSize dst_offset, std::span<const std::byte> data) {
+  const std::scoped_lock lock(_mutex);
+  const auto max_chunk = _config.staging_size / 2;
+
+  while (!data.empty()) {
+    const auto chunk_size = std::min<vk::DeviceSize>(data.size(), max_chunk);
+    const auto staging = _staging_ring->Allocate(chunk_size, kStagingAlignment);
+    if (!staging.has_value()) {
+      // Ring is full: submit what is queued and wait for the oldest batch to give its space back
+      if (!_pending_copies.empty()) {
+        (void)flushLocked();
+      }
+      if (_in_flight.empty()) {
+        throw std::runtime_error("Staging ring exhausted with no uploads in flight.");
+      }
+      retireLocked(true);
+      continue;
+    }
+
+    std::memcpy(staging->mapped, data.data(), chunk_size);
+    _device->GetAllocator().Flush(staging.value(), 0, chunk_size);
+    _pending_copies[dst].push_back(
+        vk::BufferCopy{.srcOffset = staging->offset, .dstOffset = dst_offset, .size = chunk_size});
+
+    data = data.subspan(chunk_size);
+    dst_offset += chunk_size;
+  }
+}
+
+auto UploadContext::Flush() -> uint64_t {
+  const std::scoped_lock lock(_mutex);
+  retireLocked(false);
+  return flushLocked();
+}
+
+void UploadContext::Poll() {
+  const std::scoped_lock lock(_mutex);
+  retireLocked(false);
+}
+
+void UploadContext::WaitForSubmission(uint64_t timeline_value) {
+  _device->GetTimeline(core::QueueType::Transfer).Wait(timeline_value);
+  Poll();
+}
+
+auto UploadContext::IsComplete(uint64_t timeline_value) -> bool {
+  return _device->GetTimeline(core::QueueType::Transfer).IsComplete(timeline_value);
+}
+
+auto UploadContext::flushLocked() -> uint64_t {
+  if (_pending_copies.empty()) {
+    return _last_submitted_value;
+  }
+
+  auto submission = acquireSubmission();
+  const auto command_buffer = submission.command_buffer;
+  VkCheck(command_buffer.begin(vk::CommandBufferBeginInfo{.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit}),
+          "Failed to begin upload command buffer.");
+
+  size_t region_count = 0;
+  for (const auto &[dst, regions] : _pending_copies) {
+    for (const auto &batch : splitIntoCopyBatches(regions)) {
+      command_buffer.copyBuffer(_staging_buffer, vk::Buffer{dst}, batch);
+    }
+    region_count += regions.size();
+  }
+  VkCheck(command_buffer.end(), "Failed to end upload command buffer.");
+
+  const vk::CommandBufferSubmitInfo command_buffer_info{.commandBuffer = command_buffer};
+  const vk::SubmitInfo2 submit_info{.commandBufferInfoCount = 1, .pCommandBufferInfos = &command_buffer_info};
+  submission.timeline_value = _device->Submit(core::QueueType::Transfer, std::span(&submit_info, 1));
+
+  RENDY_LOG_TRACE("Submitted {} upload regions into {} buffers", region_count, _pending_copies.size());
+  _staging_ring->EndFrame(submission.timeline_value);
+  _pending_copies.clear();
+  _in_flight.push_back(submission);
+  _last_submitted_value = submission.timeline_value;
+  return submission.timeline_value;
+}
+
+void UploadContext::retireLocked(bool wait_for_oldest) {
+  if (_in_flight.empty()) {
+    return;
+  }
+  const auto &timeline = _device->GetTimeline(core::QueueType::Transfer);
+  if (wait_for_oldest) {
+    timeline.Wait(_in_flight.front().timeline_value);
+  }
+
+  const auto completed = timeline.GetCompletedValue();
+  while (!_in_flight.empty() && _in_flight.front().timeline_value <= completed) {
+    _free_submissions.push_back(_in_flight.front());
+    _in_flight.pop_front();
+  }
+  _staging_ring->ReleaseFrames(completed);
+}
+
+auto UploadContext::acquireSubmission() -> Submission {
+  const auto vk_device = _device->Get();
+  Submission submission{};
+
+  if (!_free_submissions.empty()) {
+    submission = _free_submissions.back();
+    _free_submissions.pop_back();
+    VkCheck(submission.command_buffer.reset(), "Failed to reset upload command buffer.");
+  } else {
+    submission.command_buffer =
+        VkCheckAndUnwrap(vk_device.allocateCommandBuffers(vk::CommandBufferAllocateInfo{
+                             .commandPool = _command_pool, .level = vk::CommandBufferLevel::ePrimary,
+                             .commandBufferCount = 1}),
+                         "Failed to allocate upload command buffer.")
+            .front();
+  }
+  return submission;
+}
+
+} // namespace rendy::graphics::vulkan
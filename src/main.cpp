@@ -1,11 +1,17 @@
+#include "common/log.hpp"
 #include "vulkan/renderer.hpp"
 #include <GLFW/glfw3.h>
-#include <spdlog/fmt/ranges.h>
-#include <spdlog/spdlog.h>
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
 #include <vulkan/vulkan.hpp>
 
 constexpr int kWidth = 800;
 constexpr int kHeight = 600;
+// Frames presented by --headless-surface; the surface is resized halfway to exercise swapchain recreation
+constexpr uint32_t kHeadlessSurfaceFrames = 240;
 
 static void KeyCallback(GLFWwindow *window, int key, [[maybe_unused]] int scancode, int action,
                         [[maybe_unused]] int mods) {
@@ -14,14 +20,116 @@ static void KeyCallback(GLFWwindow *window, int key, [[maybe_unused]] int scanco
   }
 }
 
-auto main() -> int {
-  spdlog::set_level(spdlog::level::level_enum::trace);
-  spdlog::info("Starting Rendy...");
+static void WriteStartupReport(const rendy::graphics::vulkan::Renderer &renderer,
+                               const std::optional<std::filesystem::path> &path) {
+  if (path.has_value() && !renderer.GetStartupTimer().WriteJson(path.value())) {
+    RENDY_LOG_WARN("Startup report was not written");
+  }
+}
+
+static auto RunHeadless(const std::optional<std::filesystem::path> &startup_report_path) -> int {
+  auto renderer = rendy::graphics::vulkan::Renderer();
+  renderer.InitializeHeadless(vk::Extent2D{kWidth, kHeight});
+
+  auto *target = renderer.GetOffscreenTarget();
+  target->Clear({0.1F, 0.2F, 0.3F, 1.0F});
+  const auto pixels = target->Readback();
+  RENDY_LOG_INFO("Read back {} bytes from the offscreen target", pixels.size());
+  WriteStartupReport(renderer, startup_report_path);
+
+  renderer.Destroy();
+
+  RENDY_LOG_INFO("Rendy Shutting Down...");
+  return 0;
+}
+
+static auto RunHeadlessSurface(const rendy::graphics::vulkan::SwapchainConfig &swapchain_config,
+                               const std::optional<std::filesystem::path> &startup_report_path) -> int {
+  auto renderer = rendy::graphics::vulkan::Renderer();
+  renderer.InitializeHeadlessSurface(vk::Extent2D{kWidth, kHeight}, {}, swapchain_config);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < kHeadlessSurfaceFrames; ++frame) {
+    if (frame == kHeadlessSurfaceFrames / 2) {
+      renderer.Resize(vk::Extent2D{kWidth / 2, kHeight / 2});
+    }
+    renderer.BeginFrame();
+    renderer.EndFrame();
+  }
+  const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+  const auto &swapchain = *renderer.GetSwapchain();
+  RENDY_LOG_INFO("Presented {} frames in {:.1f} ms ({}, {} recreations)", kHeadlessSurfaceFrames, elapsed.count(),
+                 vk::to_string(swapchain.GetPresentMode()), swapchain.GetRecreateCount());
+  WriteStartupReport(renderer, startup_report_path);
+
+  renderer.Destroy();
+
+  RENDY_LOG_INFO("Rendy Shutting Down...");
+  return 0;
+}
+
+static auto ParsePresentMode(std::string_view name) -> std::optional<rendy::graphics::vulkan::PresentMode> {
+  using rendy::graphics::vulkan::PresentMode;
+  if (name == "fifo") {
+    return PresentMode::Fifo;
+  }
+  if (name == "fifo-relaxed") {
+    return PresentMode::FifoRelaxed;
+  }
+  if (name == "mailbox") {
+    return PresentMode::Mailbox;
+  }
+  if (name == "immediate") {
+    return PresentMode::Immediate;
+  }
+  return std::nullopt;
+}
+
+auto main(int argc, char **argv) -> int {
+  // Trace and debug messages are compiled out of release builds
+  const rendy::common::LoggingScope logging;
+  RENDY_LOG_INFO("Starting Rendy...");
+
+  const auto args = std::span(argv, static_cast<size_t>(argc));
+  std::optional<std::filesystem::path> trace_path;
+  std::optional<std::filesystem::path> startup_report_path;
+  rendy::graphics::vulkan::SwapchainConfig swapchain_config;
+  bool headless = false;
+  bool headless_surface = false;
+  for (size_t i = 1; i < args.size(); ++i) {
+    const std::string_view arg = args[i];
+    if (arg == "--headless") {
+      headless = true;
+    } else if (arg == "--headless-surface") {
+      headless_surface = true;
+    } else if (arg == "--trace" && i + 1 < args.size()) {
+      // Writes CPU and GPU zones of the last frames as a Chrome trace on exit
+      trace_path = args[++i];
+    } else if (arg == "--startup-report" && i + 1 < args.size()) {
+      // Writes the duration of each startup phase as JSON once the first frame is done
+      startup_report_path = args[++i];
+    } else if (arg == "--present-mode" && i + 1 < args.size()) {
+      const std::string_view name = args[++i];
+      if (const auto mode = ParsePresentMode(name); mode.has_value()) {
+        swapchain_config.present_mode = mode.value();
+      } else {
+        RENDY_LOG_WARN("Unknown present mode {}, expected fifo, fifo-relaxed, mailbox or immediate", name);
+      }
+    } else if (arg == "--low-latency") {
+      swapchain_config.low_latency = true;
+    }
+  }
+  if (headless) {
+    return RunHeadless(startup_report_path);
+  }
+  if (headless_surface) {
+    return RunHeadlessSurface(swapchain_config, startup_report_path);
+  }
 
   if (glfwInit() == GLFW_FALSE) {
     const char *error{};
     glfwGetError(&error);
-    spdlog::error("GLFW could not initialize! GLFW Error: {}", error);
+    RENDY_LOG_ERROR("GLFW could not initialize! GLFW Error: {}", error);
     return 1;
   }
 
@@ -30,24 +138,38 @@ auto main() -> int {
   if (glfw_window == nullptr) {
     const char *error{};
     glfwGetError(&error);
-    spdlog::error("Window could not be created! GLFW Error: {}", error);
+    RENDY_LOG_ERROR("Window could not be created! GLFW Error: {}", error);
     return 1;
   }
   glfwSetKeyCallback(glfw_window, KeyCallback);
 
   auto renderer = rendy::graphics::vulkan::Renderer();
-  renderer.Initialize(*glfw_window);
+  renderer.Initialize(*glfw_window, {}, swapchain_config);
 
-  bool quit_app = false;
   while (glfwWindowShouldClose(glfw_window) == GLFW_FALSE) {
+    // Presentation paces the loop. In low latency mode this waits for earlier presents first, so the input polled
+    // next is as fresh as possible when the frame starts.
+    renderer.WaitForLatency();
     glfwPollEvents();
+    // A minimized window has nothing to draw, so block on window events instead of spinning a core
+    if (glfwGetWindowAttrib(glfw_window, GLFW_ICONIFIED) == GLFW_TRUE) {
+      glfwWaitEvents();
+      continue;
+    }
+    renderer.BeginFrame();
+    renderer.EndFrame();
   }
+  WriteStartupReport(renderer, startup_report_path);
 
+  if (trace_path.has_value() && !renderer.GetGpuProfiler().ExportChromeTrace(trace_path.value())) {
+    RENDY_LOG_WARN("Profiling trace was not written");
+  }
   renderer.Destroy();
 
   glfwDestroyWindow(glfw_window);
   glfwTerminate();
 
-  spdlog::info("Rendy Shutting Down...");
+  RENDY_LOG_INFO("Rendy Shutting Down...");
   return 0;
 }
+
@@ -0,0 +1,91 @@
+// Offline mesh cooker: imports a glTF or OBJ file and writes the .rmesh format the runtime maps and uploads as is
+//   mesh_cooker <input.gltf|input.glb|input.obj> <output.rmesh> [--lods N] [--error fraction]
+// --lods caps the number of LODs including the full detail one, --error caps the simplification error as a fraction
+// of the mesh extent.
+#include "mesh_cooker.hpp"
+#include "source_mesh.hpp"
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace rendy::tools;
+
+struct CookerArgs {
+  std::filesystem::path input;
+  std::filesystem::path output;
+  CookOptions options;
+};
+
+// The whole argument has to be a number
+template <typename T> auto parseNumber(std::string_view text, T &value) -> bool {
+  const auto *end = text.data() + text.size();
+  const auto [last, error] = std::from_chars(text.data(), end, value);
+  return error == std::errc{} && last == end;
+}
+
+auto parseArgs(std::span<char *> args) -> std::optional<CookerArgs> {
+  CookerArgs parsed;
+  std::vector<std::filesystem::path> paths;
+  for (size_t i = 1; i < args.size(); ++i) {
+    const std::string_view arg = args[i];
+    if (arg == "--lods" || arg == "--error") {
+      if (i + 1 == args.size()) {
+        return std::nullopt;
+      }
+      const std::string_view value = args[++i];
+      const bool valid = arg == "--lods" ? parseNumber(value, parsed.options.lod_count)
+                                         : parseNumber(value, parsed.options.max_error);
+      if (!valid) {
+        return std::nullopt;
+      }
+    } else {
+      paths.emplace_back(arg);
+    }
+  }
+  if (paths.size() != 2) {
+    return std::nullopt;
+  }
+  parsed.input = paths[0];
+  parsed.output = paths[1];
+  return parsed;
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+  const auto args = parseArgs(std::span(argv, static_cast<size_t>(argc)));
+  if (!args) {
+    spdlog::error("Usage: mesh_cooker <input.gltf|input.glb|input.obj> <output.rmesh> [--lods N] [--error fraction]");
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  auto source = LoadSourceMesh(args->input);
+  if (!source) {
+    return 1;
+  }
+  const auto source_triangles = source->indices.size() / 3;
+  auto cooked = CookMesh(std::move(*source), args->options);
+  if (!WriteMeshFile(cooked, args->output)) {
+    return 1;
+  }
+
+  const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  spdlog::info("Cooked {} into {} in {:.1f} ms: {} triangles, {} vertices, {} LODs, {} meshlets",
+               args->input.string(), args->output.string(), elapsed, source_triangles, cooked.header.vertex_count,
+               cooked.header.lod_count, cooked.header.meshlet_count);
+  for (size_t i = 0; i < cooked.lods.size(); ++i) {
+    const auto &lod = cooked.lods.at(i);
+    spdlog::info("  LOD {}: {} triangles, {} meshlets, error {:.4g}", i, lod.index_count / 3, lod.meshlet_count,
+                 lod.error);
+  }
+  return 0;
+}
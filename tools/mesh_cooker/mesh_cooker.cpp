@@ -0,0 +1,285 @@
+#include "mesh_cooker.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <meshoptimizer.h>
+#include <span>
+#include <spdlog/spdlog.h>
+
+namespace rendy::tools {
+
+namespace {
+
+using namespace graphics::core;
+
+constexpr float kMeshletConeWeight = 0.25F;
+// A LOD has to drop at least this fraction of the previous level's triangles to be worth keeping
+constexpr float kMinLodReduction = 0.1F;
+
+// Collapses vertices that are identical in every attribute and drops the ones no triangle uses
+void weld(SourceMesh &mesh) {
+  std::vector<uint32_t> remap(mesh.vertices.size());
+  const auto vertex_count = meshopt_generateVertexRemap(remap.data(), mesh.indices.data(), mesh.indices.size(),
+                                                        mesh.vertices.data(), mesh.vertices.size(),
+                                                        sizeof(SourceVertex));
+  std::vector<SourceVertex> vertices(vertex_count);
+  meshopt_remapVertexBuffer(vertices.data(), mesh.vertices.data(), mesh.vertices.size(), sizeof(SourceVertex),
+                            remap.data());
+  meshopt_remapIndexBuffer(mesh.indices.data(), mesh.indices.data(), mesh.indices.size(), remap.data());
+  mesh.vertices = std::move(vertices);
+}
+
+// Area weighted smooth normals. Accumulating per position rather than per vertex keeps UV seams from showing up as
+// shading seams.
+void generateNormals(SourceMesh &mesh) {
+  std::vector<uint32_t> position_remap(mesh.vertices.size());
+  meshopt_generateShadowIndexBuffer(position_remap.data(), mesh.indices.data(), mesh.indices.size(),
+                                    mesh.vertices.data(), mesh.vertices.size(), sizeof(float) * 3,
+                                    sizeof(SourceVertex));
+
+  std::vector<std::array<float, 3>> normals(mesh.vertices.size());
+  for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    const auto &p0 = mesh.vertices.at(mesh.indices.at(i)).position;
+    const auto &p1 = mesh.vertices.at(mesh.indices.at(i + 1)).position;
+    const auto &p2 = mesh.vertices.at(mesh.indices.at(i + 2)).position;
+    const std::array<float, 3> e0{p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    const std::array<float, 3> e1{p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    const std::array<float, 3> normal{(e0[1] * e1[2]) - (e0[2] * e1[1]), (e0[2] * e1[0]) - (e0[0] * e1[2]),
+                                      (e0[0] * e1[1]) - (e0[1] * e1[0])};
+    for (size_t corner = 0; corner < 3; ++corner) {
+      auto &accumulated = normals.at(position_remap.at(i + corner));
+      for (size_t axis = 0; axis < 3; ++axis) {
+        accumulated.at(axis) += normal.at(axis);
+      }
+    }
+  }
+  // The shadow index buffer maps every vertex sharing a position onto the same representative
+  std::vector<uint32_t> representative(mesh.vertices.size());
+  for (size_t i = 0; i < mesh.indices.size(); ++i) {
+    representative.at(mesh.indices.at(i)) = position_remap.at(i);
+  }
+  for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+    const auto &normal = normals.at(representative.at(i));
+    const auto length = std::sqrt((normal[0] * normal[0]) + (normal[1] * normal[1]) + (normal[2] * normal[2]));
+    mesh.vertices.at(i).normal = length > 0.0F ? std::array{normal[0] / length, normal[1] / length, normal[2] / length}
+                                               : std::array{0.0F, 0.0F, 1.0F};
+  }
+}
+
+struct Lod {
+  std::vector<uint32_t> indices;
+  float error{0.0F}; // In object space
+};
+
+// Each level targets half the triangles of the one before and is simplified from the full detail mesh, so its error
+// is measured against the original surface
+auto buildLods(const SourceMesh &mesh, const CookOptions &options) -> std::vector<Lod> {
+  const auto *positions = mesh.vertices.front().position.data();
+  // The simplifier reports errors relative to the mesh extent
+  const auto error_scale = meshopt_simplifyScale(positions, mesh.vertices.size(), sizeof(SourceVertex));
+
+  std::vector<Lod> lods{Lod{.indices = mesh.indices}};
+  const auto lod_count = std::clamp(options.lod_count, 1U, kMeshMaxLods);
+  while (lods.size() < lod_count) {
+    const auto previous_count = lods.back().indices.size();
+    Lod lod{.indices = std::vector<uint32_t>(mesh.indices.size())};
+    lod.indices.resize(meshopt_simplify(lod.indices.data(), mesh.indices.data(), mesh.indices.size(), positions,
+                                        mesh.vertices.size(), sizeof(SourceVertex), (previous_count / 6) * 3,
+                                        options.max_error, 0, &lod.error));
+    const auto kept = static_cast<float>(lod.indices.size()) / static_cast<float>(previous_count);
+    if (lod.indices.empty() || kept > 1.0F - kMinLodReduction) {
+      break;
+    }
+    meshopt_optimizeVertexCache(lod.indices.data(), lod.indices.data(), lod.indices.size(), mesh.vertices.size());
+    lod.error *= error_scale;
+    lods.push_back(std::move(lod));
+  }
+  return lods;
+}
+
+// Octahedral mapping onto [-1, 1]^2, folding the lower hemisphere over the diagonals
+auto encodeOctahedral(const std::array<float, 3> &normal) -> std::array<int16_t, 2> {
+  const auto sum = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+  auto x = sum > 0.0F ? normal[0] / sum : 0.0F;
+  auto y = sum > 0.0F ? normal[1] / sum : 0.0F;
+  if (normal[2] < 0.0F) {
+    const auto folded_x = (1.0F - std::abs(y)) * (x >= 0.0F ? 1.0F : -1.0F);
+    const auto folded_y = (1.0F - std::abs(x)) * (y >= 0.0F ? 1.0F : -1.0F);
+    x = folded_x;
+    y = folded_y;
+  }
+  return {static_cast<int16_t>(meshopt_quantizeSnorm(x, 16)), static_cast<int16_t>(meshopt_quantizeSnorm(y, 16))};
+}
+
+void quantizeVertices(std::span<const SourceVertex> vertices, CookedMesh &cooked) {
+  std::array<float, 3> min{};
+  std::array<float, 3> max{};
+  min.fill(std::numeric_limits<float>::max());
+  max.fill(std::numeric_limits<float>::lowest());
+  for (const auto &vertex : vertices) {
+    for (size_t axis = 0; axis < 3; ++axis) {
+      min.at(axis) = std::min(min.at(axis), vertex.position.at(axis));
+      max.at(axis) = std::max(max.at(axis), vertex.position.at(axis));
+    }
+  }
+
+  auto &header = cooked.header;
+  constexpr auto kUnormMax = static_cast<float>(std::numeric_limits<uint16_t>::max());
+  for (size_t axis = 0; axis < 3; ++axis) {
+    header.position_offset.at(axis) = min.at(axis);
+    header.position_scale.at(axis) = (max.at(axis) - min.at(axis)) / kUnormMax;
+    header.bounds_center.at(axis) = (min.at(axis) + max.at(axis)) * 0.5F;
+  }
+
+  cooked.positions.reserve(vertices.size());
+  cooked.attributes.reserve(vertices.size());
+  for (const auto &vertex : vertices) {
+    MeshPosition position{};
+    float distance = 0.0F;
+    for (size_t axis = 0; axis < 3; ++axis) {
+      const auto extent = max.at(axis) - min.at(axis);
+      const auto normalized = extent > 0.0F ? (vertex.position.at(axis) - min.at(axis)) / extent : 0.0F;
+      position.value.at(axis) = static_cast<uint16_t>(meshopt_quantizeUnorm(normalized, 16));
+      const auto delta = vertex.position.at(axis) - header.bounds_center.at(axis);
+      distance += delta * delta;
+    }
+    header.bounds_radius = std::max(header.bounds_radius, std::sqrt(distance));
+    cooked.positions.push_back(position);
+    cooked.attributes.push_back(MeshAttributes{
+        .normal = encodeOctahedral(vertex.normal),
+        .uv = {meshopt_quantizeHalf(vertex.uv[0]), meshopt_quantizeHalf(vertex.uv[1])},
+    });
+  }
+}
+
+void buildMeshlets(std::span<const SourceVertex> vertices, std::span<const uint32_t> indices, MeshLod &lod,
+                   CookedMesh &cooked) {
+  const auto *positions = vertices.front().position.data();
+  const auto max_meshlets = meshopt_buildMeshletsBound(indices.size(), kMeshletMaxVertices, kMeshletMaxTriangles);
+  std::vector<meshopt_Meshlet> meshlets(max_meshlets);
+  std::vector<uint32_t> meshlet_vertices(max_meshlets * kMeshletMaxVertices);
+  std::vector<uint8_t> meshlet_triangles(max_meshlets * kMeshletMaxTriangles * 3);
+  meshlets.resize(meshopt_buildMeshlets(meshlets.data(), meshlet_vertices.data(), meshlet_triangles.data(),
+                                        indices.data(), indices.size(), positions, vertices.size(),
+                                        sizeof(SourceVertex), kMeshletMaxVertices, kMeshletMaxTriangles,
+                                        kMeshletConeWeight));
+
+  lod.meshlet_offset = static_cast<uint32_t>(cooked.meshlets.size());
+  lod.meshlet_count = static_cast<uint32_t>(meshlets.size());
+  const auto vertex_base = static_cast<uint32_t>(cooked.meshlet_vertices.size());
+  const auto triangle_base = static_cast<uint32_t>(cooked.meshlet_triangles.size());
+  for (const auto &meshlet : meshlets) {
+    meshopt_optimizeMeshlet(&meshlet_vertices.at(meshlet.vertex_offset), &meshlet_triangles.at(meshlet.triangle_offset),
+                            meshlet.triangle_count, meshlet.vertex_count);
+    const auto bounds = meshopt_computeMeshletBounds(&meshlet_vertices.at(meshlet.vertex_offset),
+                                                     &meshlet_triangles.at(meshlet.triangle_offset),
+                                                     meshlet.triangle_count, positions, vertices.size(),
+                                                     sizeof(SourceVertex));
+    cooked.meshlets.push_back(MeshletDesc{.vertex_offset = vertex_base + meshlet.vertex_offset,
+                                          .triangle_offset = triangle_base + meshlet.triangle_offset,
+                                          .vertex_count = meshlet.vertex_count,
+                                          .triangle_count = meshlet.triangle_count});
+    cooked.meshlet_bounds.push_back(MeshletBounds{
+        .center = {bounds.center[0], bounds.center[1], bounds.center[2]},
+        .radius = bounds.radius,
+        .cone_axis = {bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]},
+        .cone_cutoff = bounds.cone_cutoff,
+    });
+  }
+  // meshopt_buildMeshlets pads every meshlet's triangles to 4 bytes, the trimmed size keeps that padding
+  if (!meshlets.empty()) {
+    const auto &last = meshlets.back();
+    meshlet_vertices.resize(last.vertex_offset + last.vertex_count);
+    meshlet_triangles.resize(last.triangle_offset + ((last.triangle_count * 3 + 3) & ~3U));
+  }
+  cooked.meshlet_vertices.insert(cooked.meshlet_vertices.end(), meshlet_vertices.begin(), meshlet_vertices.end());
+  cooked.meshlet_triangles.insert(cooked.meshlet_triangles.end(), meshlet_triangles.begin(), meshlet_triangles.end());
+}
+
+auto alignSection(uint64_t offset) -> uint64_t {
+  return (offset + kMeshSectionAlignment - 1) & ~(kMeshSectionAlignment - 1);
+}
+
+} // namespace
+
+auto CookMesh(SourceMesh source, const CookOptions &options) -> CookedMesh {
+  weld(source);
+  if (!source.has_normals) {
+    generateNormals(source);
+  }
+  meshopt_optimizeVertexCache(source.indices.data(), source.indices.data(), source.indices.size(),
+                              source.vertices.size());
+  auto lods = buildLods(source, options);
+
+  // One vertex buffer serves every LOD, ordered by first use across all of them
+  std::vector<uint32_t> all_indices;
+  for (const auto &lod : lods) {
+    all_indices.insert(all_indices.end(), lod.indices.begin(), lod.indices.end());
+  }
+  std::vector<uint32_t> remap(source.vertices.size());
+  const auto vertex_count =
+      meshopt_optimizeVertexFetchRemap(remap.data(), all_indices.data(), all_indices.size(), source.vertices.size());
+  std::vector<SourceVertex> vertices(vertex_count);
+  meshopt_remapVertexBuffer(vertices.data(), source.vertices.data(), source.vertices.size(), sizeof(SourceVertex),
+                            remap.data());
+
+  CookedMesh cooked;
+  for (auto &[indices, error] : lods) {
+    meshopt_remapIndexBuffer(indices.data(), indices.data(), indices.size(), remap.data());
+    MeshLod lod{.index_offset = static_cast<uint32_t>(cooked.indices.size()),
+                .index_count = static_cast<uint32_t>(indices.size()),
+                .meshlet_offset = 0,
+                .meshlet_count = 0,
+                .error = error,
+                .padding = 0};
+    buildMeshlets(vertices, indices, lod, cooked);
+    cooked.indices.insert(cooked.indices.end(), indices.begin(), indices.end());
+    cooked.lods.push_back(lod);
+  }
+  quantizeVertices(vertices, cooked);
+
+  auto &header = cooked.header;
+  header.magic = kMeshFileMagic;
+  header.version = kMeshFileVersion;
+  header.vertex_count = static_cast<uint32_t>(vertices.size());
+  header.lod_count = static_cast<uint32_t>(cooked.lods.size());
+  header.meshlet_count = static_cast<uint32_t>(cooked.meshlets.size());
+  return cooked;
+}
+
+auto WriteMeshFile(CookedMesh &mesh, const std::filesystem::path &path) -> bool {
+  const std::array<std::span<const std::byte>, static_cast<size_t>(MeshSection::Count)> sections{
+      std::as_bytes(std::span(mesh.positions)),      std::as_bytes(std::span(mesh.attributes)),
+      std::as_bytes(std::span(mesh.indices)),        std::as_bytes(std::span(mesh.lods)),
+      std::as_bytes(std::span(mesh.meshlets)),       std::as_bytes(std::span(mesh.meshlet_bounds)),
+      std::as_bytes(std::span(mesh.meshlet_vertices)), std::as_bytes(std::span(mesh.meshlet_triangles)),
+  };
+  uint64_t offset = alignSection(sizeof(MeshFileHeader));
+  for (size_t i = 0; i < sections.size(); ++i) {
+    mesh.header.sections.at(i) = MeshFileSection{.offset = offset, .size = sections.at(i).size()};
+    offset = alignSection(offset + sections.at(i).size());
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  const auto write = [&](std::span<const std::byte> bytes) {
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  };
+  const auto pad = [&] {
+    const std::array<char, kMeshSectionAlignment> zeros{};
+    const auto position = static_cast<uint64_t>(file.tellp());
+    file.write(zeros.data(), static_cast<std::streamsize>(alignSection(position) - position));
+  };
+  write(std::as_bytes(std::span(&mesh.header, 1)));
+  for (const auto &section : sections) {
+    pad();
+    write(section);
+  }
+  if (!file) {
+    spdlog::error("Failed to write {}", path.string());
+    return false;
+  }
+  return true;
+}
+
+} // namespace rendy::tools
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "core/mesh_format.hpp"
+#include "source_mesh.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace rendy::tools {
+
+struct CookOptions {
+  uint32_t lod_count{graphics::core::kMeshMaxLods};
+  // Largest simplification error as a fraction of the mesh extent; LOD generation stops once a level would exceed it
+  float max_error{0.05F};
+};
+
+// Every section of a .rmesh file, ready to be written as is
+struct CookedMesh {
+  graphics::core::MeshFileHeader header{};
+  std::vector<graphics::core::MeshPosition> positions;
+  std::vector<graphics::core::MeshAttributes> attributes;
+  std::vector<uint32_t> indices;
+  std::vector<graphics::core::MeshLod> lods;
+  std::vector<graphics::core::MeshletDesc> meshlets;
+  std::vector<graphics::core::MeshletBounds> meshlet_bounds;
+  std::vector<uint32_t> meshlet_vertices;
+  std::vector<uint8_t> meshlet_triangles;
+};
+
+// Welds duplicate vertices, generates missing normals, optimizes for the post-transform cache and vertex fetch,
+// simplifies into LODs, splits every LOD into meshlets and quantizes the vertex streams
+[[nodiscard]] auto CookMesh(SourceMesh source, const CookOptions &options) -> CookedMesh;
+// Fills in the header's section table and writes the file
+[[nodiscard]] auto WriteMeshFile(CookedMesh &mesh, const std::filesystem::path &path) -> bool;
+
+} // namespace rendy::tools
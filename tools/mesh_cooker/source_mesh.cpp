@@ -0,0 +1,210 @@
+#include "source_mesh.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cgltf.h>
+#include <cmath>
+#include <memory>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <tiny_obj_loader.h>
+
+namespace rendy::tools {
+
+namespace {
+
+using Matrix3 = std::array<std::array<float, 3>, 3>;
+
+auto transformPoint(const std::array<float, 16> &matrix, const std::array<float, 3> &point) -> std::array<float, 3> {
+  // cgltf matrices are column major
+  std::array<float, 3> result{};
+  for (size_t row = 0; row < 3; ++row) {
+    result.at(row) = (matrix.at(row) * point[0]) + (matrix.at(4 + row) * point[1]) + (matrix.at(8 + row) * point[2]) +
+                     matrix.at(12 + row);
+  }
+  return result;
+}
+
+// Cofactor matrix of the upper 3x3, which transforms normals correctly under non-uniform scale without an inverse
+auto normalMatrix(const std::array<float, 16> &matrix) -> Matrix3 {
+  const auto m = [&](size_t row, size_t column) { return matrix.at((column * 4) + row); };
+  Matrix3 result{};
+  for (size_t row = 0; row < 3; ++row) {
+    for (size_t column = 0; column < 3; ++column) {
+      const auto r0 = (row + 1) % 3;
+      const auto r1 = (row + 2) % 3;
+      const auto c0 = (column + 1) % 3;
+      const auto c1 = (column + 2) % 3;
+      result.at(row).at(column) = (m(r0, c0) * m(r1, c1)) - (m(r0, c1) * m(r1, c0));
+    }
+  }
+  return result;
+}
+
+auto transformNormal(const Matrix3 &matrix, const std::array<float, 3> &normal) -> std::array<float, 3> {
+  std::array<float, 3> result{};
+  for (size_t row = 0; row < 3; ++row) {
+    result.at(row) =
+        (matrix.at(row)[0] * normal[0]) + (matrix.at(row)[1] * normal[1]) + (matrix.at(row)[2] * normal[2]);
+  }
+  const auto length = std::sqrt((result[0] * result[0]) + (result[1] * result[1]) + (result[2] * result[2]));
+  if (length > 0.0F) {
+    for (auto &value : result) {
+      value /= length;
+    }
+  }
+  return result;
+}
+
+auto findAttribute(const cgltf_primitive &primitive, cgltf_attribute_type type, cgltf_int index = 0)
+    -> const cgltf_accessor * {
+  for (cgltf_size i = 0; i < primitive.attributes_count; ++i) {
+    const auto &attribute = primitive.attributes[i];
+    if (attribute.type == type && attribute.index == index) {
+      return attribute.data;
+    }
+  }
+  return nullptr;
+}
+
+void appendPrimitive(const cgltf_primitive &primitive, const std::array<float, 16> &transform, SourceMesh &mesh) {
+  const auto *positions = findAttribute(primitive, cgltf_attribute_type_position);
+  if (primitive.type != cgltf_primitive_type_triangles || positions == nullptr) {
+    return;
+  }
+  const auto *normals = findAttribute(primitive, cgltf_attribute_type_normal);
+  const auto *uvs = findAttribute(primitive, cgltf_attribute_type_texcoord);
+  mesh.has_normals = mesh.has_normals && normals != nullptr;
+
+  const auto normal_matrix = normalMatrix(transform);
+  const auto &m = normal_matrix;
+  const auto determinant = (m[0][0] * transform[0]) + (m[0][1] * transform[4]) + (m[0][2] * transform[8]);
+  const auto base = static_cast<uint32_t>(mesh.vertices.size());
+  for (cgltf_size i = 0; i < positions->count; ++i) {
+    SourceVertex vertex;
+    cgltf_accessor_read_float(positions, i, vertex.position.data(), 3);
+    vertex.position = transformPoint(transform, vertex.position);
+    if (normals != nullptr) {
+      cgltf_accessor_read_float(normals, i, vertex.normal.data(), 3);
+      vertex.normal = transformNormal(normal_matrix, vertex.normal);
+      if (determinant < 0.0F) {
+        for (auto &value : vertex.normal) {
+          value = -value;
+        }
+      }
+    }
+    if (uvs != nullptr) {
+      cgltf_accessor_read_float(uvs, i, vertex.uv.data(), 2);
+    }
+    mesh.vertices.push_back(vertex);
+  }
+
+  const auto index_count = primitive.indices != nullptr ? primitive.indices->count : positions->count;
+  for (cgltf_size i = 0; i + 2 < index_count; i += 3) {
+    std::array<uint32_t, 3> triangle{};
+    for (size_t corner = 0; corner < 3; ++corner) {
+      const auto index = i + corner;
+      const auto vertex = primitive.indices != nullptr ? cgltf_accessor_read_index(primitive.indices, index) : index;
+      triangle.at(corner) = base + static_cast<uint32_t>(vertex);
+    }
+    // A mirroring transform turns the triangles inside out
+    if (determinant < 0.0F) {
+      std::swap(triangle[1], triangle[2]);
+    }
+    mesh.indices.insert(mesh.indices.end(), triangle.begin(), triangle.end());
+  }
+}
+
+auto loadGltf(const std::filesystem::path &path) -> std::optional<SourceMesh> {
+  const auto path_string = path.string();
+  cgltf_options options{};
+  cgltf_data *raw_data = nullptr;
+  if (cgltf_parse_file(&options, path_string.c_str(), &raw_data) != cgltf_result_success) {
+    spdlog::error("Failed to parse {}", path_string);
+    return std::nullopt;
+  }
+  const std::unique_ptr<cgltf_data, decltype(&cgltf_free)> data(raw_data, &cgltf_free);
+  if (cgltf_load_buffers(&options, data.get(), path_string.c_str()) != cgltf_result_success ||
+      cgltf_validate(data.get()) != cgltf_result_success) {
+    spdlog::error("Failed to load the buffers of {}", path_string);
+    return std::nullopt;
+  }
+
+  SourceMesh mesh;
+  for (cgltf_size i = 0; i < data->nodes_count; ++i) {
+    const auto &node = data->nodes[i];
+    if (node.mesh == nullptr) {
+      continue;
+    }
+    std::array<float, 16> transform{};
+    cgltf_node_transform_world(&node, transform.data());
+    for (cgltf_size j = 0; j < node.mesh->primitives_count; ++j) {
+      appendPrimitive(node.mesh->primitives[j], transform, mesh);
+    }
+  }
+  return mesh;
+}
+
+auto loadObj(const std::filesystem::path &path) -> std::optional<SourceMesh> {
+  tinyobj::ObjReaderConfig config;
+  config.triangulate = true;
+  config.vertex_color = false;
+  tinyobj::ObjReader reader;
+  if (!reader.ParseFromFile(path.string(), config)) {
+    spdlog::error("Failed to parse {}: {}", path.string(), reader.Error());
+    return std::nullopt;
+  }
+  if (!reader.Warning().empty()) {
+    spdlog::warn("{}: {}", path.string(), reader.Warning());
+  }
+
+  // One vertex per corner; the cooker welds identical ones afterwards
+  const auto &attrib = reader.GetAttrib();
+  SourceMesh mesh;
+  for (const auto &shape : reader.GetShapes()) {
+    for (const auto &index : shape.mesh.indices) {
+      SourceVertex vertex;
+      for (size_t axis = 0; axis < 3; ++axis) {
+        vertex.position.at(axis) = attrib.vertices.at((3 * static_cast<size_t>(index.vertex_index)) + axis);
+      }
+      if (index.normal_index >= 0) {
+        for (size_t axis = 0; axis < 3; ++axis) {
+          vertex.normal.at(axis) = attrib.normals.at((3 * static_cast<size_t>(index.normal_index)) + axis);
+        }
+      } else {
+        mesh.has_normals = false;
+      }
+      if (index.texcoord_index >= 0) {
+        const auto uv = 2 * static_cast<size_t>(index.texcoord_index);
+        // OBJ puts the origin at the bottom left, Vulkan and glTF at the top left
+        vertex.uv = {attrib.texcoords.at(uv), 1.0F - attrib.texcoords.at(uv + 1)};
+      }
+      mesh.indices.push_back(static_cast<uint32_t>(mesh.vertices.size()));
+      mesh.vertices.push_back(vertex);
+    }
+  }
+  return mesh;
+}
+
+} // namespace
+
+auto LoadSourceMesh(const std::filesystem::path &path) -> std::optional<SourceMesh> {
+  auto extension = path.extension().string();
+  std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+
+  std::optional<SourceMesh> mesh;
+  if (extension == ".gltf" || extension == ".glb") {
+    mesh = loadGltf(path);
+  } else if (extension == ".obj") {
+    mesh = loadObj(path);
+  } else {
+    spdlog::error("Don't know how to import {}, expected .gltf, .glb or .obj", path.string());
+    return std::nullopt;
+  }
+  if (mesh && mesh->indices.empty()) {
+    spdlog::error("{} has no triangles", path.string());
+    return std::nullopt;
+  }
+  return mesh;
+}
+
+} // namespace rendy::tools
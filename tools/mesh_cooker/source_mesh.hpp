@@ -0,0 +1,29 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace rendy::tools {
+
+// Vertex as imported, before any optimization or quantization. Positions and normals are in the mesh's object
+// space with node transforms already applied.
+struct SourceVertex {
+  std::array<float, 3> position{};
+  std::array<float, 3> normal{};
+  std::array<float, 2> uv{};
+};
+
+struct SourceMesh {
+  std::vector<SourceVertex> vertices;
+  std::vector<uint32_t> indices; // Triangle list
+  bool has_normals{true};        // False when any part of the input came without normals
+};
+
+// Picks the importer from the extension: .gltf and .glb through cgltf, .obj through tinyobjloader. All meshes of the
+// file are merged into one.
+[[nodiscard]] auto LoadSourceMesh(const std::filesystem::path &path) -> std::optional<SourceMesh>;
+
+} // namespace rendy::tools